@@ -6,6 +6,7 @@ import android.content.Context
 import android.content.Intent
 import android.content.IntentFilter
 import android.hardware.usb.*
+import android.os.SystemClock
 import android.util.Log
 import kotlinx.coroutines.*
 import java.util.*
@@ -26,8 +27,9 @@ data class CardData(
     val track2: String?,
     val track3: String?,
     val deviceId: String,
-    val rawResponse: String,
-    val timestamp: Long
+    val rawResponse: String?,
+    val timestamp: Long,
+    val rawBytes: ByteArray? = null
 )
 
 class AndroidUsbDeviceManager(private val context: Context) {
@@ -42,6 +44,12 @@ class AndroidUsbDeviceManager(private val context: Context) {
             0x0004, // Magtek uDynamo
             0x0010  // Magtek SureSwipe Reader
         )
+
+        // Read cadence, and with idle power saving, how long a reader stays
+        // quiet before it is read at the slow idle cadence instead
+        private const val POLL_INTERVAL_MS = 50L
+        private const val IDLE_AFTER_MS = 10000L
+        private const val IDLE_POLL_INTERVAL_MS = 500L
     }
 
     private val usbManager: UsbManager = context.getSystemService(Context.USB_SERVICE) as UsbManager
@@ -52,9 +60,16 @@ class AndroidUsbDeviceManager(private val context: Context) {
     private var currentDeviceId: String? = null
 
     private val monitoringScope = CoroutineScope(Dispatchers.IO + SupervisorJob())
-    private var isMonitoring = false
+    private var monitoringJob: Job? = null
+    @Volatile private var isMonitoring = false
+
+    // Read a quiet reader at the slow idle cadence until it sends a report
+    @Volatile var idlePowerSaving: Boolean = false
 
     var cardSwipeCallback: ((CardData) -> Unit)? = null
+
+    // "off", "hex" or "binary": what CardData carries of the raw report
+    @Volatile var rawResponseMode: String = "hex"
     var deviceConnectionCallback: ((DeviceInfo) -> Unit)? = null
 
     private val usbPermissionReceiver = object : BroadcastReceiver() {
@@ -274,18 +289,21 @@ class AndroidUsbDeviceManager(private val context: Context) {
     }
 
     fun startMonitoring() {
-        if (isMonitoring) return
+        if (monitoringJob?.isActive == true) return
 
         isMonitoring = true
-        monitoringScope.launch {
+        monitoringJob = monitoringScope.launch {
             Log.d(TAG, "Started device monitoring")
-            
+
+            var lastReportTime = SystemClock.elapsedRealtime()
             while (isMonitoring && isActive) {
                 try {
-                    if (isConnected()) {
-                        readFromDevice()
+                    if (isConnected() && readFromDevice()) {
+                        lastReportTime = SystemClock.elapsedRealtime()
                     }
-                    delay(50) // Check every 50ms
+                    val idle = idlePowerSaving &&
+                        SystemClock.elapsedRealtime() - lastReportTime >= IDLE_AFTER_MS
+                    delay(if (idle) IDLE_POLL_INTERVAL_MS else POLL_INTERVAL_MS)
                 } catch (e: Exception) {
                     if (isActive) {
                         Log.e(TAG, "Error in monitoring loop", e)
@@ -299,6 +317,8 @@ class AndroidUsbDeviceManager(private val context: Context) {
 
     fun stopMonitoring() {
         isMonitoring = false
+        monitoringJob?.cancel()
+        monitoringJob = null
     }
 
     private fun readFromDevice(): Boolean {
@@ -332,10 +352,15 @@ class AndroidUsbDeviceManager(private val context: Context) {
 
     private fun parseInputReport(data: ByteArray, length: Int, deviceId: String): CardData {
         val timestamp = System.currentTimeMillis()
-        val rawResponse = data.take(length).joinToString(" ") { "%02x".format(it) }
+        val rawResponse = if (rawResponseMode == "hex") {
+            data.take(length).joinToString(" ") { "%02x".format(it) }
+        } else {
+            null
+        }
+        val rawBytes = if (rawResponseMode == "binary") data.copyOf(length) else null
 
         if (length < 2) {
-            return CardData(null, null, null, deviceId, rawResponse, timestamp)
+            return CardData(null, null, null, deviceId, rawResponse, timestamp, rawBytes)
         }
 
         // Convert to string, skipping first byte (report ID)
@@ -346,7 +371,7 @@ class AndroidUsbDeviceManager(private val context: Context) {
         )
 
         if (dataString.isEmpty()) {
-            return CardData(null, null, null, deviceId, rawResponse, timestamp)
+            return CardData(null, null, null, deviceId, rawResponse, timestamp, rawBytes)
         }
 
         // Parse track data
@@ -375,7 +400,7 @@ class AndroidUsbDeviceManager(private val context: Context) {
         // Track 3: Less common, variable format
         // For now, we'll leave it null unless specific patterns are found
 
-        return CardData(track1, track2, track3, deviceId, rawResponse, timestamp)
+        return CardData(track1, track2, track3, deviceId, rawResponse, timestamp, rawBytes)
     }
 
     private fun findHidInterface(device: UsbDevice): UsbInterface? {
@@ -16,6 +16,7 @@ import android.util.Log
 class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
   companion object {
     private const val TAG = "MagtekCardReaderPlugin"
+    private val RAW_RESPONSE_MODES = setOf("off", "hex", "binary")
   }
 
   private lateinit var methodChannel: MethodChannel
@@ -28,6 +29,11 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
   private var context: Context? = null
   private var deviceManager: AndroidUsbDeviceManager? = null
 
+  // The reader is read only while Dart listens for swipes and the app isn't
+  // in the background
+  private var cardSwipeListening = false
+  private var appActive = true
+
   override fun onAttachedToEngine(flutterPluginBinding: FlutterPlugin.FlutterPluginBinding) {
     context = flutterPluginBinding.applicationContext
     
@@ -40,10 +46,14 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
     cardSwipeEventChannel.setStreamHandler(object : EventChannel.StreamHandler {
       override fun onListen(arguments: Any?, events: EventChannel.EventSink?) {
         cardSwipeEventSink = events
+        cardSwipeListening = true
+        updateMonitoring()
       }
       
       override fun onCancel(arguments: Any?) {
         cardSwipeEventSink = null
+        cardSwipeListening = false
+        updateMonitoring()
       }
     })
     
@@ -65,7 +75,7 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
         result.success("Android ${android.os.Build.VERSION.RELEASE}")
       }
       "initialize" -> {
-        handleInitialize(result)
+        handleInitialize(call, result)
       }
       "dispose" -> {
         handleDispose(result)
@@ -82,13 +92,19 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
       "isConnected" -> {
         handleIsConnected(result)
       }
+      "setRawResponseMode" -> {
+        handleSetRawResponseMode(call, result)
+      }
+      "setAppLifecycleState" -> {
+        handleSetAppLifecycleState(call, result)
+      }
       else -> {
         result.notImplemented()
       }
     }
   }
 
-  private fun handleInitialize(result: Result) {
+  private fun handleInitialize(call: MethodCall, result: Result) {
     try {
       val ctx = context
       if (ctx == null) {
@@ -96,7 +112,17 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
         return
       }
 
+      val rawResponseMode = call.argument<String>("rawResponseMode") ?: "hex"
+      if (rawResponseMode !in RAW_RESPONSE_MODES) {
+        result.error("INVALID_ARGUMENTS", "rawResponseMode must be off, hex or binary", null)
+        return
+      }
+
+      val idlePowerSaving = call.argument<Boolean>("idlePowerSaving") ?: false
+
       deviceManager = AndroidUsbDeviceManager(ctx)
+      deviceManager!!.rawResponseMode = rawResponseMode
+      deviceManager!!.idlePowerSaving = idlePowerSaving
       
       if (!deviceManager!!.initialize()) {
         result.error("INITIALIZATION_FAILED", "Failed to initialize USB device manager", null)
@@ -111,6 +137,7 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
           "track3" to cardData.track3,
           "deviceId" to cardData.deviceId,
           "rawResponse" to cardData.rawResponse,
+          "rawBytes" to cardData.rawBytes,
           "timestamp" to cardData.timestamp
         )
         cardSwipeEventSink?.success(eventMap)
@@ -134,7 +161,8 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
         deviceEventSink?.success(eventMap)
       }
 
-      deviceManager!!.startMonitoring()
+      // Monitoring starts once Dart is listening
+      updateMonitoring()
       
       Log.d(TAG, "Device manager initialized successfully")
       result.success(null)
@@ -222,6 +250,46 @@ class MagtekCardReaderPlugin: FlutterPlugin, MethodCallHandler, ActivityAware {
     }
   }
 
+  private fun handleSetRawResponseMode(call: MethodCall, result: Result) {
+    val manager = deviceManager
+    if (manager == null) {
+      result.error("NOT_INITIALIZED", "Device manager not initialized", null)
+      return
+    }
+
+    val mode = call.argument<String>("mode")
+    if (mode == null || mode !in RAW_RESPONSE_MODES) {
+      result.error("INVALID_ARGUMENTS", "mode must be off, hex or binary", null)
+      return
+    }
+
+    manager.rawResponseMode = mode
+    result.success(null)
+  }
+
+  // Monitoring stops while the app is hidden, paused or detached and
+  // resumes with it; the state is kept from before initialize too
+  private fun handleSetAppLifecycleState(call: MethodCall, result: Result) {
+    val state = call.argument<String>("state")
+    if (state == null) {
+      result.error("INVALID_ARGUMENTS", "state must be an AppLifecycleState name", null)
+      return
+    }
+
+    appActive = state !in setOf("hidden", "paused", "detached")
+    updateMonitoring()
+    result.success(null)
+  }
+
+  private fun updateMonitoring() {
+    val manager = deviceManager ?: return
+    if (cardSwipeListening && appActive) {
+      manager.startMonitoring()
+    } else {
+      manager.stopMonitoring()
+    }
+  }
+
   private fun handleIsConnected(result: Result) {
     try {
       val manager = deviceManager
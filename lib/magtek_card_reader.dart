@@ -6,15 +6,33 @@ library magtek_card_reader;
 
 import 'dart:async';
 import 'dart:typed_data';
+import 'dart:ui' show AppLifecycleState;
 
 import 'magtek_card_reader_platform_interface.dart';
 import 'src/models/card_data.dart';
+import 'src/models/device_command_response.dart';
 import 'src/models/device_info.dart';
+import 'src/models/device_metrics.dart';
+import 'src/models/log_level.dart';
+import 'src/models/raw_response_mode.dart';
+import 'src/models/swipe_batch_options.dart';
+import 'src/models/swipe_event_encoding.dart';
+import 'src/models/swipe_stats.dart';
 import 'src/exceptions/magtek_exceptions.dart';
 
 export 'src/models/card_data.dart';
+export 'src/models/device_command_response.dart';
 export 'src/models/track_data.dart';
 export 'src/models/device_info.dart';
+export 'src/models/device_metrics.dart';
+export 'src/models/encrypted_swipe_data.dart';
+export 'src/models/log_level.dart';
+export 'src/models/raw_response_mode.dart';
+export 'src/models/swipe_batch_options.dart';
+export 'src/models/swipe_event_encoding.dart';
+export 'src/models/swipe_stats.dart';
+export 'src/models/swipe_timings.dart';
+export 'src/models/swipe_validation.dart';
 export 'src/exceptions/magtek_exceptions.dart';
 
 /// The main class for interacting with Magtek card readers.
@@ -29,28 +47,92 @@ class MagtekCardReader {
   
   MagtekCardReader._();
 
-  /// Stream controller for card swipe events.
-  final StreamController<CardData> _cardSwipeController = StreamController<CardData>.broadcast();
+  /// Stream controller for card swipe events. The platform reads from the
+  /// readers only while it has a listener.
+  late final StreamController<CardData> _cardSwipeController = StreamController<CardData>.broadcast(
+    onListen: _listenForSwipes,
+    onCancel: _stopListeningForSwipes,
+  );
+
+  /// The platform's swipes, forwarded while [onCardSwipe] is listened to.
+  StreamSubscription<CardData>? _platformSwipeSubscription;
   
   /// Stream controller for device connection events.
   final StreamController<DeviceInfo> _deviceConnectionController = StreamController<DeviceInfo>.broadcast();
   
+  /// Stream controller for device disconnection events.
+  final StreamController<DeviceInfo> _deviceDisconnectionController = StreamController<DeviceInfo>.broadcast();
+  
   /// Stream controller for error events.
   final StreamController<MagtekException> _errorController = StreamController<MagtekException>.broadcast();
 
   /// Stream of card swipe events.
+  ///
+  /// Readers are monitored only while this stream has a listener: cancelling
+  /// the last subscription stops the native read loop, and listening again
+  /// restarts it.
   Stream<CardData> get onCardSwipe => _cardSwipeController.stream;
   
   /// Stream of device connection events.
+  ///
+  /// Emits when a reader is plugged in and when one is opened.
   Stream<DeviceInfo> get onDeviceConnected => _deviceConnectionController.stream;
   
+  /// Stream of device disconnection events.
+  ///
+  /// Emits when a reader is unplugged and when an open one is closed.
+  Stream<DeviceInfo> get onDeviceDisconnected => _deviceDisconnectionController.stream;
+  
   /// Stream of error events.
   Stream<MagtekException> get onError => _errorController.stream;
 
   /// Initialize the card reader and start listening for devices.
-  Future<void> initialize() async {
+  ///
+  /// [rawResponseMode] selects what each [CardData] carries of the raw
+  /// report: nothing, a hex string (the default) or the bytes themselves.
+  /// [swipeEventEncoding] set to [SwipeEventEncoding.packed] sends each swipe
+  /// as a compact binary record instead of a map; the events are the same.
+  /// [SwipeEventEncoding.nativePort] has the read thread post those records
+  /// straight to Dart over dart:ffi (Linux/Windows).
+  /// [swipeBatching] gathers swipes into batches before they cross the
+  /// event channel; leave it null to send each swipe on its own.
+  /// [rejectInvalidSwipes] drops swipes that fail the native LRC check or
+  /// have no decodable track instead of delivering them (Linux/Windows).
+  /// [idlePowerSaving] reads a reader that has been quiet for 10 seconds only
+  /// twice a second, waking it no more often than that, until it sends a
+  /// report; the first swipe after a quiet spell can arrive up to half a
+  /// second later, the rest of it at once (Android/Linux/Windows).
+  /// [duplicateSwipeWindow] drops a swipe that shares a track with the same
+  /// reader's previous swipe less than that long before, as a card swiped
+  /// back and forth or a double read produces; each repeat restarts the
+  /// window. Repeats never leave the native plugin and are counted in
+  /// [DeviceMetrics.duplicateSwipes] (Linux/Windows/web, off by default).
+  /// [rememberDevices] keeps the readers opened in a small file
+  /// (`MAGTEK_DEVICE_CACHE`, or the user's cache or local app data
+  /// directory), so that after a restart [connectToDevice] or [openDevice]
+  /// with a remembered ID opens the reader straight from its last path
+  /// instead of waiting for a bus scan; the scan runs when something first
+  /// needs the device list. Readers plugged in or unplugged before then are
+  /// not reported (Linux/Windows, off by default).
+  Future<void> initialize({
+    RawResponseMode rawResponseMode = RawResponseMode.hex,
+    SwipeEventEncoding swipeEventEncoding = SwipeEventEncoding.map,
+    SwipeBatchOptions? swipeBatching,
+    bool rejectInvalidSwipes = false,
+    bool idlePowerSaving = false,
+    Duration? duplicateSwipeWindow,
+    bool rememberDevices = false,
+  }) async {
     try {
-      await MagtekCardReaderPlatform.instance.initialize();
+      await MagtekCardReaderPlatform.instance.initialize(
+        rawResponseMode: rawResponseMode,
+        swipeEventEncoding: swipeEventEncoding,
+        swipeBatching: swipeBatching,
+        rejectInvalidSwipes: rejectInvalidSwipes,
+        idlePowerSaving: idlePowerSaving,
+        duplicateSwipeWindow: duplicateSwipeWindow,
+        rememberDevices: rememberDevices,
+      );
       _startListening();
     } catch (e) {
       _errorController.add(MagtekException('Failed to initialize card reader: $e'));
@@ -61,8 +143,10 @@ class MagtekCardReader {
   /// Dispose of resources and stop listening.
   Future<void> dispose() async {
     await MagtekCardReaderPlatform.instance.dispose();
+    await _stopListeningForSwipes();
     await _cardSwipeController.close();
     await _deviceConnectionController.close();
+    await _deviceDisconnectionController.close();
     await _errorController.close();
   }
 
@@ -77,6 +161,9 @@ class MagtekCardReader {
   }
 
   /// Connect to a specific device by its device ID.
+  ///
+  /// Any other open devices are closed. Use [openDevice] to read from
+  /// several devices at once.
   Future<bool> connectToDevice(String deviceId) async {
     try {
       return await MagtekCardReaderPlatform.instance.connectToDevice(deviceId);
@@ -86,7 +173,29 @@ class MagtekCardReader {
     }
   }
 
-  /// Disconnect from the currently connected device.
+  /// Open a device alongside any devices that are already open.
+  ///
+  /// Swipes from every open device arrive on [onCardSwipe]; use
+  /// [CardData.deviceId] to tell them apart.
+  Future<bool> openDevice(String deviceId) async {
+    try {
+      return await MagtekCardReaderPlatform.instance.openDevice(deviceId);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to open device: $e'));
+      return false;
+    }
+  }
+
+  /// Close a single open device, leaving any others open.
+  Future<void> closeDevice(String deviceId) async {
+    try {
+      await MagtekCardReaderPlatform.instance.closeDevice(deviceId);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to close device: $e'));
+    }
+  }
+
+  /// Disconnect from all open devices.
   Future<void> disconnect() async {
     try {
       await MagtekCardReaderPlatform.instance.disconnect();
@@ -105,21 +214,152 @@ class MagtekCardReader {
     }
   }
 
+  /// Change what each [CardData] carries of the raw report.
+  Future<void> setRawResponseMode(RawResponseMode mode) async {
+    try {
+      await MagtekCardReaderPlatform.instance.setRawResponseMode(mode);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to set raw response mode: $e'));
+      rethrow;
+    }
+  }
+
+  /// Get per-stage swipe latency percentiles (Linux/Windows). With [reset]
+  /// the statistics start over after this call, so successive calls cover
+  /// successive intervals.
+  Future<SwipeStats> getStats({bool reset = false}) async {
+    try {
+      return await MagtekCardReaderPlatform.instance.getStats(reset: reset);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to get stats: $e'));
+      rethrow;
+    }
+  }
+
+  /// Get the counters of every reader opened so far, by device ID
+  /// (Linux/Windows).
+  Future<Map<String, DeviceMetrics>> getMetrics() async {
+    try {
+      return await MagtekCardReaderPlatform.instance.getMetrics();
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to get metrics: $e'));
+      rethrow;
+    }
+  }
+
+  /// Set how much the native plugin logs (Linux/Windows); [MagtekLogLevel.warning]
+  /// by default.
+  Future<void> setLogLevel(MagtekLogLevel level) async {
+    try {
+      await MagtekCardReaderPlatform.instance.setLogLevel(level);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to set log level: $e'));
+      rethrow;
+    }
+  }
+
+  /// Trace the native swipe pipeline (Linux/Windows), so that reading,
+  /// parsing, queueing and delivery show up next to the Flutter engine's
+  /// events in a system trace. Each stage is a slice carrying the device ID
+  /// and report size: Linux writes them to ftrace's `trace_marker` for
+  /// Perfetto or systrace, Windows to the `Magtek.CardReader` ETW provider.
+  /// Setting `MAGTEK_TRACE=1` in the environment turns tracing on at startup.
+  ///
+  /// Returns whether tracing is on; on Linux it stays off when
+  /// `trace_marker` can't be written, which by default takes root.
+  Future<bool> setTracing(bool enabled) async {
+    try {
+      return await MagtekCardReaderPlatform.instance.setTracing(enabled);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to set tracing: $e'));
+      rethrow;
+    }
+  }
+
+  /// Pass on the app's lifecycle state (Android/Linux/Windows), e.g. from an
+  /// `AppLifecycleListener`; readers aren't monitored while the app is
+  /// hidden, paused or detached. While monitoring is stopped, an open reader
+  /// that is unplugged is closed rather than reopened when it returns.
+  Future<void> setAppLifecycleState(AppLifecycleState state) async {
+    try {
+      await MagtekCardReaderPlatform.instance.setAppLifecycleState(state);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to set app lifecycle state: $e'));
+      rethrow;
+    }
+  }
+
+  /// Send a vendor command to an open device's feature report (Linux/Windows),
+  /// e.g. to read its firmware version or KSN or change a setting.
+  ///
+  /// Commands need not be awaited one at a time: those sent together to a
+  /// monitored device go out back to back between its reads, and each device
+  /// runs its own. A command that can't run within [timeout] fails.
+  Future<DeviceCommandResponse> sendCommand(String deviceId, int command,
+      {Uint8List? data, Duration timeout = const Duration(seconds: 2)}) async {
+    try {
+      return await MagtekCardReaderPlatform.instance
+          .sendCommand(deviceId, command, data: data, timeout: timeout);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to send command: $e'));
+      rethrow;
+    }
+  }
+
+  /// Record every input report an open device sends to the file at [path]
+  /// (Linux/Windows), replacing it, until [stopCapture] or the device
+  /// closes. Captures replay through the native pipeline without a reader,
+  /// for bug reports and benchmarks. Returns false if the device isn't open
+  /// or the file can't be created.
+  ///
+  /// Captures hold raw card data; treat them like the cards themselves.
+  Future<bool> startCapture(String deviceId, String path) async {
+    try {
+      return await MagtekCardReaderPlatform.instance.startCapture(deviceId, path);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to start capture: $e'));
+      rethrow;
+    }
+  }
+
+  /// Stop recording a device's input reports and close the capture file.
+  Future<void> stopCapture(String deviceId) async {
+    try {
+      await MagtekCardReaderPlatform.instance.stopCapture(deviceId);
+    } catch (e) {
+      _errorController.add(MagtekException('Failed to stop capture: $e'));
+      rethrow;
+    }
+  }
+
   /// Get the platform version for debugging purposes.
   Future<String?> getPlatformVersion() {
     return MagtekCardReaderPlatform.instance.getPlatformVersion();
   }
 
   /// Start listening for card swipe and device events.
-  void _startListening() {
-    MagtekCardReaderPlatform.instance.onCardSwipe.listen(
+  void _listenForSwipes() {
+    _platformSwipeSubscription ??= MagtekCardReaderPlatform.instance.onCardSwipe.listen(
       (cardData) => _cardSwipeController.add(cardData),
       onError: (error) => _errorController.add(MagtekException('Card swipe error: $error')),
     );
+  }
 
+  Future<void> _stopListeningForSwipes() async {
+    final subscription = _platformSwipeSubscription;
+    _platformSwipeSubscription = null;
+    await subscription?.cancel();
+  }
+
+  void _startListening() {
     MagtekCardReaderPlatform.instance.onDeviceConnected.listen(
       (deviceInfo) => _deviceConnectionController.add(deviceInfo),
       onError: (error) => _errorController.add(MagtekException('Device connection error: $error')),
     );
+
+    MagtekCardReaderPlatform.instance.onDeviceDisconnected.listen(
+      (deviceInfo) => _deviceDisconnectionController.add(deviceInfo),
+      onError: (error) => _errorController.add(MagtekException('Device disconnection error: $error')),
+    );
   }
 }
\ No newline at end of file
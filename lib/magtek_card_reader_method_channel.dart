@@ -1,12 +1,26 @@
 import 'dart:async';
 import 'dart:convert';
+import 'dart:typed_data';
+import 'dart:ui' show AppLifecycleState;
 
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
 import 'magtek_card_reader_platform_interface.dart';
+import 'src/native/magtek_native.dart';
 import 'src/models/card_data.dart';
+import 'src/models/device_command_response.dart';
 import 'src/models/device_info.dart';
+import 'src/models/device_metrics.dart';
+import 'src/models/encrypted_swipe_data.dart';
+import 'src/models/log_level.dart';
+import 'src/models/raw_response_mode.dart';
+import 'src/models/swipe_batch_options.dart';
+import 'src/models/swipe_event_encoding.dart';
+import 'src/models/swipe_stats.dart';
+import 'src/models/swipe_timings.dart';
+import 'src/models/swipe_validation.dart';
+import 'src/models/track_data.dart';
 
 /// An implementation of [MagtekCardReaderPlatform] that uses method channels.
 class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
@@ -22,11 +36,22 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
   @visibleForTesting
   final deviceEventChannel = const EventChannel('magtek_card_reader/device_events');
 
+  /// Direct native calls, where the platform library exports them; the
+  /// queries it can answer and the native port swipes go through it.
+  @visibleForTesting
+  MagtekNative? nativeBindings = MagtekNative.instance;
+
   StreamSubscription<dynamic>? _cardSwipeSubscription;
   StreamSubscription<dynamic>? _deviceEventSubscription;
 
-  final StreamController<CardData> _cardSwipeController = StreamController<CardData>.broadcast();
+  // The native card swipe channel is listened to only while this stream is,
+  // so the platform reads from the readers only while someone takes swipes
+  late final StreamController<CardData> _cardSwipeController = StreamController<CardData>.broadcast(
+    onListen: _listenForSwipes,
+    onCancel: _stopListeningForSwipes,
+  );
   final StreamController<DeviceInfo> _deviceConnectionController = StreamController<DeviceInfo>.broadcast();
+  final StreamController<DeviceInfo> _deviceDisconnectionController = StreamController<DeviceInfo>.broadcast();
 
   @override
   Stream<CardData> get onCardSwipe => _cardSwipeController.stream;
@@ -35,10 +60,42 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
   Stream<DeviceInfo> get onDeviceConnected => _deviceConnectionController.stream;
 
   @override
-  Future<void> initialize() async {
+  Stream<DeviceInfo> get onDeviceDisconnected => _deviceDisconnectionController.stream;
+
+  @override
+  Future<void> initialize({
+    RawResponseMode rawResponseMode = RawResponseMode.hex,
+    SwipeEventEncoding swipeEventEncoding = SwipeEventEncoding.map,
+    SwipeBatchOptions? swipeBatching,
+    bool rejectInvalidSwipes = false,
+    bool idlePowerSaving = false,
+    Duration? duplicateSwipeWindow,
+    bool rememberDevices = false,
+  }) async {
+    // Swipes the port can't take still arrive packed on the event channel
+    final nativePort = swipeEventEncoding == SwipeEventEncoding.nativePort;
     try {
-      await methodChannel.invokeMethod('initialize');
+      await methodChannel.invokeMethod('initialize', {
+        'rawResponseMode': rawResponseMode.name,
+        'swipeEventEncoding': nativePort ? SwipeEventEncoding.packed.name : swipeEventEncoding.name,
+        'swipeBatching': swipeBatching?.toMap(),
+        'rejectInvalidSwipes': rejectInvalidSwipes,
+        'idlePowerSaving': idlePowerSaving,
+        'duplicateSwipeWindowMs': duplicateSwipeWindow?.inMilliseconds ?? 0,
+        'rememberDevices': rememberDevices,
+      });
       _startListening();
+      if (nativePort) {
+        nativeBindings?.listenForSwipes((record) {
+          try {
+            _addSwipeEvent(record);
+          } catch (e) {
+            debugPrint('Error processing card swipe event: $e');
+          }
+        });
+      } else {
+        nativeBindings?.stopListeningForSwipes();
+      }
     } catch (e) {
       throw Exception('Failed to initialize card reader: $e');
     }
@@ -46,10 +103,12 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
 
   @override
   Future<void> dispose() async {
-    await _cardSwipeSubscription?.cancel();
+    nativeBindings?.stopListeningForSwipes();
+    await _stopListeningForSwipes();
     await _deviceEventSubscription?.cancel();
     await _cardSwipeController.close();
     await _deviceConnectionController.close();
+    await _deviceDisconnectionController.close();
     
     try {
       await methodChannel.invokeMethod('dispose');
@@ -61,6 +120,13 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
 
   @override
   Future<List<DeviceInfo>> getConnectedDevices() async {
+    // The native cache answers without a channel hop while hotplug keeps it
+    // current
+    final devices = nativeBindings?.getConnectedDevices();
+    if (devices != null) {
+      return devices;
+    }
+
     try {
       final result = await methodChannel.invokeMethod<List<dynamic>>('getConnectedDevices');
       if (result == null) return [];
@@ -86,6 +152,29 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
     }
   }
 
+  @override
+  Future<bool> openDevice(String deviceId) async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>('openDevice', {
+        'deviceId': deviceId,
+      });
+      return result ?? false;
+    } catch (e) {
+      throw Exception('Failed to open device: $e');
+    }
+  }
+
+  @override
+  Future<void> closeDevice(String deviceId) async {
+    try {
+      await methodChannel.invokeMethod('closeDevice', {
+        'deviceId': deviceId,
+      });
+    } catch (e) {
+      throw Exception('Failed to close device: $e');
+    }
+  }
+
   @override
   Future<void> disconnect() async {
     try {
@@ -97,6 +186,11 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
 
   @override
   Future<bool> isConnected() async {
+    final native = nativeBindings;
+    if (native != null) {
+      return native.isConnected();
+    }
+
     try {
       final result = await methodChannel.invokeMethod<bool>('isConnected');
       return result ?? false;
@@ -105,6 +199,116 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
     }
   }
 
+  @override
+  Future<void> setRawResponseMode(RawResponseMode mode) async {
+    try {
+      await methodChannel.invokeMethod('setRawResponseMode', {
+        'mode': mode.name,
+      });
+    } catch (e) {
+      throw Exception('Failed to set raw response mode: $e');
+    }
+  }
+
+  @override
+  Future<SwipeStats> getStats({bool reset = false}) async {
+    try {
+      final stats = await methodChannel.invokeMethod<Map>('getStats', {
+        'reset': reset,
+      });
+      return SwipeStats.fromMap(stats ?? const {});
+    } catch (e) {
+      throw Exception('Failed to get stats: $e');
+    }
+  }
+
+  @override
+  Future<Map<String, DeviceMetrics>> getMetrics() async {
+    try {
+      final metrics = await methodChannel.invokeMethod<Map>('getMetrics');
+      return {
+        for (final entry in (metrics ?? const {}).entries)
+          entry.key as String: DeviceMetrics.fromMap(entry.value as Map),
+      };
+    } catch (e) {
+      throw Exception('Failed to get metrics: $e');
+    }
+  }
+
+  @override
+  Future<DeviceCommandResponse> sendCommand(String deviceId, int command,
+      {Uint8List? data, Duration timeout = const Duration(seconds: 2)}) async {
+    try {
+      final response = await methodChannel.invokeMethod<Map>('sendCommand', {
+        'deviceId': deviceId,
+        'command': command,
+        'data': data,
+        'timeoutMs': timeout.inMilliseconds < 1 ? 1 : timeout.inMilliseconds,
+      });
+      return DeviceCommandResponse.fromMap(response ?? const {});
+    } catch (e) {
+      throw Exception('Failed to send command: $e');
+    }
+  }
+
+  @override
+  Future<bool> startCapture(String deviceId, String path) async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>('startCapture', {
+        'deviceId': deviceId,
+        'path': path,
+      });
+      return result ?? false;
+    } catch (e) {
+      throw Exception('Failed to start capture: $e');
+    }
+  }
+
+  @override
+  Future<void> stopCapture(String deviceId) async {
+    try {
+      await methodChannel.invokeMethod('stopCapture', {
+        'deviceId': deviceId,
+      });
+    } catch (e) {
+      throw Exception('Failed to stop capture: $e');
+    }
+  }
+
+  @override
+  Future<void> setLogLevel(MagtekLogLevel level) async {
+    try {
+      await methodChannel.invokeMethod('setLogLevel', {
+        'level': level.name,
+      });
+    } catch (e) {
+      throw Exception('Failed to set log level: $e');
+    }
+  }
+
+  @override
+  Future<bool> setTracing(bool enabled) async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>('setTracing', {
+        'enabled': enabled,
+      });
+      return result ?? false;
+    } catch (e) {
+      throw Exception('Failed to set tracing: $e');
+    }
+  }
+
+  @override
+  Future<void> setAppLifecycleState(AppLifecycleState state) async {
+    try {
+      await methodChannel.invokeMethod('setAppLifecycleState', {
+        'state': state.name,
+      });
+    } catch (e) {
+      throw Exception('Failed to set app lifecycle state: $e');
+    }
+  }
+
   @override
   Future<String?> getPlatformVersion() async {
     try {
@@ -115,21 +319,205 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
     }
   }
 
+  /// Newest version of the packed swipe record this decoder understands;
+  /// see src/packed_swipe_codec.h for the layout. Version 2 records, which
+  /// lack the decoded fields, and version 1 records, which also lack the
+  /// stage timestamps, are still accepted.
+  static const int packedSwipeVersion = 3;
+
+  /// Native names of the track statuses, by their packed value.
+  static const List<String> _packedTrackStatuses = ['absent', 'decoded', 'formatError', 'lrcError'];
+
+  /// Native validations, by their packed value.
+  static const List<SwipeValidation> _packedValidations = [
+    SwipeValidation.valid,
+    SwipeValidation.lrcError,
+    SwipeValidation.formatError,
+    SwipeValidation.luhnError,
+  ];
+
+  static const int _packedRawHex = 0x01;
+  static const int _packedRawBytes = 0x02;
+  static const int _packedEncrypted = 0x04;
+
+  /// Decode a packed swipe record into [CardData].
+  ///
+  /// Returns null for a record whose version this decoder does not know.
+  @visibleForTesting
+  static CardData? decodePackedSwipe(Uint8List record) {
+    final data = ByteData.sublistView(record);
+    final version = data.getUint8(0);
+    if (version < 1 || version > packedSwipeVersion) {
+      debugPrint('Unsupported packed swipe version $version');
+      return null;
+    }
+
+    final flags = data.getUint8(1);
+    // Bytes 2-9 hold the native timestamp; CardData stamps its own on arrival
+    var offset = 10;
+
+    Uint8List nextField() {
+      final length = data.getUint16(offset, Endian.little);
+      final field = Uint8List.sublistView(record, offset + 2, offset + 2 + length);
+      offset += 2 + length;
+      return field;
+    }
+
+    String? nextString() {
+      final field = nextField();
+      return field.isEmpty ? null : utf8.decode(field);
+    }
+
+    final track1 = nextString();
+    final track2 = nextString();
+    final track3 = nextString();
+    final deviceId = nextString();
+    final raw = nextField();
+
+    SwipeTimings? timings;
+    if (version >= 2) {
+      int nextInt64() {
+        final value = data.getInt64(offset, Endian.little);
+        offset += 8;
+        return value;
+      }
+
+      timings = SwipeTimings(
+        firstReportNs: nextInt64(),
+        frameCompleteNs: nextInt64(),
+        parsedNs: nextInt64(),
+        queuedNs: nextInt64(),
+        deliveredNs: nextInt64(),
+      );
+    }
+
+    final rawResponse = (flags & _packedRawHex) != 0 ? ascii.decode(raw) : null;
+    final rawBytes = (flags & _packedRawBytes) != 0 ? Uint8List.fromList(raw) : null;
+
+    if (version < 3) {
+      return CardData.fromRawTracks(
+        track1Data: track1,
+        track2Data: track2,
+        track3Data: track3,
+        deviceId: deviceId,
+        rawResponse: rawResponse,
+        rawBytes: rawBytes,
+        timings: timings,
+      );
+    }
+
+    final validation = _packedValidations[data.getUint8(offset++)];
+    final rawTracks = [track1, track2, track3];
+    final tracks = <TrackData?>[];
+    for (var i = 0; i < 3; i++) {
+      final status = _packedTrackStatuses[data.getUint8(offset++)];
+      final fields = {
+        'status': status,
+        'accountNumber': nextString(),
+        'cardholderName': nextString(),
+        'expirationDate': nextString(),
+        'serviceCode': nextString(),
+        'discretionaryData': nextString(),
+        'additionalData': nextString(),
+      };
+      tracks.add(TrackData.fromNativeFields(i + 1, rawTracks[i], fields));
+    }
+
+    EncryptedSwipeData? encrypted;
+    if ((flags & _packedEncrypted) != 0) {
+      final decrypted = data.getUint8(offset++) != 0;
+      final ksn = Uint8List.fromList(nextField());
+      final deviceSerial = utf8.decode(nextField());
+      final encryptedTracks = [for (var i = 0; i < 3; i++) Uint8List.fromList(nextField())];
+      final magnePrint = Uint8List.fromList(nextField());
+      final magnePrintStatus = data.getUint32(offset, Endian.little);
+      final encryptionStatus = data.getUint16(offset + 4, Endian.little);
+      offset += 6;
+      encrypted = EncryptedSwipeData(
+        ksn: ksn,
+        deviceSerialNumber: deviceSerial,
+        encryptedTracks: encryptedTracks,
+        magnePrint: magnePrint,
+        magnePrintStatus: magnePrintStatus,
+        encryptionStatus: encryptionStatus,
+        sessionId: Uint8List.fromList(nextField()),
+        decrypted: decrypted,
+      );
+    }
+
+    return CardData.fromDecodedTracks(
+      track1: tracks[0],
+      track2: tracks[1],
+      track3: tracks[2],
+      deviceId: deviceId,
+      rawResponse: rawResponse,
+      rawBytes: rawBytes,
+      timings: timings,
+      validation: validation,
+      encrypted: encrypted,
+    );
+  }
+
+  /// Build [CardData] from a map event, using the native decoder's fields
+  /// when the platform sent them.
+  static CardData _cardDataFromMap(Map<dynamic, dynamic> event) {
+    final timings = event['timings'] is Map ? SwipeTimings.fromMap(event['timings'] as Map) : null;
+    final trackFields = event['trackFields'];
+    if (trackFields is! List || trackFields.length != 3) {
+      return CardData.fromRawTracks(
+        track1Data: event['track1'] as String?,
+        track2Data: event['track2'] as String?,
+        track3Data: event['track3'] as String?,
+        deviceId: event['deviceId'] as String?,
+        rawResponse: event['rawResponse'] as String?,
+        rawBytes: event['rawBytes'] as Uint8List?,
+        timings: timings,
+      );
+    }
+
+    TrackData? track(int trackNumber) {
+      final raw = event['track$trackNumber'] as String?;
+      return TrackData.fromNativeFields(
+          trackNumber, raw == null || raw.isEmpty ? null : raw, trackFields[trackNumber - 1] as Map);
+    }
+
+    return CardData.fromDecodedTracks(
+      track1: track(1),
+      track2: track(2),
+      track3: track(3),
+      deviceId: event['deviceId'] as String?,
+      rawResponse: event['rawResponse'] as String?,
+      rawBytes: event['rawBytes'] as Uint8List?,
+      timings: timings,
+      validation: SwipeValidation.fromName(event['validation'] as String?),
+      encrypted: event['encrypted'] is Map ? EncryptedSwipeData.fromMap(event['encrypted'] as Map) : null,
+    );
+  }
+
+  /// Decode one swipe event, packed or map, onto the swipe stream.
+  void _addSwipeEvent(dynamic event) {
+    if (event is Uint8List) {
+      final cardData = decodePackedSwipe(event);
+      if (cardData != null) {
+        _cardSwipeController.add(cardData);
+      }
+    } else if (event is Map) {
+      _cardSwipeController.add(_cardDataFromMap(event));
+    }
+  }
+
   /// Start listening to event channels.
-  void _startListening() {
-    // Listen for card swipe events
-    _cardSwipeSubscription = cardSwipeEventChannel.receiveBroadcastStream().listen(
+  void _listenForSwipes() {
+    _cardSwipeSubscription ??= cardSwipeEventChannel.receiveBroadcastStream().listen(
       (dynamic event) {
         try {
-          if (event is Map) {
-            final cardData = CardData.fromRawTracks(
-              track1Data: event['track1'] as String?,
-              track2Data: event['track2'] as String?,
-              track3Data: event['track3'] as String?,
-              deviceId: event['deviceId'] as String?,
-              rawResponse: event['rawResponse'] as String?,
-            );
-            _cardSwipeController.add(cardData);
+          if (event is List && event is! Uint8List) {
+            // A batch of swipes, in arrival order
+            for (final swipe in event) {
+              _addSwipeEvent(swipe);
+            }
+          } else {
+            _addSwipeEvent(event);
           }
         } catch (e) {
           debugPrint('Error processing card swipe event: $e');
@@ -139,7 +527,15 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
         debugPrint('Card swipe event error: $error');
       },
     );
+  }
+
+  Future<void> _stopListeningForSwipes() async {
+    final subscription = _cardSwipeSubscription;
+    _cardSwipeSubscription = null;
+    await subscription?.cancel();
+  }
 
+  void _startListening() {
     // Listen for device connection events
     _deviceEventSubscription = deviceEventChannel.receiveBroadcastStream().listen(
       (dynamic event) {
@@ -150,6 +546,10 @@ class MethodChannelMagtekCardReader extends MagtekCardReaderPlatform {
               final deviceMap = Map<String, dynamic>.from(event['device'] as Map);
               final deviceInfo = DeviceInfo.fromMap(deviceMap);
               _deviceConnectionController.add(deviceInfo);
+            } else if (eventType == 'device_disconnected') {
+              final deviceMap = Map<String, dynamic>.from(event['device'] as Map);
+              final deviceInfo = DeviceInfo.fromMap(deviceMap);
+              _deviceDisconnectionController.add(deviceInfo);
             }
           }
         } catch (e) {
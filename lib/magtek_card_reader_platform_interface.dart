@@ -1,10 +1,19 @@
 import 'dart:async';
+import 'dart:typed_data';
+import 'dart:ui' show AppLifecycleState;
 
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
 import 'magtek_card_reader_method_channel.dart';
 import 'src/models/card_data.dart';
+import 'src/models/device_command_response.dart';
 import 'src/models/device_info.dart';
+import 'src/models/device_metrics.dart';
+import 'src/models/log_level.dart';
+import 'src/models/raw_response_mode.dart';
+import 'src/models/swipe_batch_options.dart';
+import 'src/models/swipe_event_encoding.dart';
+import 'src/models/swipe_stats.dart';
 
 abstract class MagtekCardReaderPlatform extends PlatformInterface {
   /// Constructs a MagtekCardReaderPlatform.
@@ -37,8 +46,28 @@ abstract class MagtekCardReaderPlatform extends PlatformInterface {
     throw UnimplementedError('onDeviceConnected has not been implemented.');
   }
 
+  /// Stream of device disconnection events.
+  Stream<DeviceInfo> get onDeviceDisconnected {
+    throw UnimplementedError('onDeviceDisconnected has not been implemented.');
+  }
+
   /// Initialize the card reader plugin.
-  Future<void> initialize() {
+  ///
+  /// [rawResponseMode] selects what each [CardData] carries of the raw report;
+  /// [swipeEventEncoding] selects how swipe events cross the event channel;
+  /// [swipeBatching], if set, sends them in batches; [idlePowerSaving]
+  /// reads quiet readers at a slow idle cadence; [duplicateSwipeWindow], if
+  /// set, drops repeats of a reader's previous swipe natively;
+  /// [rememberDevices] reopens remembered readers by path after a restart.
+  Future<void> initialize({
+    RawResponseMode rawResponseMode = RawResponseMode.hex,
+    SwipeEventEncoding swipeEventEncoding = SwipeEventEncoding.map,
+    SwipeBatchOptions? swipeBatching,
+    bool rejectInvalidSwipes = false,
+    bool idlePowerSaving = false,
+    Duration? duplicateSwipeWindow,
+    bool rememberDevices = false,
+  }) {
     throw UnimplementedError('initialize() has not been implemented.');
   }
 
@@ -57,6 +86,16 @@ abstract class MagtekCardReaderPlatform extends PlatformInterface {
     throw UnimplementedError('connectToDevice() has not been implemented.');
   }
 
+  /// Open a device alongside any devices that are already open.
+  Future<bool> openDevice(String deviceId) {
+    throw UnimplementedError('openDevice() has not been implemented.');
+  }
+
+  /// Close a single open device, leaving any others open.
+  Future<void> closeDevice(String deviceId) {
+    throw UnimplementedError('closeDevice() has not been implemented.');
+  }
+
   /// Disconnect from the currently connected device.
   Future<void> disconnect() {
     throw UnimplementedError('disconnect() has not been implemented.');
@@ -67,6 +106,53 @@ abstract class MagtekCardReaderPlatform extends PlatformInterface {
     throw UnimplementedError('isConnected() has not been implemented.');
   }
 
+  /// Change what each [CardData] carries of the raw report.
+  Future<void> setRawResponseMode(RawResponseMode mode) {
+    throw UnimplementedError('setRawResponseMode() has not been implemented.');
+  }
+
+  /// Get swipe latency statistics, optionally clearing them afterwards.
+  Future<SwipeStats> getStats({bool reset = false}) {
+    throw UnimplementedError('getStats() has not been implemented.');
+  }
+
+  /// Get the counters of every device opened so far, by device ID.
+  Future<Map<String, DeviceMetrics>> getMetrics() {
+    throw UnimplementedError('getMetrics() has not been implemented.');
+  }
+
+  /// Set how much the native plugin logs.
+  Future<void> setLogLevel(MagtekLogLevel level) {
+    throw UnimplementedError('setLogLevel() has not been implemented.');
+  }
+
+  /// Turn native trace slices on or off; returns whether tracing is on.
+  Future<bool> setTracing(bool enabled) {
+    throw UnimplementedError('setTracing() has not been implemented.');
+  }
+
+  /// Tell the native plugin the app's lifecycle state, so it stops reading
+  /// while the app is in the background.
+  Future<void> setAppLifecycleState(AppLifecycleState state) {
+    throw UnimplementedError('setAppLifecycleState() has not been implemented.');
+  }
+
+  /// Send a vendor command to an open device's feature report.
+  Future<DeviceCommandResponse> sendCommand(String deviceId, int command,
+      {Uint8List? data, Duration timeout = const Duration(seconds: 2)}) {
+    throw UnimplementedError('sendCommand() has not been implemented.');
+  }
+
+  /// Start recording an open device's input reports to a capture file.
+  Future<bool> startCapture(String deviceId, String path) {
+    throw UnimplementedError('startCapture() has not been implemented.');
+  }
+
+  /// Stop recording a device's input reports.
+  Future<void> stopCapture(String deviceId) {
+    throw UnimplementedError('stopCapture() has not been implemented.');
+  }
+
   /// Get the platform version for debugging purposes.
   Future<String?> getPlatformVersion() {
     throw UnimplementedError('getPlatformVersion() has not been implemented.');
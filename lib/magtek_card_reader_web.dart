@@ -6,14 +6,21 @@ import 'dart:async';
 import 'dart:typed_data';
 
 import 'package:flutter_web_plugins/flutter_web_plugins.dart';
-import 'package:web/web.dart' as web;
 
 import 'magtek_card_reader_platform_interface.dart';
 import 'src/models/card_data.dart';
 import 'src/models/device_info.dart';
+import 'src/models/raw_response_mode.dart';
+import 'src/models/swipe_batch_options.dart';
+import 'src/models/swipe_event_encoding.dart';
 import 'src/exceptions/magtek_exceptions.dart';
+import 'src/pipeline/swipe_pipeline.dart';
 
-/// A web implementation of the MagtekCardReaderPlatform using WebUSB API.
+/// A web implementation of the MagtekCardReaderPlatform using the WebHID API.
+///
+/// Input reports go through the same stages as on Linux and Windows: they
+/// are reassembled into one frame per swipe, parsed by the rules the native
+/// core uses, filtered for repeats and, when asked, delivered in batches.
 class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
   /// Constructs a MagtekCardReaderWeb
   MagtekCardReaderWeb();
@@ -22,15 +29,30 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
     MagtekCardReaderPlatform.instance = MagtekCardReaderWeb();
   }
 
-  // WebUSB device management
+  // WebHID device management
   Object? _currentDevice;
   String? _currentDeviceId;
-  bool _isMonitoring = false;
-  Timer? _monitoringTimer;
+  Function? _inputReportListener;
+  Function? _disconnectListener;
+  RawResponseMode _rawResponseMode = RawResponseMode.hex;
+
+  // Swipe pipeline state for the open reader
+  SwipePipeline? _pipeline;
+  Timer? _gapTimer;
+  Duration? _duplicateSwipeWindow;
+
+  // Read times, as offsets from a fixed start like the native steady clock
+  final Stopwatch _clock = Stopwatch()..start();
+
+  // Swipe batching; null delivers each swipe as it completes
+  SwipeBatchOptions? _swipeBatching;
+  final List<CardData> _pendingSwipes = [];
+  Timer? _batchTimer;
 
   // Stream controllers for events
   final StreamController<CardData> _cardSwipeController = StreamController<CardData>.broadcast();
   final StreamController<DeviceInfo> _deviceConnectionController = StreamController<DeviceInfo>.broadcast();
+  final StreamController<DeviceInfo> _deviceDisconnectionController = StreamController<DeviceInfo>.broadcast();
 
   @override
   Stream<CardData> get onCardSwipe => _cardSwipeController.stream;
@@ -38,6 +60,9 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
   @override
   Stream<DeviceInfo> get onDeviceConnected => _deviceConnectionController.stream;
 
+  @override
+  Stream<DeviceInfo> get onDeviceDisconnected => _deviceDisconnectionController.stream;
+
   // Magtek device constants
   static const int _magtekVendorId = 0x0801;
   static const List<int> _magtekProductIds = [
@@ -54,20 +79,32 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
   }
 
   @override
-  Future<void> initialize() async {
+  Future<void> initialize({
+    RawResponseMode rawResponseMode = RawResponseMode.hex,
+    SwipeEventEncoding swipeEventEncoding = SwipeEventEncoding.map,
+    SwipeBatchOptions? swipeBatching,
+    bool rejectInvalidSwipes = false,
+    bool idlePowerSaving = false,
+    Duration? duplicateSwipeWindow,
+    bool rememberDevices = false,
+  }) async {
+    _rawResponseMode = rawResponseMode;
+    _swipeBatching = swipeBatching;
+    _duplicateSwipeWindow = duplicateSwipeWindow;
+    _pipeline?.duplicateWindow = duplicateSwipeWindow;
     try {
-      // Check if WebUSB is supported
-      if (!_isWebUsbSupported()) {
+      // Check if WebHID is supported
+      if (!_isWebHidSupported()) {
         throw PlatformNotSupportedException(
-          'WebUSB is not supported in this browser',
+          'WebHID is not supported in this browser',
           platform: 'web',
         );
       }
 
-      // WebUSB Magtek Card Reader initialized
+      // WebHID Magtek Card Reader initialized
     } catch (e) {
       throw DeviceInitializationException(
-        'Failed to initialize web USB support: $e',
+        'Failed to initialize WebHID support: $e',
       );
     }
   }
@@ -75,10 +112,11 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
   @override
   Future<void> dispose() async {
     try {
-      _stopMonitoring();
       await _disconnectDevice();
+      _flushSwipes();
       await _cardSwipeController.close();
       await _deviceConnectionController.close();
+      await _deviceDisconnectionController.close();
     } catch (e) {
       // Error during web plugin disposal: $e
     }
@@ -87,20 +125,19 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
   @override
   Future<List<DeviceInfo>> getConnectedDevices() async {
     try {
-      if (!_isWebUsbSupported()) {
+      if (!_isWebHidSupported()) {
         return [];
       }
 
-      final devices = await _getUsbDevices();
+      final devices = await _getHidDevices();
       final List<DeviceInfo> magtekDevices = [];
 
-      for (final device in devices) {
-        final vendorId = js_util.getProperty(device, 'vendorId') as int;
-        final productId = js_util.getProperty(device, 'productId') as int;
+      for (var i = 0; i < devices.length; i++) {
+        final vendorId = js_util.getProperty(devices[i], 'vendorId') as int;
+        final productId = js_util.getProperty(devices[i], 'productId') as int;
 
         if (_isMagtekDevice(vendorId, productId)) {
-          final deviceInfo = _createDeviceInfo(device);
-          magtekDevices.add(deviceInfo);
+          magtekDevices.add(_createDeviceInfo(devices[i], i));
         }
       }
 
@@ -115,15 +152,25 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
   @override
   Future<bool> connectToDevice(String deviceId) async {
     try {
-      if (!_isWebUsbSupported()) {
+      if (!_isWebHidSupported()) {
         throw PlatformNotSupportedException(
-          'WebUSB is not supported in this browser',
+          'WebHID is not supported in this browser',
           platform: 'web',
         );
       }
 
+      // A reader the page was already granted needs no chooser
+      final granted = await _getHidDevices();
+      var index = -1;
+      for (var i = 0; i < granted.length; i++) {
+        if (_deviceId(granted[i], i) == deviceId) {
+          index = i;
+          break;
+        }
+      }
+
       // Request device access with Magtek device filters
-      final device = await _requestUsbDevice();
+      final device = index >= 0 ? granted[index] : await _requestHidDevice();
       if (device == null) {
         return false;
       }
@@ -138,26 +185,27 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
         );
       }
 
-      // Open device connection
-      await js_util.promiseToFuture(js_util.callMethod(device, 'open', []));
-
-      // Select configuration (usually configuration 1)
-      await _selectConfiguration(device, 1);
+      await _disconnectDevice();
+      if (index < 0) {
+        index = (await _getHidDevices()).indexOf(device);
+      }
 
-      // Claim the HID interface
-      await _claimInterface(device);
+      // Open device connection
+      if (js_util.getProperty(device, 'opened') != true) {
+        await js_util.promiseToFuture(js_util.callMethod(device, 'open', []));
+      }
 
       _currentDevice = device;
-      _currentDeviceId = deviceId;
+      _currentDeviceId = _deviceId(device, index);
+      _pipeline = SwipePipeline(productId: productId, duplicateWindow: _duplicateSwipeWindow);
 
       // Start monitoring for card swipes
-      _startMonitoring();
+      _startMonitoring(device);
 
       // Notify device connection
-      final deviceInfo = _createDeviceInfo(device);
-      _deviceConnectionController.add(deviceInfo);
+      _deviceConnectionController.add(_createDeviceInfo(device, index));
 
-      // Connected to Magtek device: ${deviceInfo.deviceName}
+      // Connected to Magtek device
       return true;
     } catch (e) {
       throw DeviceConnectionException(
@@ -167,6 +215,11 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
     }
   }
 
+  @override
+  Future<void> setRawResponseMode(RawResponseMode mode) async {
+    _rawResponseMode = mode;
+  }
+
   @override
   Future<void> disconnect() async {
     await _disconnectDevice();
@@ -179,173 +232,200 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
 
   Future<void> _disconnectDevice() async {
     try {
-      _stopMonitoring();
+      final device = _currentDevice;
+      if (device == null) {
+        return;
+      }
 
-      if (_currentDevice != null) {
-        // Close the device connection
-        await js_util.promiseToFuture(
-          js_util.callMethod(_currentDevice!, 'close', [])
-        );
-        
-        _currentDevice = null;
-        _currentDeviceId = null;
-        // Disconnected from Magtek device
+      _stopMonitoring(device);
+      final deviceInfo = _disconnectedDeviceInfo(device);
+      _currentDevice = null;
+      _currentDeviceId = null;
+
+      // Close the device connection
+      if (js_util.getProperty(device, 'opened') == true) {
+        await js_util.promiseToFuture(js_util.callMethod(device, 'close', []));
       }
+      _deviceDisconnectionController.add(deviceInfo);
+      // Disconnected from Magtek device
     } catch (e) {
       // Error disconnecting device: $e
     }
   }
 
-  void _startMonitoring() {
-    if (_isMonitoring || _currentDevice == null) return;
+  void _startMonitoring(Object device) {
+    final listener = js.allowInterop((Object event) => _onInputReport(device, event));
+    _inputReportListener = listener;
+    js_util.callMethod(device, 'addEventListener', ['inputreport', listener]);
 
-    _isMonitoring = true;
-    _monitoringTimer = Timer.periodic(const Duration(milliseconds: 50), (_) {
-      _readFromDevice();
+    // An unplugged reader fires disconnect on navigator.hid, not on itself
+    final onDisconnect = js.allowInterop((Object event) {
+      if (identical(js_util.getProperty(event, 'device'), _currentDevice)) {
+        _disconnectDevice();
+      }
     });
-    
+    _disconnectListener = onDisconnect;
+    js_util.callMethod(_hid(), 'addEventListener', ['disconnect', onDisconnect]);
+
     // Started device monitoring
   }
 
-  void _stopMonitoring() {
-    _isMonitoring = false;
-    _monitoringTimer?.cancel();
-    _monitoringTimer = null;
+  void _stopMonitoring(Object device) {
+    if (_inputReportListener != null) {
+      js_util.callMethod(device, 'removeEventListener', ['inputreport', _inputReportListener]);
+      _inputReportListener = null;
+    }
+    if (_disconnectListener != null) {
+      js_util.callMethod(_hid(), 'removeEventListener', ['disconnect', _disconnectListener]);
+      _disconnectListener = null;
+    }
+
+    _gapTimer?.cancel();
+    _gapTimer = null;
+    // A swipe cut off by the disconnect is dropped, as the native managers do
+    _pipeline = null;
+    _flushSwipes();
     // Stopped device monitoring
   }
 
-  Future<void> _readFromDevice() async {
-    if (_currentDevice == null || !_isMonitoring) return;
+  void _onInputReport(Object device, Object event) {
+    final pipeline = _pipeline;
+    if (pipeline == null || !identical(device, _currentDevice)) {
+      return;
+    }
 
-    try {
-      // Try to read from HID interrupt endpoint
-      final result = await js_util.promiseToFuture(
-        js_util.callMethod(_currentDevice!, 'transferIn', [1, 64]) // endpoint 1, 64 bytes
-      );
+    // WebHID hands over the report ID apart from its data; the pipeline
+    // takes them together, as hidapi reads them
+    final reportId = js_util.getProperty(event, 'reportId') as int;
+    final ByteData data = js_util.getProperty(event, 'data');
+    final report = Uint8List(data.lengthInBytes + 1);
+    report[0] = reportId;
+    report.setRange(1, report.length, data.buffer.asUint8List(data.offsetInBytes, data.lengthInBytes));
+
+    final now = _clock.elapsed;
+    _takeSwipe(pipeline.checkTimeout(now));
+    _takeSwipe(pipeline.addReport(report, now));
+    _scheduleGapTimeout(pipeline, now);
+  }
 
-      final status = js_util.getProperty(result, 'status') as String;
-      if (status == 'ok') {
-        final data = js_util.getProperty(result, 'data');
-        final buffer = js_util.getProperty(data, 'buffer');
-        
-        if (buffer != null) {
-          final bytes = Uint8List.fromList(
-            List<int>.from(js_util.getProperty(buffer, 'data') ?? [])
-          );
-          
-          if (bytes.isNotEmpty) {
-            final cardData = _parseInputReport(bytes);
-            if (cardData.track1?.rawData?.isNotEmpty == true ||
-                cardData.track2?.rawData?.isNotEmpty == true ||
-                cardData.track3?.rawData?.isNotEmpty == true) {
-              _cardSwipeController.add(cardData);
-              // Card swipe detected via WebUSB
-            }
-          }
-        }
-      }
-    } catch (e) {
-      // Ignore read errors for now (device might not have data)
-      // print('Read error: $e');
+  // Complete a frame whose reports stop arriving, as the native read loop's
+  // poll timeout does
+  void _scheduleGapTimeout(SwipePipeline pipeline, Duration now) {
+    _gapTimer?.cancel();
+    _gapTimer = null;
+
+    final remaining = pipeline.timeUntilTimeout(now);
+    if (remaining == null) {
+      return;
     }
+    _gapTimer = Timer(remaining, () {
+      _gapTimer = null;
+      if (identical(_pipeline, pipeline)) {
+        final checkedAt = _clock.elapsed;
+        _takeSwipe(pipeline.checkTimeout(checkedAt));
+        _scheduleGapTimeout(pipeline, checkedAt);
+      }
+    });
   }
 
-  CardData _parseInputReport(Uint8List data) {
-    final timestamp = DateTime.now();
-    final rawResponse = data.map((b) => b.toRadixString(16).padLeft(2, '0')).join(' ');
-
-    if (data.length < 2) {
-      return CardData(
-        track1: null,
-        track2: null, 
-        track3: null,
-        timestamp: timestamp,
-        hasValidData: false,
-        deviceId: _currentDeviceId,
-        rawResponse: rawResponse,
-      );
+  void _takeSwipe(PipelineSwipe? swipe) {
+    if (swipe == null) {
+      return;
     }
 
-    // Convert to string, skipping first byte (report ID)
-    final dataString = String.fromCharCodes(
-      data.skip(1).where((byte) => byte >= 0x20 && byte <= 0x7E)
+    final cardData = CardData.fromRawTracks(
+      track1Data: swipe.tracks[0],
+      track2Data: swipe.tracks[1],
+      track3Data: swipe.tracks[2],
+      deviceId: _currentDeviceId,
+      rawResponse: _rawResponseMode == RawResponseMode.hex ? ReportParser.formatHex(swipe.frame) : null,
+      rawBytes: _rawResponseMode == RawResponseMode.binary ? swipe.frame : null,
     );
 
-    if (dataString.isEmpty) {
-      return CardData(
-        track1: null,
-        track2: null,
-        track3: null,
-        timestamp: timestamp,
-        hasValidData: false,
-        deviceId: _currentDeviceId,
-        rawResponse: rawResponse,
-      );
+    final batching = _swipeBatching;
+    if (batching == null) {
+      _cardSwipeController.add(cardData);
+      return;
     }
 
-    // Parse track data
-    String? track1;
-    String? track2;
-    String? track3;
-
-    // Track 1: Starts with '%', ends with '?'
-    final track1Start = dataString.indexOf('%');
-    if (track1Start != -1) {
-      final track1End = dataString.indexOf('?', track1Start);
-      if (track1End != -1) {
-        track1 = dataString.substring(track1Start, track1End + 1);
-      }
+    _pendingSwipes.add(cardData);
+    if (_pendingSwipes.length >= batching.maxEvents) {
+      _flushSwipes();
+    } else if (_batchTimer == null) {
+      // With lowLatency the batch goes once the reports already queued have
+      // been handled, rather than after the whole window
+      _batchTimer = Timer(batching.lowLatency ? Duration.zero : batching.window, _flushSwipes);
     }
+  }
 
-    // Track 2: Starts with ';', ends with '?'
-    final track2Start = dataString.indexOf(';');
-    if (track2Start != -1) {
-      final track2End = dataString.indexOf('?', track2Start);
-      if (track2End != -1) {
-        track2 = dataString.substring(track2Start, track2End + 1);
-      }
+  void _flushSwipes() {
+    _batchTimer?.cancel();
+    _batchTimer = null;
+    if (_pendingSwipes.isEmpty) {
+      return;
     }
 
-    return CardData.fromRawTracks(
-      track1Data: track1,
-      track2Data: track2,
-      track3Data: track3,
-      deviceId: _currentDeviceId,
-      rawResponse: rawResponse,
+    final swipes = List<CardData>.of(_pendingSwipes);
+    _pendingSwipes.clear();
+    for (final cardData in swipes) {
+      _cardSwipeController.add(cardData);
+    }
+  }
+
+  String _deviceId(Object device, int index) {
+    final vendorId = js_util.getProperty(device, 'vendorId') as int;
+    final productId = js_util.getProperty(device, 'productId') as int;
+    // WebHID exposes no serial number, so readers of one model are told
+    // apart by their place among the granted devices
+    return '${vendorId.toRadixString(16)}:${productId.toRadixString(16)}:$index';
+  }
+
+  DeviceInfo _createDeviceInfo(Object device, int index) {
+    final vendorId = js_util.getProperty(device, 'vendorId') as int;
+    final productId = js_util.getProperty(device, 'productId') as int;
+    final productName = js_util.getProperty(device, 'productName') as String?;
+
+    return DeviceInfo(
+      deviceId: _deviceId(device, index),
+      deviceName: _getDeviceName(vendorId, productId),
+      vendorId: vendorId,
+      productId: productId,
+      devicePath: 'WebHID',
+      isConnected: identical(_currentDevice, device),
+      additionalProperties: productName == null ? null : {'productName': productName},
     );
   }
 
-  DeviceInfo _createDeviceInfo(Object device) {
+  DeviceInfo _disconnectedDeviceInfo(Object device) {
     final vendorId = js_util.getProperty(device, 'vendorId') as int;
     final productId = js_util.getProperty(device, 'productId') as int;
-    final serialNumber = js_util.getProperty(device, 'serialNumber') as String?;
-    
+
     return DeviceInfo(
-      deviceId: '${vendorId.toRadixString(16)}:${productId.toRadixString(16)}:${serialNumber ?? 'unknown'}',
+      deviceId: _currentDeviceId ?? _deviceId(device, 0),
       deviceName: _getDeviceName(vendorId, productId),
       vendorId: vendorId,
       productId: productId,
-      serialNumber: serialNumber,
-      devicePath: 'WebUSB',
-      isConnected: _currentDevice == device,
+      devicePath: 'WebHID',
+      isConnected: false,
     );
   }
 
-  bool _isWebUsbSupported() {
-    return js_util.hasProperty(html.window.navigator, 'usb');
+  Object _hid() {
+    return js_util.getProperty(html.window.navigator, 'hid');
+  }
+
+  bool _isWebHidSupported() {
+    return js_util.hasProperty(html.window.navigator, 'hid');
   }
 
-  Future<List<Object>> _getUsbDevices() async {
-    final usb = js_util.getProperty(html.window.navigator, 'usb');
-    final devicesPromise = js_util.callMethod(usb, 'getDevices', []);
-    final devices = await js_util.promiseToFuture<List<Object>>(devicesPromise);
-    return devices;
+  Future<List<Object>> _getHidDevices() async {
+    final devicesPromise = js_util.callMethod(_hid(), 'getDevices', []);
+    final devices = await js_util.promiseToFuture<List<Object?>>(devicesPromise);
+    return devices.whereType<Object>().toList();
   }
 
-  Future<Object?> _requestUsbDevice() async {
+  Future<Object?> _requestHidDevice() async {
     try {
-      final usb = js_util.getProperty(html.window.navigator, 'usb');
-      
       // Create device filters for Magtek devices
       final filters = _magtekProductIds.map((productId) => {
         'vendorId': _magtekVendorId,
@@ -353,28 +433,17 @@ class MagtekCardReaderWeb extends MagtekCardReaderPlatform {
       }).toList();
 
       final options = {'filters': filters};
-      
-      final devicePromise = js_util.callMethod(usb, 'requestDevice', [js_util.jsify(options)]);
-      return await js_util.promiseToFuture<Object?>(devicePromise);
+
+      // Resolves to the devices the user picked, none if they cancelled
+      final devicePromise = js_util.callMethod(_hid(), 'requestDevice', [js_util.jsify(options)]);
+      final devices = await js_util.promiseToFuture<List<Object?>>(devicePromise);
+      return devices.isEmpty ? null : devices.first;
     } catch (e) {
       // User cancelled device selection or error: $e
       return null;
     }
   }
 
-  Future<void> _selectConfiguration(Object device, int configurationValue) async {
-    await js_util.promiseToFuture(
-      js_util.callMethod(device, 'selectConfiguration', [configurationValue])
-    );
-  }
-
-  Future<void> _claimInterface(Object device) async {
-    // Claim the HID interface (usually interface 0)
-    await js_util.promiseToFuture(
-      js_util.callMethod(device, 'claimInterface', [0])
-    );
-  }
-
   bool _isMagtekDevice(int vendorId, int productId) {
     return vendorId == _magtekVendorId && _magtekProductIds.contains(productId);
   }
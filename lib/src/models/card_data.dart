@@ -1,3 +1,8 @@
+import 'dart:typed_data';
+
+import 'encrypted_swipe_data.dart';
+import 'swipe_timings.dart';
+import 'swipe_validation.dart';
 import 'track_data.dart';
 
 /// Represents complete card data from all three tracks of a magnetic stripe card.
@@ -20,9 +25,21 @@ class CardData {
   /// Device ID that read the card.
   final String? deviceId;
   
-  /// Raw device response for debugging purposes.
+  /// Raw device response as hex, when the raw response mode is hex.
   final String? rawResponse;
 
+  /// Raw device response bytes, when the raw response mode is binary.
+  final Uint8List? rawBytes;
+
+  /// Native stage timestamps of the swipe (Linux/Windows).
+  final SwipeTimings? timings;
+
+  /// Native LRC and Luhn verdict on the swipe (Linux/Windows).
+  final SwipeValidation? validation;
+
+  /// Encrypted fields, when a MagneSafe reader sent the swipe (Linux/Windows).
+  final EncryptedSwipeData? encrypted;
+
   const CardData({
     this.track1,
     this.track2,
@@ -31,8 +48,44 @@ class CardData {
     required this.hasValidData,
     this.deviceId,
     this.rawResponse,
+    this.rawBytes,
+    this.timings,
+    this.validation,
+    this.encrypted,
   });
 
+  /// Create CardData from tracks that are already decoded, such as those
+  /// the native decoder sends.
+  factory CardData.fromDecodedTracks({
+    TrackData? track1,
+    TrackData? track2,
+    TrackData? track3,
+    String? deviceId,
+    String? rawResponse,
+    Uint8List? rawBytes,
+    SwipeTimings? timings,
+    SwipeValidation? validation,
+    EncryptedSwipeData? encrypted,
+  }) {
+    bool hasValidData = (track1?.isDecoded == true) ||
+                       (track2?.isDecoded == true) ||
+                       (track3?.isDecoded == true);
+
+    return CardData(
+      track1: track1,
+      track2: track2,
+      track3: track3,
+      timestamp: DateTime.now(),
+      hasValidData: hasValidData,
+      deviceId: deviceId,
+      rawResponse: rawResponse,
+      rawBytes: rawBytes,
+      timings: timings,
+      validation: validation,
+      encrypted: encrypted,
+    );
+  }
+
   /// Create CardData from raw track data strings.
   factory CardData.fromRawTracks({
     String? track1Data,
@@ -40,6 +93,8 @@ class CardData {
     String? track3Data,
     String? deviceId,
     String? rawResponse,
+    Uint8List? rawBytes,
+    SwipeTimings? timings,
   }) {
     TrackData? track1;
     TrackData? track2;
@@ -57,18 +112,14 @@ class CardData {
       track3 = TrackData.fromRawData(3, track3Data);
     }
 
-    bool hasValidData = (track1?.isDecoded == true) ||
-                       (track2?.isDecoded == true) ||
-                       (track3?.isDecoded == true);
-
-    return CardData(
+    return CardData.fromDecodedTracks(
       track1: track1,
       track2: track2,
       track3: track3,
-      timestamp: DateTime.now(),
-      hasValidData: hasValidData,
       deviceId: deviceId,
       rawResponse: rawResponse,
+      rawBytes: rawBytes,
+      timings: timings,
     );
   }
 
@@ -207,6 +258,7 @@ class CardData {
       'cardBrand': cardBrand,
       'maskedAccountNumber': maskedAccountNumber,
       'isValidPaymentCard': isValidPaymentCard,
+      'validation': validation?.name,
     };
   }
 
@@ -220,6 +272,7 @@ class CardData {
       hasValidData: json['hasValidData'] as bool,
       deviceId: json['deviceId'] as String?,
       rawResponse: json['rawResponse'] as String?,
+      validation: SwipeValidation.fromName(json['validation'] as String?),
     );
   }
 }
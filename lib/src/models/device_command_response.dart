@@ -0,0 +1,31 @@
+import 'dart:typed_data';
+
+/// A reader's response to a command sent with `sendCommand` (Linux/Windows).
+class DeviceCommandResponse {
+  /// The reader's result code; 0 means the command succeeded.
+  final int resultCode;
+
+  /// Data the reader returned, such as a property value.
+  final Uint8List data;
+
+  const DeviceCommandResponse({
+    required this.resultCode,
+    required this.data,
+  });
+
+  /// Create from the result map of a `sendCommand` call.
+  factory DeviceCommandResponse.fromMap(Map<dynamic, dynamic> map) {
+    return DeviceCommandResponse(
+      resultCode: map['resultCode'] as int? ?? 0,
+      data: map['data'] as Uint8List? ?? Uint8List(0),
+    );
+  }
+
+  /// Whether the reader accepted the command.
+  bool get isSuccess => resultCode == 0;
+
+  @override
+  String toString() {
+    return 'DeviceCommandResponse(resultCode: $resultCode, data: ${data.length} bytes)';
+  }
+}
@@ -0,0 +1,66 @@
+/// Counters for one card reader, kept by the native plugin since it was
+/// first opened (Linux/Windows).
+class DeviceMetrics {
+  /// Input reports read from the device.
+  final int reportsRead;
+
+  /// Bytes in those reports.
+  final int bytesRead;
+
+  /// Swipes in which at least one track was found.
+  final int swipesParsed;
+
+  /// Swipes completed because the reader went quiet rather than by an end
+  /// marker; often a sign of a misread.
+  final int partialFrames;
+
+  /// Swipes in which no track was found.
+  final int invalidFrames;
+
+  /// Failed HID reads.
+  final int readErrors;
+
+  /// Swipes dropped because the app fell behind.
+  final int queueOverflows;
+
+  /// Swipes dropped as repeats of the one before, within the
+  /// `duplicateSwipeWindow` given to `initialize`.
+  final int duplicateSwipes;
+
+  /// Times the device was opened again after its first open.
+  final int reconnects;
+
+  const DeviceMetrics({
+    required this.reportsRead,
+    required this.bytesRead,
+    required this.swipesParsed,
+    required this.partialFrames,
+    required this.invalidFrames,
+    required this.readErrors,
+    required this.queueOverflows,
+    required this.duplicateSwipes,
+    required this.reconnects,
+  });
+
+  /// Create from one device's entry in the `getMetrics` result.
+  factory DeviceMetrics.fromMap(Map<dynamic, dynamic> map) {
+    return DeviceMetrics(
+      reportsRead: map['reportsRead'] as int? ?? 0,
+      bytesRead: map['bytesRead'] as int? ?? 0,
+      swipesParsed: map['swipesParsed'] as int? ?? 0,
+      partialFrames: map['partialFrames'] as int? ?? 0,
+      invalidFrames: map['invalidFrames'] as int? ?? 0,
+      readErrors: map['readErrors'] as int? ?? 0,
+      queueOverflows: map['queueOverflows'] as int? ?? 0,
+      duplicateSwipes: map['duplicateSwipes'] as int? ?? 0,
+      reconnects: map['reconnects'] as int? ?? 0,
+    );
+  }
+
+  @override
+  String toString() {
+    return 'DeviceMetrics(reports: $reportsRead, swipes: $swipesParsed, '
+           'partial: $partialFrames, invalid: $invalidFrames, errors: $readErrors, '
+           'overflows: $queueOverflows, duplicates: $duplicateSwipes, reconnects: $reconnects)';
+  }
+}
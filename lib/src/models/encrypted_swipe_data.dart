@@ -0,0 +1,68 @@
+import 'dart:typed_data';
+
+/// Encrypted fields of a swipe from a MagneSafe reader such as the eDynamo
+/// or uDynamo (Linux/Windows).
+///
+/// The tracks of such a swipe are the reader's masked ones unless a native
+/// track decryptor was installed and decrypted them; [encryptedTracks] and
+/// [ksn] are what a payment processor or HSM needs to decrypt them itself.
+class EncryptedSwipeData {
+  /// DUKPT key serial number the tracks were encrypted under.
+  final Uint8List ksn;
+
+  /// The reader's own serial number.
+  final String deviceSerialNumber;
+
+  /// Ciphertext of track 1-3; empty for a track the card doesn't have.
+  final List<Uint8List> encryptedTracks;
+
+  /// Encrypted MagnePrint card authentication data.
+  final Uint8List magnePrint;
+
+  /// MagnePrint status word as the reader reported it.
+  final int magnePrintStatus;
+
+  /// Encryption status word as the reader reported it.
+  final int encryptionStatus;
+
+  /// Encrypted session ID.
+  final Uint8List sessionId;
+
+  /// Whether the native track decryptor supplied the swipe's tracks.
+  final bool decrypted;
+
+  const EncryptedSwipeData({
+    required this.ksn,
+    required this.deviceSerialNumber,
+    required this.encryptedTracks,
+    required this.magnePrint,
+    required this.magnePrintStatus,
+    required this.encryptionStatus,
+    required this.sessionId,
+    required this.decrypted,
+  });
+
+  /// Create from the `encrypted` map of a card swipe event.
+  factory EncryptedSwipeData.fromMap(Map<dynamic, dynamic> map) {
+    final tracks = map['encryptedTracks'] as List? ?? const [];
+    return EncryptedSwipeData(
+      ksn: map['ksn'] as Uint8List? ?? Uint8List(0),
+      deviceSerialNumber: map['deviceSerial'] as String? ?? '',
+      encryptedTracks: tracks.map((track) => track as Uint8List).toList(),
+      magnePrint: map['magnePrint'] as Uint8List? ?? Uint8List(0),
+      magnePrintStatus: map['magnePrintStatus'] as int? ?? 0,
+      encryptionStatus: map['encryptionStatus'] as int? ?? 0,
+      sessionId: map['sessionId'] as Uint8List? ?? Uint8List(0),
+      decrypted: map['decrypted'] as bool? ?? false,
+    );
+  }
+
+  /// Hex form of [ksn], as processors usually take it.
+  String get ksnHex => ksn.map((b) => b.toRadixString(16).padLeft(2, '0')).join().toUpperCase();
+
+  @override
+  String toString() {
+    return 'EncryptedSwipeData(ksn: $ksnHex, deviceSerialNumber: $deviceSerialNumber, '
+           'decrypted: $decrypted)';
+  }
+}
@@ -0,0 +1,20 @@
+/// How much the native plugin logs, most severe first (Linux/Windows).
+///
+/// Each level includes the ones above it. Every log site is also rate
+/// limited, so a failing reader cannot flood the output.
+enum MagtekLogLevel {
+  /// Nothing.
+  off,
+
+  /// Failures that stop the plugin from working.
+  error,
+
+  /// Failed reads, opens and drops (the default).
+  warning,
+
+  /// Devices opened and closed, monitoring started and stopped.
+  info,
+
+  /// Every swipe.
+  debug,
+}
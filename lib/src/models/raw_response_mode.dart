@@ -0,0 +1,11 @@
+/// Controls what a [CardData] carries of the raw report a swipe was parsed from.
+enum RawResponseMode {
+  /// No raw payload; the cheapest mode for production use.
+  off,
+
+  /// [CardData.rawResponse] as space-separated hex (the default).
+  hex,
+
+  /// [CardData.rawBytes] with the report bytes as sent by the reader.
+  binary,
+}
@@ -0,0 +1,39 @@
+/// Settings for delivering card swipe events in batches.
+///
+/// With batching on, the Linux and Windows plugins gather swipes and send
+/// them across the event channel together, which cuts per-event channel
+/// overhead when many readers swipe at once. [MagtekCardReader.onCardSwipe]
+/// still emits one [CardData] per swipe. The web plugin batches the same
+/// way, though it has no channel to save on; Android ignores batching.
+class SwipeBatchOptions {
+  /// Longest time a swipe waits for others to join its batch.
+  final Duration window;
+
+  /// Batch size that is sent straight away, without waiting for [window].
+  final int maxEvents;
+
+  /// Send the batch as soon as no more reports are pending instead of
+  /// waiting out [window], so a lone swipe is not delayed.
+  final bool lowLatency;
+
+  const SwipeBatchOptions({
+    this.window = const Duration(milliseconds: 10),
+    this.maxEvents = 32,
+    this.lowLatency = true,
+  }) : assert(maxEvents >= 1);
+
+  /// Convert to the map sent with `initialize`.
+  Map<String, dynamic> toMap() {
+    return {
+      // The plugins need at least a 1 ms window
+      'windowMs': window.inMilliseconds < 1 ? 1 : window.inMilliseconds,
+      'maxEvents': maxEvents,
+      'lowLatency': lowLatency,
+    };
+  }
+
+  @override
+  String toString() {
+    return 'SwipeBatchOptions(window: $window, maxEvents: $maxEvents, lowLatency: $lowLatency)';
+  }
+}
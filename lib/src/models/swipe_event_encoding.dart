@@ -0,0 +1,16 @@
+/// How card swipe events are encoded on the `magtek_card_reader/card_swipe`
+/// event channel.
+enum SwipeEventEncoding {
+  /// A string-keyed map per event (the default).
+  map,
+
+  /// A versioned binary record per event; smaller to send and faster to
+  /// decode. Used on Linux and Windows, other platforms keep sending maps.
+  packed,
+
+  /// Packed records posted to a dart:ffi native port by the reader's read
+  /// thread, skipping the platform thread and the event channel. Swipes
+  /// are not batched this way. Used on Linux and Windows; elsewhere, and
+  /// wherever the native library can't be loaded, this is [packed].
+  nativePort,
+}
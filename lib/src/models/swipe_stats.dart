@@ -0,0 +1,92 @@
+/// Latency percentiles of one stage of swipe delivery, in nanoseconds.
+///
+/// Percentiles come from a native histogram with eight buckets per power of
+/// two, so they read high by at most an eighth.
+class StageLatency {
+  /// Swipes recorded.
+  final int count;
+
+  final int p50Ns;
+  final int p90Ns;
+  final int p99Ns;
+  final int maxNs;
+  final int meanNs;
+
+  const StageLatency({
+    required this.count,
+    required this.p50Ns,
+    required this.p90Ns,
+    required this.p99Ns,
+    required this.maxNs,
+    required this.meanNs,
+  });
+
+  /// No swipes recorded.
+  static const StageLatency empty =
+      StageLatency(count: 0, p50Ns: 0, p90Ns: 0, p99Ns: 0, maxNs: 0, meanNs: 0);
+
+  factory StageLatency.fromMap(Map<dynamic, dynamic> map) {
+    return StageLatency(
+      count: map['count'] as int? ?? 0,
+      p50Ns: map['p50Ns'] as int? ?? 0,
+      p90Ns: map['p90Ns'] as int? ?? 0,
+      p99Ns: map['p99Ns'] as int? ?? 0,
+      maxNs: map['maxNs'] as int? ?? 0,
+      meanNs: map['meanNs'] as int? ?? 0,
+    );
+  }
+
+  @override
+  String toString() {
+    return 'StageLatency(count: $count, p50: $p50Ns ns, p90: $p90Ns ns, '
+           'p99: $p99Ns ns, max: $maxNs ns)';
+  }
+}
+
+/// Swipe latency statistics from [MagtekCardReader.getStats], broken down
+/// by the stages of [SwipeTimings].
+class SwipeStats {
+  /// First report to complete frame.
+  final StageLatency assembly;
+
+  /// Complete frame to parsed tracks.
+  final StageLatency parse;
+
+  /// Parsed tracks to queued for the platform thread.
+  final StageLatency queue;
+
+  /// Queued to handed to the event channel.
+  final StageLatency delivery;
+
+  /// First report to handed to the event channel.
+  final StageLatency total;
+
+  const SwipeStats({
+    required this.assembly,
+    required this.parse,
+    required this.queue,
+    required this.delivery,
+    required this.total,
+  });
+
+  /// Create from the map returned by the `getStats` method.
+  factory SwipeStats.fromMap(Map<dynamic, dynamic> map) {
+    StageLatency stage(String name) {
+      final value = map[name];
+      return value is Map ? StageLatency.fromMap(value) : StageLatency.empty;
+    }
+
+    return SwipeStats(
+      assembly: stage('assembly'),
+      parse: stage('parse'),
+      queue: stage('queue'),
+      delivery: stage('delivery'),
+      total: stage('total'),
+    );
+  }
+
+  @override
+  String toString() {
+    return 'SwipeStats(total: $total)';
+  }
+}
@@ -0,0 +1,60 @@
+/// Monotonic nanosecond timestamps of one swipe's trip through the native
+/// plugin, from the reader's first report to the event channel.
+///
+/// The values come from the native steady clock and are only meaningful
+/// relative to each other. A stage the swipe never reached is 0.
+class SwipeTimings {
+  /// First HID report of the swipe received.
+  final int firstReportNs;
+
+  /// Reports assembled into a complete frame.
+  final int frameCompleteNs;
+
+  /// Tracks parsed out of the frame.
+  final int parsedNs;
+
+  /// Queued for the platform thread.
+  final int queuedNs;
+
+  /// Handed to the event channel.
+  final int deliveredNs;
+
+  const SwipeTimings({
+    required this.firstReportNs,
+    required this.frameCompleteNs,
+    required this.parsedNs,
+    required this.queuedNs,
+    required this.deliveredNs,
+  });
+
+  /// Create from the `timings` map of a card swipe event.
+  factory SwipeTimings.fromMap(Map<dynamic, dynamic> map) {
+    return SwipeTimings(
+      firstReportNs: map['firstReportNs'] as int? ?? 0,
+      frameCompleteNs: map['frameCompleteNs'] as int? ?? 0,
+      parsedNs: map['parsedNs'] as int? ?? 0,
+      queuedNs: map['queuedNs'] as int? ?? 0,
+      deliveredNs: map['deliveredNs'] as int? ?? 0,
+    );
+  }
+
+  /// Time from the first report to the event channel.
+  Duration get total => Duration(microseconds: (deliveredNs - firstReportNs) ~/ 1000);
+
+  Map<String, int> toMap() {
+    return {
+      'firstReportNs': firstReportNs,
+      'frameCompleteNs': frameCompleteNs,
+      'parsedNs': parsedNs,
+      'queuedNs': queuedNs,
+      'deliveredNs': deliveredNs,
+    };
+  }
+
+  @override
+  String toString() {
+    return 'SwipeTimings(assembly: ${frameCompleteNs - firstReportNs} ns, '
+           'parse: ${parsedNs - frameCompleteNs} ns, queue: ${queuedNs - parsedNs} ns, '
+           'delivery: ${deliveredNs - queuedNs} ns)';
+  }
+}
@@ -0,0 +1,24 @@
+/// Verdict of the native LRC and Luhn checks on a swipe (Linux/Windows).
+enum SwipeValidation {
+  /// Every track read cleanly and the account number passes the Luhn check.
+  valid,
+
+  /// A track's LRC character did not match its data; the stripe was misread.
+  lrcError,
+
+  /// No track could be decoded.
+  formatError,
+
+  /// The tracks decoded, but the account number fails the Luhn check.
+  luhnError;
+
+  /// The value with the given native name, or null for an unknown one.
+  static SwipeValidation? fromName(String? name) {
+    for (final validation in values) {
+      if (validation.name == name) {
+        return validation;
+      }
+    }
+    return null;
+  }
+}
@@ -84,6 +84,49 @@ class TrackData {
     }
   }
 
+  /// Create a TrackData instance from the fields the native decoder sent
+  /// (one entry of a swipe event's `trackFields`), without parsing the
+  /// track again. Returns null for a track the swipe did not have.
+  static TrackData? fromNativeFields(int trackNumber, String? rawData, Map<dynamic, dynamic> fields) {
+    String? field(String key) {
+      final value = fields[key] as String?;
+      return value == null || value.isEmpty ? null : value;
+    }
+
+    switch (fields['status'] as String?) {
+      case 'absent':
+        return null;
+      case 'decoded':
+        final accountNumber = field('accountNumber');
+        return TrackData(
+          trackNumber: trackNumber,
+          rawData: rawData,
+          isDecoded: true,
+          accountNumber: trackNumber == 1 ? accountNumber : null,
+          primaryAccountNumber: trackNumber == 2 ? accountNumber : null,
+          cardholderName: field('cardholderName'),
+          expirationDate: field('expirationDate'),
+          serviceCode: field('serviceCode'),
+          discretionaryData: field('discretionaryData'),
+          additionalData: trackNumber == 3 ? fields['additionalData'] as String? : null,
+        );
+      case 'lrcError':
+        return TrackData(
+          trackNumber: trackNumber,
+          rawData: rawData,
+          isDecoded: false,
+          errorMessage: 'Track $trackNumber LRC mismatch',
+        );
+      default:
+        return TrackData(
+          trackNumber: trackNumber,
+          rawData: rawData,
+          isDecoded: false,
+          errorMessage: 'Invalid Track $trackNumber format',
+        );
+    }
+  }
+
   /// Parse Track 1 data (Format: %B + PAN + ^ + Name + ^ + Additional Data + ?)
   static TrackData _parseTrack1(String data) {
     if (!data.startsWith('%B') || !data.endsWith('?')) {
@@ -0,0 +1,3 @@
+/// Direct calls into the Linux/Windows plugin library; a stand-in that has
+/// no library where dart:ffi is unavailable.
+export 'magtek_native_stub.dart' if (dart.library.ffi) 'magtek_native_ffi.dart';
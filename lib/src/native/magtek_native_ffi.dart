@@ -0,0 +1,178 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart';
+
+import '../models/device_info.dart';
+
+/// ABI version these bindings were written against; see src/ffi_bridge.h.
+const int _abiVersion = 1;
+
+/// MAGTEK_FFI_STRING_SIZE.
+const int _stringSize = 256;
+
+/// MagtekFfiDevice.
+final class _FfiDevice extends Struct {
+  @Array(_stringSize)
+  external Array<Uint8> deviceId;
+
+  @Array(_stringSize)
+  external Array<Uint8> deviceName;
+
+  @Array(_stringSize)
+  external Array<Uint8> serialNumber;
+
+  @Array(_stringSize)
+  external Array<Uint8> devicePath;
+
+  @Uint16()
+  external int vendorId;
+
+  @Uint16()
+  external int productId;
+
+  @Int32()
+  external int isConnected;
+}
+
+typedef _VersionNative = Int32 Function();
+typedef _Version = int Function();
+typedef _GetDevicesNative = Int32 Function(Pointer<_FfiDevice> devices, Int32 capacity);
+typedef _GetDevices = int Function(Pointer<_FfiDevice> devices, int capacity);
+typedef _SetSwipePortNative = Void Function(Int64 port, Pointer<Void> postCObject);
+typedef _SetSwipePort = void Function(int port, Pointer<Void> postCObject);
+
+/// Direct calls into the Linux/Windows plugin library through the C ABI it
+/// exports, skipping the method codec and the hop to the platform thread.
+class MagtekNative {
+  MagtekNative._(DynamicLibrary library)
+      : _version = library.lookupFunction<_VersionNative, _Version>('magtek_ffi_version'),
+        _isConnected = library.lookupFunction<_VersionNative, _Version>('magtek_ffi_is_connected'),
+        _getDevices = library.lookupFunction<_GetDevicesNative, _GetDevices>('magtek_ffi_get_connected_devices'),
+        _setSwipePort = library.lookupFunction<_SetSwipePortNative, _SetSwipePort>('magtek_ffi_set_swipe_port');
+
+  final _Version _version;
+  final _Version _isConnected;
+  final _GetDevices _getDevices;
+  final _SetSwipePort _setSwipePort;
+
+  ReceivePort? _swipePort;
+
+  /// Readers to make room for on the first query; grown as needed.
+  int _deviceCapacity = 8;
+
+  static bool _opened = false;
+  static MagtekNative? _instance;
+
+  /// The plugin library's bindings, or null off Linux and Windows or when
+  /// the library doesn't export them.
+  static MagtekNative? get instance {
+    if (!_opened) {
+      _opened = true;
+      _instance = _open();
+    }
+    return _instance;
+  }
+
+  static MagtekNative? _open() {
+    final String name;
+    if (Platform.isLinux) {
+      name = 'libmagtek_card_reader_plugin.so';
+    } else if (Platform.isWindows) {
+      name = 'magtek_card_reader_plugin.dll';
+    } else {
+      return null;
+    }
+
+    try {
+      final native = MagtekNative._(DynamicLibrary.open(name));
+      if (native._version() != _abiVersion) {
+        debugPrint('Native ABI version ${native._version()} is not $_abiVersion; using the method channel');
+        return null;
+      }
+      return native;
+    } on ArgumentError catch (e) {
+      // Not loaded, as under `flutter test`, or built without the bindings
+      debugPrint('Native bindings unavailable: $e');
+      return null;
+    }
+  }
+
+  /// Whether at least one reader is open.
+  bool isConnected() => _isConnected() != 0;
+
+  /// The cached readers, or null when the method channel has to answer:
+  /// before initialize, or when the cache has to be rescanned.
+  List<DeviceInfo>? getConnectedDevices() {
+    while (true) {
+      final capacity = _deviceCapacity;
+      final devices = calloc<_FfiDevice>(capacity);
+      try {
+        final count = _getDevices(devices, capacity);
+        if (count < 0) {
+          return null;
+        }
+        if (count > capacity) {
+          _deviceCapacity = count;
+          continue;
+        }
+        return [
+          for (var i = 0; i < count; i++) _deviceInfo(devices[i]),
+        ];
+      } finally {
+        calloc.free(devices);
+      }
+    }
+  }
+
+  /// Receive each swipe as a packed record, posted by the reader's read
+  /// thread. Replaces any earlier listener.
+  bool listenForSwipes(void Function(Uint8List record) onRecord) {
+    stopListeningForSwipes();
+    final port = ReceivePort('magtek_card_reader swipes');
+    port.listen((message) {
+      if (message is Uint8List) {
+        onRecord(message);
+      }
+    });
+    _setSwipePort(port.sendPort.nativePort, NativeApi.postCObject.cast());
+    _swipePort = port;
+    return true;
+  }
+
+  /// Send swipes on the event channel again.
+  void stopListeningForSwipes() {
+    final port = _swipePort;
+    if (port == null) {
+      return;
+    }
+    _setSwipePort(0, nullptr);
+    port.close();
+    _swipePort = null;
+  }
+
+  static DeviceInfo _deviceInfo(_FfiDevice device) {
+    return DeviceInfo(
+      deviceId: _string(device.deviceId),
+      deviceName: _string(device.deviceName),
+      vendorId: device.vendorId,
+      productId: device.productId,
+      serialNumber: _string(device.serialNumber),
+      isConnected: device.isConnected != 0,
+      devicePath: _string(device.devicePath),
+    );
+  }
+
+  /// A NUL-terminated UTF-8 field.
+  static String _string(Array<Uint8> field) {
+    final bytes = <int>[];
+    for (var i = 0; i < _stringSize && field[i] != 0; i++) {
+      bytes.add(field[i]);
+    }
+    return utf8.decode(bytes);
+  }
+}
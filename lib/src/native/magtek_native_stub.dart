@@ -0,0 +1,21 @@
+import 'dart:typed_data';
+
+import '../models/device_info.dart';
+
+/// Stand-in for platforms without dart:ffi; there is never a library.
+class MagtekNative {
+  /// Always null here; callers use the method channel.
+  static MagtekNative? get instance => null;
+
+  /// Whether at least one reader is open.
+  bool isConnected() => false;
+
+  /// The cached readers, or null when the method channel has to answer.
+  List<DeviceInfo>? getConnectedDevices() => null;
+
+  /// Receive each swipe as a packed record; false if unavailable.
+  bool listenForSwipes(void Function(Uint8List record) onRecord) => false;
+
+  /// Send swipes on the event channel again.
+  void stopListeningForSwipes() {}
+}
@@ -0,0 +1,395 @@
+import 'dart:typed_data';
+
+/// Dart port of the native swipe pipeline (src/swipe_assembler.cc,
+/// src/report_parser.cc and src/swipe_deduplicator.cc), used where the C++
+/// core can't run, such as the web plugin.
+///
+/// Both implementations are held to the same behaviour by the vectors in
+/// test/conformance/swipe_pipeline_vectors.txt; a change to one needs the
+/// same change to the other and to the vectors.
+
+const int _track1Sentinel = 0x25; // '%'
+const int _track2Sentinel = 0x3B; // ';'
+const int _endSentinel = 0x3F; // '?'
+
+/// Rules that decide when the reports gathered for a swipe form a complete
+/// frame.
+class FramingRules {
+  /// Complete when a track end sentinel ('?') is followed by zero padding in
+  /// the same report.
+  final bool completeOnPadding;
+
+  /// Complete on a CR/LF end-of-swipe marker after the last track.
+  final bool completeOnNewline;
+
+  /// Offset (after the report ID) of a little-endian 16-bit total payload
+  /// length in the first report of a frame, or -1 if the reader sends none.
+  final int lengthHeaderOffset;
+
+  /// Complete a pending frame when no further report arrives within this
+  /// time.
+  final Duration gapTimeout;
+
+  const FramingRules({
+    this.completeOnPadding = true,
+    this.completeOnNewline = true,
+    this.lengthHeaderOffset = -1,
+    this.gapTimeout = const Duration(milliseconds: 20),
+  });
+
+  /// Readers that zero-pad every report, even mid-swipe (the report layout
+  /// column of src/magtek_products.h).
+  static const Set<int> _paddedMultiReportProducts = {0x0003, 0x0010};
+
+  /// Rules matching a Magtek reader's report layout.
+  factory FramingRules.forProduct(int productId) {
+    return FramingRules(
+      completeOnPadding: !_paddedMultiReportProducts.contains(productId),
+    );
+  }
+}
+
+/// Gathers the HID input reports that make up a single card swipe so that
+/// the tracks are parsed once per swipe instead of once per report.
+///
+/// A completed frame is the first report's ID byte followed by the payload
+/// of every report, in arrival order. Times are offsets from any fixed
+/// start, as a [Stopwatch] gives.
+class SwipeAssembler {
+  /// Reports kept for one frame; a full set completes it.
+  static const int maxReports = 8;
+
+  /// Longest report kept; the rest of a longer one is dropped.
+  static const int maxReportSize = 256;
+
+  FramingRules _rules;
+  final List<Uint8List> _reports = [];
+  int _payloadLength = 0;
+  int _expectedPayloadLength = 0;
+  bool _inTrack = false;
+  bool _hasTrack = false;
+  Duration _lastReportTime = Duration.zero;
+  Duration _frameStartTime = Duration.zero;
+
+  SwipeAssembler([FramingRules rules = const FramingRules()]) : _rules = rules;
+
+  /// Replace the framing rules; drops any partially gathered frame.
+  set rules(FramingRules rules) {
+    _rules = rules;
+    reset();
+  }
+
+  /// Whether reports are waiting for the rest of their swipe.
+  bool get hasPendingFrame => _reports.isNotEmpty;
+
+  /// When the first report of the last completed frame arrived.
+  Duration get frameStartTime => _frameStartTime;
+
+  /// Add one input report. Returns the frame it completes, if any.
+  Uint8List? addReport(Uint8List report, Duration now) {
+    if (report.isEmpty) {
+      return null;
+    }
+    if (report.length > maxReportSize) {
+      report = Uint8List.sublistView(report, 0, maxReportSize);
+    }
+
+    // Idle reports between swipes carry nothing worth buffering
+    if (_reports.isEmpty && !_hasPayload(report)) {
+      return null;
+    }
+
+    _reports.add(report);
+    _payloadLength += report.length - 1;
+    _lastReportTime = now;
+    if (_reports.length == 1) {
+      _frameStartTime = now;
+      if (_rules.lengthHeaderOffset >= 0) {
+        final offset = 1 + _rules.lengthHeaderOffset;
+        if (offset + 1 < report.length) {
+          _expectedPayloadLength = report[offset] | (report[offset + 1] << 8);
+        }
+      }
+    }
+
+    final bool complete;
+    if (_expectedPayloadLength > 0) {
+      // A length header is authoritative; sentinels may appear in binary data
+      complete = _payloadLength >= _expectedPayloadLength;
+    } else {
+      complete = _scanReport(report);
+    }
+
+    // A full set means the reader never sent an end marker; parse what we have
+    if (complete || _reports.length == maxReports) {
+      return _completeFrame();
+    }
+    return null;
+  }
+
+  /// Complete the pending frame if no report has arrived for the gap
+  /// timeout.
+  Uint8List? checkTimeout(Duration now) {
+    if (_reports.isEmpty || now - _lastReportTime < _rules.gapTimeout) {
+      return null;
+    }
+    return _completeFrame();
+  }
+
+  /// Time left before [checkTimeout] completes the pending frame, or null
+  /// if there is none.
+  Duration? timeUntilTimeout(Duration now) {
+    if (_reports.isEmpty) {
+      return null;
+    }
+    final remaining = _rules.gapTimeout - (now - _lastReportTime);
+    return remaining.isNegative ? Duration.zero : remaining;
+  }
+
+  /// Drop any partially gathered frame.
+  void reset() {
+    _reports.clear();
+    _payloadLength = 0;
+    _expectedPayloadLength = 0;
+    _inTrack = false;
+    _hasTrack = false;
+  }
+
+  /// Whether a report carries anything besides its report ID and padding.
+  static bool _hasPayload(Uint8List report) {
+    for (var i = 1; i < report.length; i++) {
+      if (report[i] >= 0x20 && report[i] <= 0x7E) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool _scanReport(Uint8List report) {
+    var trackEndedHere = false;
+
+    for (var i = 1; i < report.length; i++) {
+      final c = report[i];
+
+      if (_inTrack) {
+        if (c == _endSentinel) {
+          _inTrack = false;
+          _hasTrack = true;
+          trackEndedHere = true;
+        }
+        continue;
+      }
+
+      if (c == _track1Sentinel || c == _track2Sentinel) {
+        _inTrack = true;
+      } else if (c == 0x00 && trackEndedHere && _rules.completeOnPadding) {
+        return true;
+      } else if ((c == 0x0D || c == 0x0A) && _hasTrack && _rules.completeOnNewline) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  Uint8List _completeFrame() {
+    final frame = BytesBuilder(copy: false);
+    for (var i = 0; i < _reports.length; i++) {
+      // Keep the first report ID so the frame looks like a single report
+      frame.add(i == 0 ? _reports[i] : Uint8List.sublistView(_reports[i], 1));
+    }
+    reset();
+    return frame.takeBytes();
+  }
+}
+
+/// Finds the three tracks in a frame, as the native parser does.
+class ReportParser {
+  /// Tracks in a swipe.
+  static const int trackCount = 3;
+
+  ReportParser._();
+
+  /// The raw tracks of a frame, empty for a track that wasn't read, or null
+  /// if it holds no track at all.
+  static List<String>? parse(Uint8List frame) {
+    if (frame.length < 2) {
+      return null;
+    }
+
+    // Everything printable after the report ID
+    final text = String.fromCharCodes(frame.skip(1).where((byte) => byte >= 0x20 && byte <= 0x7E));
+
+    // Track 3 starts with ';' like track 2, or '+' on some readers. The
+    // readers send the tracks in order, so it is the next track after track
+    // 2; a swipe with track 3 alone reads as track 2.
+    final track1 = _findTrack(text, '%', 0);
+    final track2 = _findTrack(text, ';', 0);
+    final track3 = _findTrack(text, track2.isEmpty ? '+' : ';+', track2.end);
+
+    if (track1.isEmpty && track2.isEmpty && track3.isEmpty) {
+      return null;
+    }
+    return [track1.of(text), track2.of(text), track3.of(text)];
+  }
+
+  /// The native raw-response hex format: two digits and a space per byte.
+  static String formatHex(Uint8List data) {
+    final out = StringBuffer();
+    for (final byte in data) {
+      out
+        ..write(byte.toRadixString(16).padLeft(2, '0'))
+        ..write(' ');
+    }
+    return out.toString();
+  }
+
+  /// The first track from [from] on that starts with one of [startSentinels]
+  /// and runs through the next '?', or an empty one.
+  static _TrackSpan _findTrack(String text, String startSentinels, int from) {
+    var offset = from;
+    while (offset < text.length && !startSentinels.contains(text[offset])) {
+      offset++;
+    }
+    if (offset >= text.length) {
+      return const _TrackSpan(0, 0);
+    }
+
+    final end = text.indexOf('?', offset);
+    return end == -1 ? const _TrackSpan(0, 0) : _TrackSpan(offset, end + 1);
+  }
+}
+
+/// Where a track sits in the parser's text; empty when start == end.
+class _TrackSpan {
+  final int start;
+  final int end;
+
+  const _TrackSpan(this.start, this.end);
+
+  bool get isEmpty => start == end;
+
+  String of(String text) => text.substring(start, end);
+}
+
+/// Recognizes repeats of a swipe: the same card read again within a time
+/// window. Tracks are compared each on their own, so a repeat in which one
+/// track misread still matches on the others.
+///
+/// The native filter compares 64-bit FNV-1a hashes, which JavaScript numbers
+/// can't hold; this one keeps the tracks themselves, which gives the same
+/// verdicts.
+class SwipeDeduplicator {
+  List<String>? _lastTracks;
+  Duration _lastTime = Duration.zero;
+
+  /// Whether a swipe with [tracks] (empty for a missing track), completed at
+  /// [now], shares a track with the last swipe seen less than [window]
+  /// before. Each repeat restarts the window, so a card swiped back and
+  /// forth stays suppressed until it is put down.
+  bool isRepeat(List<String> tracks, Duration now, Duration window) {
+    final last = _lastTracks;
+    var repeat = false;
+    if (last != null && now - _lastTime < window) {
+      for (var i = 0; i < tracks.length; i++) {
+        if (tracks[i].isNotEmpty && tracks[i] == last[i]) {
+          repeat = true;
+          break;
+        }
+      }
+    }
+
+    if (repeat) {
+      // A track the first read missed identifies the card from now on too
+      for (var i = 0; i < tracks.length; i++) {
+        if (last![i].isEmpty) {
+          last[i] = tracks[i];
+        }
+      }
+    } else {
+      _lastTracks = List<String>.of(tracks);
+    }
+    _lastTime = now;
+    return repeat;
+  }
+
+  /// Forget the last swipe.
+  void reset() {
+    _lastTracks = null;
+  }
+}
+
+/// One swipe out of a [SwipePipeline].
+class PipelineSwipe {
+  /// The reassembled frame, starting with the first report's ID.
+  final Uint8List frame;
+
+  /// Raw track 1, 2 and 3, empty for a track that wasn't read.
+  final List<String> tracks;
+
+  /// When the first report of the swipe arrived.
+  final Duration startTime;
+
+  /// When the frame completed.
+  final Duration completeTime;
+
+  const PipelineSwipe(this.frame, this.tracks, this.startTime, this.completeTime);
+}
+
+/// The stages one reader's reports go through, in the order the native
+/// read thread runs them: reassembly, track parsing, then the repeat filter.
+class SwipePipeline {
+  final SwipeAssembler _assembler;
+  final SwipeDeduplicator _deduplicator = SwipeDeduplicator();
+
+  /// Repeat-swipe window; null or zero turns the filter off.
+  Duration? duplicateWindow;
+
+  /// Frames that held tracks but were dropped as repeats.
+  int duplicates = 0;
+
+  SwipePipeline({required int productId, this.duplicateWindow})
+      : _assembler = SwipeAssembler(FramingRules.forProduct(productId));
+
+  /// Whether reports are waiting for the rest of their swipe.
+  bool get hasPendingFrame => _assembler.hasPendingFrame;
+
+  /// Time left before [checkTimeout] completes the pending frame, or null
+  /// if there is none.
+  Duration? timeUntilTimeout(Duration now) => _assembler.timeUntilTimeout(now);
+
+  /// Feed one input report, its report ID first. Returns the swipe it
+  /// completes, if any.
+  PipelineSwipe? addReport(Uint8List report, Duration now) {
+    return _take(_assembler.addReport(report, now), now);
+  }
+
+  /// Complete a frame whose reports stopped arriving. Returns its swipe, if
+  /// any.
+  PipelineSwipe? checkTimeout(Duration now) {
+    return _take(_assembler.checkTimeout(now), now);
+  }
+
+  /// Drop the pending frame and forget the last swipe.
+  void reset() {
+    _assembler.reset();
+    _deduplicator.reset();
+  }
+
+  PipelineSwipe? _take(Uint8List? frame, Duration now) {
+    if (frame == null) {
+      return null;
+    }
+    final tracks = ReportParser.parse(frame);
+    if (tracks == null) {
+      return null;
+    }
+
+    final window = duplicateWindow;
+    if (window != null && window > Duration.zero && _deduplicator.isRepeat(tracks, now, window)) {
+      duplicates++;
+      return null;
+    }
+    return PipelineSwipe(frame, tracks, _assembler.frameStartTime, now);
+  }
+}
@@ -0,0 +1,122 @@
+#include "hidapi_transport.h"
+#include <sstream>
+
+#include "utf8_conversion.h"
+
+namespace {
+
+// Longest serial number read back from an open reader, in characters
+const size_t SERIAL_NUMBER_MAX_LENGTH = 128;
+
+// A reader opened through HIDAPI
+class HidapiConnection : public HidConnection {
+public:
+    explicit HidapiConnection(hid_device* handle) : handle_(handle) {}
+
+    ~HidapiConnection() override {
+        hid_close(handle_);
+    }
+
+    int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) override {
+        // hid_read_timeout blocks on HIDAPI's own completion event
+        return hid_read_timeout(handle_, buffer, size, timeout_ms);
+    }
+
+    int SendFeatureReport(const unsigned char* data, size_t length) override {
+        return hid_send_feature_report(handle_, data, length);
+    }
+
+    int GetFeatureReport(unsigned char* buffer, size_t size) override {
+        return hid_get_feature_report(handle_, buffer, size);
+    }
+
+    std::string LastError() override {
+        const wchar_t* error = hid_error(handle_);
+        if (!error) {
+            return std::string();
+        }
+        return WideToUtf8(error);
+    }
+
+    std::string SerialNumber() override {
+        wchar_t serial_number[SERIAL_NUMBER_MAX_LENGTH + 1];
+        if (hid_get_serial_number_string(handle_, serial_number, SERIAL_NUMBER_MAX_LENGTH + 1) != 0) {
+            return std::string();
+        }
+        serial_number[SERIAL_NUMBER_MAX_LENGTH] = L'\0';
+        return WideToUtf8(serial_number);
+    }
+
+private:
+    hid_device* handle_;
+};
+
+}  // namespace
+
+const char* HidapiTransport::Name() const {
+    return "hidapi";
+}
+
+bool HidapiTransport::Initialize() {
+    return hid_init() == 0;
+}
+
+void HidapiTransport::Shutdown() {
+    hid_exit();
+}
+
+std::string HidapiTransport::MakeDeviceId(const struct hid_device_info* device) {
+    // Generate unique device ID
+    std::stringstream ss;
+    ss << std::hex << device->vendor_id << ":" << device->product_id << ":";
+    if (device->serial_number) {
+        ss << WideToUtf8(device->serial_number);
+    } else {
+        ss << device->path;
+    }
+    return ss.str();
+}
+
+DeviceInfo HidapiTransport::MakeDeviceInfo(const struct hid_device_info* device) {
+    DeviceInfo info;
+    info.device_id = MakeDeviceId(device);
+    info.device_name = DeviceManagerCore::GetDeviceName(device->vendor_id, device->product_id);
+    info.vendor_id = device->vendor_id;
+    info.product_id = device->product_id;
+    info.device_path = device->path ? device->path : "";
+
+    if (device->serial_number) {
+        info.serial_number = WideToUtf8(device->serial_number);
+    }
+
+    info.is_connected = false;
+    return info;
+}
+
+std::vector<DeviceInfo> HidapiTransport::Enumerate() {
+    std::vector<DeviceInfo> devices;
+
+    struct hid_device_info* device_info = hid_enumerate(MAGTEK_VENDOR_ID, 0);
+    struct hid_device_info* current = device_info;
+
+    while (current != nullptr) {
+        if (DeviceManagerCore::IsMagtekDevice(current->vendor_id, current->product_id)) {
+            devices.push_back(MakeDeviceInfo(current));
+        }
+        current = current->next;
+    }
+
+    hid_free_enumeration(device_info);
+    return devices;
+}
+
+std::unique_ptr<HidConnection> HidapiTransport::Open(const DeviceInfo& info) {
+    hid_device* handle = hid_open_path(info.device_path.c_str());
+    if (!handle) {
+        return nullptr;
+    }
+
+    // Set non-blocking mode
+    hid_set_nonblocking(handle, 1);
+    return std::unique_ptr<HidConnection>(new HidapiConnection(handle));
+}
@@ -0,0 +1,26 @@
+#ifndef HIDAPI_TRANSPORT_H_
+#define HIDAPI_TRANSPORT_H_
+
+#include <hidapi/hidapi.h>
+
+#include "hid_transport.h"
+
+// Readers reached through HIDAPI's libusb backend. Reads copy each report
+// out of the queue HIDAPI's own libusb thread fills.
+class HidapiTransport : public HidTransport {
+public:
+    const char* Name() const override;
+    bool Initialize() override;
+    void Shutdown() override;
+    std::vector<DeviceInfo> Enumerate() override;
+    std::unique_ptr<HidConnection> Open(const DeviceInfo& info) override;
+
+    // Build a device ID from an enumeration entry; the serial number, when
+    // there is one, is converted to UTF-8
+    static std::string MakeDeviceId(const struct hid_device_info* device);
+
+    // Build device details from an enumeration entry
+    static DeviceInfo MakeDeviceInfo(const struct hid_device_info* device);
+};
+
+#endif  // HIDAPI_TRANSPORT_H_
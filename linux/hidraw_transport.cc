@@ -0,0 +1,230 @@
+#include "hidraw_transport.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#include "logger.h"
+
+static const char* const HIDRAW_CLASS_DIR = "/sys/class/hidraw";
+static const char* const HIDRAW_DEVICE_DIR = "/dev";
+
+// Longest serial number read back from an open reader
+static const size_t SERIAL_NUMBER_MAX_LENGTH = 128;
+
+namespace {
+
+// A reader opened through its hidraw node
+class HidrawConnection : public HidConnection {
+public:
+    explicit HidrawConnection(int fd)
+        : fd_(fd), cancel_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), last_errno_(0) {}
+
+    ~HidrawConnection() override {
+        if (cancel_fd_ >= 0) {
+            close(cancel_fd_);
+        }
+        close(fd_);
+    }
+
+    int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) override {
+        // The node, and the eventfd CancelRead signals
+        struct pollfd poll_fds[2];
+        poll_fds[0].fd = fd_;
+        poll_fds[1].fd = cancel_fd_;
+        for (struct pollfd& poll_fd : poll_fds) {
+            poll_fd.events = POLLIN;
+            poll_fd.revents = 0;
+        }
+        int ready = poll(poll_fds, cancel_fd_ >= 0 ? 2 : 1, timeout_ms);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            return 0;
+        }
+        if (ready < 0) {
+            return Fail(errno);
+        }
+        if (poll_fds[1].revents & POLLIN) {
+            eventfd_t count;
+            eventfd_read(cancel_fd_, &count);
+        }
+        // An unplugged reader's node hangs up
+        if (poll_fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            return Fail(ENODEV);
+        }
+        if (!(poll_fds[0].revents & POLLIN)) {
+            return 0;
+        }
+
+        ssize_t length = read(fd_, buffer, size);
+        if (length < 0) {
+            return errno == EAGAIN || errno == EINTR ? 0 : Fail(errno);
+        }
+        return static_cast<int>(length);
+    }
+
+    bool CanCancelRead() const override { return cancel_fd_ >= 0; }
+
+    void CancelRead() override {
+        if (cancel_fd_ >= 0) {
+            eventfd_write(cancel_fd_, 1);
+        }
+    }
+
+    int SendFeatureReport(const unsigned char* data, size_t length) override {
+        int result = ioctl(fd_, HIDIOCSFEATURE(length), data);
+        return result < 0 ? Fail(errno) : result;
+    }
+
+    int GetFeatureReport(unsigned char* buffer, size_t size) override {
+        int result = ioctl(fd_, HIDIOCGFEATURE(size), buffer);
+        return result < 0 ? Fail(errno) : result;
+    }
+
+    std::string LastError() override {
+        return std::generic_category().message(last_errno_);
+    }
+
+    std::string SerialNumber() override {
+#ifdef HIDIOCGRAWUNIQ
+        // The HID_UNIQ the kernel lists the node with
+        char serial_number[SERIAL_NUMBER_MAX_LENGTH];
+        int length = ioctl(fd_, HIDIOCGRAWUNIQ(sizeof(serial_number)), serial_number);
+        if (length <= 0) {
+            return std::string();
+        }
+        return std::string(serial_number, strnlen(serial_number, static_cast<size_t>(length)));
+#else
+        // Kernels before 5.6 can't be asked through the node
+        return std::string();
+#endif
+    }
+
+private:
+    // Remember why a call failed, for LastError
+    int Fail(int error) {
+        last_errno_ = error;
+        return -1;
+    }
+
+    int fd_;
+    // Wakes a blocked read early; -1 if it couldn't be created
+    int cancel_fd_;
+    int last_errno_;
+};
+
+// Read a whole sysfs attribute; empty if it can't be read
+std::string ReadSysfsFile(const std::string& path) {
+    std::ifstream file(path.c_str());
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+}  // namespace
+
+const char* HidrawTransport::Name() const {
+    return "hidraw";
+}
+
+bool HidrawTransport::Initialize() {
+    if (access(HIDRAW_CLASS_DIR, R_OK) != 0) {
+        MAGTEK_LOG(LogLevel::kWarning, "No " << HIDRAW_CLASS_DIR << "; is the hidraw driver loaded?");
+        return false;
+    }
+    return true;
+}
+
+void HidrawTransport::Shutdown() {}
+
+bool HidrawTransport::ParseUevent(const std::string& uevent, unsigned short* vendor_id, unsigned short* product_id,
+                                  std::string* serial_number) {
+    static const std::string ID_KEY = "HID_ID=";
+    static const std::string UNIQ_KEY = "HID_UNIQ=";
+
+    bool found_id = false;
+    serial_number->clear();
+    std::istringstream lines(uevent);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, ID_KEY.size(), ID_KEY) == 0) {
+            // HID_ID=<bus>:<vendor>:<product>, each in hex
+            unsigned int bus = 0;
+            unsigned int vendor = 0;
+            unsigned int product = 0;
+            if (sscanf(line.c_str() + ID_KEY.size(), "%x:%x:%x", &bus, &vendor, &product) != 3 ||
+                vendor > 0xFFFF || product > 0xFFFF) {
+                return false;
+            }
+            *vendor_id = static_cast<unsigned short>(vendor);
+            *product_id = static_cast<unsigned short>(product);
+            found_id = true;
+        } else if (line.compare(0, UNIQ_KEY.size(), UNIQ_KEY) == 0) {
+            *serial_number = line.substr(UNIQ_KEY.size());
+        }
+    }
+    return found_id;
+}
+
+std::vector<DeviceInfo> HidrawTransport::Enumerate() {
+    std::vector<DeviceInfo> devices;
+
+    DIR* directory = opendir(HIDRAW_CLASS_DIR);
+    if (!directory) {
+        return devices;
+    }
+
+    while (struct dirent* entry = readdir(directory)) {
+        std::string name(entry->d_name);
+        if (name.compare(0, 6, "hidraw") != 0) {
+            continue;
+        }
+
+        unsigned short vendor_id = 0;
+        unsigned short product_id = 0;
+        std::string serial_number;
+        std::string uevent = ReadSysfsFile(std::string(HIDRAW_CLASS_DIR) + "/" + name + "/device/uevent");
+        if (!ParseUevent(uevent, &vendor_id, &product_id, &serial_number) ||
+            !DeviceManagerCore::IsMagtekDevice(vendor_id, product_id)) {
+            continue;
+        }
+
+        // The same ID scheme as the HIDAPI transport
+        DeviceInfo info;
+        info.device_path = std::string(HIDRAW_DEVICE_DIR) + "/" + name;
+        std::stringstream id;
+        id << std::hex << vendor_id << ":" << product_id << ":"
+           << (serial_number.empty() ? info.device_path : serial_number);
+        info.device_id = id.str();
+        info.device_name = DeviceManagerCore::GetDeviceName(vendor_id, product_id);
+        info.vendor_id = vendor_id;
+        info.product_id = product_id;
+        info.serial_number = serial_number;
+        info.is_connected = false;
+        devices.push_back(info);
+    }
+
+    closedir(directory);
+    return devices;
+}
+
+std::unique_ptr<HidConnection> HidrawTransport::Open(const DeviceInfo& info) {
+    // Non-blocking, since every read waits in poll first
+    int fd = open(info.device_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        MAGTEK_LOG(LogLevel::kWarning,
+                   "Can't open " << info.device_path << ": " << std::generic_category().message(errno));
+        return nullptr;
+    }
+    return std::unique_ptr<HidConnection>(new HidrawConnection(fd));
+}
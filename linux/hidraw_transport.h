@@ -0,0 +1,28 @@
+#ifndef HIDRAW_TRANSPORT_H_
+#define HIDRAW_TRANSPORT_H_
+
+#include <string>
+
+#include "hid_transport.h"
+
+// Readers reached through the kernel's hidraw nodes, found under
+// /sys/class/hidraw. A read is one poll and one read() straight from the
+// kernel's report queue, with no libusb thread or extra copy in between;
+// commands use the HIDIOC[GS]FEATURE ioctls. The nodes must be readable and
+// writable by the app, which usually takes a udev rule.
+class HidrawTransport : public HidTransport {
+public:
+    const char* Name() const override;
+    bool Initialize() override;
+    void Shutdown() override;
+    std::vector<DeviceInfo> Enumerate() override;
+    std::unique_ptr<HidConnection> Open(const DeviceInfo& info) override;
+
+    // Read the vendor and product IDs (HID_ID) and serial number (HID_UNIQ,
+    // possibly empty) out of a hidraw device's uevent file. False if it has
+    // no valid HID_ID.
+    static bool ParseUevent(const std::string& uevent, unsigned short* vendor_id, unsigned short* product_id,
+                            std::string* serial_number);
+};
+
+#endif  // HIDRAW_TRANSPORT_H_
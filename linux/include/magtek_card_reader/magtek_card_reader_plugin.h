@@ -21,6 +21,19 @@ FLUTTER_PLUGIN_EXPORT GType magtek_card_reader_plugin_get_type();
 FLUTTER_PLUGIN_EXPORT void magtek_card_reader_plugin_register_with_registrar(
     FlPluginRegistrar* registrar);
 
+// Decrypts one track of a MagneSafe encrypted swipe, e.g. by handing the KSN
+// and ciphertext to an HSM. Called on a reader's read thread, so it must be
+// thread-safe. Writes at most plaintext_capacity bytes of plaintext and
+// returns how many, or -1 to deliver the reader's masked track instead.
+typedef int (*MagtekTrackDecryptFunc)(gpointer user_data, const guint8* ksn, gsize ksn_length, gint track_number,
+                                      const guint8* ciphertext, gsize ciphertext_length, gchar* plaintext,
+                                      gsize plaintext_capacity);
+
+// Install the track decryptor, or remove it with a NULL func. Decrypted
+// tracks never cross the platform channel unless one is installed.
+FLUTTER_PLUGIN_EXPORT void magtek_card_reader_plugin_set_track_decryptor(
+    MagtekTrackDecryptFunc func, gpointer user_data);
+
 G_END_DECLS
 
 #endif  // FLUTTER_PLUGIN_MAGTEK_CARD_READER_PLUGIN_H_
@@ -0,0 +1,448 @@
+#include "libusb_transport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "logger.h"
+#include "magnesafe_report.h"
+#include "magtek_products.h"
+#include "utf8_conversion.h"
+
+const int LibusbTransport::ASYNC_TRANSFERS_IN_FLIGHT;
+
+// Reports a connection holds for its read thread; more are dropped
+static const size_t REPORT_QUEUE_CAPACITY = 64;
+
+// Control transfer timeout for commands
+static const unsigned int CONTROL_TIMEOUT_MS = 1000;
+
+// HID class requests and the feature report type
+static const uint8_t HID_GET_REPORT = 0x01;
+static const uint8_t HID_SET_REPORT = 0x09;
+static const uint16_t HID_FEATURE_REPORT = 0x0300;
+
+// USB string descriptor type, and the longest descriptor
+static const uint8_t USB_STRING_DESCRIPTOR = 0x03;
+static const size_t STRING_DESCRIPTOR_MAX_LENGTH = 255;
+
+namespace {
+
+// Where a reader's input reports come from
+struct InputEndpoint {
+    int interface_number;
+    unsigned char address;
+    int max_packet_size;
+};
+
+// Find the interrupt-IN endpoint of the device's first HID interface
+bool FindInputEndpoint(libusb_device* device, InputEndpoint* endpoint) {
+    struct libusb_config_descriptor* config = nullptr;
+    if (libusb_get_active_config_descriptor(device, &config) != LIBUSB_SUCCESS) {
+        return false;
+    }
+
+    bool found = false;
+    for (int i = 0; i < config->bNumInterfaces && !found; i++) {
+        if (config->interface[i].num_altsetting < 1) {
+            continue;
+        }
+        const struct libusb_interface_descriptor& setting = config->interface[i].altsetting[0];
+        if (setting.bInterfaceClass != LIBUSB_CLASS_HID) {
+            continue;
+        }
+        for (int j = 0; j < setting.bNumEndpoints; j++) {
+            const struct libusb_endpoint_descriptor& candidate = setting.endpoint[j];
+            if ((candidate.bEndpointAddress & LIBUSB_ENDPOINT_DIR_MASK) == LIBUSB_ENDPOINT_IN &&
+                (candidate.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
+                endpoint->interface_number = setting.bInterfaceNumber;
+                endpoint->address = candidate.bEndpointAddress;
+                endpoint->max_packet_size = candidate.wMaxPacketSize;
+                found = true;
+                break;
+            }
+        }
+    }
+
+    libusb_free_config_descriptor(config);
+    return found;
+}
+
+// Read a device's serial number in its first language, as
+// libusb_get_string_descriptor_ascii would, but keeping every character
+std::string ReadSerialNumber(libusb_device_handle* handle, uint8_t index) {
+    unsigned char descriptor[STRING_DESCRIPTOR_MAX_LENGTH];
+    // String descriptor 0 lists the language IDs the device supports
+    int length = libusb_get_string_descriptor(handle, 0, 0, descriptor, sizeof(descriptor));
+    if (length < 4) {
+        return std::string();
+    }
+    uint16_t language = static_cast<uint16_t>(descriptor[2] | (descriptor[3] << 8));
+
+    length = libusb_get_string_descriptor(handle, index, language, descriptor, sizeof(descriptor));
+    return length > 0 ? LibusbTransport::DecodeStringDescriptor(descriptor, static_cast<size_t>(length))
+                      : std::string();
+}
+
+// The same bus:address:interface path HIDAPI's libusb backend uses
+std::string MakeDevicePath(libusb_device* device, int interface_number) {
+    char path[16];
+    snprintf(path, sizeof(path), "%04x:%04x:%02x", libusb_get_bus_number(device),
+             libusb_get_device_address(device), interface_number);
+    return path;
+}
+
+// A reader opened through libusb, read through a ring of preallocated
+// report slots that the event thread fills from its completed transfers
+class LibusbConnection : public HidConnection {
+public:
+    LibusbConnection(libusb_device_handle* handle, const InputEndpoint& endpoint, int transfer_size)
+        : handle_(handle), endpoint_(endpoint), transfer_size_(transfer_size), head_(0), count_(0),
+          in_flight_(0), stopping_(false), failed_(false), read_cancelled_(false), last_error_(LIBUSB_SUCCESS), dropped_(0),
+          slots_(REPORT_QUEUE_CAPACITY, std::vector<unsigned char>(transfer_size)),
+          lengths_(REPORT_QUEUE_CAPACITY, 0) {}
+
+    ~LibusbConnection() override {
+        // Cancelled transfers still complete on the event thread, which
+        // must be done with every one of them before they are freed
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping_ = true;
+            for (libusb_transfer* transfer : transfers_) {
+                libusb_cancel_transfer(transfer);
+            }
+            drained_.wait(lock, [this] { return in_flight_ == 0; });
+        }
+        for (libusb_transfer* transfer : transfers_) {
+            libusb_free_transfer(transfer);
+        }
+
+        if (dropped_ > 0) {
+            MAGTEK_LOG(LogLevel::kWarning, "Dropped " << dropped_ << " reports on a full queue");
+        }
+        libusb_release_interface(handle_, endpoint_.interface_number);
+        libusb_close(handle_);
+    }
+
+    // Submit the transfers; false if none could be
+    bool Start() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        transfer_buffers_.reserve(LibusbTransport::ASYNC_TRANSFERS_IN_FLIGHT);
+        for (int i = 0; i < LibusbTransport::ASYNC_TRANSFERS_IN_FLIGHT; i++) {
+            libusb_transfer* transfer = libusb_alloc_transfer(0);
+            if (!transfer) {
+                break;
+            }
+            transfer_buffers_.push_back(std::vector<unsigned char>(transfer_size_));
+            libusb_fill_interrupt_transfer(transfer, handle_, endpoint_.address, transfer_buffers_.back().data(),
+                                           transfer_size_, &LibusbConnection::OnTransferComplete, this, 0);
+            transfers_.push_back(transfer);
+            int rc = libusb_submit_transfer(transfer);
+            if (rc != LIBUSB_SUCCESS) {
+                last_error_ = rc;
+                break;
+            }
+            in_flight_++;
+        }
+        return in_flight_ > 0;
+    }
+
+    int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                        [this] { return count_ > 0 || failed_ || read_cancelled_; });
+        read_cancelled_ = false;
+        if (count_ == 0) {
+            return failed_ ? -1 : 0;
+        }
+
+        size_t length = std::min(size, lengths_[head_]);
+        memcpy(buffer, slots_[head_].data(), length);
+        head_ = (head_ + 1) % REPORT_QUEUE_CAPACITY;
+        count_--;
+        return static_cast<int>(length);
+    }
+
+    bool CanCancelRead() const override { return true; }
+
+    void CancelRead() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            read_cancelled_ = true;
+        }
+        ready_.notify_one();
+    }
+
+    int SendFeatureReport(const unsigned char* data, size_t length) override {
+        if (length == 0) {
+            return -1;
+        }
+        // Unnumbered reports go out without the report ID byte, as in
+        // HIDAPI, which still counts it as sent
+        unsigned char report_id = data[0];
+        size_t skipped = report_id == 0 ? 1 : 0;
+        int rc = libusb_control_transfer(
+            handle_, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_OUT, HID_SET_REPORT,
+            HID_FEATURE_REPORT | report_id, static_cast<uint16_t>(endpoint_.interface_number),
+            const_cast<unsigned char*>(data + skipped), static_cast<uint16_t>(length - skipped), CONTROL_TIMEOUT_MS);
+        return rc < 0 ? Fail(rc) : rc + static_cast<int>(skipped);
+    }
+
+    int GetFeatureReport(unsigned char* buffer, size_t size) override {
+        if (size == 0) {
+            return -1;
+        }
+        unsigned char report_id = buffer[0];
+        size_t skipped = report_id == 0 ? 1 : 0;
+        int rc = libusb_control_transfer(
+            handle_, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_IN, HID_GET_REPORT,
+            HID_FEATURE_REPORT | report_id, static_cast<uint16_t>(endpoint_.interface_number), buffer + skipped,
+            static_cast<uint16_t>(size - skipped), CONTROL_TIMEOUT_MS);
+        return rc < 0 ? Fail(rc) : rc + static_cast<int>(skipped);
+    }
+
+    std::string LastError() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return libusb_error_name(last_error_);
+    }
+
+    std::string SerialNumber() override {
+        struct libusb_device_descriptor descriptor;
+        if (libusb_get_device_descriptor(libusb_get_device(handle_), &descriptor) != LIBUSB_SUCCESS ||
+            !descriptor.iSerialNumber) {
+            return std::string();
+        }
+        return ReadSerialNumber(handle_, descriptor.iSerialNumber);
+    }
+
+private:
+    static void LIBUSB_CALL OnTransferComplete(libusb_transfer* transfer) {
+        static_cast<LibusbConnection*>(transfer->user_data)->Complete(transfer);
+    }
+
+    // Queue a completed transfer's report and put the transfer back in
+    // flight; runs on the event thread
+    void Complete(libusb_transfer* transfer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (transfer->status == LIBUSB_TRANSFER_COMPLETED && transfer->actual_length > 0) {
+            if (count_ == REPORT_QUEUE_CAPACITY) {
+                dropped_++;
+            } else {
+                size_t tail = (head_ + count_) % REPORT_QUEUE_CAPACITY;
+                size_t length = static_cast<size_t>(transfer->actual_length);
+                memcpy(slots_[tail].data(), transfer->buffer, length);
+                lengths_[tail] = length;
+                count_++;
+            }
+        }
+
+        bool resubmit = !stopping_ && (transfer->status == LIBUSB_TRANSFER_COMPLETED ||
+                                       transfer->status == LIBUSB_TRANSFER_TIMED_OUT);
+        bool unplugged = transfer->status == LIBUSB_TRANSFER_NO_DEVICE;
+        int rc = resubmit ? libusb_submit_transfer(transfer) : unplugged ? LIBUSB_ERROR_NO_DEVICE : LIBUSB_ERROR_IO;
+        if (rc != LIBUSB_SUCCESS) {
+            in_flight_--;
+            if (!stopping_) {
+                // An unplugged reader fails at once; other errors retire one
+                // transfer, and the reads fail once none is left
+                last_error_ = rc;
+                failed_ = failed_ || unplugged || rc == LIBUSB_ERROR_NO_DEVICE || in_flight_ == 0;
+            }
+            drained_.notify_all();
+        }
+        ready_.notify_one();
+    }
+
+    // Remember why a command failed, for LastError
+    int Fail(int error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_error_ = error;
+        return -1;
+    }
+
+    libusb_device_handle* handle_;
+    InputEndpoint endpoint_;
+    int transfer_size_;
+    std::vector<libusb_transfer*> transfers_;
+    std::vector<std::vector<unsigned char>> transfer_buffers_;
+
+    // Everything below is shared with the event thread, under mutex_
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable drained_;
+    size_t head_;
+    size_t count_;
+    int in_flight_;
+    bool stopping_;
+    bool failed_;
+    // Set by CancelRead until a read returns
+    bool read_cancelled_;
+    int last_error_;
+    unsigned long long dropped_;
+    std::vector<std::vector<unsigned char>> slots_;
+    std::vector<size_t> lengths_;
+};
+
+}  // namespace
+
+LibusbTransport::LibusbTransport() : context_(nullptr), running_(false) {}
+
+LibusbTransport::~LibusbTransport() {
+    Shutdown();
+}
+
+const char* LibusbTransport::Name() const {
+    return "libusb";
+}
+
+bool LibusbTransport::Initialize() {
+    if (running_.load()) {
+        return true;
+    }
+    int rc = libusb_init(&context_);
+    if (rc != LIBUSB_SUCCESS) {
+        MAGTEK_LOG(LogLevel::kWarning, "Failed to initialize libusb: " << libusb_error_name(rc));
+        context_ = nullptr;
+        return false;
+    }
+    running_ = true;
+    event_thread_ = std::thread(&LibusbTransport::EventThread, this);
+    return true;
+}
+
+void LibusbTransport::Shutdown() {
+    if (!running_.load()) {
+        return;
+    }
+    running_ = false;
+    libusb_interrupt_event_handler(context_);
+    if (event_thread_.joinable()) {
+        event_thread_.join();
+    }
+    libusb_exit(context_);
+    context_ = nullptr;
+}
+
+void LibusbTransport::EventThread() {
+    // Sleeps until a transfer completes or Shutdown interrupts the wait,
+    // which stays flagged until a wait sees it, so idle readers cost no
+    // wakeups
+    while (running_.load()) {
+        libusb_handle_events_completed(context_, nullptr);
+    }
+}
+
+std::string LibusbTransport::DecodeStringDescriptor(const unsigned char* descriptor, size_t length) {
+    if (length < 2 || descriptor[1] != USB_STRING_DESCRIPTOR) {
+        return std::string();
+    }
+    // bLength covers the header; trust it only as far as what was read
+    size_t descriptor_length = std::min(length, static_cast<size_t>(descriptor[0]));
+    return descriptor_length > 2 ? Utf16LeToUtf8(descriptor + 2, descriptor_length - 2) : std::string();
+}
+
+std::vector<DeviceInfo> LibusbTransport::Enumerate() {
+    std::vector<DeviceInfo> devices;
+    libusb_device** list = nullptr;
+    ssize_t count = libusb_get_device_list(context_, &list);
+    if (count < 0) {
+        return devices;
+    }
+
+    for (ssize_t i = 0; i < count; i++) {
+        struct libusb_device_descriptor descriptor;
+        InputEndpoint endpoint;
+        if (libusb_get_device_descriptor(list[i], &descriptor) != LIBUSB_SUCCESS ||
+            !DeviceManagerCore::IsMagtekDevice(descriptor.idVendor, descriptor.idProduct) ||
+            !FindInputEndpoint(list[i], &endpoint)) {
+            continue;
+        }
+
+        DeviceInfo info;
+        info.device_path = MakeDevicePath(list[i], endpoint.interface_number);
+        info.vendor_id = descriptor.idVendor;
+        info.product_id = descriptor.idProduct;
+        info.device_name = DeviceManagerCore::GetDeviceName(descriptor.idVendor, descriptor.idProduct);
+        info.is_connected = false;
+
+        // Reading the serial number takes a handle, as in HIDAPI
+        libusb_device_handle* handle = nullptr;
+        if (descriptor.iSerialNumber && libusb_open(list[i], &handle) == LIBUSB_SUCCESS) {
+            info.serial_number = ReadSerialNumber(handle, descriptor.iSerialNumber);
+            libusb_close(handle);
+        }
+
+        // The same ID scheme as the other transports
+        std::stringstream id;
+        id << std::hex << info.vendor_id << ":" << info.product_id << ":"
+           << (info.serial_number.empty() ? info.device_path : info.serial_number);
+        info.device_id = id.str();
+        devices.push_back(info);
+    }
+
+    libusb_free_device_list(list, 1);
+    return devices;
+}
+
+std::unique_ptr<HidConnection> LibusbTransport::Open(const DeviceInfo& info) {
+    unsigned int bus = 0;
+    unsigned int address = 0;
+    unsigned int interface_number = 0;
+    if (sscanf(info.device_path.c_str(), "%x:%x:%x", &bus, &address, &interface_number) != 3) {
+        return nullptr;
+    }
+
+    libusb_device** list = nullptr;
+    ssize_t count = libusb_get_device_list(context_, &list);
+    if (count < 0) {
+        return nullptr;
+    }
+
+    libusb_device_handle* handle = nullptr;
+    InputEndpoint endpoint;
+    for (ssize_t i = 0; i < count; i++) {
+        if (libusb_get_bus_number(list[i]) == bus && libusb_get_device_address(list[i]) == address &&
+            FindInputEndpoint(list[i], &endpoint) &&
+            static_cast<unsigned int>(endpoint.interface_number) == interface_number) {
+            int rc = libusb_open(list[i], &handle);
+            if (rc != LIBUSB_SUCCESS) {
+                MAGTEK_LOG(LogLevel::kWarning, "Can't open " << info.device_path << ": " << libusb_error_name(rc));
+                handle = nullptr;
+            }
+            break;
+        }
+    }
+    libusb_free_device_list(list, 1);
+    if (!handle) {
+        return nullptr;
+    }
+
+    // The kernel's HID driver gives the interface back when it is released
+    libusb_set_auto_detach_kernel_driver(handle, 1);
+    int rc = libusb_claim_interface(handle, endpoint.interface_number);
+    if (rc != LIBUSB_SUCCESS) {
+        MAGTEK_LOG(LogLevel::kWarning, "Can't claim " << info.device_path << ": " << libusb_error_name(rc));
+        libusb_close(handle);
+        return nullptr;
+    }
+
+    // HIDAPI's libusb backend reads one packet per transfer, and the swipe
+    // assembler joins reports; a MagneSafe report has to arrive whole, so
+    // encrypting readers get transfers of a full report, which ends in a
+    // short packet
+    const ProductDescriptor* product = FindMagtekProduct(info.product_id);
+    int transfer_size = product && product->encrypting ? static_cast<int>(MagneSafeReportParser::REPORT_SIZE)
+                                                       : endpoint.max_packet_size;
+    std::unique_ptr<LibusbConnection> connection(new LibusbConnection(handle, endpoint, transfer_size));
+    if (!connection->Start()) {
+        MAGTEK_LOG(LogLevel::kWarning, "Can't start reading " << info.device_path << ": "
+                                       << connection->LastError());
+        return nullptr;
+    }
+    return std::unique_ptr<HidConnection>(connection.release());
+}
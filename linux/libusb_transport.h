@@ -0,0 +1,47 @@
+#ifndef LIBUSB_TRANSPORT_H_
+#define LIBUSB_TRANSPORT_H_
+
+#include <atomic>
+#include <libusb.h>
+#include <string>
+#include <thread>
+
+#include "hid_transport.h"
+
+// Readers reached through libusb directly, with asynchronous I/O: every
+// open reader keeps ASYNC_TRANSFERS_IN_FLIGHT interrupt-IN transfers
+// queued, so reports that arrive back to back while the read thread is busy
+// wait in the connection's report queue instead of being missed between
+// reads. One event thread per transport handles the completions of every
+// reader. Commands go out as HID class control transfers (SET_REPORT and
+// GET_REPORT). The reader's interface is claimed, detaching the kernel's
+// HID driver, as HIDAPI's libusb backend does.
+class LibusbTransport : public HidTransport {
+public:
+    // Transfers each open reader keeps submitted
+    static const int ASYNC_TRANSFERS_IN_FLIGHT = 4;
+
+    LibusbTransport();
+    ~LibusbTransport() override;
+
+    const char* Name() const override;
+    bool Initialize() override;
+    void Shutdown() override;
+    std::vector<DeviceInfo> Enumerate() override;
+    std::unique_ptr<HidConnection> Open(const DeviceInfo& info) override;
+
+    // The UTF-8 text of a USB string descriptor as read from the device,
+    // header bytes included; converted as HIDAPI's strings are, so a serial
+    // number reads the same through either transport
+    static std::string DecodeStringDescriptor(const unsigned char* descriptor, size_t length);
+
+private:
+    // Runs libusb's event handling, and with it every transfer completion
+    void EventThread();
+
+    libusb_context* context_;
+    std::atomic<bool> running_;
+    std::thread event_thread_;
+};
+
+#endif  // LIBUSB_TRANSPORT_H_
@@ -5,9 +5,19 @@
 #include <sys/utsname.h>
 
 #include <cstring>
+#include <functional>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "magtek_card_reader_plugin_private.h"
+#include "ffi_bridge.h"
+#include "logger.h"
+#include "packed_swipe_codec.h"
+#include "serial_executor.h"
+#include "systrace_sink.h"
+#include "trace_events.h"
 #include "usb_device_manager.h"
 
 #define MAGTEK_CARD_READER_PLUGIN(obj) \
@@ -21,32 +31,80 @@ struct _MagtekCardReaderPlugin {
   FlEventChannelHandler* card_swipe_handler;
   FlEventChannelHandler* device_event_handler;
   std::unique_ptr<UsbDeviceManager> device_manager;
+  // Runs the device manager calls that can block (bus scans, device opens,
+  // read thread joins) off the main loop, in the order they were made
+  std::unique_ptr<SerialExecutor> control_executor;
+  // Set while an idle callback to drain queued swipes is pending
+  gint swipe_drain_scheduled;
+  // Send swipes as packed records (packed_swipe_codec.h) instead of maps
+  gboolean packed_swipe_events;
+  // Swipe batching: events are gathered into pending_swipes and sent as
+  // one list once batch_max_events are queued, the window timer fires, or,
+  // with batch_low_latency, a drain pass leaves the read queues empty
+  gboolean batch_swipes;
+  guint batch_window_ms;
+  guint batch_max_events;
+  gboolean batch_low_latency;
+  FlValue* pending_swipes;
+  guint batch_flush_source;
+  // The read threads run only while Dart listens for swipes and the app
+  // isn't in the background; monitoring is the state last asked of the
+  // manager
+  gboolean card_swipe_listening;
+  gboolean app_active;
+  gboolean monitoring;
 };
 
 G_DEFINE_TYPE(MagtekCardReaderPlugin, magtek_card_reader_plugin, g_object_get_type())
 
 // Forward declarations
-static FlMethodResponse* handle_initialize(MagtekCardReaderPlugin* self);
+static FlMethodResponse* handle_initialize(MagtekCardReaderPlugin* self, FlMethodCall* method_call);
 static FlMethodResponse* handle_dispose(MagtekCardReaderPlugin* self);
-static FlMethodResponse* handle_get_connected_devices(MagtekCardReaderPlugin* self);
-static FlMethodResponse* handle_connect_to_device(MagtekCardReaderPlugin* self, FlValue* args);
-static FlMethodResponse* handle_disconnect(MagtekCardReaderPlugin* self);
+static FlMethodResponse* handle_get_connected_devices(MagtekCardReaderPlugin* self,
+                                                      FlMethodCall* method_call);
+static FlMethodResponse* handle_connect_to_device(MagtekCardReaderPlugin* self,
+                                                  FlMethodCall* method_call);
+static FlMethodResponse* handle_open_device(MagtekCardReaderPlugin* self, FlMethodCall* method_call);
+static FlMethodResponse* handle_close_device(MagtekCardReaderPlugin* self, FlMethodCall* method_call);
+static FlMethodResponse* handle_disconnect(MagtekCardReaderPlugin* self, FlMethodCall* method_call);
 static FlMethodResponse* handle_is_connected(MagtekCardReaderPlugin* self);
+static FlMethodResponse* handle_set_raw_response_mode(MagtekCardReaderPlugin* self, FlValue* args);
+static FlMethodResponse* handle_get_stats(MagtekCardReaderPlugin* self, FlValue* args);
+static FlMethodResponse* handle_get_metrics(MagtekCardReaderPlugin* self);
+static FlMethodResponse* handle_set_log_level(FlValue* args);
+static FlMethodResponse* handle_set_tracing(FlValue* args);
+static FlMethodResponse* handle_set_app_lifecycle_state(MagtekCardReaderPlugin* self, FlValue* args);
+static FlMethodResponse* handle_send_command(MagtekCardReaderPlugin* self, FlMethodCall* method_call);
+static FlMethodResponse* handle_start_capture(MagtekCardReaderPlugin* self, FlMethodCall* method_call);
+static FlMethodResponse* handle_stop_capture(MagtekCardReaderPlugin* self, FlMethodCall* method_call);
 static void send_card_swipe_event(MagtekCardReaderPlugin* self, const CardData& card_data);
-static void send_device_event(MagtekCardReaderPlugin* self, const DeviceInfo& device_info);
+static FlValue* build_card_swipe_map(const CardData& card_data);
+static void schedule_swipe_drain(MagtekCardReaderPlugin* self);
+static void flush_swipe_batch(MagtekCardReaderPlugin* self);
+static gboolean batch_window_cb(gpointer user_data);
+static void schedule_device_event(MagtekCardReaderPlugin* self, DeviceEventType type,
+                                  DeviceInfo&& device_info);
+static void send_device_event(MagtekCardReaderPlugin* self, DeviceEventType type,
+                              const DeviceInfo& device_info);
+static void update_monitoring(MagtekCardReaderPlugin* self);
 
-// Event channel handlers
+// Event channel handlers. Nobody taking swipes means nothing to read them
+// for, so the card swipe channel starts and stops monitoring.
 static FlMethodErrorResponse* card_swipe_listen_cb(FlEventChannel* channel,
                                                    FlValue* args,
                                                    gpointer user_data) {
-  // Event channel setup - no action needed for listen
+  MagtekCardReaderPlugin* self = MAGTEK_CARD_READER_PLUGIN(user_data);
+  self->card_swipe_listening = TRUE;
+  update_monitoring(self);
   return nullptr;
 }
 
 static FlMethodErrorResponse* card_swipe_cancel_cb(FlEventChannel* channel,
                                                    FlValue* args,
                                                    gpointer user_data) {
-  // Event channel cleanup - no action needed for cancel
+  MagtekCardReaderPlugin* self = MAGTEK_CARD_READER_PLUGIN(user_data);
+  self->card_swipe_listening = FALSE;
+  update_monitoring(self);
   return nullptr;
 }
 
@@ -64,6 +122,58 @@ static FlMethodErrorResponse* device_event_cancel_cb(FlEventChannel* channel,
   return nullptr;
 }
 
+// A method call answered from the control executor
+struct PendingMethodResponse {
+  FlMethodCall* method_call;
+  FlMethodResponse* response;
+};
+
+static gboolean respond_idle_cb(gpointer user_data) {
+  PendingMethodResponse* pending = static_cast<PendingMethodResponse*>(user_data);
+  fl_method_call_respond(pending->method_call, pending->response, nullptr);
+  g_object_unref(pending->response);
+  g_object_unref(pending->method_call);
+  delete pending;
+  return G_SOURCE_REMOVE;
+}
+
+// Runs work on the control executor and responds to method_call with its
+// result from the main loop, so a slow reader never stalls a frame. The
+// manager outlives the work: dispose waits for the executor to go idle.
+static void respond_from_executor(MagtekCardReaderPlugin* self, FlMethodCall* method_call,
+                                  std::function<FlMethodResponse*(UsbDeviceManager*)> work) {
+  UsbDeviceManager* manager = self->device_manager.get();
+  FlMethodCall* call = FL_METHOD_CALL(g_object_ref(method_call));
+  self->control_executor->Post([manager, call, work]() {
+    PendingMethodResponse* pending = new PendingMethodResponse{call, work(manager)};
+    g_idle_add(respond_idle_cb, pending);
+  });
+}
+
+// Starts or stops the read threads to match whether anyone can take a
+// swipe. The change runs on the control executor, behind the calls already
+// made, so a bus scan or device open is never waited on here.
+static void update_monitoring(MagtekCardReaderPlugin* self) {
+  if (!self->device_manager) {
+    return;
+  }
+
+  gboolean wanted = self->card_swipe_listening && self->app_active;
+  if (wanted == self->monitoring) {
+    return;
+  }
+  self->monitoring = wanted;
+
+  UsbDeviceManager* manager = self->device_manager.get();
+  self->control_executor->Post([manager, wanted]() {
+    if (wanted) {
+      manager->StartMonitoring();
+    } else {
+      manager->StopMonitoring();
+    }
+  });
+}
+
 // Called when a method call is received from Flutter.
 static void magtek_card_reader_plugin_handle_method_call(
     MagtekCardReaderPlugin* self,
@@ -73,25 +183,51 @@ static void magtek_card_reader_plugin_handle_method_call(
   const gchar* method = fl_method_call_get_name(method_call);
   FlValue* args = fl_method_call_get_args(method_call);
 
+  // Handlers that hand their work to the control executor return nullptr
+  // and respond later
   if (strcmp(method, "getPlatformVersion") == 0) {
     response = get_platform_version();
   } else if (strcmp(method, "initialize") == 0) {
-    response = handle_initialize(self);
+    response = handle_initialize(self, method_call);
   } else if (strcmp(method, "dispose") == 0) {
     response = handle_dispose(self);
   } else if (strcmp(method, "getConnectedDevices") == 0) {
-    response = handle_get_connected_devices(self);
+    response = handle_get_connected_devices(self, method_call);
   } else if (strcmp(method, "connectToDevice") == 0) {
-    response = handle_connect_to_device(self, args);
+    response = handle_connect_to_device(self, method_call);
+  } else if (strcmp(method, "openDevice") == 0) {
+    response = handle_open_device(self, method_call);
+  } else if (strcmp(method, "closeDevice") == 0) {
+    response = handle_close_device(self, method_call);
   } else if (strcmp(method, "disconnect") == 0) {
-    response = handle_disconnect(self);
+    response = handle_disconnect(self, method_call);
   } else if (strcmp(method, "isConnected") == 0) {
     response = handle_is_connected(self);
+  } else if (strcmp(method, "setRawResponseMode") == 0) {
+    response = handle_set_raw_response_mode(self, args);
+  } else if (strcmp(method, "getStats") == 0) {
+    response = handle_get_stats(self, args);
+  } else if (strcmp(method, "getMetrics") == 0) {
+    response = handle_get_metrics(self);
+  } else if (strcmp(method, "setLogLevel") == 0) {
+    response = handle_set_log_level(args);
+  } else if (strcmp(method, "setTracing") == 0) {
+    response = handle_set_tracing(args);
+  } else if (strcmp(method, "setAppLifecycleState") == 0) {
+    response = handle_set_app_lifecycle_state(self, args);
+  } else if (strcmp(method, "sendCommand") == 0) {
+    response = handle_send_command(self, method_call);
+  } else if (strcmp(method, "startCapture") == 0) {
+    response = handle_start_capture(self, method_call);
+  } else if (strcmp(method, "stopCapture") == 0) {
+    response = handle_stop_capture(self, method_call);
   } else {
     response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
   }
 
-  fl_method_call_respond(method_call, response, nullptr);
+  if (response) {
+    fl_method_call_respond(method_call, response, nullptr);
+  }
 }
 
 FlMethodResponse* get_platform_version() {
@@ -102,101 +238,348 @@ FlMethodResponse* get_platform_version() {
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-static FlMethodResponse* handle_initialize(MagtekCardReaderPlugin* self) {
+// Parses a "rawResponseMode" value ("off", "hex" or "binary")
+static bool parse_raw_response_mode(FlValue* value, RawResponseMode* mode) {
+  if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+
+  const gchar* name = fl_value_get_string(value);
+  if (strcmp(name, "off") == 0) {
+    *mode = RawResponseMode::kOff;
+  } else if (strcmp(name, "hex") == 0) {
+    *mode = RawResponseMode::kHex;
+  } else if (strcmp(name, "binary") == 0) {
+    *mode = RawResponseMode::kBinary;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Where the "rememberDevices" option keeps the readers it has opened: the
+// MAGTEK_DEVICE_CACHE environment variable, or else a file in the user's
+// cache directory. Empty if that directory can't be created.
+static std::string device_identity_cache_path() {
+  const gchar* configured = g_getenv("MAGTEK_DEVICE_CACHE");
+  if (configured && *configured) {
+    return configured;
+  }
+
+  g_autofree gchar* directory =
+      g_build_filename(g_get_user_cache_dir(), "magtek_card_reader", nullptr);
+  if (g_mkdir_with_parents(directory, 0700) != 0) {
+    MAGTEK_LOG(LogLevel::kWarning, "Can't create " << directory << ", not remembering devices");
+    return std::string();
+  }
+  g_autofree gchar* path = g_build_filename(directory, "devices", nullptr);
+  return path;
+}
+
+// Applies the "swipeBatching" option: null turns batching off, otherwise a
+// map of windowMs, maxEvents and lowLatency
+static bool parse_swipe_batching(MagtekCardReaderPlugin* self, FlValue* value,
+                                 FlMethodResponse** error) {
+  if (!value || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
+    flush_swipe_batch(self);
+    self->batch_swipes = FALSE;
+    return true;
+  }
+
+  FlValue* window_value = nullptr;
+  FlValue* max_events_value = nullptr;
+  FlValue* low_latency_value = nullptr;
+  if (fl_value_get_type(value) == FL_VALUE_TYPE_MAP) {
+    window_value = fl_value_lookup_string(value, "windowMs");
+    max_events_value = fl_value_lookup_string(value, "maxEvents");
+    low_latency_value = fl_value_lookup_string(value, "lowLatency");
+  }
+  if (!window_value || fl_value_get_type(window_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(window_value) < 1 ||
+      !max_events_value || fl_value_get_type(max_events_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(max_events_value) < 1 ||
+      !low_latency_value || fl_value_get_type(low_latency_value) != FL_VALUE_TYPE_BOOL) {
+    *error = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS",
+        "swipeBatching needs windowMs >= 1, maxEvents >= 1 and lowLatency", nullptr));
+    return false;
+  }
+
+  // Anything gathered under the old settings goes out first
+  flush_swipe_batch(self);
+  self->batch_swipes = TRUE;
+  self->batch_window_ms = static_cast<guint>(fl_value_get_int(window_value));
+  self->batch_max_events = static_cast<guint>(fl_value_get_int(max_events_value));
+  self->batch_low_latency = fl_value_get_bool(low_latency_value);
+  return true;
+}
+
+static FlMethodResponse* handle_initialize(MagtekCardReaderPlugin* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  // Options are optional; older callers send no arguments at all
+  RawResponseMode raw_mode = RawResponseMode::kHex;
+  gboolean packed_swipe_events = FALSE;
+  gboolean reject_invalid_swipes = FALSE;
+  gboolean idle_power_saving = FALSE;
+  int64_t duplicate_swipe_window_ms = 0;
+  gboolean remember_devices = FALSE;
+  if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* raw_mode_value = fl_value_lookup_string(args, "rawResponseMode");
+    if (raw_mode_value && !parse_raw_response_mode(raw_mode_value, &raw_mode)) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENTS", "rawResponseMode must be off, hex or binary", nullptr));
+    }
+
+    FlValue* encoding_value = fl_value_lookup_string(args, "swipeEventEncoding");
+    if (encoding_value) {
+      if (fl_value_get_type(encoding_value) != FL_VALUE_TYPE_STRING ||
+          (strcmp(fl_value_get_string(encoding_value), "map") != 0 &&
+           strcmp(fl_value_get_string(encoding_value), "packed") != 0)) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENTS", "swipeEventEncoding must be map or packed", nullptr));
+      }
+      packed_swipe_events = strcmp(fl_value_get_string(encoding_value), "packed") == 0;
+    }
+
+    FlValue* reject_value = fl_value_lookup_string(args, "rejectInvalidSwipes");
+    if (reject_value) {
+      if (fl_value_get_type(reject_value) != FL_VALUE_TYPE_BOOL) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENTS", "rejectInvalidSwipes must be a bool", nullptr));
+      }
+      reject_invalid_swipes = fl_value_get_bool(reject_value);
+    }
+
+    FlValue* power_saving_value = fl_value_lookup_string(args, "idlePowerSaving");
+    if (power_saving_value) {
+      if (fl_value_get_type(power_saving_value) != FL_VALUE_TYPE_BOOL) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENTS", "idlePowerSaving must be a bool", nullptr));
+      }
+      idle_power_saving = fl_value_get_bool(power_saving_value);
+    }
+
+    FlValue* window_value = fl_value_lookup_string(args, "duplicateSwipeWindowMs");
+    if (window_value) {
+      if (fl_value_get_type(window_value) != FL_VALUE_TYPE_INT || fl_value_get_int(window_value) < 0 ||
+          fl_value_get_int(window_value) > G_MAXINT) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENTS", "duplicateSwipeWindowMs must be a non-negative int", nullptr));
+      }
+      duplicate_swipe_window_ms = fl_value_get_int(window_value);
+    }
+
+    FlValue* remember_value = fl_value_lookup_string(args, "rememberDevices");
+    if (remember_value) {
+      if (fl_value_get_type(remember_value) != FL_VALUE_TYPE_BOOL) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENTS", "rememberDevices must be a bool", nullptr));
+      }
+      remember_devices = fl_value_get_bool(remember_value);
+    }
+
+    FlMethodResponse* error = nullptr;
+    if (!parse_swipe_batching(self, fl_value_lookup_string(args, "swipeBatching"), &error)) {
+      return error;
+    }
+  }
+  self->packed_swipe_events = packed_swipe_events;
+
   if (!self->device_manager) {
     self->device_manager = std::make_unique<UsbDeviceManager>();
+    self->control_executor = std::make_unique<SerialExecutor>();
+    // Lets the dart:ffi binding query the manager and take swipes directly
+    FfiBridge::Attach(self->device_manager.get());
   }
 
-  if (!self->device_manager->Initialize()) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INITIALIZATION_FAILED", "Failed to initialize USB device manager", nullptr));
-  }
+  self->device_manager->SetRawResponseMode(raw_mode);
+  self->device_manager->SetRejectInvalidSwipes(reject_invalid_swipes);
+  self->device_manager->SetReadMode(idle_power_saving ? ReadMode::kAdaptive : ReadMode::kEventDriven);
+  self->device_manager->SetDuplicateSwipeWindow(static_cast<int>(duplicate_swipe_window_ms));
+  self->device_manager->SetDeviceIdentityCache(remember_devices ? device_identity_cache_path()
+                                                                : std::string());
 
-  // Set up callbacks
-  self->device_manager->SetCardSwipeCallback([self](const CardData& card_data) {
+  // Hotplug events can fire as soon as Initialize returns, from the hotplug
+  // thread, so the callback has to be in place first
+  self->device_manager->SetDeviceEventCallback(
+      [self](DeviceEventType type, DeviceInfo&& device_info) {
+        schedule_device_event(self, type, std::move(device_info));
+      });
+
+  // Set up callbacks. Swipes are queued by the read threads and sent from
+  // the main loop, since FlEventChannel must only be used on that thread.
+  self->device_manager->SetCardSwipeCallback([self](CardData&& card_data) {
     send_card_swipe_event(self, card_data);
   });
 
-  self->device_manager->SetDeviceConnectionCallback([self](const DeviceInfo& device_info) {
-    send_device_event(self, device_info);
+  self->device_manager->SetSwipeQueuedCallback([self]() {
+    schedule_swipe_drain(self);
   });
 
-  self->device_manager->StartMonitoring();
+  // Initializing scans the bus, so it runs on the control executor
+  respond_from_executor(self, method_call, [](UsbDeviceManager* manager) {
+    if (!manager->Initialize()) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INITIALIZATION_FAILED", "Failed to initialize USB device manager", nullptr));
+    }
 
-  g_autoptr(FlValue) result = fl_value_new_null();
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    g_autoptr(FlValue) result = fl_value_new_null();
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  });
+
+  // Monitoring starts after the scan, once Dart is listening
+  update_monitoring(self);
+  return nullptr;
 }
 
 static FlMethodResponse* handle_dispose(MagtekCardReaderPlugin* self) {
   if (self->device_manager) {
+    // Calls already handed to the executor finish against the manager first
+    self->control_executor->WaitIdle();
+    FfiBridge::Detach(self->device_manager.get());
     self->device_manager->Cleanup();
     self->device_manager.reset();
+    self->monitoring = FALSE;
   }
 
   g_autoptr(FlValue) result = fl_value_new_null();
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-static FlMethodResponse* handle_get_connected_devices(MagtekCardReaderPlugin* self) {
+static FlMethodResponse* handle_get_connected_devices(MagtekCardReaderPlugin* self,
+                                                      FlMethodCall* method_call) {
   if (!self->device_manager) {
     return FL_METHOD_RESPONSE(fl_method_error_response_new(
         "NOT_INITIALIZED", "Device manager not initialized", nullptr));
   }
 
-  auto devices = self->device_manager->GetConnectedDevices();
-  g_autoptr(FlValue) device_list = fl_value_new_list();
+  // Without hotplug support this rescans the bus
+  respond_from_executor(self, method_call, [](UsbDeviceManager* manager) {
+    auto devices = manager->GetConnectedDevices();
+    g_autoptr(FlValue) device_list = fl_value_new_list();
+
+    for (const auto& device : devices) {
+      g_autoptr(FlValue) device_map = fl_value_new_map();
+
+      fl_value_set_string_take(device_map, "deviceId", fl_value_new_string(device.device_id.c_str()));
+      fl_value_set_string_take(device_map, "deviceName", fl_value_new_string(device.device_name.c_str()));
+      fl_value_set_string_take(device_map, "vendorId", fl_value_new_int(device.vendor_id));
+      fl_value_set_string_take(device_map, "productId", fl_value_new_int(device.product_id));
+      fl_value_set_string_take(device_map, "serialNumber", fl_value_new_string(device.serial_number.c_str()));
+      fl_value_set_string_take(device_map, "devicePath", fl_value_new_string(device.device_path.c_str()));
+      fl_value_set_string_take(device_map, "isConnected", fl_value_new_bool(device.is_connected));
+
+      fl_value_append_take(device_list, device_map);
+    }
+
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(device_list));
+  });
+  return nullptr;
+}
 
-  for (const auto& device : devices) {
-    g_autoptr(FlValue) device_map = fl_value_new_map();
-    
-    fl_value_set_string_take(device_map, "deviceId", fl_value_new_string(device.device_id.c_str()));
-    fl_value_set_string_take(device_map, "deviceName", fl_value_new_string(device.device_name.c_str()));
-    fl_value_set_string_take(device_map, "vendorId", fl_value_new_int(device.vendor_id));
-    fl_value_set_string_take(device_map, "productId", fl_value_new_int(device.product_id));
-    fl_value_set_string_take(device_map, "serialNumber", fl_value_new_string(device.serial_number.c_str()));
-    fl_value_set_string_take(device_map, "devicePath", fl_value_new_string(device.device_path.c_str()));
-    fl_value_set_string_take(device_map, "isConnected", fl_value_new_bool(device.is_connected));
+// Extracts the "deviceId" string argument. Returns nullptr and sets *error
+// if the arguments are malformed.
+static const gchar* get_device_id_argument(FlValue* args, FlMethodResponse** error) {
+  if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    *error = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "Arguments must be a map", nullptr));
+    return nullptr;
+  }
 
-    fl_value_append_take(device_list, device_map);
+  FlValue* device_id_value = fl_value_lookup_string(args, "deviceId");
+  if (!device_id_value || fl_value_get_type(device_id_value) != FL_VALUE_TYPE_STRING) {
+    *error = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "deviceId must be a string", nullptr));
+    return nullptr;
   }
 
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(device_list));
+  return fl_value_get_string(device_id_value);
 }
 
-static FlMethodResponse* handle_connect_to_device(MagtekCardReaderPlugin* self, FlValue* args) {
+static FlMethodResponse* handle_connect_to_device(MagtekCardReaderPlugin* self,
+                                                  FlMethodCall* method_call) {
   if (!self->device_manager) {
     return FL_METHOD_RESPONSE(fl_method_error_response_new(
         "NOT_INITIALIZED", "Device manager not initialized", nullptr));
   }
 
-  if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+  FlMethodResponse* error = nullptr;
+  const gchar* device_id = get_device_id_argument(fl_method_call_get_args(method_call), &error);
+  if (!device_id) {
+    return error;
+  }
+
+  std::string id(device_id);
+  respond_from_executor(self, method_call, [id](UsbDeviceManager* manager) {
+    bool success = manager->ConnectToDevice(id);
+
+    g_autoptr(FlValue) result = fl_value_new_bool(success);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  });
+  return nullptr;
+}
+
+static FlMethodResponse* handle_open_device(MagtekCardReaderPlugin* self,
+                                            FlMethodCall* method_call) {
+  if (!self->device_manager) {
     return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENTS", "Arguments must be a map", nullptr));
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
   }
 
-  FlValue* device_id_value = fl_value_lookup_string(args, "deviceId");
-  if (!device_id_value || fl_value_get_type(device_id_value) != FL_VALUE_TYPE_STRING) {
+  FlMethodResponse* error = nullptr;
+  const gchar* device_id = get_device_id_argument(fl_method_call_get_args(method_call), &error);
+  if (!device_id) {
+    return error;
+  }
+
+  std::string id(device_id);
+  respond_from_executor(self, method_call, [id](UsbDeviceManager* manager) {
+    bool success = manager->OpenDevice(id);
+
+    g_autoptr(FlValue) result = fl_value_new_bool(success);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  });
+  return nullptr;
+}
+
+static FlMethodResponse* handle_close_device(MagtekCardReaderPlugin* self,
+                                              FlMethodCall* method_call) {
+  if (!self->device_manager) {
     return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENTS", "deviceId must be a string", nullptr));
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
   }
 
-  const char* device_id = fl_value_get_string(device_id_value);
-  bool success = self->device_manager->ConnectToDevice(std::string(device_id));
+  FlMethodResponse* error = nullptr;
+  const gchar* device_id = get_device_id_argument(fl_method_call_get_args(method_call), &error);
+  if (!device_id) {
+    return error;
+  }
 
-  g_autoptr(FlValue) result = fl_value_new_bool(success);
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  // Closing joins the device's read thread
+  std::string id(device_id);
+  respond_from_executor(self, method_call, [id](UsbDeviceManager* manager) {
+    manager->CloseDevice(id);
+
+    g_autoptr(FlValue) result = fl_value_new_null();
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  });
+  return nullptr;
 }
 
-static FlMethodResponse* handle_disconnect(MagtekCardReaderPlugin* self) {
+static FlMethodResponse* handle_disconnect(MagtekCardReaderPlugin* self, FlMethodCall* method_call) {
   if (!self->device_manager) {
     return FL_METHOD_RESPONSE(fl_method_error_response_new(
         "NOT_INITIALIZED", "Device manager not initialized", nullptr));
   }
 
-  self->device_manager->Disconnect();
+  respond_from_executor(self, method_call, [](UsbDeviceManager* manager) {
+    manager->Disconnect();
 
-  g_autoptr(FlValue) result = fl_value_new_null();
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    g_autoptr(FlValue) result = fl_value_new_null();
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  });
+  return nullptr;
 }
 
 static FlMethodResponse* handle_is_connected(MagtekCardReaderPlugin* self) {
@@ -210,29 +593,501 @@ static FlMethodResponse* handle_is_connected(MagtekCardReaderPlugin* self) {
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
+static FlMethodResponse* handle_set_raw_response_mode(MagtekCardReaderPlugin* self, FlValue* args) {
+  if (!self->device_manager) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
+  }
+
+  RawResponseMode raw_mode;
+  if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP ||
+      !parse_raw_response_mode(fl_value_lookup_string(args, "mode"), &raw_mode)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "mode must be off, hex or binary", nullptr));
+  }
+
+  self->device_manager->SetRawResponseMode(raw_mode);
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_get_stats(MagtekCardReaderPlugin* self, FlValue* args) {
+  if (!self->device_manager) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
+  }
+
+  // The histograms are lock-free, so this never waits on the read threads
+  g_autoptr(FlValue) stages = fl_value_new_map();
+  for (int i = 0; i < SWIPE_STAGE_COUNT; i++) {
+    SwipeStage stage = static_cast<SwipeStage>(i);
+    LatencySummary summary = self->device_manager->GetStageLatency(stage);
+
+    FlValue* stage_map = fl_value_new_map();
+    fl_value_set_string_take(stage_map, "count", fl_value_new_int(static_cast<int64_t>(summary.count)));
+    fl_value_set_string_take(stage_map, "p50Ns", fl_value_new_int(summary.p50_ns));
+    fl_value_set_string_take(stage_map, "p90Ns", fl_value_new_int(summary.p90_ns));
+    fl_value_set_string_take(stage_map, "p99Ns", fl_value_new_int(summary.p99_ns));
+    fl_value_set_string_take(stage_map, "maxNs", fl_value_new_int(summary.max_ns));
+    fl_value_set_string_take(stage_map, "meanNs", fl_value_new_int(summary.mean_ns));
+    fl_value_set_string_take(stages, SwipeLatencyStats::StageName(stage), stage_map);
+  }
+
+  FlValue* reset_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                             ? fl_value_lookup_string(args, "reset")
+                             : nullptr;
+  if (reset_value && fl_value_get_type(reset_value) == FL_VALUE_TYPE_BOOL &&
+      fl_value_get_bool(reset_value)) {
+    self->device_manager->ResetStats();
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(stages));
+}
+
+static FlMethodResponse* handle_get_metrics(MagtekCardReaderPlugin* self) {
+  if (!self->device_manager) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
+  }
+
+  g_autoptr(FlValue) devices = fl_value_new_map();
+  for (const auto& metrics : self->device_manager->GetMetrics()) {
+    FlValue* counters = fl_value_new_map();
+    fl_value_set_string_take(counters, "reportsRead", fl_value_new_int(static_cast<int64_t>(metrics.reports_read)));
+    fl_value_set_string_take(counters, "bytesRead", fl_value_new_int(static_cast<int64_t>(metrics.bytes_read)));
+    fl_value_set_string_take(counters, "swipesParsed", fl_value_new_int(static_cast<int64_t>(metrics.swipes_parsed)));
+    fl_value_set_string_take(counters, "partialFrames", fl_value_new_int(static_cast<int64_t>(metrics.partial_frames)));
+    fl_value_set_string_take(counters, "invalidFrames", fl_value_new_int(static_cast<int64_t>(metrics.invalid_frames)));
+    fl_value_set_string_take(counters, "readErrors", fl_value_new_int(static_cast<int64_t>(metrics.read_errors)));
+    fl_value_set_string_take(counters, "queueOverflows", fl_value_new_int(static_cast<int64_t>(metrics.queue_overflows)));
+    fl_value_set_string_take(counters, "duplicateSwipes", fl_value_new_int(static_cast<int64_t>(metrics.duplicate_swipes)));
+    fl_value_set_string_take(counters, "reconnects", fl_value_new_int(static_cast<int64_t>(metrics.reconnects)));
+    fl_value_set_string_take(devices, metrics.device_id.c_str(), counters);
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(devices));
+}
+
+// Parses a log level name ("off", "error", "warning", "info" or "debug")
+static bool parse_log_level(FlValue* value, LogLevel* level) {
+  if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+
+  const gchar* name = fl_value_get_string(value);
+  if (strcmp(name, "off") == 0) {
+    *level = LogLevel::kOff;
+  } else if (strcmp(name, "error") == 0) {
+    *level = LogLevel::kError;
+  } else if (strcmp(name, "warning") == 0) {
+    *level = LogLevel::kWarning;
+  } else if (strcmp(name, "info") == 0) {
+    *level = LogLevel::kInfo;
+  } else if (strcmp(name, "debug") == 0) {
+    *level = LogLevel::kDebug;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// The logger is process-wide, so this works before initialize too
+static FlMethodResponse* handle_set_log_level(FlValue* args) {
+  LogLevel level;
+  if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP ||
+      !parse_log_level(fl_value_lookup_string(args, "level"), &level)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "level must be off, error, warning, info or debug", nullptr));
+  }
+
+  Logger::SetLevel(level);
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Sends the read loop's trace slices to trace_marker, or stops. False if it
+// can't be written, in which case tracing stays off.
+static bool set_tracing(bool enabled) {
+  if (!enabled) {
+    Tracer::SetSink(nullptr);
+    return true;
+  }
+
+  SystraceSink* sink = SystraceSink::Instance();
+  if (!sink->IsAvailable()) {
+    return false;
+  }
+  Tracer::SetSink(sink);
+  return true;
+}
+
+// Tracing is process-wide like the logger, so this works before initialize
+// too
+static FlMethodResponse* handle_set_tracing(FlValue* args) {
+  FlValue* enabled = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                         ? fl_value_lookup_string(args, "enabled")
+                         : nullptr;
+  if (!enabled || fl_value_get_type(enabled) != FL_VALUE_TYPE_BOOL) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "enabled must be a bool", nullptr));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_bool(set_tracing(fl_value_get_bool(enabled)));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Monitoring stops while the app is hidden, paused or detached and resumes
+// with it; the state is kept from before initialize too
+static FlMethodResponse* handle_set_app_lifecycle_state(MagtekCardReaderPlugin* self, FlValue* args) {
+  FlValue* state_value = nullptr;
+  if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    state_value = fl_value_lookup_string(args, "state");
+  }
+  if (!state_value || fl_value_get_type(state_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "state must be an AppLifecycleState name", nullptr));
+  }
+
+  const gchar* state = fl_value_get_string(state_value);
+  self->app_active = strcmp(state, "hidden") != 0 && strcmp(state, "paused") != 0 &&
+                     strcmp(state, "detached") != 0;
+  update_monitoring(self);
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// The method call response for a command's result
+static FlMethodResponse* build_command_response(const CommandResult& result) {
+  switch (result.status) {
+    case CommandStatus::kOk:
+      break;
+    case CommandStatus::kNotOpen:
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "DEVICE_NOT_OPEN", "Device is not open", nullptr));
+    case CommandStatus::kTimedOut:
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "TIMEOUT", "Command timed out before it could run", nullptr));
+    case CommandStatus::kFailed:
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "COMMAND_FAILED", "Command could not be sent or its response read", nullptr));
+  }
+
+  g_autoptr(FlValue) response = fl_value_new_map();
+  fl_value_set_string_take(response, "resultCode", fl_value_new_int(result.result_code));
+  fl_value_set_string_take(response, "data", fl_value_new_uint8_list(result.data.data(), result.data.size()));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(response));
+}
+
+static FlMethodResponse* handle_send_command(MagtekCardReaderPlugin* self, FlMethodCall* method_call) {
+  if (!self->device_manager) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
+  }
+
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlMethodResponse* error = nullptr;
+  const gchar* device_id = get_device_id_argument(args, &error);
+  if (!device_id) {
+    return error;
+  }
+
+  FlValue* command_value = fl_value_lookup_string(args, "command");
+  FlValue* data_value = fl_value_lookup_string(args, "data");
+  FlValue* timeout_value = fl_value_lookup_string(args, "timeoutMs");
+  if (!command_value || fl_value_get_type(command_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(command_value) < 0 || fl_value_get_int(command_value) > 0xFF) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "command must be an int from 0 to 255", nullptr));
+  }
+  if (data_value && fl_value_get_type(data_value) != FL_VALUE_TYPE_NULL &&
+      fl_value_get_type(data_value) != FL_VALUE_TYPE_UINT8_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "data must be a Uint8List", nullptr));
+  }
+  if (!timeout_value || fl_value_get_type(timeout_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(timeout_value) < 1 || fl_value_get_int(timeout_value) > G_MAXINT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "timeoutMs must be an int >= 1", nullptr));
+  }
+
+  DeviceCommand command;
+  command.command = static_cast<unsigned char>(fl_value_get_int(command_value));
+  if (data_value && fl_value_get_type(data_value) == FL_VALUE_TYPE_UINT8_LIST) {
+    const uint8_t* data = fl_value_get_uint8_list(data_value);
+    command.data.assign(data, data + fl_value_get_length(data_value));
+  }
+  command.timeout_ms = static_cast<int>(fl_value_get_int(timeout_value));
+
+  // For a monitored device the executor only queues the command for its
+  // read thread, so a batch sent together reaches every reader at once;
+  // the result comes back from whichever thread ran it
+  UsbDeviceManager* manager = self->device_manager.get();
+  std::string id(device_id);
+  FlMethodCall* call = FL_METHOD_CALL(g_object_ref(method_call));
+  self->control_executor->Post([manager, id, command, call]() {
+    manager->SendCommand(id, command, [call](const CommandResult& result) {
+      PendingMethodResponse* pending = new PendingMethodResponse{call, build_command_response(result)};
+      g_idle_add(respond_idle_cb, pending);
+    });
+  });
+  return nullptr;
+}
+
+static FlMethodResponse* handle_start_capture(MagtekCardReaderPlugin* self, FlMethodCall* method_call) {
+  if (!self->device_manager) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
+  }
+
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlMethodResponse* error = nullptr;
+  const gchar* device_id = get_device_id_argument(args, &error);
+  if (!device_id) {
+    return error;
+  }
+  FlValue* path_value = fl_value_lookup_string(args, "path");
+  if (!path_value || fl_value_get_type(path_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENTS", "path must be a string", nullptr));
+  }
+
+  // Creating the file can block
+  std::string id(device_id);
+  std::string path(fl_value_get_string(path_value));
+  respond_from_executor(self, method_call, [id, path](UsbDeviceManager* manager) {
+    g_autoptr(FlValue) result = fl_value_new_bool(manager->StartCapture(id, path));
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  });
+  return nullptr;
+}
+
+static FlMethodResponse* handle_stop_capture(MagtekCardReaderPlugin* self, FlMethodCall* method_call) {
+  if (!self->device_manager) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "NOT_INITIALIZED", "Device manager not initialized", nullptr));
+  }
+
+  FlMethodResponse* error = nullptr;
+  const gchar* device_id = get_device_id_argument(fl_method_call_get_args(method_call), &error);
+  if (!device_id) {
+    return error;
+  }
+
+  std::string id(device_id);
+  respond_from_executor(self, method_call, [id](UsbDeviceManager* manager) {
+    manager->StopCapture(id);
+
+    g_autoptr(FlValue) result = fl_value_new_null();
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  });
+  return nullptr;
+}
+
 static void send_card_swipe_event(MagtekCardReaderPlugin* self, const CardData& card_data) {
   if (!self->card_swipe_handler) {
     return;
   }
+  TraceScope trace("SendCardSwipeEvent", card_data.device_id, card_data.frame.size());
 
-  g_autoptr(FlValue) event_map = fl_value_new_map();
+  g_autoptr(FlValue) event = nullptr;
+  if (self->packed_swipe_events) {
+    std::vector<unsigned char> record;
+    EncodePackedSwipe(card_data, &record);
+    event = fl_value_new_uint8_list(record.data(), record.size());
+  } else {
+    event = build_card_swipe_map(card_data);
+  }
+
+  if (!self->batch_swipes) {
+    fl_event_channel_send(self->card_swipe_event_channel, event, nullptr, nullptr);
+    return;
+  }
+
+  if (!self->pending_swipes) {
+    self->pending_swipes = fl_value_new_list();
+  }
+  fl_value_append(self->pending_swipes, event);
+  if (fl_value_get_length(self->pending_swipes) >= self->batch_max_events) {
+    flush_swipe_batch(self);
+  } else if (self->batch_flush_source == 0) {
+    // The window runs from the first event of the batch
+    self->batch_flush_source = g_timeout_add(self->batch_window_ms, batch_window_cb, self);
+  }
+}
+
+static gboolean batch_window_cb(gpointer user_data) {
+  MagtekCardReaderPlugin* self = MAGTEK_CARD_READER_PLUGIN(user_data);
+
+  self->batch_flush_source = 0;
+  flush_swipe_batch(self);
+  return G_SOURCE_REMOVE;
+}
+
+// Sends the pending batch, if any, as a single list event
+static void flush_swipe_batch(MagtekCardReaderPlugin* self) {
+  if (self->batch_flush_source != 0) {
+    g_source_remove(self->batch_flush_source);
+    self->batch_flush_source = 0;
+  }
+  if (!self->pending_swipes) {
+    return;
+  }
+
+  g_autoptr(FlValue) batch = self->pending_swipes;
+  self->pending_swipes = nullptr;
+  if (fl_value_get_length(batch) > 0) {
+    fl_event_channel_send(self->card_swipe_event_channel, batch, nullptr, nullptr);
+  }
+}
+
+// Called once a drain pass has emptied the read queues
+static void on_swipe_drain_complete(MagtekCardReaderPlugin* self) {
+  if (!self->pending_swipes || fl_value_get_length(self->pending_swipes) == 0) {
+    return;
+  }
+
+  // Nothing else is waiting, so holding the batch back only adds latency;
+  // otherwise the window timer armed by the first event flushes it
+  if (self->batch_low_latency) {
+    flush_swipe_batch(self);
+  }
+}
+
+static FlValue* build_card_swipe_map(const CardData& card_data) {
+  FlValue* event_map = fl_value_new_map();
   fl_value_set_string_take(event_map, "track1", fl_value_new_string(card_data.track1.c_str()));
   fl_value_set_string_take(event_map, "track2", fl_value_new_string(card_data.track2.c_str()));
   fl_value_set_string_take(event_map, "track3", fl_value_new_string(card_data.track3.c_str()));
   fl_value_set_string_take(event_map, "deviceId", fl_value_new_string(card_data.device_id.c_str()));
-  fl_value_set_string_take(event_map, "rawResponse", fl_value_new_string(card_data.raw_response.c_str()));
+  // Only the representation the raw response mode asked for is sent
+  if (!card_data.raw_response.empty()) {
+    fl_value_set_string_take(event_map, "rawResponse", fl_value_new_string(card_data.raw_response.c_str()));
+  }
+  if (!card_data.raw_bytes.empty()) {
+    fl_value_set_string_take(event_map, "rawBytes",
+                             fl_value_new_uint8_list(card_data.raw_bytes.data(), card_data.raw_bytes.size()));
+  }
   fl_value_set_string_take(event_map, "timestamp", fl_value_new_int(card_data.timestamp));
 
-  fl_event_channel_send(self->card_swipe_event_channel, event_map, nullptr, nullptr);
+  FlValue* timings = fl_value_new_map();
+  fl_value_set_string_take(timings, "firstReportNs", fl_value_new_int(card_data.timings.first_report_ns));
+  fl_value_set_string_take(timings, "frameCompleteNs", fl_value_new_int(card_data.timings.frame_complete_ns));
+  fl_value_set_string_take(timings, "parsedNs", fl_value_new_int(card_data.timings.parsed_ns));
+  fl_value_set_string_take(timings, "queuedNs", fl_value_new_int(card_data.timings.queued_ns));
+  fl_value_set_string_take(timings, "deliveredNs", fl_value_new_int(card_data.timings.delivered_ns));
+  fl_value_set_string_take(event_map, "timings", timings);
+
+  // Decoded track1-3, so Dart doesn't parse the tracks again
+  FlValue* track_fields = fl_value_new_list();
+  for (const auto& fields : card_data.track_fields) {
+    FlValue* fields_map = fl_value_new_map();
+    fl_value_set_string_take(fields_map, "status", fl_value_new_string(TrackDecoder::StatusName(fields.status)));
+    fl_value_set_string_take(fields_map, "accountNumber", fl_value_new_string(fields.primary_account_number.c_str()));
+    fl_value_set_string_take(fields_map, "cardholderName", fl_value_new_string(fields.cardholder_name.c_str()));
+    fl_value_set_string_take(fields_map, "expirationDate", fl_value_new_string(fields.expiration_date.c_str()));
+    fl_value_set_string_take(fields_map, "serviceCode", fl_value_new_string(fields.service_code.c_str()));
+    fl_value_set_string_take(fields_map, "discretionaryData",
+                             fl_value_new_string(fields.discretionary_data.c_str()));
+    fl_value_set_string_take(fields_map, "additionalData", fl_value_new_string(fields.additional_data.c_str()));
+    fl_value_append_take(track_fields, fields_map);
+  }
+  fl_value_set_string_take(event_map, "trackFields", track_fields);
+  fl_value_set_string_take(event_map, "validation",
+                           fl_value_new_string(TrackDecoder::ValidationName(card_data.validation)));
+
+  // A MagneSafe swipe's encrypted fields, for decryption off the device
+  if (card_data.encrypted) {
+    const MagneSafeReport& report = card_data.magnesafe;
+    FlValue* encrypted = fl_value_new_map();
+    fl_value_set_string_take(encrypted, "ksn", fl_value_new_uint8_list(report.ksn.data(), report.ksn.size()));
+    fl_value_set_string_take(encrypted, "deviceSerial",
+                             fl_value_new_string_sized(report.device_serial.chars(), report.device_serial.size()));
+    FlValue* encrypted_tracks = fl_value_new_list();
+    for (const auto& track : report.tracks) {
+      fl_value_append_take(encrypted_tracks, fl_value_new_uint8_list(track.encrypted.data(), track.encrypted.size()));
+    }
+    fl_value_set_string_take(encrypted, "encryptedTracks", encrypted_tracks);
+    fl_value_set_string_take(encrypted, "magnePrint",
+                             fl_value_new_uint8_list(report.magneprint.data(), report.magneprint.size()));
+    fl_value_set_string_take(encrypted, "magnePrintStatus", fl_value_new_int(report.magneprint_status));
+    fl_value_set_string_take(encrypted, "encryptionStatus", fl_value_new_int(report.encryption_status));
+    fl_value_set_string_take(encrypted, "sessionId", fl_value_new_uint8_list(report.encrypted_session_id.data(),
+                                                                             report.encrypted_session_id.size()));
+    fl_value_set_string_take(encrypted, "decrypted", fl_value_new_bool(card_data.decrypted));
+    fl_value_set_string_take(event_map, "encrypted", encrypted);
+  }
+
+  return event_map;
+}
+
+static gboolean drain_swipes_idle_cb(gpointer user_data) {
+  MagtekCardReaderPlugin* self = MAGTEK_CARD_READER_PLUGIN(user_data);
+
+  // Clear first so a swipe queued while draining schedules another pass
+  g_atomic_int_set(&self->swipe_drain_scheduled, FALSE);
+  if (self->device_manager) {
+    self->device_manager->DrainCardSwipes();
+  }
+  on_swipe_drain_complete(self);
+
+  return G_SOURCE_REMOVE;
+}
+
+// Called on a read thread after it queues a swipe. Coalesces wake-ups so a
+// burst of swipes is delivered in a single main loop pass.
+static void schedule_swipe_drain(MagtekCardReaderPlugin* self) {
+  if (g_atomic_int_compare_and_exchange(&self->swipe_drain_scheduled, FALSE, TRUE)) {
+    g_idle_add_full(G_PRIORITY_DEFAULT, drain_swipes_idle_cb,
+                    g_object_ref(self), g_object_unref);
+  }
 }
 
-static void send_device_event(MagtekCardReaderPlugin* self, const DeviceInfo& device_info) {
+// A device event on its way from the thread that raised it to the main loop
+struct PendingDeviceEvent {
+  MagtekCardReaderPlugin* self;
+  DeviceEventType type;
+  DeviceInfo device_info;
+};
+
+static void free_pending_device_event(gpointer user_data) {
+  PendingDeviceEvent* event = static_cast<PendingDeviceEvent*>(user_data);
+  g_object_unref(event->self);
+  delete event;
+}
+
+static gboolean device_event_idle_cb(gpointer user_data) {
+  PendingDeviceEvent* event = static_cast<PendingDeviceEvent*>(user_data);
+
+  // The manager itself reopens or closes an unplugged reader's dead handle
+  send_device_event(event->self, event->type, event->device_info);
+
+  return G_SOURCE_REMOVE;
+}
+
+// Called from the hotplug thread, a read thread or the main loop; events are
+// always sent from a main loop pass so they keep their order.
+static void schedule_device_event(MagtekCardReaderPlugin* self, DeviceEventType type,
+                                  DeviceInfo&& device_info) {
+  PendingDeviceEvent* event = new PendingDeviceEvent{
+      MAGTEK_CARD_READER_PLUGIN(g_object_ref(self)), type, std::move(device_info)};
+  g_idle_add_full(G_PRIORITY_DEFAULT, device_event_idle_cb, event,
+                  free_pending_device_event);
+}
+
+static void send_device_event(MagtekCardReaderPlugin* self, DeviceEventType type,
+                              const DeviceInfo& device_info) {
   if (!self->device_event_handler) {
     return;
   }
 
+  const char* event_type =
+      type == DeviceEventType::kConnected ? "device_connected" : "device_disconnected";
+
   g_autoptr(FlValue) event_map = fl_value_new_map();
-  fl_value_set_string_take(event_map, "type", fl_value_new_string("device_connected"));
+  fl_value_set_string_take(event_map, "type", fl_value_new_string(event_type));
   
   g_autoptr(FlValue) device_map = fl_value_new_map();
   fl_value_set_string_take(device_map, "deviceId", fl_value_new_string(device_info.device_id.c_str()));
@@ -251,11 +1106,21 @@ static void send_device_event(MagtekCardReaderPlugin* self, const DeviceInfo& de
 static void magtek_card_reader_plugin_dispose(GObject* object) {
   MagtekCardReaderPlugin* self = MAGTEK_CARD_READER_PLUGIN(object);
   
+  // Finishes any queued control calls before the manager goes away
+  self->control_executor.reset();
   if (self->device_manager) {
+    FfiBridge::Detach(self->device_manager.get());
     self->device_manager->Cleanup();
     self->device_manager.reset();
   }
 
+  // The window timer holds no reference, so it must not outlive us
+  if (self->batch_flush_source != 0) {
+    g_source_remove(self->batch_flush_source);
+    self->batch_flush_source = 0;
+  }
+  g_clear_pointer(&self->pending_swipes, fl_value_unref);
+
   G_OBJECT_CLASS(magtek_card_reader_plugin_parent_class)->dispose(object);
 }
 
@@ -269,6 +1134,18 @@ static void magtek_card_reader_plugin_init(MagtekCardReaderPlugin* self) {
   self->card_swipe_handler = nullptr;
   self->device_event_handler = nullptr;
   self->device_manager = nullptr;
+  self->control_executor = nullptr;
+  self->swipe_drain_scheduled = FALSE;
+  self->packed_swipe_events = FALSE;
+  self->batch_swipes = FALSE;
+  self->batch_window_ms = 0;
+  self->batch_max_events = 0;
+  self->batch_low_latency = FALSE;
+  self->pending_swipes = nullptr;
+  self->batch_flush_source = 0;
+  self->card_swipe_listening = FALSE;
+  self->app_active = TRUE;
+  self->monitoring = FALSE;
 }
 
 static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
@@ -278,6 +1155,12 @@ static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
 }
 
 void magtek_card_reader_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+  // MAGTEK_TRACE traces from startup, before Dart can ask to
+  const gchar* trace = g_getenv("MAGTEK_TRACE");
+  if (trace && *trace && strcmp(trace, "0") != 0 && !set_tracing(true)) {
+    MAGTEK_LOG(LogLevel::kWarning, "MAGTEK_TRACE is set but trace_marker can't be written");
+  }
+
   MagtekCardReaderPlugin* plugin = MAGTEK_CARD_READER_PLUGIN(
       g_object_new(magtek_card_reader_plugin_get_type(), nullptr));
 
@@ -321,3 +1204,8 @@ void magtek_card_reader_plugin_register_with_registrar(FlPluginRegistrar* regist
 
   g_object_unref(plugin);
 }
+
+void magtek_card_reader_plugin_set_track_decryptor(MagtekTrackDecryptFunc func, gpointer user_data) {
+  // gchar and guint8 are char and unsigned char, so the types line up
+  DeviceManagerCore::SetTrackDecryptFunction(func, user_data);
+}
@@ -0,0 +1,63 @@
+#include "systrace_sink.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "logger.h"
+
+const size_t SystraceSink::MAX_LINE_LENGTH;
+
+// Where tracefs is mounted, newest kernels first
+static const char* const TRACE_MARKER_PATHS[] = {
+    "/sys/kernel/tracing/trace_marker",
+    "/sys/kernel/debug/tracing/trace_marker",
+};
+
+SystraceSink::SystraceSink() : fd_(-1), pid_(static_cast<int>(getpid())) {
+    for (const char* path : TRACE_MARKER_PATHS) {
+        fd_ = open(path, O_WRONLY | O_CLOEXEC);
+        if (fd_ >= 0) {
+            return;
+        }
+    }
+    MAGTEK_LOG(LogLevel::kWarning, "Can't open trace_marker for writing, tracing is unavailable");
+}
+
+SystraceSink* SystraceSink::Instance() {
+    // Never destroyed: a read thread may still be inside a slice at exit
+    static SystraceSink* sink = new SystraceSink();
+    return sink;
+}
+
+bool SystraceSink::IsAvailable() const {
+    return fd_ >= 0;
+}
+
+void SystraceSink::BeginSlice(const char* name, const std::string& device_id, size_t report_size) {
+    char line[MAX_LINE_LENGTH];
+    size_t length = FormatBegin(line, sizeof(line), pid_, name, device_id, report_size);
+    // A failed write only loses the slice
+    if (write(fd_, line, length) < 0) {
+        return;
+    }
+}
+
+void SystraceSink::EndSlice(const char* /*name*/) {
+    char line[32];
+    int length = snprintf(line, sizeof(line), "E|%d", pid_);
+    if (write(fd_, line, static_cast<size_t>(length)) < 0) {
+        return;
+    }
+}
+
+size_t SystraceSink::FormatBegin(char* line, size_t size, int pid, const char* name, const std::string& device_id,
+                                 size_t report_size) {
+    int length = snprintf(line, size, "B|%d|%s %s %zu bytes", pid, name, device_id.c_str(), report_size);
+    if (length < 0) {
+        line[0] = '\0';
+        return 0;
+    }
+    return static_cast<size_t>(length) < size ? static_cast<size_t>(length) : size - 1;
+}
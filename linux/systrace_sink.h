@@ -0,0 +1,43 @@
+#ifndef SYSTRACE_SINK_H_
+#define SYSTRACE_SINK_H_
+
+#include <cstddef>
+#include <string>
+
+#include "trace_events.h"
+
+// Writes the swipe pipeline's trace slices to ftrace's trace_marker in the
+// systrace text format ("B|<pid>|<name>" and "E|<pid>"), which Perfetto's
+// ftrace data source and systrace both turn into slices on the writing
+// thread. The device ID and report size are appended to the slice name,
+// since the format has no arguments. Each slice is a single write(), so
+// threads never interleave inside one.
+//
+// trace_marker is only writable by root by default; `chmod a+w` on it, or
+// tracefs mounted with a suitable gid, lets an app without privileges trace.
+class SystraceSink : public TraceSink {
+public:
+    // Longest line written; longer device IDs are cut short
+    static const size_t MAX_LINE_LENGTH = 256;
+
+    // The process's sink; trace_marker is opened on first use and kept open
+    static SystraceSink* Instance();
+
+    // Whether trace_marker could be opened for writing
+    bool IsAvailable() const;
+
+    void BeginSlice(const char* name, const std::string& device_id, size_t report_size) override;
+    void EndSlice(const char* name) override;
+
+    // The line a slice's start is written as. Returns its length.
+    static size_t FormatBegin(char* line, size_t size, int pid, const char* name, const std::string& device_id,
+                              size_t report_size);
+
+private:
+    SystraceSink();
+
+    int fd_;
+    int pid_;
+};
+
+#endif  // SYSTRACE_SINK_H_
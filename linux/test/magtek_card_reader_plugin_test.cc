@@ -2,8 +2,247 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "include/magtek_card_reader/magtek_card_reader_plugin.h"
 #include "magtek_card_reader_plugin_private.h"
+#include "device_command.h"
+#include "device_identity_cache.h"
+#include "device_manager_core.h"
+#include "ffi_bridge.h"
+#include "fixed_string.h"
+#include "hidapi_transport.h"
+#include "hidraw_transport.h"
+#include "libusb_transport.h"
+#include "logger.h"
+#include "magnesafe_report.h"
+#include "magtek_products.h"
+#include "mock_hid_transport.h"
+#include "packed_swipe_codec.h"
+#include "report_buffer_pool.h"
+#include "report_capture.h"
+#include "report_parser.h"
+#include "report_replay.h"
+#include "serial_executor.h"
+#include "spsc_ring.h"
+#include "swipe_assembler.h"
+#include "swipe_deduplicator.h"
+#include "swipe_latency.h"
+#include "systrace_sink.h"
+#include "trace_events.h"
+#include "track_decoder.h"
+#include "usb_device_manager.h"
+
+namespace {
+
+// A MagneSafe encrypted swipe with only track 2, at the V5 report offsets
+std::vector<unsigned char> MakeMagneSafeReport() {
+  std::vector<unsigned char> report(MagneSafeReportParser::REPORT_SIZE, 0);
+  const char* masked = ";4111********1111=2512?";
+  report[3 + 1] = 8;
+  memset(&report[7 + 112], 0xA5, 8);
+  report[343] = 0x81;
+  report[344] = 0x01;
+  report[347] = 0x02;
+  report[348] = 4;
+  memset(&report[349], 0x5A, 4);
+  memcpy(&report[477], "B0123456", 8);
+  report[493] = 0x02;
+  for (int i = 0; i < 10; i++) {
+    report[495 + i] = static_cast<unsigned char>(0xF0 + i);
+  }
+  report[505 + 1] = static_cast<unsigned char>(strlen(masked));
+  memcpy(&report[508 + 112], masked, strlen(masked));
+  memset(&report[844], 0x33, 8);
+  return report;
+}
+
+// Copies of a viewed field, for comparing
+std::vector<unsigned char> Bytes(const ByteView& view) {
+  return std::vector<unsigned char>(view.begin(), view.end());
+}
+
+std::string Text(const ByteView& view) {
+  return std::string(view.chars(), view.size());
+}
+
+// Decrypts track 2 of MakeMagneSafeReport, as an HSM bridge would
+int DecryptTestTrack(void* user_data, const unsigned char* ksn, size_t ksn_length, int track_number,
+                     const unsigned char* ciphertext, size_t ciphertext_length, char* plaintext,
+                     size_t plaintext_capacity) {
+  const char* clear = static_cast<const char*>(user_data);
+  if (track_number != 2 || ksn_length != 10 || ksn[9] != 0xF9 || ciphertext_length != 8 ||
+      strlen(clear) > plaintext_capacity) {
+    return -1;
+  }
+  memcpy(plaintext, clear, strlen(clear));
+  return static_cast<int>(strlen(clear));
+}
+
+// Hands out one padded swipe report, then times out on every read, or
+// fails them all when it is a reader being unplugged. Answers each command
+// with result code 0 and the command's own data.
+class FakeConnection : public HidConnection {
+public:
+  explicit FakeConnection(bool fail_after_swipe = false, std::vector<unsigned char> report = {})
+      : fail_after_swipe_(fail_after_swipe), report_(std::move(report)) {}
+
+  // Set before the read thread starts: reads after the swipe block through
+  // their whole timeout, as an idle reader's do, unless cancelled; and
+  // each command counts itself in commands_started and then takes
+  // command_delay_ms to answer
+  bool block_reads = false;
+  std::atomic<int>* commands_started = nullptr;
+  int command_delay_ms = 0;
+
+  int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) override {
+    if (sent_) {
+      if (fail_after_swipe_) {
+        return -1;
+      }
+      if (block_reads) {
+        std::unique_lock<std::mutex> lock(cancel_mutex_);
+        cancel_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return read_cancelled_; });
+        read_cancelled_ = false;
+        return 0;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return 0;
+    }
+    sent_ = true;
+    if (!report_.empty()) {
+      memcpy(buffer, report_.data(), std::min(size, report_.size()));
+      return static_cast<int>(std::min(size, report_.size()));
+    }
+    const char* tracks = "%B41^DOE/J^25?;41=25?";
+    memset(buffer, 0, size);
+    buffer[0] = 0x01;
+    memcpy(buffer + 1, tracks, strlen(tracks));
+    return 64;
+  }
+
+  bool CanCancelRead() const override { return block_reads; }
+
+  void CancelRead() override {
+    {
+      std::lock_guard<std::mutex> lock(cancel_mutex_);
+      read_cancelled_ = true;
+    }
+    cancel_cv_.notify_one();
+  }
+
+  int SendFeatureReport(const unsigned char* data, size_t length) override {
+    if (commands_started) {
+      (*commands_started)++;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(command_delay_ms));
+    feature_report_.assign(data, data + length);
+    return static_cast<int>(length);
+  }
+
+  int GetFeatureReport(unsigned char* buffer, size_t size) override {
+    if (feature_report_.size() < 3 || size < feature_report_.size()) {
+      return -1;
+    }
+    memcpy(buffer, feature_report_.data(), feature_report_.size());
+    buffer[1] = 0;
+    return static_cast<int>(feature_report_.size());
+  }
+
+  std::string LastError() override { return std::string(); }
+
+private:
+  bool fail_after_swipe_;
+  std::vector<unsigned char> feature_report_;
+  std::vector<unsigned char> report_;
+  bool sent_ = false;
+  std::mutex cancel_mutex_;
+  std::condition_variable cancel_cv_;
+  bool read_cancelled_ = false;
+};
+
+// DeviceManagerCore over one fake reader and no hotplug
+class FakeDeviceManager : public DeviceManagerCore {
+public:
+  ~FakeDeviceManager() { Cleanup(); }
+
+  // While set, OpenConnection waits, as a slow device open would
+  std::atomic<bool> hold_open{false};
+  std::atomic<bool> opening{false};
+  // Connections opened from now on fail every read after their swipe
+  std::atomic<bool> fail_reads{false};
+  // When set before Initialize, the reader is a uDynamo sending this report
+  std::vector<unsigned char> encrypted_report;
+  // Claims hotplug notifications keep the device cache current
+  std::atomic<bool> hotplug_active{false};
+  // Connections opened from now on block their idle reads until
+  // cancelled, and answer commands after this delay
+  std::atomic<bool> block_reads{false};
+  std::atomic<int> command_delay_ms{0};
+  // Commands the device has started on
+  std::atomic<int> commands_started{0};
+
+protected:
+  bool InitializeHid() override { return true; }
+  void ShutdownHid() override {}
+
+  std::vector<DeviceInfo> EnumerateDevices() override {
+    unsigned short product_id = encrypted_report.empty() ? 0x0002 : 0x0004;
+    DeviceInfo info;
+    info.device_id = encrypted_report.empty() ? "801:2:fake" : "801:4:fake";
+    info.device_name = GetDeviceName(MAGTEK_VENDOR_ID, product_id);
+    info.vendor_id = MAGTEK_VENDOR_ID;
+    info.product_id = product_id;
+    info.device_path = "fake";
+    info.is_connected = false;
+    return {info};
+  }
+
+  std::unique_ptr<HidConnection> OpenConnection(const DeviceInfo& info) override {
+    opening = true;
+    while (hold_open.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::unique_ptr<FakeConnection> connection(new FakeConnection(fail_reads.exchange(false), encrypted_report));
+    connection->block_reads = block_reads.load();
+    connection->commands_started = &commands_started;
+    connection->command_delay_ms = command_delay_ms.load();
+    return std::unique_ptr<HidConnection>(connection.release());
+  }
+
+  void StartHotplugMonitor() override {}
+  void StopHotplugMonitor() override {}
+  bool IsHotplugActive() const override { return hotplug_active.load(); }
+};
+
+// The last record the FFI bridge posted to port 42, and how many it posted
+std::vector<unsigned char> g_posted_record;
+std::atomic<int> g_posted_count(0);
+
+bool FakePostCObject(int64_t port, MagtekDartCObject* message) {
+  // Dart_CObject_kTypedData of Dart_TypedData_kUint8
+  if (port != 42 || message->type != 7 || message->value.as_typed_data.type != 2) {
+    return false;
+  }
+  const uint8_t* values = message->value.as_typed_data.values;
+  g_posted_record.assign(values, values + message->value.as_typed_data.length);
+  g_posted_count++;
+  return true;
+}
+
+}  // namespace
 
 // This demonstrates a simple unit test of the C portion of this plugin's
 // implementation.
@@ -27,5 +266,1309 @@ TEST(MagtekCardReaderPlugin, GetPlatformVersion) {
   EXPECT_THAT(fl_value_get_string(result), testing::StartsWith("Linux "));
 }
 
+TEST(SwipeAssembler, CompletesSingleReportOnPaddedEndSentinel) {
+  SwipeAssembler assembler;
+  const char* tracks = "%B4111111111111111^DOE/JOHN^2512101?;4111111111111111=2512101?";
+  unsigned char padded[96] = {0x01};
+  memcpy(padded + 1, tracks, strlen(tracks));
+
+  auto now = SwipeAssembler::Clock::now();
+  ASSERT_TRUE(assembler.AddReport(padded, sizeof(padded), now));
+  EXPECT_EQ(assembler.FrameLength(), sizeof(padded));
+  EXPECT_FALSE(assembler.HasPendingFrame());
+}
+
+TEST(SwipeAssembler, JoinsReportsUntilGapTimeout) {
+  SwipeAssembler assembler;
+  FramingRules rules;
+  rules.complete_on_padding = false;
+  rules.gap_timeout_ms = 20;
+  assembler.SetFramingRules(rules);
+
+  unsigned char first[16] = {0x01};
+  memcpy(first + 1, "%B41111^DOE/J?", 14);
+  unsigned char second[16] = {0x01};
+  memcpy(second + 1, ";41111=2512?", 12);
+
+  auto now = SwipeAssembler::Clock::now();
+  EXPECT_FALSE(assembler.AddReport(first, sizeof(first), now));
+  EXPECT_FALSE(assembler.AddReport(second, sizeof(second), now));
+  EXPECT_FALSE(assembler.CheckTimeout(now + std::chrono::milliseconds(5)));
+  ASSERT_TRUE(assembler.CheckTimeout(now + std::chrono::milliseconds(25)));
+
+  // Report ID once, then both payloads back to back
+  EXPECT_EQ(assembler.FrameLength(), sizeof(first) + sizeof(second) - 1);
+  EXPECT_EQ(assembler.FrameData()[0], 0x01);
+  EXPECT_EQ(assembler.FrameData()[16], ';');
+
+  // Payloads go straight into the caller's buffer, and a frame partway
+  // through follows the buffer when it is replaced
+  std::vector<unsigned char> buffer(SwipeAssembler::MAX_FRAME_SIZE);
+  std::vector<unsigned char> replacement(SwipeAssembler::MAX_FRAME_SIZE);
+  assembler.SetFrameBuffer(buffer.data());
+  EXPECT_FALSE(assembler.AddReport(first, sizeof(first), now));
+  EXPECT_EQ(buffer[1], '%');
+  assembler.SetFrameBuffer(replacement.data());
+  EXPECT_FALSE(assembler.AddReport(second, sizeof(second), now));
+  ASSERT_TRUE(assembler.CheckTimeout(now + std::chrono::milliseconds(25)));
+  EXPECT_EQ(assembler.FrameData(), replacement.data());
+  EXPECT_EQ(assembler.FrameLength(), sizeof(first) + sizeof(second) - 1);
+  EXPECT_EQ(replacement[1], '%');
+  EXPECT_EQ(replacement[16], ';');
+}
+
+TEST(SwipeDeduplicator, MatchesAnyTrackWithinAWindowEachRepeatRestarts) {
+  SwipeDeduplicator deduplicator;
+  const std::chrono::milliseconds window(500);
+  uint64_t track1 = SwipeDeduplicator::HashTrack("%B41^DOE/J^25?", 14);
+  uint64_t track2 = SwipeDeduplicator::HashTrack(";41=25?", 7);
+  uint64_t other = SwipeDeduplicator::HashTrack(";42=25?", 7);
+  EXPECT_EQ(SwipeDeduplicator::HashTrack("", 0), 0u);
+  EXPECT_NE(track2, other);
+
+  auto now = SwipeDeduplicator::Clock::now();
+  const uint64_t both[3] = {track1, track2, 0};
+  const uint64_t misread_track1[3] = {other, track2, 0};
+  const uint64_t only_track1[3] = {track1, 0, 0};
+  const uint64_t other_card[3] = {0, other, 0};
+  EXPECT_FALSE(deduplicator.IsRepeat(both, now, window));
+  // One matching track is enough, and each repeat moves the window on
+  EXPECT_TRUE(deduplicator.IsRepeat(misread_track1, now + std::chrono::milliseconds(400), window));
+  EXPECT_TRUE(deduplicator.IsRepeat(only_track1, now + std::chrono::milliseconds(800), window));
+  EXPECT_FALSE(deduplicator.IsRepeat(both, now + std::chrono::milliseconds(1400), window));
+
+  // A different card in between starts over
+  EXPECT_FALSE(deduplicator.IsRepeat(other_card, now + std::chrono::milliseconds(1500), window));
+  EXPECT_FALSE(deduplicator.IsRepeat(both, now + std::chrono::milliseconds(1600), window));
+  deduplicator.Reset();
+  EXPECT_FALSE(deduplicator.IsRepeat(both, now + std::chrono::milliseconds(1700), window));
+}
+
+// One case of test/conformance/swipe_pipeline_vectors.txt, which the Dart
+// pipeline's tests run too
+struct ConformanceCase {
+  std::string name;
+  unsigned short product_id = 0;
+  int dedup_ms = 0;
+  std::vector<std::pair<int, std::vector<unsigned char>>> reports;
+  std::vector<std::string> swipes;
+  int duplicates = 0;
+};
+
+// A report line's ID, size and payload, its escapes decoded
+static std::vector<unsigned char> DecodeConformanceReport(const std::string& id, size_t size,
+                                                          const std::string& payload) {
+  std::vector<unsigned char> report(1, static_cast<unsigned char>(std::stoi(id, nullptr, 16)));
+  for (size_t i = 0; i < payload.size(); i++) {
+    if (payload[i] != '\\' || i + 1 == payload.size()) {
+      report.push_back(static_cast<unsigned char>(payload[i]));
+      continue;
+    }
+    char escape = payload[++i];
+    if (escape == 'x') {
+      report.push_back(static_cast<unsigned char>(std::stoi(payload.substr(i + 1, 2), nullptr, 16)));
+      i += 2;
+    } else {
+      report.push_back(escape == 'r' ? '\r' : escape == 'n' ? '\n' : static_cast<unsigned char>(escape));
+    }
+  }
+  if (size > report.size()) {
+    report.resize(size, 0);
+  }
+  return report;
+}
+
+static std::vector<ConformanceCase> LoadConformanceCases(const std::string& path) {
+  std::vector<ConformanceCase> cases;
+  std::ifstream file(path.c_str());
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string keyword;
+    if (line.empty() || line[0] == '#' || !(fields >> keyword)) {
+      continue;
+    }
+    if (keyword == "case") {
+      cases.push_back(ConformanceCase());
+      fields >> cases.back().name;
+      continue;
+    }
+
+    ConformanceCase& current = cases.back();
+    if (keyword == "product") {
+      unsigned int product_id = 0;
+      fields >> std::hex >> product_id;
+      current.product_id = static_cast<unsigned short>(product_id);
+    } else if (keyword == "dedup") {
+      fields >> current.dedup_ms;
+    } else if (keyword == "duplicates") {
+      fields >> current.duplicates;
+    } else if (keyword == "swipe") {
+      current.swipes.push_back(line.size() > 6 ? line.substr(6) : std::string());
+    } else if (keyword == "report") {
+      int at_ms = 0;
+      std::string id;
+      size_t size = 0;
+      fields >> at_ms >> id >> size;
+      std::string payload;
+      if (fields.get() == ' ') {
+        std::getline(fields, payload);
+      }
+      current.reports.push_back(std::make_pair(at_ms, DecodeConformanceReport(id, size, payload)));
+    }
+  }
+  return cases;
+}
+
+// What the core's assembler, parser and repeat filter make of a case's
+// reports, as "track1|track2|track3" per swipe
+static std::vector<std::string> RunConformanceCase(const ConformanceCase& test_case, int* duplicates) {
+  SwipeAssembler assembler;
+  assembler.SetFramingRules(GetFramingRules(*FindMagtekProduct(test_case.product_id)));
+  ReportParser parser;
+  SwipeDeduplicator deduplicator;
+  std::vector<std::string> swipes;
+  *duplicates = 0;
+
+  auto take_frame = [&]() {
+    if (!parser.Parse(assembler.FrameData(), assembler.FrameLength())) {
+      return;
+    }
+    std::string tracks[ReportParser::TRACK_COUNT];
+    uint64_t hashes[SwipeDeduplicator::TRACK_COUNT];
+    for (int i = 0; i < ReportParser::TRACK_COUNT; i++) {
+      parser.AssignTrack(i + 1, &tracks[i]);
+      hashes[i] = SwipeDeduplicator::HashTrack(tracks[i].data(), tracks[i].size());
+    }
+    if (test_case.dedup_ms > 0 &&
+        deduplicator.IsRepeat(hashes, assembler.FrameCompleteTime(), std::chrono::milliseconds(test_case.dedup_ms))) {
+      (*duplicates)++;
+      return;
+    }
+    swipes.push_back(tracks[0] + "|" + tracks[1] + "|" + tracks[2]);
+  };
+
+  SwipeAssembler::Clock::time_point start = SwipeAssembler::Clock::now();
+  SwipeAssembler::Clock::time_point now = start;
+  for (const auto& report : test_case.reports) {
+    now = start + std::chrono::milliseconds(report.first);
+    if (assembler.CheckTimeout(now)) {
+      take_frame();
+    }
+    if (assembler.AddReport(report.second.data(), report.second.size(), now)) {
+      take_frame();
+    }
+  }
+  now += std::chrono::seconds(1);
+  if (assembler.CheckTimeout(now)) {
+    take_frame();
+  }
+  return swipes;
+}
+
+TEST(SwipePipelineConformance, MatchesTheSharedVectors) {
+  std::vector<ConformanceCase> cases = LoadConformanceCases(MAGTEK_CONFORMANCE_VECTORS);
+  ASSERT_GE(cases.size(), 8u);
+  for (const ConformanceCase& test_case : cases) {
+    SCOPED_TRACE(test_case.name);
+    ASSERT_NE(FindMagtekProduct(test_case.product_id), nullptr);
+    int duplicates = 0;
+    EXPECT_EQ(RunConformanceCase(test_case, &duplicates), test_case.swipes);
+    EXPECT_EQ(duplicates, test_case.duplicates);
+  }
+}
+
+TEST(SpscRing, DrainsInOrderAndRejectsWhenFull) {
+  SpscRing<int, 4> ring;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(ring.TryPush(i));
+  }
+  EXPECT_FALSE(ring.TryPush(4));
+
+  std::vector<int> drained;
+  EXPECT_EQ(ring.ConsumeAll([&drained](const int& value) { drained.push_back(value); }), 4u);
+  EXPECT_THAT(drained, testing::ElementsAre(0, 1, 2, 3));
+  EXPECT_TRUE(ring.Empty());
+  EXPECT_TRUE(ring.TryPush(5));
+
+  // Filled in place, an item is only visible once committed
+  int* slot = ring.PrepareSlot();
+  ASSERT_NE(slot, nullptr);
+  *slot = 6;
+  drained.clear();
+  ring.ConsumeAll([&drained](const int& value) { drained.push_back(value); });
+  EXPECT_THAT(drained, testing::ElementsAre(5));
+  ring.CommitSlot();
+  ring.ConsumeAll([&drained](const int& value) { drained.push_back(value); });
+  EXPECT_THAT(drained, testing::ElementsAre(5, 6));
+  for (int i = 0; i < 4; i++) {
+    ASSERT_NE(ring.PrepareSlot(), nullptr);
+    ring.CommitSlot();
+  }
+  EXPECT_EQ(ring.PrepareSlot(), nullptr);
+}
+
+TEST(FixedString, KeepsWhatFitsAndStaysTerminated) {
+  FixedString<4> value;
+  EXPECT_TRUE(value.empty());
+  EXPECT_STREQ(value.c_str(), "");
+  value.assign("ab", 2);
+  EXPECT_EQ(value, "ab");
+  value.assign("abcdef", 6);
+  EXPECT_EQ(value.size(), 4u);
+  EXPECT_STREQ(value.c_str(), "abcd");
+  EXPECT_EQ(value.str(), std::string("abcd"));
+}
+
+TEST(ReportBufferPool, SharesBuffersAndRecyclesThemWithoutGrowing) {
+  std::shared_ptr<ReportBufferPool> pool = ReportBufferPool::Create(64, 2);
+  ReportBuffer first = pool->Acquire();
+  ASSERT_TRUE(first.IsUnique());
+  EXPECT_EQ(first.capacity(), 64u);
+  memcpy(first.mutable_data(), "abc", 3);
+  first.SetSize(3);
+
+  // Copies share the bytes rather than duplicating them
+  ReportBuffer shared = first;
+  EXPECT_FALSE(first.IsUnique());
+  EXPECT_EQ(shared.data(), first.data());
+  EXPECT_EQ(Text(shared.View(1, 2)), "bc");
+
+  // A buffer goes back once its last handle lets go, and is handed out again
+  const unsigned char* recycled = first.data();
+  first.Reset();
+  shared.Reset();
+  for (int i = 0; i < 100; i++) {
+    ReportBuffer buffer = pool->Acquire();
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.data(), recycled);
+  }
+  EXPECT_EQ(pool->BufferCount(), 2u);
+
+  // Only holding every buffer makes it grow, a block at a time
+  std::vector<ReportBuffer> held;
+  for (int i = 0; i < 3; i++) {
+    held.push_back(pool->Acquire());
+  }
+  EXPECT_EQ(pool->BufferCount(), 4u);
+
+  // Outstanding buffers keep the arena alive past its owner
+  std::weak_ptr<ReportBufferPool> weak = pool;
+  pool.reset();
+  EXPECT_FALSE(weak.expired());
+  held.clear();
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(ReportParser, FindsTracksAmongNonPrintableBytes) {
+  unsigned char frame[48] = {0x01};
+  memcpy(frame + 1, "%B41^DOE/J^25?", 14);
+  frame[15] = 0x00;
+  memcpy(frame + 16, ";41=25", 6);
+  frame[22] = 0x07;
+  memcpy(frame + 23, "12?", 3);
+
+  ReportParser parser;
+  ASSERT_TRUE(parser.Parse(frame, sizeof(frame)));
+
+  std::string track;
+  parser.AssignTrack(1, &track);
+  EXPECT_EQ(track, "%B41^DOE/J^25?");
+  parser.AssignTrack(2, &track);
+  EXPECT_EQ(track, ";41=2512?");
+  EXPECT_EQ(parser.Track(3).length, 0u);
+
+  std::string hex;
+  ReportParser::FormatHex(frame, 3, &hex);
+  EXPECT_EQ(hex, "01 25 42 ");
+}
+
+TEST(MagtekProducts, FindsEveryTableEntryAndRejectsUnknownIds) {
+  for (const ProductDescriptor& product : MAGTEK_PRODUCTS) {
+    const ProductDescriptor* found = FindMagtekProduct(product.product_id);
+    ASSERT_NE(found, nullptr);
+    EXPECT_STREQ(found->name, product.name);
+  }
+  EXPECT_EQ(FindMagtekProduct(0x0005), nullptr);
+  EXPECT_EQ(FindMagtekProduct(0x0021), nullptr);
+  EXPECT_FALSE(GetFramingRules(*FindMagtekProduct(0x0003)).complete_on_padding);
+}
+
+TEST(PackedSwipeCodec, EncodesVersionThreeRecord) {
+  struct {
+    std::string track1, track2, track3, device_id, raw_response;
+    std::vector<unsigned char> raw_bytes;
+    long timestamp;
+    SwipeTimings timings;
+    TrackFields track_fields[3];
+    SwipeValidation validation;
+    bool encrypted;
+    bool decrypted;
+    MagneSafeReport magnesafe;
+  } card = {"", ";41=25?", "", "d1", "01 ", {}, 0x0102, {1, 2, 3, 4, 0x0105}};
+  card.track_fields[0].status = TrackStatus::kAbsent;
+  card.track_fields[1].status = TrackStatus::kDecoded;
+  card.track_fields[1].primary_account_number.assign("41", 2);
+  card.track_fields[2].status = TrackStatus::kAbsent;
+  card.validation = SwipeValidation::kLuhnError;
+
+  std::vector<unsigned char> record;
+  EncodePackedSwipe(card, &record);
+
+  // Same bytes as the decodePackedSwipe test on the Dart side
+  std::vector<unsigned char> expected = {3, 0x01, 0x02, 0x01, 0, 0, 0, 0, 0, 0, 0, 0,
+                                         7, 0, ';', '4', '1', '=', '2', '5', '?',
+                                         0, 0, 2, 0, 'd', '1', 3, 0, '0', '1', ' ',
+                                         1, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0,
+                                         3, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0,
+                                         0x05, 0x01, 0, 0, 0, 0, 0, 0,
+                                         3,
+                                         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                         1, 2, 0, '4', '1', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  EXPECT_EQ(record, expected);
+}
+
+TEST(TrackDecoder, DecodesIsoTracksAndChecksLrcAndLuhn) {
+  TrackFields fields;
+  const char* track1 = "%B4111111111111111^DOE/JOHN^2512101123?";
+  EXPECT_EQ(TrackDecoder::Decode(1, track1, strlen(track1), 0, &fields), TrackStatus::kDecoded);
+  EXPECT_EQ(fields.primary_account_number, "4111111111111111");
+  EXPECT_EQ(fields.cardholder_name, "DOE/JOHN");
+  EXPECT_EQ(fields.expiration_date, "2512");
+  EXPECT_EQ(fields.service_code, "101");
+  EXPECT_EQ(fields.discretionary_data, "123");
+
+  // A matching LRC passes; any other character is a misread
+  char lrc = TrackDecoder::ComputeLrc(1, track1, strlen(track1));
+  EXPECT_EQ(TrackDecoder::Decode(1, track1, strlen(track1), lrc, &fields), TrackStatus::kDecoded);
+  EXPECT_EQ(TrackDecoder::Decode(1, track1, strlen(track1), lrc ^ 0x01, &fields), TrackStatus::kLrcError);
+  EXPECT_TRUE(fields.primary_account_number.empty());
+
+  const char* track2 = ";4111111111111111=2512101?";
+  EXPECT_EQ(TrackDecoder::Decode(2, track2, strlen(track2), 0, &fields), TrackStatus::kDecoded);
+  EXPECT_EQ(fields.expiration_date, "2512");
+  EXPECT_EQ(fields.service_code, "101");
+  EXPECT_EQ(TrackDecoder::Decode(2, ";41A1=25?", 9, 0, &fields), TrackStatus::kFormatError);
+
+  // Track 3 follows track 2 and keeps its content whole
+  ReportParser parser;
+  const char* frame = "\x01%B41^A^?;41=25?;0123=456?";
+  ASSERT_TRUE(parser.Parse(reinterpret_cast<const unsigned char*>(frame), strlen(frame)));
+  std::string track3;
+  parser.AssignTrack(3, &track3);
+  EXPECT_EQ(track3, ";0123=456?");
+  EXPECT_EQ(TrackDecoder::Decode(3, track3.data(), track3.size(), 0, &fields), TrackStatus::kDecoded);
+  EXPECT_EQ(fields.additional_data, "0123=456");
+
+  TrackFields tracks[3];
+  TrackDecoder::Decode(1, track1, strlen(track1), 0, &tracks[0]);
+  TrackDecoder::Decode(2, track2, strlen(track2), 0, &tracks[1]);
+  TrackDecoder::Decode(3, "", 0, 0, &tracks[2]);
+  EXPECT_EQ(TrackDecoder::Validate(tracks, 3), SwipeValidation::kValid);
+  TrackDecoder::Decode(1, "%B4111111111111112^A^?", 22, 0, &tracks[0]);
+  EXPECT_EQ(TrackDecoder::Validate(tracks, 3), SwipeValidation::kLuhnError);
+  TrackDecoder::Decode(2, track2, strlen(track2), '0', &tracks[1]);
+  EXPECT_EQ(TrackDecoder::Validate(tracks, 3), SwipeValidation::kLrcError);
+}
+
+TEST(MagneSafeReportParser, ReadsFieldsAndRejectsOverrunningLengths) {
+  std::vector<unsigned char> data = MakeMagneSafeReport();
+  EXPECT_TRUE(MagneSafeReportParser::IsEncryptedReport(data.size()));
+  EXPECT_FALSE(MagneSafeReportParser::IsEncryptedReport(SwipeAssembler::MAX_REPORT_SIZE));
+
+  MagneSafeReport report;
+  ASSERT_TRUE(MagneSafeReportParser::Parse(data.data(), data.size(), &report));
+  EXPECT_TRUE(report.tracks[0].encrypted.empty());
+  EXPECT_EQ(Bytes(report.tracks[1].encrypted), std::vector<unsigned char>(8, 0xA5));
+  EXPECT_EQ(Text(report.tracks[1].masked), ";4111********1111=2512?");
+  EXPECT_EQ(report.card_status, 0x81);
+  EXPECT_EQ(report.magneprint_status, 0x02000001ul);
+  EXPECT_EQ(Bytes(report.magneprint), std::vector<unsigned char>(4, 0x5A));
+  EXPECT_EQ(Text(report.device_serial), "B0123456");
+  EXPECT_EQ(report.encryption_status, 0x0002);
+  ASSERT_EQ(report.ksn.size(), MagneSafeReportParser::KSN_SIZE);
+  EXPECT_EQ(report.ksn[0], 0xF0);
+  EXPECT_EQ(Bytes(report.encrypted_session_id), std::vector<unsigned char>(8, 0x33));
+  // Views into the report, not copies
+  EXPECT_EQ(report.ksn.data(), data.data() + 495);
+
+  // A length past its slot is a corrupt report, not a reason to overread
+  data[505 + 1] = MagneSafeReportParser::TRACK_DATA_SIZE + 1;
+  EXPECT_FALSE(MagneSafeReportParser::Parse(data.data(), data.size(), &report));
+  EXPECT_FALSE(MagneSafeReportParser::Parse(data.data(), MagneSafeReportParser::MIN_REPORT_SIZE - 1, &report));
+}
+
+TEST(LatencyHistogram, BucketsStayWithinAnEighthAndCoverEveryDuration) {
+  for (long long ns : {0LL, 7LL, 8LL, 15LL, 16LL, 1000LL, 123456789LL}) {
+    int index = LatencyHistogram::BucketIndex(ns);
+    long long upper = LatencyHistogram::BucketUpperBound(index);
+    EXPECT_GE(upper, ns);
+    EXPECT_LE(upper - ns, ns / 8);
+  }
+  EXPECT_EQ(LatencyHistogram::BucketIndex(1LL << 50), LatencyHistogram::BUCKET_COUNT - 1);
+
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 100; i++) {
+    histogram.Record(i * 1000);
+  }
+  LatencySummary summary = histogram.Summarize();
+  EXPECT_EQ(summary.count, 100u);
+  EXPECT_EQ(summary.max_ns, 100000);
+  EXPECT_EQ(summary.mean_ns, 50500);
+  EXPECT_GE(summary.p50_ns, 50000);
+  EXPECT_LE(summary.p50_ns, 50000 + 50000 / 8);
+  EXPECT_GE(summary.p99_ns, 99000);
+  EXPECT_LE(summary.p99_ns, 100000);
+
+  histogram.Reset();
+  EXPECT_EQ(histogram.Summarize().count, 0u);
+}
+
+TEST(DeviceManagerCore, DeliversSwipesFromAdapterConnection) {
+  FakeDeviceManager manager;
+  std::vector<CardData> swipes;
+  std::atomic<bool> queued(false);
+  manager.SetCardSwipeCallback([&swipes](CardData&& card_data) { swipes.push_back(std::move(card_data)); });
+  manager.SetSwipeQueuedCallback([&queued] { queued = true; });
+  ASSERT_TRUE(manager.Initialize());
+
+  std::vector<DeviceInfo> devices = manager.GetConnectedDevices();
+  ASSERT_EQ(devices.size(), 1u);
+  EXPECT_EQ(devices[0].device_name, "Magtek USB Swipe Reader");
+  ASSERT_TRUE(manager.OpenDevice(devices[0].device_id));
+  manager.StartMonitoring();
+
+  for (int i = 0; i < 1000 && !queued.load(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.DrainCardSwipes();
+
+  ASSERT_EQ(swipes.size(), 1u);
+  EXPECT_EQ(swipes[0].track1, "%B41^DOE/J^25?");
+  EXPECT_EQ(swipes[0].track2, ";41=25?");
+  EXPECT_EQ(swipes[0].device_id, "801:2:fake");
+  EXPECT_EQ(swipes[0].track_fields[0].cardholder_name, "DOE/J");
+  EXPECT_EQ(swipes[0].track_fields[1].primary_account_number, "41");
+  EXPECT_EQ(swipes[0].validation, SwipeValidation::kLuhnError);
+  EXPECT_TRUE(manager.IsDeviceOpen("801:2:fake"));
+
+  // Every stage is stamped, in order, and counted in the statistics
+  const SwipeTimings& timings = swipes[0].timings;
+  EXPECT_GT(timings.first_report_ns, 0);
+  EXPECT_LE(timings.first_report_ns, timings.frame_complete_ns);
+  EXPECT_LE(timings.frame_complete_ns, timings.parsed_ns);
+  EXPECT_LE(timings.parsed_ns, timings.queued_ns);
+  EXPECT_LE(timings.queued_ns, timings.delivered_ns);
+  LatencySummary total = manager.GetStageLatency(SwipeStage::kTotal);
+  EXPECT_EQ(total.count, 1u);
+  EXPECT_EQ(total.max_ns, timings.delivered_ns - timings.first_report_ns);
+
+  std::vector<DeviceMetrics> metrics = manager.GetMetrics();
+  ASSERT_EQ(metrics.size(), 1u);
+  EXPECT_EQ(metrics[0].device_id, "801:2:fake");
+  EXPECT_EQ(metrics[0].reports_read, 1u);
+  EXPECT_EQ(metrics[0].bytes_read, 64u);
+  EXPECT_EQ(metrics[0].swipes_parsed, 1u);
+  EXPECT_EQ(metrics[0].reconnects, 0u);
+
+  // Counters outlive the session, and a reopen counts as a reconnect
+  manager.StopMonitoring();
+  manager.CloseDevice("801:2:fake");
+  ASSERT_TRUE(manager.OpenDevice("801:2:fake"));
+  metrics = manager.GetMetrics();
+  EXPECT_EQ(metrics[0].reports_read, 1u);
+  EXPECT_EQ(metrics[0].reconnects, 1u);
+}
+
+TEST(Logger, RateLimitsEachSiteAndCountsWhatItDropped) {
+  LogRateLimiter limiter;
+  unsigned suppressed = 0;
+  for (unsigned i = 0; i < LogRateLimiter::LINES_PER_WINDOW; i++) {
+    EXPECT_TRUE(limiter.Allow(&suppressed));
+    EXPECT_EQ(suppressed, 0u);
+  }
+  EXPECT_FALSE(limiter.Allow(&suppressed));
+  EXPECT_FALSE(limiter.Allow(&suppressed));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(LogRateLimiter::WINDOW_MS + 10));
+  EXPECT_TRUE(limiter.Allow(&suppressed));
+  EXPECT_EQ(suppressed, 2u);
+
+  // A disabled level never evaluates the message
+  Logger::SetLevel(LogLevel::kError);
+  bool formatted = false;
+  auto format = [&formatted]() {
+    formatted = true;
+    return "x";
+  };
+  MAGTEK_LOG(LogLevel::kDebug, format());
+  EXPECT_FALSE(formatted);
+  Logger::SetLevel(LogLevel::kWarning);
+}
+
+TEST(DeviceManagerCore, QueriesDoNotWaitForASlowOpen) {
+  FakeDeviceManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  manager.hold_open = true;
+
+  std::thread opener([&manager] { manager.OpenDevice("801:2:fake"); });
+  while (!manager.opening.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // The open is stuck in the adapter; none of these may block on it
+  EXPECT_FALSE(manager.IsConnected());
+  EXPECT_FALSE(manager.IsDeviceOpen("801:2:fake"));
+  EXPECT_EQ(manager.GetConnectedDevices().size(), 1u);
+  manager.DrainCardSwipes();
+
+  manager.hold_open = false;
+  opener.join();
+  EXPECT_TRUE(manager.IsConnected());
+}
+
+TEST(DeviceManagerCore, ReopensADeviceWhoseReadsFail) {
+  // Declared first so the manager's final close events still find them
+  std::mutex events_mutex;
+  std::vector<DeviceEventType> events;
+  std::atomic<int> queued(0);
+  std::vector<CardData> swipes;
+  FakeDeviceManager manager;
+  manager.SetDeviceEventCallback([&events_mutex, &events](DeviceEventType type, DeviceInfo&& info) {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.push_back(type);
+  });
+  manager.SetSwipeQueuedCallback([&queued] { queued++; });
+  ASSERT_TRUE(manager.Initialize());
+
+  manager.fail_reads = true;
+  ASSERT_TRUE(manager.OpenDevice("801:2:fake"));
+  manager.StartMonitoring();
+
+  // One swipe from the first handle, which then dies, and one from the
+  // handle the read thread reopened after its backoff
+  for (int i = 0; i < 2000 && queued.load() < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.StopMonitoring();
+  manager.SetCardSwipeCallback([&swipes](CardData&& card_data) { swipes.push_back(std::move(card_data)); });
+  manager.DrainCardSwipes();
+
+  EXPECT_EQ(swipes.size(), 2u);
+  EXPECT_TRUE(manager.IsDeviceOpen("801:2:fake"));
+  std::vector<DeviceMetrics> metrics = manager.GetMetrics();
+  ASSERT_EQ(metrics.size(), 1u);
+  EXPECT_EQ(metrics[0].read_errors, 1u);
+  EXPECT_EQ(metrics[0].reconnects, 1u);
+
+  std::lock_guard<std::mutex> lock(events_mutex);
+  EXPECT_EQ(events, (std::vector<DeviceEventType>{DeviceEventType::kConnected, DeviceEventType::kDisconnected,
+                                                  DeviceEventType::kConnected}));
+}
+
+TEST(DeviceManagerCore, IdlesQuietDevicesAndReadsTheWholeSwipeOnceOneArrives) {
+  std::atomic<int> queued(0);
+  std::vector<CardData> swipes;
+  DeviceInfo info;
+  info.device_id = "801:2:mock";
+  info.device_name = DeviceManagerCore::GetDeviceName(MAGTEK_VENDOR_ID, 0x0002);
+  info.vendor_id = MAGTEK_VENDOR_ID;
+  info.product_id = 0x0002;
+  info.device_path = "mock0";
+  info.is_connected = false;
+
+  MockHidTransport* transport = new MockHidTransport();
+  transport->AddDevice(info);
+  UsbDeviceManager manager{std::unique_ptr<HidTransport>(transport)};
+  manager.SetSwipeQueuedCallback([&queued] { queued++; });
+  manager.SetReadMode(ReadMode::kAdaptive);
+  manager.SetAdaptiveIdle(20, 200);
+  ASSERT_TRUE(manager.Initialize());
+  ASSERT_TRUE(manager.OpenDevice("801:2:mock"));
+  manager.StartMonitoring();
+  // Past the idle timeout and the event-driven read already waiting then
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+  // A swipe split across two reports reaches an idle device: the first
+  // report is read at the idle cadence, the second without waiting for it
+  std::vector<unsigned char> first = {0x01, '%', 'B', '4', '1', '^', 'D', 'O'};
+  std::vector<unsigned char> second(32, 0);
+  second[0] = 0x01;
+  memcpy(&second[1], "E/J^25?;41=25?", strlen("E/J^25?;41=25?"));
+  transport->QueueReport("mock0", first);
+  transport->QueueReport("mock0", second);
+  for (int i = 0; i < 1000 && queued.load() < 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.StopMonitoring();
+  manager.SetCardSwipeCallback([&swipes](CardData&& card_data) { swipes.push_back(std::move(card_data)); });
+  manager.DrainCardSwipes();
+
+  ASSERT_EQ(swipes.size(), 1u);
+  EXPECT_EQ(swipes[0].track1, "%B41^DOE/J^25?");
+  EXPECT_LT(swipes[0].timings.frame_complete_ns - swipes[0].timings.first_report_ns, 100000000);
+}
+
+TEST(DeviceManagerCore, DropsRepeatedSwipesBeforeTheyAreQueued) {
+  std::atomic<int> queued(0);
+  std::vector<CardData> swipes;
+  DeviceInfo info;
+  info.device_id = "801:2:mock";
+  info.device_name = DeviceManagerCore::GetDeviceName(MAGTEK_VENDOR_ID, 0x0002);
+  info.vendor_id = MAGTEK_VENDOR_ID;
+  info.product_id = 0x0002;
+  info.device_path = "mock0";
+  info.is_connected = false;
+  auto make_report = [](const char* tracks) {
+    std::vector<unsigned char> report(64, 0);
+    report[0] = 0x01;
+    memcpy(&report[1], tracks, strlen(tracks));
+    return report;
+  };
+
+  MockHidTransport* transport = new MockHidTransport();
+  transport->AddDevice(info);
+  UsbDeviceManager manager{std::unique_ptr<HidTransport>(transport)};
+  manager.SetSwipeQueuedCallback([&queued] { queued++; });
+  manager.SetDuplicateSwipeWindow(60000);
+  ASSERT_TRUE(manager.Initialize());
+  ASSERT_TRUE(manager.OpenDevice("801:2:mock"));
+
+  // The same card three times, the last with track 1 misread, then another
+  transport->QueueReport("mock0", make_report("%B41^DOE/J^25?;41=25?"));
+  transport->QueueReport("mock0", make_report("%B41^DOE/J^25?;41=25?"));
+  transport->QueueReport("mock0", make_report("%B4X^DOE/J^25?;41=25?"));
+  transport->QueueReport("mock0", make_report(";42=25?"));
+  manager.StartMonitoring();
+  for (int i = 0; i < 1000 && manager.GetMetrics()[0].reports_read < 4; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.StopMonitoring();
+  manager.SetCardSwipeCallback([&swipes](CardData&& card_data) { swipes.push_back(std::move(card_data)); });
+  manager.DrainCardSwipes();
+
+  ASSERT_EQ(swipes.size(), 2u);
+  EXPECT_EQ(queued.load(), 2);
+  EXPECT_EQ(swipes[0].track2, ";41=25?");
+  EXPECT_EQ(swipes[1].track2, ";42=25?");
+  std::vector<DeviceMetrics> metrics = manager.GetMetrics();
+  EXPECT_EQ(metrics[0].duplicate_swipes, 2u);
+  EXPECT_EQ(metrics[0].swipes_parsed, 2u);
+}
+
+// Keeps every slice it is sent, as "B <name> <device> <size>" or "E <name>"
+class RecordingTraceSink : public TraceSink {
+public:
+  void BeginSlice(const char* name, const std::string& device_id, size_t report_size) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slices_.push_back(std::string("B ") + name + " " + device_id + " " + std::to_string(report_size));
+  }
+
+  void EndSlice(const char* name) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slices_.push_back(std::string("E ") + name);
+  }
+
+  std::vector<std::string> Slices() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slices_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<std::string> slices_;
+};
+
+TEST(Tracer, TracesEachStageOfASwipeOnlyWhileASinkIsSet) {
+  RecordingTraceSink sink;
+  DeviceInfo info;
+  info.device_id = "801:2:mock";
+  info.device_name = DeviceManagerCore::GetDeviceName(MAGTEK_VENDOR_ID, 0x0002);
+  info.vendor_id = MAGTEK_VENDOR_ID;
+  info.product_id = 0x0002;
+  info.device_path = "mock0";
+  info.is_connected = false;
+  std::vector<unsigned char> report(64, 0);
+  report[0] = 0x01;
+  memcpy(&report[1], ";41=25?", 7);
+
+  MockHidTransport* transport = new MockHidTransport();
+  transport->AddDevice(info);
+  UsbDeviceManager manager{std::unique_ptr<HidTransport>(transport)};
+  manager.SetCardSwipeCallback([](CardData&&) {});
+  ASSERT_TRUE(manager.Initialize());
+  ASSERT_TRUE(manager.OpenDevice("801:2:mock"));
+
+  auto swipe = [&manager, &transport, &report](unsigned long long reports) {
+    transport->QueueReport("mock0", report);
+    manager.StartMonitoring();
+    for (int i = 0; i < 1000 && manager.GetMetrics()[0].swipes_parsed < reports; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    manager.StopMonitoring();
+    manager.DrainCardSwipes();
+  };
+
+  Tracer::SetSink(&sink);
+  swipe(1);
+  Tracer::SetSink(nullptr);
+  swipe(2);
+
+  std::vector<std::string> expected = {
+      "B ReadFromDevice 801:2:mock 64",
+      "B ParseInputReport 801:2:mock 64",
+      "E ParseInputReport",
+      "B QueueSwipe 801:2:mock 64",
+      "E QueueSwipe",
+      "E ReadFromDevice",
+      "B DeliverSwipe 801:2:mock 64",
+      "E DeliverSwipe",
+  };
+  EXPECT_EQ(sink.Slices(), expected);
+}
+
+TEST(SystraceSink, FormatsSliceStartsForTraceMarker) {
+  char line[SystraceSink::MAX_LINE_LENGTH];
+  size_t length = SystraceSink::FormatBegin(line, sizeof(line), 42, "ParseInputReport", "801:2:ABC", 64);
+  EXPECT_EQ(std::string(line, length), "B|42|ParseInputReport 801:2:ABC 64 bytes");
+
+  // A device ID too long for the line is cut short, never overrun
+  char short_line[16];
+  length = SystraceSink::FormatBegin(short_line, sizeof(short_line), 42, "QueueSwipe", "801:2:ABC", 64);
+  EXPECT_EQ(length, sizeof(short_line) - 1);
+  EXPECT_EQ(std::string(short_line, length), "B|42|QueueSwipe");
+}
+
+TEST(DeviceManagerCore, DeliversMaskedOrDecryptedMagneSafeSwipes) {
+  std::vector<CardData> swipes;
+  std::atomic<bool> queued(false);
+  FakeDeviceManager manager;
+  manager.encrypted_report = MakeMagneSafeReport();
+  manager.SetCardSwipeCallback([&swipes](CardData&& card_data) { swipes.push_back(std::move(card_data)); });
+  manager.SetSwipeQueuedCallback([&queued] { queued = true; });
+  ASSERT_TRUE(manager.Initialize());
+
+  auto swipe_once = [&manager, &queued] {
+    queued = false;
+    ASSERT_TRUE(manager.OpenDevice("801:4:fake"));
+    manager.StartMonitoring();
+    for (int i = 0; i < 1000 && !queued.load(); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    manager.StopMonitoring();
+    manager.CloseDevice("801:4:fake");
+    manager.DrainCardSwipes();
+  };
+
+  // Without a decryptor the masked track is delivered, unjudged by Luhn
+  swipe_once();
+  ASSERT_EQ(swipes.size(), 1u);
+  EXPECT_TRUE(swipes[0].encrypted);
+  EXPECT_FALSE(swipes[0].decrypted);
+  EXPECT_EQ(swipes[0].track2, ";4111********1111=2512?");
+  EXPECT_EQ(swipes[0].track_fields[1].primary_account_number, "4111********1111");
+  EXPECT_EQ(swipes[0].validation, SwipeValidation::kValid);
+  // The delivered copy keeps the frame its fields point into, even though
+  // the device and its buffer pool have closed
+  EXPECT_EQ(Text(swipes[0].magnesafe.device_serial), "B0123456");
+
+  static char clear_track[] = ";4111111111111111=2512101?";
+  DeviceManagerCore::SetTrackDecryptFunction(DecryptTestTrack, clear_track);
+  swipe_once();
+  DeviceManagerCore::SetTrackDecryptFunction(nullptr, nullptr);
+  ASSERT_EQ(swipes.size(), 2u);
+  EXPECT_TRUE(swipes[1].decrypted);
+  EXPECT_EQ(swipes[1].track2, clear_track);
+  EXPECT_EQ(swipes[1].track_fields[1].service_code, "101");
+  EXPECT_EQ(swipes[1].validation, SwipeValidation::kValid);
+
+  // Both swipes bypassed reassembly, one report each
+  std::vector<DeviceMetrics> metrics = manager.GetMetrics();
+  ASSERT_EQ(metrics.size(), 1u);
+  EXPECT_EQ(metrics[0].reports_read, 2u);
+  EXPECT_EQ(metrics[0].swipes_parsed, 2u);
+}
+
+TEST(DeviceCommandCodec, FramesCommandsAndResponses) {
+  DeviceCommand command = {0x09, {0x01, 0x02}, 100};
+  std::vector<unsigned char> report;
+  ASSERT_TRUE(DeviceCommandCodec::Encode(command, 24, &report));
+  ASSERT_EQ(report.size(), 25u);
+  EXPECT_EQ(report[0], 0);
+  EXPECT_EQ(report[1], 0x09);
+  EXPECT_EQ(report[2], 2);
+  EXPECT_EQ(report[3], 0x01);
+  EXPECT_EQ(report[4], 0x02);
+  EXPECT_EQ(report[5], 0);
+
+  command.data.assign(23, 0);
+  EXPECT_FALSE(DeviceCommandCodec::Encode(command, 24, &report));
+
+  const unsigned char response[] = {0, 0x02, 1, 0x7F, 0};
+  CommandResult result;
+  ASSERT_TRUE(DeviceCommandCodec::Decode(response, sizeof(response), &result));
+  EXPECT_EQ(result.result_code, 0x02);
+  EXPECT_EQ(result.data, std::vector<unsigned char>(1, 0x7F));
+  // A length byte past the end of the report is a corrupt response
+  const unsigned char truncated[] = {0, 0, 3, 0x7F};
+  EXPECT_FALSE(DeviceCommandCodec::Decode(truncated, sizeof(truncated), &result));
+}
+
+TEST(DeviceManagerCore, RunsCommandsInlineOrBetweenReads) {
+  FakeDeviceManager manager;
+  ASSERT_TRUE(manager.Initialize());
+
+  std::vector<CommandResult> results;
+  std::mutex results_mutex;
+  auto record = [&results, &results_mutex](const CommandResult& result) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    results.push_back(result);
+  };
+
+  // Not open, then open but unmonitored, which runs on this thread
+  manager.SendCommand("801:2:fake", {0x00, {0x01}, 1000}, record);
+  ASSERT_TRUE(manager.OpenDevice("801:2:fake"));
+  manager.SendCommand("801:2:fake", {0x00, {0x01}, 1000}, record);
+  manager.SendCommand("801:2:fake", {0x00, std::vector<unsigned char>(23, 0), 1000}, record);
+  ASSERT_EQ(results.size(), 3u);
+  EXPECT_EQ(results[0].status, CommandStatus::kNotOpen);
+  EXPECT_EQ(results[1].status, CommandStatus::kOk);
+  EXPECT_EQ(results[1].data, std::vector<unsigned char>(1, 0x01));
+  EXPECT_EQ(results[2].status, CommandStatus::kFailed);
+
+  // A batch sent to a monitored device comes back in order from its read
+  // thread
+  manager.StartMonitoring();
+  for (unsigned char i = 0; i < 3; i++) {
+    manager.SendCommand("801:2:fake", {0x01, {i}, 1000}, record);
+  }
+  for (int i = 0; i < 1000; i++) {
+    {
+      std::lock_guard<std::mutex> lock(results_mutex);
+      if (results.size() == 6u) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.StopMonitoring();
+
+  {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    ASSERT_EQ(results.size(), 6u);
+    for (unsigned char i = 0; i < 3; i++) {
+      EXPECT_EQ(results[3 + i].status, CommandStatus::kOk);
+      EXPECT_EQ(results[3 + i].data, std::vector<unsigned char>(1, i));
+    }
+  }
+
+  // An idle reader whose reads block for the whole event-driven slice,
+  // and whose commands take 200 ms
+  FakeDeviceManager idle;
+  idle.block_reads = true;
+  idle.command_delay_ms = 200;
+  ASSERT_TRUE(idle.Initialize());
+  ASSERT_TRUE(idle.OpenDevice("801:2:fake"));
+  idle.StartMonitoring();
+
+  struct Outcome {
+    std::mutex mutex;
+    std::condition_variable done;
+    std::vector<CommandResult> results;
+  };
+  std::shared_ptr<Outcome> outcome = std::make_shared<Outcome>();
+  auto record_idle = [outcome](const CommandResult& result) {
+    {
+      std::lock_guard<std::mutex> lock(outcome->mutex);
+      outcome->results.push_back(result);
+    }
+    outcome->done.notify_all();
+  };
+  auto wait_for_results = [outcome](size_t count) {
+    std::unique_lock<std::mutex> lock(outcome->mutex);
+    outcome->done.wait_for(lock, std::chrono::seconds(2), [&] { return outcome->results.size() >= count; });
+  };
+
+  // The read thread is well into an event-driven wait when a command
+  // shorter than the wait slice arrives; it still goes out
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  idle.SendCommand("801:2:fake", {0x01, {0x07}, 50}, record_idle);
+  wait_for_results(1);
+
+  // While the device works on a slow command, the next one's deadline
+  // passes in the queue; its caller hears so at the deadline, not when
+  // the slow command is done
+  idle.SendCommand("801:2:fake", {0x02, {0x08}, 1000}, record_idle);
+  for (int i = 0; i < 1000 && idle.commands_started.load() < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto queued_at = std::chrono::steady_clock::now();
+  idle.SendCommand("801:2:fake", {0x03, {0x09}, 30}, record_idle);
+  wait_for_results(2);
+  auto answered_after = std::chrono::steady_clock::now() - queued_at;
+  wait_for_results(3);
+  idle.StopMonitoring();
+
+  std::lock_guard<std::mutex> idle_lock(outcome->mutex);
+  ASSERT_EQ(outcome->results.size(), 3u);
+  EXPECT_EQ(outcome->results[0].status, CommandStatus::kOk);
+  EXPECT_EQ(outcome->results[0].data, std::vector<unsigned char>(1, 0x07));
+  EXPECT_EQ(outcome->results[1].status, CommandStatus::kTimedOut);
+  EXPECT_GE(answered_after, std::chrono::milliseconds(30));
+  EXPECT_LT(answered_after, std::chrono::milliseconds(150));
+  EXPECT_EQ(outcome->results[2].status, CommandStatus::kOk);
+  EXPECT_EQ(idle.commands_started.load(), 2);
+}
+
+TEST(FfiBridge, AnswersQueriesAndPostsSwipesToTheNativePort) {
+  EXPECT_EQ(magtek_ffi_version(), MAGTEK_FFI_VERSION);
+  EXPECT_EQ(magtek_ffi_is_connected(), 0);
+
+  FakeDeviceManager manager;
+  manager.hotplug_active = true;
+  bool delivered = false;
+  manager.SetCardSwipeCallback([&delivered](CardData&&) { delivered = true; });
+  FfiBridge::Attach(&manager);
+  ASSERT_TRUE(manager.Initialize());
+
+  MagtekFfiDevice devices[2];
+  ASSERT_EQ(magtek_ffi_get_connected_devices(devices, 2), 1);
+  EXPECT_STREQ(devices[0].device_id, "801:2:fake");
+  EXPECT_STREQ(devices[0].device_name, "Magtek USB Swipe Reader");
+  EXPECT_EQ(devices[0].product_id, 0x0002);
+  EXPECT_EQ(devices[0].is_connected, 0);
+  ASSERT_TRUE(manager.OpenDevice("801:2:fake"));
+  EXPECT_EQ(magtek_ffi_is_connected(), 1);
+  EXPECT_EQ(magtek_ffi_is_device_open("801:2:fake"), 1);
+  ASSERT_EQ(magtek_ffi_get_connected_devices(devices, 1), 1);
+  EXPECT_EQ(devices[0].is_connected, 1);
+
+  // The swipe goes to the port from the read thread and skips the queue
+  magtek_ffi_set_swipe_port(42, FakePostCObject);
+  manager.StartMonitoring();
+  for (int i = 0; i < 1000 && g_posted_count.load() == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.StopMonitoring();
+  magtek_ffi_set_swipe_port(0, nullptr);
+  manager.DrainCardSwipes();
+
+  ASSERT_EQ(g_posted_count.load(), 1);
+  EXPECT_EQ(g_posted_record[0], PACKED_SWIPE_VERSION);
+  EXPECT_FALSE(delivered);
+  EXPECT_EQ(manager.GetStageLatency(SwipeStage::kTotal).count, 1u);
+
+  FfiBridge::Detach(&manager);
+  EXPECT_EQ(magtek_ffi_is_connected(), 0);
+  EXPECT_EQ(magtek_ffi_get_connected_devices(devices, 2), -1);
+}
+
+TEST(ReportCapture, RecordsReportsAndReplaysThemIntoTheManager) {
+  std::string path = testing::TempDir() + "magtek_capture_test.bin";
+
+  // Capture the fake reader's one swipe report
+  {
+    FakeDeviceManager manager;
+    std::atomic<bool> queued(false);
+    manager.SetSwipeQueuedCallback([&queued] { queued = true; });
+    ASSERT_TRUE(manager.Initialize());
+    EXPECT_FALSE(manager.StartCapture("801:2:fake", path));
+    ASSERT_TRUE(manager.OpenDevice("801:2:fake"));
+    ASSERT_TRUE(manager.StartCapture("801:2:fake", path));
+    manager.StartMonitoring();
+    for (int i = 0; i < 1000 && !queued.load(); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    manager.StopMonitoring();
+    manager.StopCapture("801:2:fake");
+  }
+
+  auto capture = std::make_shared<ReportCapture>();
+  ASSERT_TRUE(ReportCapture::Load(path, capture.get()));
+  EXPECT_EQ(capture->product_id, 0x0002);
+  ASSERT_EQ(capture->reports.size(), 1u);
+  EXPECT_EQ(capture->reports[0].data.size(), 64u);
+  EXPECT_GE(capture->reports[0].offset_us, 0);
+
+  // Played back, it is the same swipe
+  std::vector<CardData> swipes;
+  ReplayDeviceManager replay(capture, ReplayPacing::kRecorded);
+  replay.SetCardSwipeCallback([&swipes](CardData&& card_data) { swipes.push_back(std::move(card_data)); });
+  ASSERT_TRUE(replay.Initialize());
+  ASSERT_TRUE(replay.OpenDevice(ReplayDeviceManager::REPLAY_DEVICE_ID));
+  replay.StartMonitoring();
+  for (int i = 0; i < 1000 && swipes.empty(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    replay.DrainCardSwipes();
+  }
+  EXPECT_TRUE(replay.Finished());
+  replay.StopMonitoring();
+
+  ASSERT_EQ(swipes.size(), 1u);
+  EXPECT_EQ(swipes[0].track1, "%B41^DOE/J^25?");
+  EXPECT_EQ(swipes[0].device_id, ReplayDeviceManager::REPLAY_DEVICE_ID);
+  std::remove(path.c_str());
+}
+
+TEST(UsbDeviceManager, ReadsAndReconnectsThroughAMockTransport) {
+  // Declared first so the manager's final close events still find them
+  std::mutex events_mutex;
+  std::vector<DeviceEventType> events;
+  std::atomic<int> queued(0);
+  std::vector<CardData> swipes;
+
+  DeviceInfo info;
+  info.device_id = "801:2:mock";
+  info.device_name = DeviceManagerCore::GetDeviceName(MAGTEK_VENDOR_ID, 0x0002);
+  info.vendor_id = MAGTEK_VENDOR_ID;
+  info.product_id = 0x0002;
+  info.device_path = "mock0";
+  info.is_connected = false;
+  std::vector<unsigned char> report(64, 0);
+  report[0] = 0x01;
+  memcpy(&report[1], "%B41^DOE/J^25?;41=25?", strlen("%B41^DOE/J^25?;41=25?"));
+
+  MockHidTransport* transport = new MockHidTransport();
+  transport->AddDevice(info);
+  transport->QueueReport("mock0", report);
+  UsbDeviceManager manager{std::unique_ptr<HidTransport>(transport)};
+  manager.SetDeviceEventCallback([&events_mutex, &events](DeviceEventType type, DeviceInfo&&) {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.push_back(type);
+  });
+  manager.SetSwipeQueuedCallback([&queued] { queued++; });
+  ASSERT_TRUE(manager.Initialize());
+
+  std::vector<DeviceInfo> devices = manager.GetConnectedDevices();
+  ASSERT_EQ(devices.size(), 1u);
+  EXPECT_EQ(devices[0].device_name, "Magtek USB Swipe Reader");
+  ASSERT_TRUE(manager.OpenDevice("801:2:mock"));
+  manager.StartMonitoring();
+  for (int i = 0; i < 1000 && queued.load() < 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // Unplugging fails the read; replugging lets the read thread reopen it
+  transport->RemoveDevice("mock0");
+  for (int i = 0; i < 1000 && manager.GetMetrics()[0].read_errors == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  transport->AddDevice(info);
+  transport->QueueReport("mock0", report);
+  for (int i = 0; i < 2000 && queued.load() < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.StopMonitoring();
+  manager.SetCardSwipeCallback([&swipes](CardData&& card_data) { swipes.push_back(std::move(card_data)); });
+  manager.DrainCardSwipes();
+
+  ASSERT_EQ(swipes.size(), 2u);
+  EXPECT_EQ(swipes[1].track1, "%B41^DOE/J^25?");
+  EXPECT_EQ(swipes[1].device_id, "801:2:mock");
+  EXPECT_EQ(transport->OpenCount("mock0"), 2);
+  std::lock_guard<std::mutex> lock(events_mutex);
+  EXPECT_EQ(events, (std::vector<DeviceEventType>{DeviceEventType::kConnected, DeviceEventType::kDisconnected,
+                                                  DeviceEventType::kConnected}));
+}
+
+TEST(DeviceIdentityCache, KeepsTheMostRecentlyOpenedReadersOnDisk) {
+  std::string path = testing::TempDir() + "magtek_identity_test";
+  DeviceInfo first;
+  first.device_id = "801:10:B1234";
+  first.vendor_id = MAGTEK_VENDOR_ID;
+  first.product_id = 0x0010;
+  first.serial_number = "B1234";
+  first.device_path = "/dev/hidraw3";
+  first.is_connected = true;
+  DeviceInfo second = first;
+  second.device_id = "801:2:0001:0004:00";
+  second.product_id = 0x0002;
+  second.serial_number = "";
+  second.device_path = "0001:0004:00";
+
+  DeviceIdentityCache cache;
+  EXPECT_TRUE(cache.Remember(first));
+  EXPECT_FALSE(cache.Remember(first));
+  EXPECT_TRUE(cache.Remember(second));
+  // The same reader under a new path replaces its old record
+  first.device_path = "/dev/hidraw1";
+  EXPECT_TRUE(cache.Remember(first));
+  ASSERT_TRUE(cache.Save(path));
+
+  DeviceIdentityCache loaded;
+  ASSERT_TRUE(DeviceIdentityCache::Load(path, &loaded));
+  ASSERT_EQ(loaded.devices.size(), 2u);
+  EXPECT_EQ(loaded.devices[0].device_id, "801:10:B1234");
+  EXPECT_EQ(loaded.devices[0].product_id, 0x0010);
+  EXPECT_EQ(loaded.devices[0].serial_number, "B1234");
+  EXPECT_EQ(loaded.devices[0].device_path, "/dev/hidraw1");
+  EXPECT_EQ(loaded.devices[0].device_name, DeviceManagerCore::GetDeviceName(MAGTEK_VENDOR_ID, 0x0010));
+  EXPECT_FALSE(loaded.devices[0].is_connected);
+  EXPECT_EQ(loaded.devices[1].serial_number, "");
+  EXPECT_EQ(loaded.devices[1].device_path, "0001:0004:00");
+  DeviceInfo found;
+  EXPECT_TRUE(loaded.Find("801:2:0001:0004:00", &found));
+  EXPECT_FALSE(loaded.Find("801:2:missing", &found));
+
+  for (size_t i = 0; i < DeviceIdentityCache::MAX_DEVICES + 4; i++) {
+    second.device_id = "801:2:" + std::to_string(i);
+    loaded.Remember(second);
+  }
+  EXPECT_EQ(loaded.devices.size(), DeviceIdentityCache::MAX_DEVICES);
+  // Saving again replaces the file whole and leaves no temporary behind
+  ASSERT_TRUE(loaded.Save(path));
+  DeviceIdentityCache reloaded;
+  ASSERT_TRUE(DeviceIdentityCache::Load(path, &reloaded));
+  EXPECT_EQ(reloaded.devices.size(), DeviceIdentityCache::MAX_DEVICES);
+  EXPECT_FALSE(std::ifstream((path + ".tmp").c_str()).good());
+  // A save that can't write keeps the cache that was there
+  EXPECT_FALSE(cache.Save(testing::TempDir() + "missing_dir/magtek_identity_test"));
+  ASSERT_TRUE(DeviceIdentityCache::Load(path, &reloaded));
+  EXPECT_EQ(reloaded.devices.size(), DeviceIdentityCache::MAX_DEVICES);
+
+  std::ofstream(path.c_str(), std::ios::trunc) << "MTKC\n";
+  EXPECT_FALSE(DeviceIdentityCache::Load(path, &loaded));
+  std::remove(path.c_str());
+}
+
+TEST(DeviceManagerCore, OpensARememberedReaderBeforeScanningTheBus) {
+  std::string path = testing::TempDir() + "magtek_identity_core_test";
+  std::remove(path.c_str());
+  DeviceInfo info;
+  info.device_id = "801:2:SN1";
+  info.device_name = DeviceManagerCore::GetDeviceName(MAGTEK_VENDOR_ID, 0x0002);
+  info.vendor_id = MAGTEK_VENDOR_ID;
+  info.product_id = 0x0002;
+  info.serial_number = "SN1";
+  info.device_path = "mock0";
+  info.is_connected = false;
+
+  // The first run scans, and remembers the reader it opens
+  {
+    MockHidTransport* transport = new MockHidTransport();
+    transport->AddDevice(info);
+    UsbDeviceManager manager{std::unique_ptr<HidTransport>(transport)};
+    manager.SetDeviceIdentityCache(path);
+    ASSERT_TRUE(manager.Initialize());
+    EXPECT_EQ(transport->EnumerateCount(), 1);
+    ASSERT_TRUE(manager.ConnectToDevice("801:2:SN1"));
+  }
+
+  // The next opens it by path, and scans only once the device list is wanted
+  {
+    MockHidTransport* transport = new MockHidTransport();
+    transport->AddDevice(info);
+    UsbDeviceManager manager{std::unique_ptr<HidTransport>(transport)};
+    manager.SetDeviceIdentityCache(path);
+    ASSERT_TRUE(manager.Initialize());
+    ASSERT_TRUE(manager.ConnectToDevice("801:2:SN1"));
+    EXPECT_EQ(transport->EnumerateCount(), 0);
+    EXPECT_EQ(transport->OpenCount("mock0"), 1);
+    std::vector<DeviceInfo> devices = manager.GetConnectedDevices();
+    EXPECT_EQ(transport->EnumerateCount(), 1);
+    ASSERT_EQ(devices.size(), 1u);
+    EXPECT_TRUE(devices[0].is_connected);
+  }
+
+  // Another reader at the remembered path isn't taken for it
+  {
+    DeviceInfo other = info;
+    other.device_id = "801:2:SN2";
+    other.serial_number = "SN2";
+    MockHidTransport* transport = new MockHidTransport();
+    transport->AddDevice(other);
+    UsbDeviceManager manager{std::unique_ptr<HidTransport>(transport)};
+    manager.SetDeviceIdentityCache(path);
+    ASSERT_TRUE(manager.Initialize());
+    EXPECT_FALSE(manager.ConnectToDevice("801:2:SN1"));
+    EXPECT_EQ(transport->EnumerateCount(), 1);
+    EXPECT_FALSE(manager.IsConnected());
+  }
+  std::remove(path.c_str());
+}
+
+TEST(HidapiTransport, ConvertsWideSerialNumbersToUtf8) {
+  wchar_t serial_number[] = {L'A', 0x00E9, 0x20AC, 0x1F4B3, 0xD800, 0};
+  char path[] = "0001:0004:00";
+  struct hid_device_info device = {};
+  device.path = path;
+  device.vendor_id = MAGTEK_VENDOR_ID;
+  device.product_id = 0x0002;
+  device.serial_number = serial_number;
+
+  // Each code point whole, and an unpaired surrogate replaced
+  const std::string utf8 = "A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x92\xB3\xEF\xBF\xBD";
+  EXPECT_EQ(HidapiTransport::MakeDeviceInfo(&device).serial_number, utf8);
+  EXPECT_EQ(HidapiTransport::MakeDeviceId(&device), "801:2:" + utf8);
+
+  device.serial_number = nullptr;
+  EXPECT_EQ(HidapiTransport::MakeDeviceId(&device), "801:2:0001:0004:00");
+}
+
+TEST(LibusbTransport, ReadsSerialNumbersAsHidapiDoes) {
+  // The serial number of the HIDAPI test above as its string descriptor
+  // sends it: bLength, bDescriptorType, then UTF-16LE with U+1F4B3 as a
+  // surrogate pair
+  const unsigned char descriptor[] = {14,   0x03, 'A',  0x00, 0xE9, 0x00, 0xAC, 0x20,
+                                      0x3D, 0xD8, 0xB3, 0xDC, 0x00, 0xD8, 0xFF, 0xFF};
+  wchar_t serial_number[] = {L'A', 0x00E9, 0x20AC, 0x1F4B3, 0xD800, 0};
+  char path[] = "0001:0004:00";
+  struct hid_device_info device = {};
+  device.path = path;
+  device.vendor_id = MAGTEK_VENDOR_ID;
+  device.product_id = 0x0002;
+  device.serial_number = serial_number;
+
+  // Bytes read past bLength aren't part of the string
+  EXPECT_EQ(LibusbTransport::DecodeStringDescriptor(descriptor, sizeof(descriptor)),
+            HidapiTransport::MakeDeviceInfo(&device).serial_number);
+
+  // A short read, a descriptor of another type, and an empty string
+  EXPECT_EQ(LibusbTransport::DecodeStringDescriptor(descriptor, 7), "A\xC3\xA9");
+  const unsigned char other[] = {4, 0x02, 'A', 0x00};
+  EXPECT_EQ(LibusbTransport::DecodeStringDescriptor(other, sizeof(other)), "");
+  const unsigned char empty[] = {2, 0x03};
+  EXPECT_EQ(LibusbTransport::DecodeStringDescriptor(empty, sizeof(empty)), "");
+}
+
+TEST(HidrawTransport, ParsesIdsAndSerialFromUevent) {
+  unsigned short vendor_id = 0;
+  unsigned short product_id = 0;
+  std::string serial_number;
+  EXPECT_TRUE(HidrawTransport::ParseUevent(
+      "DRIVER=hid-generic\nHID_ID=0003:00000801:00000011\nHID_NAME=Mag-Tek USB Swipe Reader\n"
+      "HID_PHYS=usb-0000:00:14.0-1/input0\nHID_UNIQ=B12345\nMODALIAS=hid:b0003g0001v00000801p00000011\n",
+      &vendor_id, &product_id, &serial_number));
+  EXPECT_EQ(vendor_id, 0x0801);
+  EXPECT_EQ(product_id, 0x0011);
+  EXPECT_EQ(serial_number, "B12345");
+
+  EXPECT_TRUE(HidrawTransport::ParseUevent("HID_ID=0003:00000801:00000002\nHID_UNIQ=\n", &vendor_id, &product_id,
+                                           &serial_number));
+  EXPECT_EQ(product_id, 0x0002);
+  EXPECT_EQ(serial_number, "");
+  EXPECT_FALSE(HidrawTransport::ParseUevent("HID_ID=0003:00010801:00000002\n", &vendor_id, &product_id,
+                                            &serial_number));
+  EXPECT_FALSE(HidrawTransport::ParseUevent("HID_NAME=keyboard\n", &vendor_id, &product_id, &serial_number));
+}
+
+TEST(SerialExecutor, RunsTasksInPostOrderOffTheCallingThread) {
+  SerialExecutor executor;
+  std::vector<int> order;
+  std::thread::id worker_id;
+
+  for (int i = 0; i < 5; i++) {
+    executor.Post([&order, &worker_id, i] {
+      worker_id = std::this_thread::get_id();
+      order.push_back(i);
+    });
+  }
+  executor.WaitIdle();
+
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4}));
+  EXPECT_NE(worker_id, std::this_thread::get_id());
+}
+
 }  // namespace test
 }  // namespace magtek_card_reader
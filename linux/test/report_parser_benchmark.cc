@@ -0,0 +1,118 @@
+// Times ReportParser against the stringstream/substr parser it replaced.
+//
+// Usage: magtek_card_reader_parse_benchmark [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "report_parser.h"
+
+namespace {
+
+struct LegacyResult {
+  std::string track1;
+  std::string track2;
+  std::string raw_response;
+};
+
+// The original UsbDeviceManager::ParseInputReport body, kept for comparison
+LegacyResult LegacyParse(const unsigned char* data, size_t length) {
+  LegacyResult result;
+
+  std::stringstream raw_ss;
+  for (size_t i = 0; i < length; i++) {
+    raw_ss << std::hex << std::setfill('0') << std::setw(2) << (int)data[i] << " ";
+  }
+  result.raw_response = raw_ss.str();
+
+  std::string data_str;
+  for (size_t i = 1; i < length; i++) {
+    if (data[i] >= 0x20 && data[i] <= 0x7E) {
+      data_str += (char)data[i];
+    }
+  }
+
+  size_t track1_start = data_str.find('%');
+  if (track1_start != std::string::npos) {
+    size_t track1_end = data_str.find('?', track1_start);
+    if (track1_end != std::string::npos) {
+      result.track1 = data_str.substr(track1_start, track1_end - track1_start + 1);
+    }
+  }
+
+  size_t track2_start = data_str.find(';');
+  if (track2_start != std::string::npos) {
+    size_t track2_end = data_str.find('?', track2_start);
+    if (track2_end != std::string::npos) {
+      result.track2 = data_str.substr(track2_start, track2_end - track2_start + 1);
+    }
+  }
+
+  return result;
+}
+
+template <typename Fn>
+double NanosecondsPerCall(long iterations, Fn&& fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) {
+    fn();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+  if (iterations <= 0) {
+    iterations = 200000;
+  }
+
+  // A typical two-track swipe in a single zero-padded 337-byte frame
+  unsigned char frame[337] = {0x01};
+  const char* tracks = "%B4111111111111111^CARDHOLDER/TEST^2512101000000000000000000?"
+                       ";4111111111111111=25121010000000000000?";
+  memcpy(frame + 1, tracks, strlen(tracks));
+
+  // Keep results observable so the loops aren't optimised away
+  size_t sink = 0;
+
+  double legacy_ns = NanosecondsPerCall(iterations, [&] {
+    LegacyResult result = LegacyParse(frame, sizeof(frame));
+    sink += result.track1.size() + result.track2.size() + result.raw_response.size();
+  });
+
+  ReportParser parser;
+  std::string track1;
+  std::string track2;
+  std::string raw_response;
+
+  double tracks_ns = NanosecondsPerCall(iterations, [&] {
+    parser.Parse(frame, sizeof(frame));
+    parser.AssignTrack(1, &track1);
+    parser.AssignTrack(2, &track2);
+    sink += track1.size() + track2.size();
+  });
+
+  double raw_ns = NanosecondsPerCall(iterations, [&] {
+    parser.Parse(frame, sizeof(frame));
+    parser.AssignTrack(1, &track1);
+    parser.AssignTrack(2, &track2);
+    raw_response.clear();
+    ReportParser::FormatHex(frame, sizeof(frame), &raw_response);
+    sink += track1.size() + track2.size() + raw_response.size();
+  });
+
+  std::printf("iterations:               %ld\n", iterations);
+  std::printf("legacy parse:             %10.1f ns/swipe\n", legacy_ns);
+  std::printf("ReportParser:             %10.1f ns/swipe\n", tracks_ns);
+  std::printf("ReportParser + raw hex:   %10.1f ns/swipe\n", raw_ns);
+  std::printf("(checksum %zu)\n", sink);
+  return 0;
+}
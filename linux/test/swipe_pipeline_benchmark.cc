@@ -0,0 +1,192 @@
+// Replays a report capture through the whole native swipe pipeline (read
+// loop, assembly, parsing, track decoding, queueing, drain) and reports
+// throughput, per-stage latency and heap allocations per swipe.
+//
+// Usage: magtek_card_reader_pipeline_benchmark [capture_file] [--realtime]
+//                                              [--swipes N]
+//
+// Without a capture file it replays N (default 2000) generated two-report
+// swipes. --realtime keeps the capture's own timing instead of handing the
+// reports out as fast as the read loop takes them.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+#include "report_capture.h"
+#include "report_replay.h"
+
+namespace {
+
+std::atomic<unsigned long long> g_allocations(0);
+
+// A typical two-track swipe split over two 64-byte reports, the second
+// zero-padded, one millisecond apart, with swipes 50 ms apart
+std::shared_ptr<ReportCapture> GenerateCapture(long swipes) {
+  const char* tracks = "%B4111111111111111^CARDHOLDER/TEST^2512101000000000000000?"
+                       ";4111111111111111=25121010000000000000?";
+  const size_t payload_size = 63;
+
+  auto capture = std::make_shared<ReportCapture>();
+  capture->product_id = 0x0002;
+  for (long i = 0; i < swipes; i++) {
+    for (size_t offset = 0, part = 0; offset < strlen(tracks); offset += payload_size, part++) {
+      CapturedReport report;
+      report.offset_us = i * 50000LL + part * 1000LL;
+      report.data.assign(payload_size + 1, 0);
+      report.data[0] = 0x01;
+      size_t length = strlen(tracks) - offset < payload_size ? strlen(tracks) - offset : payload_size;
+      memcpy(&report.data[1], tracks + offset, length);
+      capture->reports.push_back(report);
+    }
+  }
+  return capture;
+}
+
+const char* StageName(SwipeStage stage) {
+  switch (stage) {
+    case SwipeStage::kAssembly:
+      return "assembly";
+    case SwipeStage::kParse:
+      return "parse";
+    case SwipeStage::kQueue:
+      return "queue";
+    case SwipeStage::kDelivery:
+      return "delivery";
+    case SwipeStage::kTotal:
+      return "total";
+  }
+  return "";
+}
+
+}  // namespace
+
+// Count every heap allocation in the process, the pipeline's included
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* memory = std::malloc(size ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  std::free(memory);
+}
+
+int main(int argc, char** argv) {
+  std::string capture_path;
+  ReplayPacing pacing = ReplayPacing::kAsFastAsPossible;
+  long generated_swipes = 2000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--realtime") == 0) {
+      pacing = ReplayPacing::kRecorded;
+    } else if (strcmp(argv[i], "--swipes") == 0 && i + 1 < argc) {
+      generated_swipes = std::atol(argv[++i]);
+    } else {
+      capture_path = argv[i];
+    }
+  }
+  if (generated_swipes <= 0) {
+    generated_swipes = 2000;
+  }
+
+  std::shared_ptr<ReportCapture> capture;
+  if (capture_path.empty()) {
+    capture = GenerateCapture(generated_swipes);
+  } else {
+    capture = std::make_shared<ReportCapture>();
+    if (!ReportCapture::Load(capture_path, capture.get())) {
+      std::fprintf(stderr, "Can't read capture %s\n", capture_path.c_str());
+      return 1;
+    }
+  }
+
+  // Declared before the manager, whose destructor may still deliver swipes
+  std::mutex mutex;
+  std::condition_variable queued_cv;
+  bool queued = false;
+  std::atomic<unsigned long long> queued_count(0);
+  std::atomic<unsigned long long> delivered(0);
+  // Keep results observable so nothing is optimised away
+  size_t sink = 0;
+
+  ReplayDeviceManager manager(capture, pacing);
+  manager.SetCardSwipeCallback([&delivered, &sink](CardData&& card_data) {
+    delivered++;
+    sink += card_data.track1.size() + card_data.track2.size();
+  });
+  manager.SetSwipeQueuedCallback([&mutex, &queued_cv, &queued, &queued_count] {
+    queued_count++;
+    std::lock_guard<std::mutex> lock(mutex);
+    queued = true;
+    queued_cv.notify_one();
+  });
+  // Half the swipe queue in flight at most, so no swipe is dropped
+  manager.SetPaceGate([&queued_count, &delivered] { return queued_count.load() - delivered.load() < 8; });
+  manager.SetRawResponseMode(RawResponseMode::kOff);
+  if (!manager.Initialize() || !manager.OpenDevice(ReplayDeviceManager::REPLAY_DEVICE_ID)) {
+    std::fprintf(stderr, "Capture product 0x%04x is not a known reader\n", capture->product_id);
+    return 1;
+  }
+
+  unsigned long long allocations_before = g_allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  manager.StartMonitoring();
+
+  // Drain as the platform thread would, until the replay has run out and
+  // the last frame has had time to time out
+  auto idle_since = std::chrono::steady_clock::now();
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queued_cv.wait_for(lock, std::chrono::milliseconds(1), [&queued] { return queued; });
+      queued = false;
+    }
+    unsigned long long before = delivered.load();
+    manager.DrainCardSwipes();
+    auto now = std::chrono::steady_clock::now();
+    if (delivered.load() != before || !manager.Finished()) {
+      idle_since = now;
+    } else if (now - idle_since > std::chrono::milliseconds(100)) {
+      break;
+    }
+  }
+  auto elapsed = idle_since - start;
+  unsigned long long allocations = g_allocations.load() - allocations_before;
+  manager.StopMonitoring();
+
+  std::vector<DeviceMetrics> metrics = manager.GetMetrics();
+  unsigned long long parsed = metrics.empty() ? 0 : metrics[0].swipes_parsed;
+  unsigned long long dropped = metrics.empty() ? 0 : metrics[0].queue_overflows;
+  double seconds = std::chrono::duration<double>(elapsed).count();
+
+  std::printf("reports replayed:   %zu (%s)\n", capture->reports.size(),
+              pacing == ReplayPacing::kRecorded ? "recorded timing" : "as fast as possible");
+  unsigned long long swipes = delivered.load();
+  std::printf("swipes delivered:   %llu of %llu parsed, %llu dropped on a full queue\n", swipes, parsed, dropped);
+  std::printf("throughput:         %.0f swipes/s\n", seconds > 0 ? swipes / seconds : 0.0);
+  std::printf("allocations:        %.2f per swipe (%llu total, thread start included)\n",
+              swipes ? static_cast<double>(allocations) / swipes : 0.0, allocations);
+  std::printf("\n%-10s %12s %12s %12s %12s\n", "stage", "p50 ns", "p90 ns", "p99 ns", "max ns");
+  for (int i = 0; i < SWIPE_STAGE_COUNT; i++) {
+    LatencySummary summary = manager.GetStageLatency(static_cast<SwipeStage>(i));
+    std::printf("%-10s %12lld %12lld %12lld %12lld\n", StageName(static_cast<SwipeStage>(i)), summary.p50_ns,
+                summary.p90_ns, summary.p99_ns, summary.max_ns);
+  }
+  std::printf("(checksum %zu)\n", sink);
+  return 0;
+}
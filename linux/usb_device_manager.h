@@ -4,97 +4,56 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include <functional>
-#include <mutex>
 #include <thread>
 #include <atomic>
-#include <hidapi/hidapi.h>
+#include <libusb.h>
 
-struct DeviceInfo {
-    std::string device_id;
-    std::string device_name;
-    unsigned short vendor_id;
-    unsigned short product_id;
-    std::string serial_number;
-    std::string device_path;
-    bool is_connected;
-};
-
-struct CardData {
-    std::string track1;
-    std::string track2;
-    std::string track3;
-    std::string device_id;
-    std::string raw_response;
-    long timestamp;
-};
+#include "device_manager_core.h"
+#include "hid_transport.h"
 
-class UsbDeviceManager {
+// Linux adapter for DeviceManagerCore: a HidTransport for device access and
+// libusb hotplug callbacks for arrival/removal
+class UsbDeviceManager : public DeviceManagerCore {
 public:
+    // Use the transport named by the MAGTEK_HID_TRANSPORT environment
+    // variable, or else the build's default (the MAGTEK_HID_TRANSPORT CMake
+    // option, "hidapi" unless set)
     UsbDeviceManager();
+
+    // Use the given transport, e.g. a MockHidTransport in tests
+    explicit UsbDeviceManager(std::unique_ptr<HidTransport> transport);
+
     ~UsbDeviceManager();
 
-    // Initialize the USB device manager
-    bool Initialize();
-    
-    // Cleanup resources
-    void Cleanup();
-    
-    // Get list of connected Magtek devices
-    std::vector<DeviceInfo> GetConnectedDevices();
-    
-    // Connect to a specific device
-    bool ConnectToDevice(const std::string& device_id);
-    
-    // Disconnect from current device
-    void Disconnect();
-    
-    // Check if connected to a device
-    bool IsConnected() const;
-    
-    // Start monitoring for card swipes
-    void StartMonitoring();
-    
-    // Stop monitoring
-    void StopMonitoring();
-    
-    // Set callback for card swipe events
-    void SetCardSwipeCallback(std::function<void(const CardData&)> callback);
-    
-    // Set callback for device connection events
-    void SetDeviceConnectionCallback(std::function<void(const DeviceInfo&)> callback);
+    // Create a transport by name: "hidapi", "hidraw" or "libusb". Null for
+    // any other.
+    static std::unique_ptr<HidTransport> CreateTransport(const std::string& name);
+
+protected:
+    bool InitializeHid() override;
+    void ShutdownHid() override;
+    std::vector<DeviceInfo> EnumerateDevices() override;
+    std::unique_ptr<HidConnection> OpenConnection(const DeviceInfo& info) override;
+    void StartHotplugMonitor() override;
+    void StopHotplugMonitor() override;
+    bool IsHotplugActive() const override;
 
 private:
-    // Check if vendor/product ID is a Magtek device
-    bool IsMagtekDevice(unsigned short vendor_id, unsigned short product_id);
+    std::unique_ptr<HidTransport> transport_;
     
-    // Get device name from vendor/product ID
-    std::string GetDeviceName(unsigned short vendor_id, unsigned short product_id);
-    
-    // Parse HID input report from device
-    CardData ParseInputReport(const unsigned char* data, size_t length, const std::string& device_id);
-    
-    // Parse track data from raw magnetic stripe data
-    std::string ParseTrackData(const unsigned char* data, size_t length, int track_number);
-    
-    // Device monitoring thread function
-    void MonitoringThread();
-    
-    // Read data from HID device
-    bool ReadFromDevice();
-
-    hid_device* current_device_;
-    std::string current_device_id_;
-    std::atomic<bool> is_monitoring_;
-    std::thread monitoring_thread_;
-    std::mutex device_mutex_;
+    // Rescans the device cache whenever a hotplug notification arrives
+    void HotplugThread();
     
-    std::function<void(const CardData&)> card_swipe_callback_;
-    std::function<void(const DeviceInfo&)> device_connection_callback_;
+    // libusb hotplug callback for Magtek vendor ID arrival/removal
+    static int LIBUSB_CALL HotplugCallback(libusb_context* context, libusb_device* device,
+                                           libusb_hotplug_event event, void* user_data);
     
-    // Magtek vendor IDs and product IDs
-    static const unsigned short MAGTEK_VENDOR_ID = 0x0801;
-    static const std::vector<unsigned short> MAGTEK_PRODUCT_IDS;
+    // Hotplug notification state
+    std::atomic<bool> hotplug_active_;
+    std::thread hotplug_thread_;
+    libusb_context* usb_context_;
+    libusb_hotplug_callback_handle hotplug_handle_;
+    std::atomic<bool> hotplug_pending_;
 };
 
 #endif  // USB_DEVICE_MANAGER_H_
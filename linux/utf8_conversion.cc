@@ -0,0 +1,56 @@
+#include "utf8_conversion.h"
+
+namespace {
+
+// Append one code point as UTF-8
+void AppendUtf8(unsigned long code_point, std::string* utf8) {
+    if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+        code_point = 0xFFFD;
+    }
+
+    if (code_point < 0x80) {
+        *utf8 += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        *utf8 += static_cast<char>(0xC0 | (code_point >> 6));
+        *utf8 += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        *utf8 += static_cast<char>(0xE0 | (code_point >> 12));
+        *utf8 += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *utf8 += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        *utf8 += static_cast<char>(0xF0 | (code_point >> 18));
+        *utf8 += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        *utf8 += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *utf8 += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+}  // namespace
+
+std::string WideToUtf8(const wchar_t* wide) {
+    std::string utf8;
+    for (; *wide; wide++) {
+        AppendUtf8(static_cast<unsigned long>(*wide), &utf8);
+    }
+    return utf8;
+}
+
+std::string Utf16LeToUtf8(const unsigned char* data, size_t length) {
+    std::string utf8;
+    size_t units = length / 2;
+    for (size_t i = 0; i < units; i++) {
+        unsigned long unit = data[2 * i] | (static_cast<unsigned long>(data[2 * i + 1]) << 8);
+
+        // A high surrogate combines with the low one after it; either one
+        // alone is left for AppendUtf8 to replace
+        if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < units) {
+            unsigned long next = data[2 * i + 2] | (static_cast<unsigned long>(data[2 * i + 3]) << 8);
+            if (next >= 0xDC00 && next <= 0xDFFF) {
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00);
+                i++;
+            }
+        }
+        AppendUtf8(unit, &utf8);
+    }
+    return utf8;
+}
@@ -0,0 +1,19 @@
+#ifndef UTF8_CONVERSION_H_
+#define UTF8_CONVERSION_H_
+
+#include <cstddef>
+#include <string>
+
+// The conversion every Linux transport applies to the strings a reader
+// reports, so that its serial number, and the device ID built from it, come
+// out the same whichever transport read them. Code points that aren't valid
+// Unicode, unpaired surrogates included, become U+FFFD.
+
+// HIDAPI's wchar_t strings, which are UTF-32 on Linux
+std::string WideToUtf8(const wchar_t* wide);
+
+// The length bytes of UTF-16LE code units in a USB string descriptor,
+// following its two header bytes; a trailing odd byte is ignored
+std::string Utf16LeToUtf8(const unsigned char* data, size_t length);
+
+#endif  // UTF8_CONVERSION_H_
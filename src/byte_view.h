@@ -0,0 +1,27 @@
+#ifndef MAGTEK_BYTE_VIEW_H_
+#define MAGTEK_BYTE_VIEW_H_
+
+#include <cstddef>
+
+// A read-only view of bytes owned by someone else, typically a field of a
+// report held in a ReportBuffer. It is only valid while that storage is.
+struct ByteView {
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+
+    ByteView() {}
+    ByteView(const unsigned char* data, size_t size) : bytes(data), length(size) {}
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    const unsigned char* begin() const { return bytes; }
+    const unsigned char* end() const { return bytes + length; }
+    unsigned char operator[](size_t index) const { return bytes[index]; }
+
+    // The bytes as characters, for text fields
+    const char* chars() const { return reinterpret_cast<const char*>(bytes); }
+};
+
+#endif  // MAGTEK_BYTE_VIEW_H_
@@ -0,0 +1,49 @@
+#include "device_command.h"
+#include <algorithm>
+
+// Bytes ahead of the data in a feature report, after the report ID: the
+// command number or result code, then the data length
+static const size_t HEADER_SIZE = 2;
+
+bool DeviceCommandCodec::Encode(const DeviceCommand& command, size_t report_size,
+                                std::vector<unsigned char>* report) {
+    if (report_size < HEADER_SIZE || command.data.size() > report_size - HEADER_SIZE) {
+        return false;
+    }
+
+    // Readers expect the full report length, zero padded
+    report->assign(1 + report_size, 0);
+    (*report)[1] = command.command;
+    (*report)[2] = static_cast<unsigned char>(command.data.size());
+    std::copy(command.data.begin(), command.data.end(), report->begin() + 1 + HEADER_SIZE);
+    return true;
+}
+
+bool DeviceCommandCodec::Decode(const unsigned char* report, size_t length, CommandResult* result) {
+    if (length < 1 + HEADER_SIZE) {
+        return false;
+    }
+
+    size_t data_length = report[2];
+    if (data_length > length - 1 - HEADER_SIZE) {
+        return false;
+    }
+
+    result->result_code = report[1];
+    result->data.assign(report + 1 + HEADER_SIZE, report + 1 + HEADER_SIZE + data_length);
+    return true;
+}
+
+const char* DeviceCommandCodec::StatusName(CommandStatus status) {
+    switch (status) {
+        case CommandStatus::kOk:
+            return "ok";
+        case CommandStatus::kNotOpen:
+            return "notOpen";
+        case CommandStatus::kTimedOut:
+            return "timedOut";
+        case CommandStatus::kFailed:
+            return "failed";
+    }
+    return "";
+}
@@ -0,0 +1,60 @@
+#ifndef MAGTEK_DEVICE_COMMAND_H_
+#define MAGTEK_DEVICE_COMMAND_H_
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// A vendor command sent over a reader's feature report, such as reading
+// its serial number or KSN or changing a configuration property
+struct DeviceCommand {
+    unsigned char command;
+    std::vector<unsigned char> data;
+    // How long the command may wait for its turn and its response
+    int timeout_ms;
+};
+
+// Outcome of a device command, apart from the reader's own result code
+enum class CommandStatus {
+    // The reader answered; its verdict is the result code
+    kOk,
+    // The device is not open, or was lost before the command ran
+    kNotOpen,
+    // The command did not run before its deadline
+    kTimedOut,
+    // The feature report could not be sent or read back, or the data does
+    // not fit the reader's feature report
+    kFailed,
+};
+
+struct CommandResult {
+    CommandStatus status;
+    // The reader's result code; 0 is success
+    unsigned char result_code;
+    std::vector<unsigned char> data;
+};
+
+// Receives a command's result, on the device's read thread or on the thread
+// that sent the command
+typedef std::function<void(const CommandResult& result)> CommandCallback;
+
+// Frames commands and responses the way Magtek readers lay them out in
+// their feature report: the command number or result code, a length byte,
+// then the data.
+class DeviceCommandCodec {
+public:
+    // Build the feature report for a command, report ID byte first.
+    // report_size is the reader's feature report length without the report
+    // ID. Returns false if the data does not fit.
+    static bool Encode(const DeviceCommand& command, size_t report_size, std::vector<unsigned char>* report);
+
+    // Parse a feature report read back from the reader, report ID byte
+    // first, into result. Returns false if it is too short or its length
+    // byte overruns it.
+    static bool Decode(const unsigned char* report, size_t length, CommandResult* result);
+
+    // Names used on the method channel: "ok", "timedOut", ...
+    static const char* StatusName(CommandStatus status);
+};
+
+#endif  // MAGTEK_DEVICE_COMMAND_H_
@@ -0,0 +1,123 @@
+#include "device_identity_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+static const char* const CACHE_MAGIC = "magtek-device-identities";
+
+const size_t DeviceIdentityCache::MAX_DEVICES;
+
+// Whether a field can be written without breaking up its record
+static bool IsWritable(const std::string& field) {
+    return field.find_first_of("\t\r\n") == std::string::npos;
+}
+
+bool DeviceIdentityCache::Load(const std::string& path, DeviceIdentityCache* cache) {
+    std::ifstream in(path.c_str());
+    std::string line;
+    if (!in || !std::getline(in, line)) {
+        return false;
+    }
+    std::istringstream header(line);
+    std::string magic;
+    int version = 0;
+    if (!(header >> magic >> version) || magic != CACHE_MAGIC || version != DEVICE_IDENTITY_CACHE_VERSION) {
+        return false;
+    }
+
+    cache->devices.clear();
+    while (std::getline(in, line) && cache->devices.size() < MAX_DEVICES) {
+        std::istringstream record(line);
+        unsigned int vendor_id = 0;
+        unsigned int product_id = 0;
+        DeviceInfo info;
+        if (!(record >> std::hex >> vendor_id >> product_id) || record.get() != '\t' || vendor_id > 0xFFFF ||
+            product_id > 0xFFFF || !std::getline(record, info.device_id, '\t') ||
+            !std::getline(record, info.serial_number, '\t') || !std::getline(record, info.device_path) ||
+            info.device_id.empty() || info.device_path.empty()) {
+            continue;
+        }
+
+        info.vendor_id = static_cast<unsigned short>(vendor_id);
+        info.product_id = static_cast<unsigned short>(product_id);
+        // A product this build doesn't know can't be opened anyway
+        if (!DeviceManagerCore::IsMagtekDevice(info.vendor_id, info.product_id)) {
+            continue;
+        }
+        info.device_name = DeviceManagerCore::GetDeviceName(info.vendor_id, info.product_id);
+        info.is_connected = false;
+        cache->devices.push_back(info);
+    }
+    return true;
+}
+
+// Move a fully written file over the cache, replacing it in one step
+static bool ReplaceFile(const std::string& from, const std::string& to) {
+#if defined(_WIN32)
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool DeviceIdentityCache::Save(const std::string& path) const {
+    // Written beside the cache and renamed over it, so a crash or full disk
+    // mid-write leaves the previous cache rather than a truncated one
+    std::string temp_path = path + ".tmp";
+    std::ofstream out(temp_path.c_str(), std::ios::trunc);
+    out << CACHE_MAGIC << " " << DEVICE_IDENTITY_CACHE_VERSION << "\n";
+    for (const DeviceInfo& info : devices) {
+        if (!IsWritable(info.device_id) || !IsWritable(info.serial_number) || !IsWritable(info.device_path)) {
+            continue;
+        }
+        out << std::hex << info.vendor_id << " " << info.product_id << std::dec << "\t" << info.device_id << "\t"
+            << info.serial_number << "\t" << info.device_path << "\n";
+    }
+    out.flush();
+    out.close();
+    if (out.fail() || !ReplaceFile(temp_path, path)) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool DeviceIdentityCache::Find(const std::string& device_id, DeviceInfo* info) const {
+    for (const DeviceInfo& device : devices) {
+        if (device.device_id == device_id) {
+            *info = device;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DeviceIdentityCache::Remember(const DeviceInfo& info) {
+    auto same_reader = [&info](const DeviceInfo& device) {
+        return device.device_id == info.device_id ||
+               (!info.serial_number.empty() && device.product_id == info.product_id &&
+                device.serial_number == info.serial_number);
+    };
+
+    if (!devices.empty() && devices.front().device_id == info.device_id &&
+        devices.front().serial_number == info.serial_number && devices.front().device_path == info.device_path) {
+        return false;
+    }
+
+    DeviceInfo remembered = info;
+    remembered.is_connected = false;
+    std::vector<DeviceInfo> updated;
+    updated.push_back(remembered);
+    for (const DeviceInfo& device : devices) {
+        if (!same_reader(device) && updated.size() < MAX_DEVICES) {
+            updated.push_back(device);
+        }
+    }
+    devices.swap(updated);
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef MAGTEK_DEVICE_IDENTITY_CACHE_H_
+#define MAGTEK_DEVICE_IDENTITY_CACHE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "device_manager_core.h"
+
+// The readers an app has opened, kept in a small file between runs so the
+// next launch can open them straight from their remembered path, without
+// scanning the bus first. A reader's report layout follows from its product
+// ID (magtek_products.h), so the ID, serial number and path are all that is
+// kept of it.
+//
+// Layout, text, one record per line:
+//   magtek-device-identities <DEVICE_IDENTITY_CACHE_VERSION>
+//   <vendor ID> <product ID> then the device ID, serial number and path,
+//   each after a tab; the IDs are in hex
+constexpr int DEVICE_IDENTITY_CACHE_VERSION = 1;
+
+// A cache read back into memory, or about to be written
+struct DeviceIdentityCache {
+    // Records kept; opening another forgets the one opened longest ago
+    static const size_t MAX_DEVICES = 16;
+
+    // Most recently opened first. device_name and is_connected are not kept.
+    std::vector<DeviceInfo> devices;
+
+    // Read a cache file. Returns false if it can't be read or isn't a cache;
+    // a record that doesn't parse is skipped.
+    static bool Load(const std::string& path, DeviceIdentityCache* cache);
+
+    // Write the cache to a file, replacing it only once the new contents are
+    // complete; false on an I/O error, leaving any previous file as it was
+    bool Save(const std::string& path) const;
+
+    // Find a remembered reader by device ID
+    bool Find(const std::string& device_id, DeviceInfo* info) const;
+
+    // Move a reader that was just opened to the front, replacing any record
+    // of the same device ID or of the same product and serial number. False
+    // if it was already at the front as it is.
+    bool Remember(const DeviceInfo& info);
+};
+
+#endif  // MAGTEK_DEVICE_IDENTITY_CACHE_H_
@@ -0,0 +1,1316 @@
+#include "device_manager_core.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+
+#include "device_identity_cache.h"
+#include "logger.h"
+#include "trace_events.h"
+
+// Longest single wait in event-driven mode; bounds how long StopMonitoring
+// or CloseDevice can take while a device is idle
+static const int EVENT_WAIT_SLICE_MS = 250;
+
+// Read timeout used by the legacy polling loop, and by idle adaptive reads
+static const int POLL_READ_TIMEOUT_MS = 10;
+
+// Defaults for adaptive reads: how long a device stays quiet before it
+// idles, and the idle cadence
+static const int ADAPTIVE_IDLE_AFTER_MS = 10000;
+static const int ADAPTIVE_IDLE_INTERVAL_MS = 500;
+
+// Wait before the first reopen of a device whose reads failed, doubled
+// after each failed attempt up to the maximum
+static const int RECONNECT_INITIAL_BACKOFF_MS = 100;
+static const int RECONNECT_MAX_BACKOFF_MS = 5000;
+
+// Decryptor shared by every manager in the process; published like the
+// session map so the read threads never lock to find it
+static std::shared_ptr<const TrackDecryptor> g_track_decryptor;
+
+// Set track 1-3 of a swipe; a track longer than ISO allows is cut short
+static void AssignTrack(CardData& card_data, int track_number, const char* data, size_t length) {
+    if (track_number == 1) {
+        card_data.track1.assign(data, length);
+    } else if (track_number == 2) {
+        card_data.track2.assign(data, length);
+    } else {
+        card_data.track3.assign(data, length);
+    }
+}
+
+static_assert(SwipeAssembler::MAX_FRAME_SIZE >= MagneSafeReportParser::REPORT_SIZE,
+              "A pooled report buffer must hold a whole MagneSafe report");
+
+DeviceManagerCore::DeviceManagerCore()
+    : sessions_(std::make_shared<SessionMap>()), is_monitoring_(false),
+      read_mode_(ReadMode::kEventDriven), adaptive_idle_after_ms_(ADAPTIVE_IDLE_AFTER_MS),
+      adaptive_idle_interval_ms_(ADAPTIVE_IDLE_INTERVAL_MS), raw_response_mode_(RawResponseMode::kHex),
+      reject_invalid_swipes_(false), duplicate_swipe_window_ms_(0), deadline_stopping_(false), scan_sequence_(0),
+      committed_scan_(0), identities_(new DeviceIdentityCache()) {
+}
+
+DeviceManagerCore::~DeviceManagerCore() {
+    // Nothing to do: the subclass destructor has already run Cleanup(),
+    // which needs the platform hooks that are gone by now
+}
+
+bool DeviceManagerCore::Initialize() {
+    if (!InitializeHid()) {
+        MAGTEK_LOG(LogLevel::kError, "Failed to initialize HIDAPI");
+        return false;
+    }
+
+    // Seed the cache before hotplug events can start diffing against it,
+    // unless remembered readers can be opened without it
+    bool remembered = false;
+    {
+        std::lock_guard<std::mutex> lock(identities_mutex_);
+        if (!identity_cache_path_.empty()) {
+            remembered = DeviceIdentityCache::Load(identity_cache_path_, identities_.get()) &&
+                         !identities_->devices.empty();
+        }
+    }
+    if (!remembered) {
+        RefreshDeviceCache(false);
+    }
+    StartHotplugMonitor();
+    return true;
+}
+
+void DeviceManagerCore::Cleanup() {
+    StopHotplugMonitor();
+    StopMonitoring();
+    Disconnect();
+    StopDeadlineThread();
+    // The closed devices' last swipes, while the callback is still wanted
+    DrainCardSwipes();
+    ShutdownHid();
+
+    std::lock_guard<std::mutex> lock(refresh_mutex_);
+    PublishDeviceCache(nullptr);
+}
+
+std::vector<DeviceInfo> DeviceManagerCore::GetConnectedDevices() {
+    // Without hotplug notifications the cache can't be trusted to be current
+    if (!IsHotplugActive()) {
+        RefreshDeviceCache(false);
+    } else {
+        EnsureDeviceCache();
+    }
+
+    std::vector<DeviceInfo> devices;
+    std::shared_ptr<const std::vector<DeviceInfo>> cache = LoadDeviceCache();
+    if (cache) {
+        devices = *cache;
+    }
+
+    std::shared_ptr<const SessionMap> sessions = LoadSessions();
+    for (auto& device : devices) {
+        device.is_connected = sessions->count(device.device_id) > 0;
+    }
+    return devices;
+}
+
+std::shared_ptr<const std::vector<DeviceInfo>> DeviceManagerCore::GetCachedDevices() const {
+    if (!IsHotplugActive()) {
+        return nullptr;
+    }
+    return LoadDeviceCache();
+}
+
+bool DeviceManagerCore::ConnectToDevice(const std::string& device_id) {
+    std::vector<std::shared_ptr<DeviceSession>> closed;
+    {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+
+        // Single-device callers expect this to replace whatever was open
+        std::shared_ptr<const SessionMap> sessions = LoadSessions();
+        std::shared_ptr<SessionMap> remaining = std::make_shared<SessionMap>();
+        for (const auto& entry : *sessions) {
+            if (entry.first == device_id) {
+                (*remaining)[entry.first] = entry.second;
+            } else {
+                closed.push_back(entry.second);
+            }
+        }
+        if (!closed.empty()) {
+            PublishSessions(remaining);
+        }
+    }
+
+    for (const auto& session : closed) {
+        CloseSession(session);
+        NotifyClosed(session->device_id);
+    }
+
+    return OpenDevice(device_id);
+}
+
+bool DeviceManagerCore::OpenDevice(const std::string& device_id) {
+    if (IsDeviceOpen(device_id)) {
+        return true;
+    }
+
+    // Open the device before taking the lock; a slow open must not hold up
+    // other control calls. Until the bus has been scanned, a remembered
+    // device is opened from its remembered path.
+    DeviceInfo info;
+    std::unique_ptr<HidConnection> connection;
+    bool found = FindCachedDevice(device_id, &info);
+    if (!found && !LoadDeviceCache()) {
+        connection = OpenRememberedDevice(device_id, &info);
+    }
+
+    if (!connection) {
+        // Find the device in the cache, rescanning once in case it just arrived
+        if (!found) {
+            RefreshDeviceCache(true);
+            found = FindCachedDevice(device_id, &info);
+        }
+
+        if (!found || info.device_path.empty()) {
+            MAGTEK_LOG(LogLevel::kWarning, "Device not found: " << device_id);
+            return false;
+        }
+
+        connection = OpenConnection(info);
+        if (!connection) {
+            MAGTEK_LOG(LogLevel::kWarning, "Failed to open device: " << info.device_path);
+            return false;
+        }
+    }
+
+    std::shared_ptr<DeviceSession> session = std::make_shared<DeviceSession>();
+    session->device_id = device_id;
+    session->product_id = info.product_id;
+    session->serial_number = info.serial_number;
+    session->connection = std::move(connection);
+    session->running = false;
+    session->reconnect_wakeup = false;
+    // Only known products make it into the cache, so the lookup can't fail
+    const ProductDescriptor& product = *FindMagtekProduct(info.product_id);
+    session->encrypting = product.encrypting;
+    session->feature_report_size = product.feature_report_size;
+    session->commands_pending = false;
+    session->capturing = false;
+    session->assembler.SetFramingRules(GetFramingRules(product));
+    session->buffer_pool = ReportBufferPool::Create(REPORT_BUFFER_SIZE, REPORT_BUFFERS_PER_DEVICE);
+    session->card_data = &session->spare_card;
+
+    {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+
+        // Lost a race with another open of the same device; ours is dropped
+        std::shared_ptr<const SessionMap> sessions = LoadSessions();
+        if (sessions->count(device_id) > 0) {
+            return true;
+        }
+
+        {
+            std::lock_guard<std::mutex> counters_lock(counters_mutex_);
+            std::shared_ptr<DeviceCounters>& counters = counters_[device_id];
+            if (counters) {
+                DeviceCounters::Increment(counters->reconnects);
+            } else {
+                counters = std::make_shared<DeviceCounters>();
+            }
+            session->counters = counters;
+        }
+
+        if (is_monitoring_.load()) {
+            StartSession(*session);
+        }
+        std::shared_ptr<SessionMap> updated = std::make_shared<SessionMap>(*sessions);
+        (*updated)[device_id] = session;
+        PublishSessions(updated);
+    }
+
+    RememberDevice(info);
+
+    // Notify about device connection
+    info.is_connected = true;
+    NotifyDeviceEvent(DeviceEventType::kConnected, std::move(info));
+
+    MAGTEK_LOG(LogLevel::kInfo, "Connected to device: " << device_id);
+    return true;
+}
+
+void DeviceManagerCore::CloseDevice(const std::string& device_id) {
+    std::shared_ptr<DeviceSession> session;
+    {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+
+        std::shared_ptr<const SessionMap> sessions = LoadSessions();
+        auto it = sessions->find(device_id);
+        if (it == sessions->end()) {
+            return;
+        }
+
+        session = it->second;
+        std::shared_ptr<SessionMap> updated = std::make_shared<SessionMap>(*sessions);
+        updated->erase(device_id);
+        PublishSessions(updated);
+    }
+
+    // Unpublished, so this call owns the session now; joining its read
+    // thread happens without any lock held
+    CloseSession(session);
+    NotifyClosed(device_id);
+    MAGTEK_LOG(LogLevel::kInfo, "Disconnected from device: " << device_id);
+}
+
+void DeviceManagerCore::Disconnect() {
+    std::shared_ptr<const SessionMap> closed;
+    {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+
+        closed = LoadSessions();
+        if (closed->empty()) {
+            return;
+        }
+        PublishSessions(std::make_shared<SessionMap>());
+    }
+
+    for (const auto& entry : *closed) {
+        CloseSession(entry.second);
+    }
+    for (const auto& entry : *closed) {
+        NotifyClosed(entry.first);
+    }
+    MAGTEK_LOG(LogLevel::kInfo, "Disconnected from all devices");
+}
+
+bool DeviceManagerCore::IsConnected() const {
+    return !LoadSessions()->empty();
+}
+
+bool DeviceManagerCore::IsDeviceOpen(const std::string& device_id) const {
+    return LoadSessions()->count(device_id) > 0;
+}
+
+void DeviceManagerCore::StartMonitoring() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+
+    if (is_monitoring_.load()) {
+        return;
+    }
+
+    is_monitoring_ = true;
+    std::shared_ptr<const SessionMap> sessions = LoadSessions();
+    for (const auto& entry : *sessions) {
+        StartSession(*entry.second);
+    }
+    MAGTEK_LOG(LogLevel::kInfo, "Started device monitoring");
+}
+
+void DeviceManagerCore::StopMonitoring() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+
+    if (!is_monitoring_.load()) {
+        return;
+    }
+
+    is_monitoring_ = false;
+    std::shared_ptr<const SessionMap> sessions = LoadSessions();
+    for (const auto& entry : *sessions) {
+        StopSession(*entry.second);
+    }
+    MAGTEK_LOG(LogLevel::kInfo, "Stopped device monitoring");
+}
+
+void DeviceManagerCore::SetReadMode(ReadMode mode) {
+    read_mode_ = mode;
+}
+
+void DeviceManagerCore::SetAdaptiveIdle(int idle_after_ms, int interval_ms) {
+    adaptive_idle_after_ms_ = idle_after_ms;
+    adaptive_idle_interval_ms_ = interval_ms;
+}
+
+void DeviceManagerCore::SetRawResponseMode(RawResponseMode mode) {
+    raw_response_mode_ = mode;
+}
+
+void DeviceManagerCore::SetRejectInvalidSwipes(bool reject) {
+    reject_invalid_swipes_ = reject;
+}
+
+void DeviceManagerCore::SetDuplicateSwipeWindow(int window_ms) {
+    duplicate_swipe_window_ms_ = window_ms;
+}
+
+void DeviceManagerCore::SetDeviceIdentityCache(const std::string& path) {
+    std::lock_guard<std::mutex> lock(identities_mutex_);
+    identity_cache_path_ = path;
+    if (path.empty()) {
+        identities_->devices.clear();
+    }
+}
+
+void DeviceManagerCore::SetCardSwipeCallback(std::function<void(CardData&&)> callback) {
+    card_swipe_callback_ = std::move(callback);
+}
+
+void DeviceManagerCore::SetSwipeQueuedCallback(std::function<void()> callback) {
+    swipe_queued_callback_ = std::move(callback);
+}
+
+void DeviceManagerCore::SetSwipeListener(std::function<bool(const CardData&)> listener) {
+    swipe_listener_ = std::move(listener);
+}
+
+void DeviceManagerCore::DrainCardSwipes() {
+    std::shared_ptr<const SessionMap> sessions = LoadSessions();
+
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    for (const auto& entry : *sessions) {
+        DeliverQueuedSwipes(*entry.second);
+    }
+
+    // Sessions closed since the last drain, with whatever they had queued
+    std::vector<std::shared_ptr<DeviceSession>> retired;
+    retired.swap(retired_sessions_);
+    for (const auto& session : retired) {
+        DeliverQueuedSwipes(*session);
+    }
+}
+
+void DeviceManagerCore::SetDeviceEventCallback(std::function<void(DeviceEventType, DeviceInfo&&)> callback) {
+    device_event_callback_ = std::move(callback);
+}
+
+LatencySummary DeviceManagerCore::GetStageLatency(SwipeStage stage) const {
+    return latency_stats_.Summarize(stage);
+}
+
+void DeviceManagerCore::ResetStats() {
+    latency_stats_.Reset();
+}
+
+std::vector<DeviceMetrics> DeviceManagerCore::GetMetrics() const {
+    std::lock_guard<std::mutex> lock(counters_mutex_);
+
+    std::vector<DeviceMetrics> metrics;
+    metrics.reserve(counters_.size());
+    for (const auto& entry : counters_) {
+        metrics.push_back(entry.second->Snapshot(entry.first));
+    }
+    return metrics;
+}
+
+void DeviceManagerCore::SendCommand(const std::string& device_id, const DeviceCommand& command,
+                                    CommandCallback callback) {
+    PendingCommand pending;
+    pending.command = command;
+    pending.ticket = std::make_shared<CommandTicket>();
+    pending.ticket->callback = std::move(callback);
+    pending.ticket->deadline = SwipeAssembler::Clock::now() + std::chrono::milliseconds(command.timeout_ms);
+    pending.ticket->claimed = false;
+    pending.owned = false;
+    pending.result.status = CommandStatus::kNotOpen;
+    pending.result.result_code = 0;
+
+    std::shared_ptr<const SessionMap> sessions = LoadSessions();
+    auto it = sessions->find(device_id);
+    if (it == sessions->end()) {
+        pending.ticket->callback(pending.result);
+        return;
+    }
+
+    std::shared_ptr<DeviceSession> session = it->second;
+    std::shared_ptr<CommandTicket> ticket = pending.ticket;
+    bool running;
+    {
+        std::lock_guard<std::mutex> lock(session->wait_mutex);
+        session->commands.push_back(std::move(pending));
+        session->commands_pending = true;
+        // Cut an event-driven read short; the read thread only replaces
+        // its connection under this lock
+        running = session->running.load();
+        if (running && session->connection) {
+            session->connection->CancelRead();
+        }
+    }
+    // Wakes a polling or reconnecting read thread
+    session->wait_cv.notify_all();
+    if (running) {
+        WatchDeadline(ticket);
+    }
+
+    // With no read thread the command runs here; control_mutex_ keeps one
+    // from starting, and the device from closing, meanwhile
+    std::deque<PendingCommand> commands;
+    {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (session->running.load()) {
+            return;
+        }
+        commands = TakeCommands(*session);
+        // A device closed since the lookup has had its connection released
+        std::shared_ptr<const SessionMap> current = LoadSessions();
+        auto current_it = current->find(device_id);
+        if (current_it != current->end() && current_it->second == session) {
+            RunCommands(*session, commands);
+        }
+    }
+    CompleteCommands(commands);
+}
+
+bool DeviceManagerCore::StartCapture(const std::string& device_id, const std::string& path) {
+    std::shared_ptr<const SessionMap> sessions = LoadSessions();
+    auto it = sessions->find(device_id);
+    if (it == sessions->end()) {
+        return false;
+    }
+
+    DeviceSession& session = *it->second;
+    std::shared_ptr<ReportCaptureWriter> writer = std::make_shared<ReportCaptureWriter>();
+    if (!writer->Open(path, session.product_id)) {
+        MAGTEK_LOG(LogLevel::kError, "Failed to create capture file " << path);
+        return false;
+    }
+    // The read thread may still be writing to the old capture; it closes
+    // when that thread lets go of it
+    std::atomic_store(&session.capture_writer, writer);
+    session.capturing = true;
+    MAGTEK_LOG(LogLevel::kInfo, "Capturing reports from " << device_id << " to " << path);
+    return true;
+}
+
+void DeviceManagerCore::StopCapture(const std::string& device_id) {
+    std::shared_ptr<const SessionMap> sessions = LoadSessions();
+    auto it = sessions->find(device_id);
+    if (it == sessions->end()) {
+        return;
+    }
+
+    DeviceSession& session = *it->second;
+    session.capturing = false;
+    std::atomic_store(&session.capture_writer, std::shared_ptr<ReportCaptureWriter>());
+}
+
+void DeviceManagerCore::SetTrackDecryptor(TrackDecryptor decryptor) {
+    std::shared_ptr<const TrackDecryptor> published;
+    if (decryptor) {
+        published = std::make_shared<const TrackDecryptor>(std::move(decryptor));
+    }
+    std::atomic_store(&g_track_decryptor, std::move(published));
+}
+
+void DeviceManagerCore::SetTrackDecryptFunction(TrackDecryptFunction function, void* user_data) {
+    if (!function) {
+        SetTrackDecryptor(TrackDecryptor());
+        return;
+    }
+    SetTrackDecryptor([function, user_data](const MagneSafeReport& report, int track_number, std::string* plaintext) {
+        // Block ciphers never make the plaintext longer than the ciphertext
+        const ByteView& ciphertext = report.tracks[track_number - 1].encrypted;
+        char buffer[MagneSafeReportParser::TRACK_DATA_SIZE];
+        int length = function(user_data, report.ksn.data(), report.ksn.size(), track_number, ciphertext.data(),
+                              ciphertext.size(), buffer, sizeof(buffer));
+        if (length < 0 || static_cast<size_t>(length) > sizeof(buffer)) {
+            return false;
+        }
+        plaintext->assign(buffer, length);
+        return true;
+    });
+}
+
+bool DeviceManagerCore::IsMagtekDevice(unsigned short vendor_id, unsigned short product_id) {
+    return vendor_id == MAGTEK_VENDOR_ID && FindMagtekProduct(product_id) != nullptr;
+}
+
+std::string DeviceManagerCore::GetDeviceName(unsigned short vendor_id, unsigned short product_id) {
+    if (vendor_id != MAGTEK_VENDOR_ID) {
+        return "Unknown Device";
+    }
+
+    const ProductDescriptor* product = FindMagtekProduct(product_id);
+    if (product) {
+        return product->name;
+    }
+
+    std::stringstream ss;
+    ss << "Magtek Card Reader (PID: 0x" << std::hex << std::setfill('0') << std::setw(4) << product_id << ")";
+    return ss.str();
+}
+
+void DeviceManagerCore::RefreshDeviceCache(bool notify) {
+    // Enumerate with no lock held; the bus scan is the slow part
+    unsigned long long scan = ++scan_sequence_;
+    std::shared_ptr<const std::vector<DeviceInfo>> current =
+        std::make_shared<const std::vector<DeviceInfo>>(EnumerateDevices());
+
+    std::vector<std::string> removed;
+    bool arrived = false;
+    {
+        // Commit and report one scan at a time, so every arrival and removal
+        // is reported once and in order
+        std::lock_guard<std::mutex> refresh_lock(refresh_mutex_);
+        if (scan <= committed_scan_) {
+            // A scan that started later has already landed; this one is stale
+            return;
+        }
+        committed_scan_ = scan;
+
+        std::shared_ptr<const std::vector<DeviceInfo>> last = LoadDeviceCache();
+        PublishDeviceCache(current);
+
+        if (!notify || !last) {
+            return;
+        }
+        const std::vector<DeviceInfo>& previous = *last;
+        const std::vector<DeviceInfo>& devices = *current;
+
+        auto contains = [](const std::vector<DeviceInfo>& list, const std::string& device_id) {
+            for (const auto& device : list) {
+                if (device.device_id == device_id) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        for (const auto& device : previous) {
+            if (!contains(devices, device.device_id)) {
+                removed.push_back(device.device_id);
+                NotifyDeviceEvent(DeviceEventType::kDisconnected, device);
+            }
+        }
+        for (const auto& device : devices) {
+            if (!contains(previous, device.device_id)) {
+                arrived = true;
+                NotifyDeviceEvent(DeviceEventType::kConnected, device);
+            }
+        }
+    }
+
+    // A monitored device that went away is reopened by its read thread when
+    // it comes back; one that isn't monitored has nothing watching its dead
+    // handle, so it is closed here
+    if (!is_monitoring_.load()) {
+        for (const auto& device_id : removed) {
+            CloseDevice(device_id);
+        }
+    }
+
+    // Sessions waiting out a reconnect backoff retry now
+    if (arrived) {
+        std::shared_ptr<const SessionMap> sessions = LoadSessions();
+        for (const auto& entry : *sessions) {
+            DeviceSession& session = *entry.second;
+            {
+                std::lock_guard<std::mutex> lock(session.wait_mutex);
+                session.reconnect_wakeup = true;
+            }
+            session.wait_cv.notify_all();
+        }
+    }
+}
+
+void DeviceManagerCore::EnsureDeviceCache() {
+    if (!LoadDeviceCache()) {
+        RefreshDeviceCache(false);
+    }
+}
+
+std::unique_ptr<HidConnection> DeviceManagerCore::OpenRememberedDevice(const std::string& device_id,
+                                                                       DeviceInfo* info) {
+    DeviceInfo remembered;
+    {
+        std::lock_guard<std::mutex> lock(identities_mutex_);
+        if (identity_cache_path_.empty() || !identities_->Find(device_id, &remembered)) {
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<HidConnection> connection = OpenConnection(remembered);
+    if (!connection) {
+        MAGTEK_LOG(LogLevel::kDebug, "Remembered path " << remembered.device_path << " of " << device_id
+                                     << " didn't open, scanning");
+        return nullptr;
+    }
+
+    // Nodes are numbered in the order readers turn up, so after a reboot
+    // the path may lead to another reader
+    if (!remembered.serial_number.empty()) {
+        std::string serial_number = connection->SerialNumber();
+        if (!serial_number.empty() && serial_number != remembered.serial_number) {
+            MAGTEK_LOG(LogLevel::kDebug, "Remembered path " << remembered.device_path << " of " << device_id
+                                         << " is now another reader, scanning");
+            return nullptr;
+        }
+    }
+
+    *info = remembered;
+    return connection;
+}
+
+void DeviceManagerCore::RememberDevice(const DeviceInfo& info) {
+    std::lock_guard<std::mutex> lock(identities_mutex_);
+    if (identity_cache_path_.empty() || !identities_->Remember(info)) {
+        return;
+    }
+    if (!identities_->Save(identity_cache_path_)) {
+        MAGTEK_LOG(LogLevel::kWarning, "Can't write the device identity cache " << identity_cache_path_);
+    }
+}
+
+bool DeviceManagerCore::FindCachedDevice(const std::string& device_id, DeviceInfo* info) {
+    std::shared_ptr<const std::vector<DeviceInfo>> cache = LoadDeviceCache();
+    if (!cache) {
+        return false;
+    }
+
+    for (const auto& device : *cache) {
+        if (device.device_id == device_id) {
+            *info = device;
+            return true;
+        }
+    }
+    return false;
+}
+
+void DeviceManagerCore::NotifyDeviceEvent(DeviceEventType type, DeviceInfo info) {
+    if (device_event_callback_) {
+        device_event_callback_(type, std::move(info));
+    }
+}
+
+bool DeviceManagerCore::NotifyClosed(const std::string& device_id) {
+    // An unplugged device has already been reported by the hotplug rescan.
+    // A device opened from the identity cache may be the first to need it.
+    EnsureDeviceCache();
+    DeviceInfo info;
+    if (!FindCachedDevice(device_id, &info)) {
+        return false;
+    }
+    NotifyDeviceEvent(DeviceEventType::kDisconnected, std::move(info));
+    return true;
+}
+
+std::shared_ptr<const DeviceManagerCore::SessionMap> DeviceManagerCore::LoadSessions() const {
+    return std::atomic_load(&sessions_);
+}
+
+void DeviceManagerCore::PublishSessions(std::shared_ptr<const SessionMap> sessions) {
+    std::atomic_store(&sessions_, std::move(sessions));
+}
+
+std::shared_ptr<const std::vector<DeviceInfo>> DeviceManagerCore::LoadDeviceCache() const {
+    return std::atomic_load(&device_cache_);
+}
+
+void DeviceManagerCore::PublishDeviceCache(std::shared_ptr<const std::vector<DeviceInfo>> devices) {
+    std::atomic_store(&device_cache_, std::move(devices));
+}
+
+void DeviceManagerCore::StartSession(DeviceSession& session) {
+    if (session.running.load()) {
+        return;
+    }
+
+    // A device starts out responsive, however long it sat unmonitored
+    session.last_report_time = SwipeAssembler::Clock::now();
+    session.running = true;
+    session.thread = std::thread(&DeviceManagerCore::MonitoringThread, this, &session);
+}
+
+void DeviceManagerCore::StopSession(DeviceSession& session) {
+    {
+        std::lock_guard<std::mutex> lock(session.wait_mutex);
+        session.running = false;
+    }
+    session.wait_cv.notify_all();
+
+    // The read thread owns the handle while it runs, so it must be gone
+    // before the handle can be closed
+    if (session.thread.joinable()) {
+        session.thread.join();
+    }
+
+    // Commands the read thread didn't get to still run before the handle
+    // can close
+    ServiceCommands(session);
+}
+
+void DeviceManagerCore::CloseSession(const std::shared_ptr<DeviceSession>& session) {
+    StopSession(*session);
+    session->connection.reset();
+
+    // The read thread is gone, but swipes it queued are still owed to the
+    // card swipe callback, which only ever runs on the draining thread; so
+    // hand the session to the next drain rather than delivering them here
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        if (!session->swipe_queue.Empty()) {
+            retired_sessions_.push_back(session);
+            queued = true;
+        }
+    }
+    if (queued && swipe_queued_callback_) {
+        swipe_queued_callback_();
+    }
+}
+
+void DeviceManagerCore::DeliverQueuedSwipes(DeviceSession& session) {
+    session.swipe_queue.ConsumeAll([this](CardData& card_data) {
+        TraceScope trace("DeliverSwipe", card_data.device_id, card_data.frame.size());
+        card_data.timings.delivered_ns = MonotonicNanoseconds();
+        latency_stats_.Record(card_data.timings);
+        if (card_swipe_callback_) {
+            card_swipe_callback_(std::move(card_data));
+        }
+        // Hand the frame back to the pool now, not when the slot is reused
+        card_data.frame.Reset();
+    });
+}
+
+void DeviceManagerCore::MonitoringThread(DeviceSession* session) {
+    const int SLEEP_INTERVAL_MS = 50; // Check every 50ms
+
+    // Whether an adaptive session has gone quiet; a swipe partway in never has
+    auto is_idle = [this, session] {
+        return !session->assembler.HasPendingFrame() &&
+               SwipeAssembler::Clock::now() - session->last_report_time >=
+                   std::chrono::milliseconds(adaptive_idle_after_ms_.load());
+    };
+
+    bool was_idle = false;
+    while (session->running.load()) {
+        ReadMode mode = read_mode_.load();
+        bool idle = mode == ReadMode::kAdaptive && is_idle();
+        if (idle != was_idle) {
+            MAGTEK_LOG(LogLevel::kDebug, "Device " << session->device_id << (idle ? " idle" : " active"));
+            was_idle = idle;
+        }
+        bool polling = mode == ReadMode::kPolling || idle;
+
+        // Commands go out between reads, every queued one per pass
+        ServiceCommands(*session);
+
+        // The HID read blocks on the library's own completion event, so in
+        // event-driven mode an idle device wakes the thread only once per
+        // slice, and a report ends the wait at once. A command queued during
+        // the wait cancels it where the connection can; elsewhere it waits
+        // for the slice to end, and the deadline thread answers it if its
+        // timeout comes first. One queued since the pass above keeps the
+        // read short, since nothing could cut it short.
+        int timeout_ms = polling ? POLL_READ_TIMEOUT_MS : EVENT_WAIT_SLICE_MS;
+        if (!polling && session->commands_pending.load() &&
+            !(session->connection && session->connection->CanCancelRead())) {
+            timeout_ms = POLL_READ_TIMEOUT_MS;
+        }
+        if (!ReadFromDevice(*session, timeout_ms)) {
+            // The handle is dead, typically because the reader was unplugged
+            // or its hub reset
+            ReconnectSession(*session);
+            continue;
+        }
+
+        // An idle device that just sent a report reads the rest of the swipe
+        // straight away
+        int interval_ms = 0;
+        if (mode == ReadMode::kPolling) {
+            interval_ms = SLEEP_INTERVAL_MS;
+        } else if (idle && is_idle()) {
+            interval_ms = adaptive_idle_interval_ms_.load();
+        }
+
+        if (interval_ms > 0) {
+            // Poll interval
+            std::unique_lock<std::mutex> lock(session->wait_mutex);
+            session->wait_cv.wait_for(lock, std::chrono::milliseconds(interval_ms), [session] {
+                return !session->running.load() || !session->commands.empty();
+            });
+        }
+    }
+}
+
+void DeviceManagerCore::ReconnectSession(DeviceSession& session) {
+    // Drop the dead handle along with any swipe it was partway through;
+    // swipes already queued stay queued for the next drain
+    session.assembler.Reset();
+    {
+        std::lock_guard<std::mutex> lock(session.wait_mutex);
+        session.connection.reset();
+        session.reconnect_wakeup = false;
+    }
+
+    // When the hotplug rescan got here first the removal has been reported,
+    // and it will report the arrival too
+    bool reported = NotifyClosed(session.device_id);
+    MAGTEK_LOG(LogLevel::kWarning, "Lost device " << session.device_id << ", reconnecting");
+
+    int backoff_ms = RECONNECT_INITIAL_BACKOFF_MS;
+    while (session.running.load()) {
+        // Commands sent to a lost device fail rather than wait it out
+        ServiceCommands(session);
+
+        // Without hotplug notifications nothing else updates the cache
+        if (!IsHotplugActive()) {
+            RefreshDeviceCache(false);
+        }
+
+        DeviceInfo info;
+        if (FindReconnectTarget(session, &info)) {
+            std::unique_ptr<HidConnection> connection = OpenConnection(info);
+            if (connection) {
+                {
+                    std::lock_guard<std::mutex> lock(session.wait_mutex);
+                    session.connection = std::move(connection);
+                }
+                session.last_report_time = SwipeAssembler::Clock::now();
+                DeviceCounters::Increment(session.counters->reconnects);
+                if (reported) {
+                    info.is_connected = true;
+                    NotifyDeviceEvent(DeviceEventType::kConnected, std::move(info));
+                }
+                MAGTEK_LOG(LogLevel::kInfo, "Reconnected to device: " << session.device_id);
+                return;
+            }
+        }
+
+        // Sleep out the backoff, cut short by StopSession or by a hotplug
+        // arrival that may be this device coming back. Commands arriving
+        // meanwhile are failed at once rather than left to time out.
+        SwipeAssembler::Clock::time_point wake_time =
+            SwipeAssembler::Clock::now() + std::chrono::milliseconds(backoff_ms);
+        std::unique_lock<std::mutex> lock(session.wait_mutex);
+        while (session.wait_cv.wait_until(lock, wake_time, [&session] {
+            return !session.running.load() || session.reconnect_wakeup || !session.commands.empty();
+        })) {
+            if (!session.running.load() || session.reconnect_wakeup) {
+                break;
+            }
+            lock.unlock();
+            ServiceCommands(session);
+            lock.lock();
+        }
+        session.reconnect_wakeup = false;
+        backoff_ms = std::min(backoff_ms * 2, RECONNECT_MAX_BACKOFF_MS);
+    }
+}
+
+bool DeviceManagerCore::FindReconnectTarget(const DeviceSession& session, DeviceInfo* info) {
+    if (FindCachedDevice(session.device_id, info)) {
+        return true;
+    }
+
+    // A reader whose ID is built from its path comes back with a new one;
+    // its serial number, when it has one, still identifies it
+    if (session.serial_number.empty()) {
+        return false;
+    }
+    std::shared_ptr<const std::vector<DeviceInfo>> cache = LoadDeviceCache();
+    if (!cache) {
+        return false;
+    }
+    for (const auto& device : *cache) {
+        if (device.product_id == session.product_id && device.serial_number == session.serial_number) {
+            *info = device;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::deque<DeviceManagerCore::PendingCommand> DeviceManagerCore::TakeCommands(DeviceSession& session) {
+    std::deque<PendingCommand> commands;
+    {
+        std::lock_guard<std::mutex> lock(session.wait_mutex);
+        commands.swap(session.commands);
+        session.commands_pending = false;
+    }
+
+    // Deadlines are checked once, on pickup, so a batch isn't timed out by
+    // its own earlier commands; a ticket the deadline thread claimed has
+    // been answered already
+    SwipeAssembler::Clock::time_point now = SwipeAssembler::Clock::now();
+    for (auto& pending : commands) {
+        pending.owned = !pending.ticket->claimed.exchange(true);
+        if (pending.owned && now > pending.ticket->deadline) {
+            pending.result.status = CommandStatus::kTimedOut;
+        }
+    }
+    return commands;
+}
+
+void DeviceManagerCore::RunCommands(DeviceSession& session, std::deque<PendingCommand>& commands) {
+    for (auto& pending : commands) {
+        if (!pending.owned || pending.result.status == CommandStatus::kTimedOut) {
+            continue;
+        } else if (!session.connection) {
+            pending.result.status = CommandStatus::kNotOpen;
+        } else {
+            ExecuteCommand(session, pending);
+        }
+    }
+}
+
+void DeviceManagerCore::ExecuteCommand(DeviceSession& session, PendingCommand& pending) {
+    CommandResult& result = pending.result;
+    result.status = CommandStatus::kFailed;
+
+    std::vector<unsigned char> report;
+    if (!DeviceCommandCodec::Encode(pending.command, session.feature_report_size, &report)) {
+        MAGTEK_LOG(LogLevel::kWarning, "Command data too long for device " << session.device_id);
+        return;
+    }
+    if (session.connection->SendFeatureReport(report.data(), report.size()) < 0) {
+        MAGTEK_LOG(LogLevel::kWarning, "Error sending command to device " << session.device_id << ": "
+                                                                         << session.connection->LastError());
+        return;
+    }
+
+    // The response replaces the command in the same feature report
+    std::fill(report.begin(), report.end(), 0);
+    int length = session.connection->GetFeatureReport(report.data(), report.size());
+    if (length < 0 || !DeviceCommandCodec::Decode(report.data(), length, &result)) {
+        MAGTEK_LOG(LogLevel::kWarning, "Error reading command response from device " << session.device_id << ": "
+                                                                                    << session.connection->LastError());
+        return;
+    }
+    result.status = CommandStatus::kOk;
+}
+
+void DeviceManagerCore::CompleteCommands(std::deque<PendingCommand>& commands) {
+    for (const auto& pending : commands) {
+        if (pending.owned && pending.ticket->callback) {
+            pending.ticket->callback(pending.result);
+        }
+    }
+}
+
+void DeviceManagerCore::WatchDeadline(const std::shared_ptr<CommandTicket>& ticket) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(deadline_mutex_);
+        if (!deadline_thread_.joinable()) {
+            deadline_thread_ = std::thread(&DeviceManagerCore::DeadlineThread, this);
+        }
+        auto it = deadlines_.insert(std::make_pair(ticket->deadline, ticket));
+        earliest = it == deadlines_.begin();
+    }
+    if (earliest) {
+        deadline_cv_.notify_all();
+    }
+}
+
+void DeviceManagerCore::StopDeadlineThread() {
+    {
+        std::lock_guard<std::mutex> lock(deadline_mutex_);
+        deadline_stopping_ = true;
+    }
+    deadline_cv_.notify_all();
+    if (deadline_thread_.joinable()) {
+        deadline_thread_.join();
+    }
+
+    // Every session has stopped, running whatever it had queued
+    std::lock_guard<std::mutex> lock(deadline_mutex_);
+    deadlines_.clear();
+    deadline_stopping_ = false;
+}
+
+void DeviceManagerCore::DeadlineThread() {
+    std::unique_lock<std::mutex> lock(deadline_mutex_);
+    while (!deadline_stopping_) {
+        if (deadlines_.empty()) {
+            deadline_cv_.wait(lock);
+            continue;
+        }
+        auto first = deadlines_.begin();
+        if (SwipeAssembler::Clock::now() < first->first) {
+            deadline_cv_.wait_until(lock, first->first);
+            continue;
+        }
+
+        // Entries stay until their deadline, claimed or not
+        std::shared_ptr<CommandTicket> ticket = first->second;
+        deadlines_.erase(first);
+        if (ticket->claimed.exchange(true)) {
+            continue;
+        }
+        lock.unlock();
+        CommandResult result;
+        result.status = CommandStatus::kTimedOut;
+        result.result_code = 0;
+        if (ticket->callback) {
+            ticket->callback(result);
+        }
+        lock.lock();
+    }
+}
+
+void DeviceManagerCore::ServiceCommands(DeviceSession& session) {
+    if (!session.commands_pending.load()) {
+        return;
+    }
+    std::deque<PendingCommand> commands = TakeCommands(session);
+    RunCommands(session, commands);
+    CompleteCommands(commands);
+}
+
+bool DeviceManagerCore::ReadFromDevice(DeviceSession& session, int timeout_ms) {
+    if (!session.connection) {
+        return false;
+    }
+
+    SwipeAssembler& assembler = session.assembler;
+    DeviceCounters& counters = *session.counters;
+    PrepareReadBuffers(session);
+    ReportBuffer& buffer = session.read_buffer;
+    // Only encrypting readers send reports longer than a clear one
+    size_t buffer_size = session.encrypting ? MagneSafeReportParser::REPORT_SIZE : SwipeAssembler::MAX_REPORT_SIZE;
+    // Don't wait past the point where a partially received swipe times out
+    int wait_ms = assembler.MillisecondsUntilTimeout(SwipeAssembler::Clock::now(), timeout_ms);
+    int bytes_read = session.connection->ReadReport(buffer.mutable_data(), buffer_size, wait_ms);
+
+    if (bytes_read > 0) {
+        // Only a read that returned a report is a slice; the wait before it
+        // is idle time
+        TraceScope trace("ReadFromDevice", session.device_id, static_cast<size_t>(bytes_read));
+        buffer.SetSize(static_cast<size_t>(bytes_read));
+        SwipeAssembler::Clock::time_point now = SwipeAssembler::Clock::now();
+        session.last_report_time = now;
+        DeviceCounters::Increment(counters.reports_read);
+        DeviceCounters::Increment(counters.bytes_read, static_cast<unsigned long long>(bytes_read));
+
+        if (session.capturing.load()) {
+            std::shared_ptr<ReportCaptureWriter> writer = std::atomic_load(&session.capture_writer);
+            if (writer) {
+                writer->Write(buffer.data(), bytes_read, now);
+            }
+        }
+
+        // An encrypted swipe arrives whole in one report
+        if (session.encrypting && MagneSafeReportParser::IsEncryptedReport(bytes_read)) {
+            DispatchEncryptedReport(session, buffer);
+            return true;
+        }
+
+        // Gather reports until the swipe is complete, then parse it once
+        if (assembler.AddReport(buffer.data(), bytes_read, now)) {
+            DispatchFrame(session);
+        }
+        return true;
+    } else if (bytes_read < 0) {
+        // Error occurred; an unplugged reader fails every read until closed
+        DeviceCounters::Increment(counters.read_errors);
+        MAGTEK_LOG(LogLevel::kWarning,
+                   "Error reading from device " << session.device_id << ": " << session.connection->LastError());
+        return false;
+    }
+
+    // No data available (bytes_read == 0): a swipe without an end marker
+    // is complete once the device goes quiet
+    if (assembler.CheckTimeout(SwipeAssembler::Clock::now())) {
+        TraceScope trace("CompleteFrame", session.device_id, assembler.FrameLength());
+        DeviceCounters::Increment(counters.partial_frames);
+        DispatchFrame(session);
+    }
+    return true;
+}
+
+void DeviceManagerCore::PrepareReadBuffers(DeviceSession& session) {
+    // A buffer some swipe still holds is left to it; the pool only
+    // allocates if swipes are held longer than the queue is deep
+    if (!session.read_buffer.IsUnique()) {
+        session.read_buffer = session.buffer_pool->Acquire();
+    }
+    if (!session.frame_buffer.IsUnique()) {
+        session.frame_buffer = session.buffer_pool->Acquire();
+        session.assembler.SetFrameBuffer(session.frame_buffer.mutable_data());
+    }
+}
+
+void DeviceManagerCore::DispatchFrame(DeviceSession& session) {
+    // The assembler completed the frame in frame_buffer
+    ReportBuffer& frame = session.frame_buffer;
+    frame.SetSize(session.assembler.FrameLength());
+
+    // Parse the assembled frame; only notify if we have valid track data
+    if (!ParseInputReport(session, frame)) {
+        DeviceCounters::Increment(session.counters->invalid_frames);
+        return;
+    }
+    QueueSwipe(session, session.assembler.FrameStartTime(), session.assembler.FrameCompleteTime());
+}
+
+void DeviceManagerCore::DispatchEncryptedReport(DeviceSession& session, const ReportBuffer& report) {
+    if (!ParseEncryptedReport(session, report)) {
+        DeviceCounters::Increment(session.counters->invalid_frames);
+        return;
+    }
+    // The single report is both the first and the completing one
+    SwipeAssembler::Clock::time_point now = SwipeAssembler::Clock::now();
+    QueueSwipe(session, now, now);
+}
+
+void DeviceManagerCore::QueueSwipe(DeviceSession& session, SwipeAssembler::Clock::time_point first_report_time,
+                                   SwipeAssembler::Clock::time_point frame_complete_time) {
+    CardData& card_data = *session.card_data;
+    TraceScope trace("QueueSwipe", session.device_id, card_data.frame.size());
+    SwipeValidation validation = card_data.validation;
+    if (reject_invalid_swipes_.load() &&
+        (validation == SwipeValidation::kLrcError || validation == SwipeValidation::kFormatError)) {
+        DeviceCounters::Increment(session.counters->invalid_frames);
+        MAGTEK_LOG(LogLevel::kDebug, "Rejected swipe from " << session.device_id << ": "
+                                                            << TrackDecoder::ValidationName(validation));
+        return;
+    }
+
+    // A repeat stops here, before either delivery path can send it on
+    int window_ms = duplicate_swipe_window_ms_.load();
+    if (window_ms > 0) {
+        uint64_t track_hashes[SwipeDeduplicator::TRACK_COUNT] = {
+            SwipeDeduplicator::HashTrack(card_data.track1.data(), card_data.track1.size()),
+            SwipeDeduplicator::HashTrack(card_data.track2.data(), card_data.track2.size()),
+            SwipeDeduplicator::HashTrack(card_data.track3.data(), card_data.track3.size()),
+        };
+        if (session.deduplicator.IsRepeat(track_hashes, frame_complete_time,
+                                          std::chrono::milliseconds(window_ms))) {
+            DeviceCounters::Increment(session.counters->duplicate_swipes);
+            MAGTEK_LOG(LogLevel::kDebug, "Dropped repeated swipe from " << session.device_id);
+            return;
+        }
+    }
+    DeviceCounters::Increment(session.counters->swipes_parsed);
+
+    SwipeTimings& timings = card_data.timings;
+    timings.first_report_ns = MonotonicNanoseconds(first_report_time);
+    timings.frame_complete_ns = MonotonicNanoseconds(frame_complete_time);
+    timings.parsed_ns = MonotonicNanoseconds();
+    timings.delivered_ns = 0;
+
+    // A listener delivers from this thread, so queueing and delivery coincide
+    if (swipe_listener_) {
+        timings.queued_ns = MonotonicNanoseconds();
+        timings.delivered_ns = timings.queued_ns;
+        if (swipe_listener_(card_data)) {
+            latency_stats_.Record(timings);
+            return;
+        }
+        timings.delivered_ns = 0;
+    }
+
+    // Hand off to the platform thread; never block this thread on Dart. A
+    // swipe parsed into the queue's next slot only has to be published; one
+    // parsed into the spare moves into a slot if one has freed up since.
+    timings.queued_ns = MonotonicNanoseconds();
+    if (session.card_data == &session.spare_card) {
+        CardData* slot = session.swipe_queue.PrepareSlot();
+        if (!slot) {
+            DeviceCounters::Increment(session.counters->queue_overflows);
+            MAGTEK_LOG(LogLevel::kWarning, "Swipe queue full, dropping swipe from " << session.device_id);
+            return;
+        }
+        std::swap(*slot, session.spare_card);
+    }
+    session.swipe_queue.CommitSlot();
+    if (swipe_queued_callback_) {
+        swipe_queued_callback_();
+    }
+    MAGTEK_LOG(LogLevel::kDebug, "Card swipe detected on " << session.device_id);
+}
+
+CardData& DeviceManagerCore::BeginSwipe(DeviceSession& session) {
+    // Only a full queue leaves the swipe to the spare
+    CardData* slot = session.swipe_queue.PrepareSlot();
+    session.card_data = slot ? slot : &session.spare_card;
+    return *session.card_data;
+}
+
+bool DeviceManagerCore::ParseInputReport(DeviceSession& session, const ReportBuffer& frame) {
+    TraceScope trace("ParseInputReport", session.device_id, frame.size());
+    // Scans the frame in place; nothing here allocates once the session's
+    // strings have grown to fit a typical swipe
+    if (!session.parser.Parse(frame.data(), frame.size())) {
+        return false;
+    }
+
+    CardData& card_data = BeginSwipe(session);
+    card_data.frame = frame;
+    card_data.device_id = session.device_id;
+    card_data.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    session.parser.AssignTrack(1, &card_data.track1);
+    session.parser.AssignTrack(2, &card_data.track2);
+    session.parser.AssignTrack(3, &card_data.track3);
+    for (int track = 1; track <= ReportParser::TRACK_COUNT; track++) {
+        ParseTrackData(card_data, track, session.parser.TrackLrc(track));
+    }
+    card_data.validation = TrackDecoder::Validate(card_data.track_fields, ReportParser::TRACK_COUNT);
+    card_data.encrypted = false;
+    card_data.decrypted = false;
+    // Don't leave views into whatever frame the slot held before
+    card_data.magnesafe = MagneSafeReport();
+
+    AssignRawResponse(card_data);
+    return true;
+}
+
+bool DeviceManagerCore::ParseEncryptedReport(DeviceSession& session, const ReportBuffer& buffer) {
+    TraceScope trace("ParseEncryptedReport", session.device_id, buffer.size());
+    CardData& card_data = BeginSwipe(session);
+    MagneSafeReport& report = card_data.magnesafe;
+    // The report's fields are views into the buffer, which the swipe keeps
+    card_data.frame = buffer;
+    if (!MagneSafeReportParser::Parse(buffer.data(), buffer.size(), &report)) {
+        return false;
+    }
+
+    card_data.device_id = session.device_id;
+    card_data.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Plaintext from the decryptor where it has it, the masked track where not
+    std::shared_ptr<const TrackDecryptor> decryptor = std::atomic_load(&g_track_decryptor);
+    card_data.decrypted = false;
+    for (int track = 1; track <= ReportParser::TRACK_COUNT; track++) {
+        const MagneSafeTrack& source = report.tracks[track - 1];
+        bool decrypted = decryptor && !source.encrypted.empty() && (*decryptor)(report, track, &session.plaintext);
+        if (decrypted) {
+            card_data.decrypted = true;
+            AssignTrack(card_data, track, session.plaintext.data(), session.plaintext.size());
+        } else {
+            AssignTrack(card_data, track, source.masked.chars(), source.masked.size());
+        }
+        // The reader has already checked the LRC of an encrypted swipe
+        ParseTrackData(card_data, track, 0);
+    }
+    // Masked account numbers can't pass the Luhn check
+    card_data.validation = TrackDecoder::Validate(card_data.track_fields, ReportParser::TRACK_COUNT,
+                                                  card_data.decrypted);
+    card_data.encrypted = true;
+
+    AssignRawResponse(card_data);
+    return true;
+}
+
+TrackStatus DeviceManagerCore::ParseTrackData(CardData& card_data, int track_number, char lrc) {
+    const char* track = track_number == 1 ? card_data.track1.data()
+                        : track_number == 2 ? card_data.track2.data() : card_data.track3.data();
+    size_t length = track_number == 1 ? card_data.track1.size()
+                    : track_number == 2 ? card_data.track2.size() : card_data.track3.size();
+    return TrackDecoder::Decode(track_number, track, length, lrc, &card_data.track_fields[track_number - 1]);
+}
+
+void DeviceManagerCore::AssignRawResponse(CardData& card_data) {
+    // Store raw response for debugging
+    const ReportBuffer& frame = card_data.frame;
+    RawResponseMode raw_mode = raw_response_mode_.load();
+    card_data.raw_response.clear();
+    card_data.raw_bytes = ByteView();
+    if (raw_mode == RawResponseMode::kHex) {
+        ReportParser::FormatHex(frame.data(), frame.size(), &card_data.raw_response);
+    } else if (raw_mode == RawResponseMode::kBinary) {
+        card_data.raw_bytes = frame.View(0, frame.size());
+    }
+}
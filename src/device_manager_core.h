@@ -0,0 +1,613 @@
+#ifndef MAGTEK_DEVICE_MANAGER_CORE_H_
+#define MAGTEK_DEVICE_MANAGER_CORE_H_
+
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+
+#include "device_command.h"
+#include "device_metrics.h"
+#include "fixed_string.h"
+#include "magnesafe_report.h"
+#include "magtek_products.h"
+#include "report_buffer_pool.h"
+#include "report_capture.h"
+#include "report_parser.h"
+#include "spsc_ring.h"
+#include "swipe_assembler.h"
+#include "swipe_deduplicator.h"
+#include "swipe_latency.h"
+#include "track_decoder.h"
+
+struct DeviceIdentityCache;
+
+struct DeviceInfo {
+    std::string device_id;
+    std::string device_name;
+    unsigned short vendor_id;
+    unsigned short product_id;
+    std::string serial_number;
+    std::string device_path;
+    bool is_connected;
+};
+
+// One swipe. Move-only: a swipe is handed from the read thread to its sink,
+// never duplicated along the way. The tracks and their decoded fields are
+// stored inline at their ISO maximum lengths, so a swipe owns no heap
+// memory for them.
+struct CardData {
+    CardData() = default;
+    CardData(CardData&&) = default;
+    CardData& operator=(CardData&&) = default;
+    CardData(const CardData&) = delete;
+    CardData& operator=(const CardData&) = delete;
+
+    FixedString<ReportParser::TRACK1_MAX_LENGTH> track1;
+    FixedString<ReportParser::TRACK2_MAX_LENGTH> track2;
+    FixedString<ReportParser::TRACK3_MAX_LENGTH> track3;
+    std::string device_id;
+    // Hex dump of the swipe frame; set in RawResponseMode::kHex
+    std::string raw_response;
+    // The swipe frame itself, a view of frame; set in RawResponseMode::kBinary
+    ByteView raw_bytes;
+    // Milliseconds since the epoch
+    long long timestamp;
+    // Monotonic stage timestamps, for latency breakdowns
+    SwipeTimings timings;
+    // Decoded fields of track1-3, in that order
+    TrackFields track_fields[ReportParser::TRACK_COUNT];
+    // Verdict of the LRC and Luhn checks
+    SwipeValidation validation;
+    // Set when the swipe came from a MagneSafe encrypted report, whose
+    // fields are then in magnesafe
+    bool encrypted;
+    // Whether the track decryptor supplied track1-3; when it didn't, an
+    // encrypted swipe's tracks are the reader's masked ones
+    bool decrypted;
+    MagneSafeReport magnesafe;
+    // The pooled buffer holding the frame the swipe was parsed from, which
+    // raw_bytes and magnesafe's fields point into
+    ReportBuffer frame;
+};
+
+// Decrypts one track of a MagneSafe swipe into plaintext, e.g. by handing
+// the KSN and ciphertext to an HSM. Runs on the reader's read thread, so it
+// must be thread-safe, and the time it takes delays that reader's swipes.
+// Returns false if it can't decrypt the track; the masked track is
+// delivered instead.
+typedef std::function<bool(const MagneSafeReport& report, int track_number, std::string* plaintext)>
+    TrackDecryptor;
+
+// C form of TrackDecryptor, for the plugins' exported setters. Writes at
+// most plaintext_capacity bytes of plaintext and returns how many, or -1
+// if it can't decrypt the track.
+typedef int (*TrackDecryptFunction)(void* user_data, const unsigned char* ksn, size_t ksn_length, int track_number,
+                                    const unsigned char* ciphertext, size_t ciphertext_length, char* plaintext,
+                                    size_t plaintext_capacity);
+
+// Kinds of device event delivered to the device event callback
+enum class DeviceEventType {
+    // A reader was plugged in, or one was opened
+    kConnected,
+    // A reader was unplugged, or one was closed
+    kDisconnected,
+};
+
+// How the monitoring threads wait for input reports
+enum class ReadMode {
+    // Block in the HID read until a report arrives or monitoring stops
+    kEventDriven,
+    // Legacy loop: sleep for a fixed interval, then read with a short timeout
+    kPolling,
+    // Event-driven while reports arrive; a device quiet for the idle timeout
+    // is read at a slow idle cadence instead, sleeping in between, until its
+    // first report puts it back on event-driven reads
+    kAdaptive,
+};
+
+// What CardData carries of the frame a swipe was parsed from
+enum class RawResponseMode {
+    // Nothing; the cheapest mode
+    kOff,
+    // raw_response as space-separated hex, three characters per byte
+    kHex,
+    // raw_bytes, one byte per byte
+    kBinary,
+};
+
+// An open reader, as seen through the platform's HID library. Only the
+// device's read thread uses it while monitoring runs.
+class HidConnection {
+public:
+    virtual ~HidConnection() {}
+
+    // Wait up to timeout_ms for an input report. Returns its length, 0 if
+    // none arrived in time, or a negative value on error.
+    virtual int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) = 0;
+
+    // Whether CancelRead can cut a read short
+    virtual bool CanCancelRead() const { return false; }
+
+    // Make a ReadReport blocked on another thread return 0 now, or the next
+    // one if none is. Safe to call from any thread while the connection
+    // lives; a no-op unless CanCancelRead.
+    virtual void CancelRead() {}
+
+    // Send a feature report, report ID byte first. Returns the bytes sent,
+    // or a negative value on error.
+    virtual int SendFeatureReport(const unsigned char* data, size_t length) = 0;
+
+    // Read a feature report into buffer, whose first byte names the report
+    // ID. Returns its length including that byte, or a negative value on
+    // error.
+    virtual int GetFeatureReport(unsigned char* buffer, size_t size) = 0;
+
+    // Describe the last error, for logging
+    virtual std::string LastError() = 0;
+
+    // The serial number the reader reports, asked of the device itself
+    // rather than taken from a listing; empty when the connection can't tell
+    virtual std::string SerialNumber() { return std::string(); }
+};
+
+// Device sessions, the enumeration cache, the read loop, swipe parsing and
+// queueing, shared by the Linux and Windows plugins. Platform subclasses
+// supply HID access and hotplug notifications through the protected hooks,
+// and must call Cleanup() from their destructor.
+class DeviceManagerCore {
+public:
+    virtual ~DeviceManagerCore();
+
+    // Initialize the USB device manager
+    bool Initialize();
+
+    // Cleanup resources. Swipes still queued are delivered on the calling thread.
+    void Cleanup();
+
+    // Get list of connected Magtek devices. Served from a cache that hotplug
+    // notifications keep current; rescans the bus only when those are
+    // unavailable, or when no scan has run yet.
+    std::vector<DeviceInfo> GetConnectedDevices();
+
+    // The enumeration cache as it stands, without scanning; null before the
+    // first scan or when hotplug notifications aren't keeping it current.
+    // is_connected is not filled in.
+    std::shared_ptr<const std::vector<DeviceInfo>> GetCachedDevices() const;
+
+    // Connect to a specific device, closing any other open devices
+    bool ConnectToDevice(const std::string& device_id);
+
+    // Open a device alongside any that are already open
+    bool OpenDevice(const std::string& device_id);
+
+    // Close one open device. While monitoring runs, an open device stays
+    // open across read errors and unplugs: its read thread reopens it with
+    // exponential backoff, reporting the loss and return as device events.
+    void CloseDevice(const std::string& device_id);
+
+    // Disconnect from all open devices
+    void Disconnect();
+
+    // Check if connected to at least one device
+    bool IsConnected() const;
+
+    // Check if a specific device is open
+    bool IsDeviceOpen(const std::string& device_id) const;
+
+    // Start monitoring for card swipes
+    void StartMonitoring();
+
+    // Stop monitoring
+    void StopMonitoring();
+
+    // Select how the monitoring threads wait for reports (event-driven by default)
+    void SetReadMode(ReadMode mode);
+
+    // Tune ReadMode::kAdaptive: how long a device must be quiet before it
+    // idles, and how often an idle device is read (10 s and 500 ms by
+    // default). An idle device's first report waits up to interval_ms in
+    // the kernel's queue; the rest of the swipe doesn't.
+    void SetAdaptiveIdle(int idle_after_ms, int interval_ms);
+
+    // Select what CardData carries of each swipe frame (kHex by default).
+    // Formatting hex is most of the per-swipe parse cost.
+    void SetRawResponseMode(RawResponseMode mode);
+
+    // Drop swipes that fail the LRC check or in which no track decodes,
+    // rather than delivering them with their validation (off by default).
+    // Swipes that only fail the Luhn check are always delivered.
+    void SetRejectInvalidSwipes(bool reject);
+
+    // Drop a swipe that shares a track with the same device's previous
+    // swipe less than window_ms before it, counting it in
+    // DeviceMetrics::duplicate_swipes; it reaches neither the swipe listener
+    // nor the card swipe callback. Each repeat restarts the window. 0, the
+    // default, turns the filter off.
+    void SetDuplicateSwipeWindow(int window_ms);
+
+    // Remember the readers opened in an identity cache file at path
+    // (device_identity_cache.h), or forget them with an empty path. When
+    // Initialize finds readers remembered there it skips its bus scan:
+    // opening one of them before anything else needs the device list opens
+    // its remembered path directly, checking the serial number where the
+    // connection can, and only scans when that fails. Plug-ins and unplugs
+    // before the first scan are not reported. Set before Initialize.
+    void SetDeviceIdentityCache(const std::string& path);
+
+    // Set the sink for card swipe events; it runs on the thread that calls
+    // DrainCardSwipes, never on a read thread. It takes ownership of each
+    // swipe; one it doesn't move from keeps its storage for the next.
+    void SetCardSwipeCallback(std::function<void(CardData&&)> callback);
+
+    // Set a callback the read threads invoke after queueing a swipe. It must
+    // be cheap and thread-safe; typically it schedules DrainCardSwipes on the
+    // platform thread.
+    void SetSwipeQueuedCallback(std::function<void()> callback);
+
+    // Set a listener the read threads offer each swipe before queueing it.
+    // If it returns true it has delivered the swipe itself, which is then
+    // recorded as delivered and never reaches the card swipe callback. It
+    // must be thread-safe and must not block; set it before opening devices.
+    void SetSwipeListener(std::function<bool(const CardData&)> listener);
+
+    // Deliver every queued swipe, including those left by devices closed
+    // since the last drain, to the card swipe callback. Typically called on
+    // the platform thread; never blocks on connect/disconnect, which may run
+    // on any one other thread.
+    void DrainCardSwipes();
+
+    // Set the sink for device events, which takes ownership of each event's
+    // DeviceInfo. Hotplug events arrive on a background thread, the loss and
+    // return of a monitored device on its read thread, and open/close events
+    // on the thread that made the call.
+    void SetDeviceEventCallback(std::function<void(DeviceEventType, DeviceInfo&&)> callback);
+
+    // Latency percentiles of one stage, over the swipes delivered since
+    // the manager was created or the last ResetStats
+    LatencySummary GetStageLatency(SwipeStage stage) const;
+
+    // Clear the latency statistics
+    void ResetStats();
+
+    // Counters of every device opened since the manager was created
+    std::vector<DeviceMetrics> GetMetrics() const;
+
+    // Send a command to an open device's feature report and hand the
+    // reader's response to callback. While the device is monitored its read
+    // thread runs queued commands between reads, so a batch sent together
+    // goes out back to back without stopping the read loop, and the
+    // callback runs on that thread; it must be cheap and must not close the
+    // device. Otherwise the command runs on the calling thread before this
+    // returns. A command not picked up by the time its timeout expires
+    // fails with CommandStatus::kTimedOut, its callback then running on the
+    // manager's deadline thread; one picked up in time runs to the end.
+    void SendCommand(const std::string& device_id, const DeviceCommand& command, CommandCallback callback);
+
+    // Save every input report the device's read thread receives, with its
+    // arrival time, to a capture file at path (report_capture.h), replacing
+    // any capture already running on it. False if the device isn't open or
+    // the file can't be created.
+    bool StartCapture(const std::string& device_id, const std::string& path);
+
+    // Stop capturing a device's reports and close the file
+    void StopCapture(const std::string& device_id);
+
+    // Check if vendor/product ID is a known Magtek reader
+    static bool IsMagtekDevice(unsigned short vendor_id, unsigned short product_id);
+
+    // Get device name from vendor/product ID
+    static std::string GetDeviceName(unsigned short vendor_id, unsigned short product_id);
+
+    // Install the decryptor every manager in the process uses for MagneSafe
+    // swipes, or remove it with an empty function. Process-wide so an
+    // in-process module can register it without a handle to the plugin.
+    static void SetTrackDecryptor(TrackDecryptor decryptor);
+
+    // Install a C decryptor, or remove it with a null function
+    static void SetTrackDecryptFunction(TrackDecryptFunction function, void* user_data);
+
+protected:
+    DeviceManagerCore();
+
+    // Initialize the platform's HID library
+    virtual bool InitializeHid() = 0;
+
+    // Release the platform's HID library
+    virtual void ShutdownHid() = 0;
+
+    // Enumerate Magtek devices on the bus
+    virtual std::vector<DeviceInfo> EnumerateDevices() = 0;
+
+    // Open a cached device for reading; nullptr on failure
+    virtual std::unique_ptr<HidConnection> OpenConnection(const DeviceInfo& info) = 0;
+
+    // Register for hotplug notifications; on each one the subclass calls
+    // RefreshDeviceCache(true) from a thread of its own
+    virtual void StartHotplugMonitor() = 0;
+
+    // Unregister hotplug notifications and stop their thread
+    virtual void StopHotplugMonitor() = 0;
+
+    // Whether hotplug notifications are keeping the device cache current
+    virtual bool IsHotplugActive() const = 0;
+
+    // Rescan the bus into the device cache, reporting arrivals and removals
+    // to the device event callback when notify is set
+    void RefreshDeviceCache(bool notify);
+
+private:
+    // Swipes each device can queue before the platform thread drains them
+    static const size_t SWIPE_QUEUE_CAPACITY = 16;
+
+    // Size of each pooled report buffer: a whole assembled frame, which is
+    // longer than a MagneSafe encrypted report
+    static const size_t REPORT_BUFFER_SIZE = SwipeAssembler::MAX_FRAME_SIZE;
+
+    // Pooled buffers per device, and per block when the pool has to grow:
+    // one for each queue slot plus the few the read path holds
+    static const size_t REPORT_BUFFERS_PER_DEVICE = SWIPE_QUEUE_CAPACITY + 4;
+
+    // A command's callback and deadline. Whoever claims it first answers
+    // the caller: the thread that picks the command up, or the deadline
+    // thread once the deadline passes with it still queued.
+    struct CommandTicket {
+        CommandCallback callback;
+        SwipeAssembler::Clock::time_point deadline;
+        std::atomic<bool> claimed;
+    };
+
+    // A command waiting for its device, and then its result
+    struct PendingCommand {
+        DeviceCommand command;
+        std::shared_ptr<CommandTicket> ticket;
+        // Whether this copy claimed the ticket, and so owes the callback
+        bool owned;
+        CommandResult result;
+    };
+
+    // An open reader and the state owned by its read path
+    struct DeviceSession {
+        std::string device_id;
+        unsigned short product_id;
+        // Sends MagneSafe encrypted reports
+        bool encrypting;
+        // Identifies the device again if it comes back under another ID
+        std::string serial_number;
+        // Length of the reader's command feature report
+        size_t feature_report_size;
+        std::unique_ptr<HidConnection> connection;
+        // Shared with every later session of the same device
+        std::shared_ptr<DeviceCounters> counters;
+        SwipeAssembler assembler;
+        ReportParser parser;
+        SwipeDeduplicator deduplicator;
+        // Reports are read straight into read_buffer and frames assembled
+        // into frame_buffer, both from the session's own pool; a swipe
+        // keeps the buffer it was parsed from, and the read path takes a
+        // fresh one. The pool is freed in one piece once the session and
+        // every swipe it produced are gone.
+        std::shared_ptr<ReportBufferPool> buffer_pool;
+        ReportBuffer read_buffer;
+        ReportBuffer frame_buffer;
+        // The swipe being parsed: the swipe queue's next slot, filled in
+        // place so queueing it copies nothing, or spare_card while the queue
+        // is full. Slots are reused, so their strings keep their capacity.
+        CardData* card_data;
+        CardData spare_card;
+        // Plaintext from the track decryptor, reused across swipes
+        std::string plaintext;
+        // When the read thread last received a report, for adaptive reads
+        SwipeAssembler::Clock::time_point last_report_time;
+        std::thread thread;
+        std::atomic<bool> running;
+        std::mutex wait_mutex;
+        std::condition_variable wait_cv;
+        // Set by a hotplug arrival to cut a reconnect backoff short;
+        // guarded by wait_mutex
+        bool reconnect_wakeup;
+        // Commands waiting to be run, oldest first; guarded by wait_mutex.
+        // commands_pending lets the read loop skip the lock when it's empty.
+        // While running, the read thread swaps connection only under
+        // wait_mutex, so a queued command can cancel its read.
+        std::deque<PendingCommand> commands;
+        std::atomic<bool> commands_pending;
+        // Set while capture_writer is; lets the read loop skip loading it
+        std::atomic<bool> capturing;
+        // Published with atomic_store; only the read thread writes to it
+        std::shared_ptr<ReportCaptureWriter> capture_writer;
+        // Filled by the read thread, drained by the platform thread
+        SpscRing<CardData, SWIPE_QUEUE_CAPACITY> swipe_queue;
+    };
+
+    // Open sessions keyed by device ID. Published snapshots are never
+    // modified; writers copy, edit and publish a new map.
+    typedef std::map<std::string, std::shared_ptr<DeviceSession>> SessionMap;
+
+    // Look up a device in the cache by ID
+    bool FindCachedDevice(const std::string& device_id, DeviceInfo* info);
+
+    // Scan the bus into the device cache unless a scan has already run
+    void EnsureDeviceCache();
+
+    // Open a remembered reader straight from its path; null if it isn't
+    // remembered, doesn't open, or opens as a reader with another serial
+    // number. Fills in info on success.
+    std::unique_ptr<HidConnection> OpenRememberedDevice(const std::string& device_id, DeviceInfo* info);
+
+    // Record a reader that was just opened in the identity cache, saving the
+    // file when that changed it
+    void RememberDevice(const DeviceInfo& info);
+
+    // Deliver a device event, and its own copy of the device, to the device
+    // event callback
+    void NotifyDeviceEvent(DeviceEventType type, DeviceInfo info);
+
+    // Report an open device as closed, unless it has already gone away;
+    // true if it was reported
+    bool NotifyClosed(const std::string& device_id);
+
+    // Current session snapshot; lock-free for readers
+    std::shared_ptr<const SessionMap> LoadSessions() const;
+
+    // Replace the session snapshot; caller holds control_mutex_
+    void PublishSessions(std::shared_ptr<const SessionMap> sessions);
+
+    // Current device cache snapshot; null until the first scan
+    std::shared_ptr<const std::vector<DeviceInfo>> LoadDeviceCache() const;
+
+    // Replace the device cache snapshot; caller holds refresh_mutex_
+    void PublishDeviceCache(std::shared_ptr<const std::vector<DeviceInfo>> devices);
+
+    // Point session.card_data at the slot the next swipe is parsed into
+    CardData& BeginSwipe(DeviceSession& session);
+
+    // Parse a swipe frame into session.card_data; false if it holds no tracks
+    bool ParseInputReport(DeviceSession& session, const ReportBuffer& frame);
+
+    // Parse a MagneSafe encrypted report into session.card_data, decrypting
+    // its tracks when a decryptor is installed; false if it is malformed
+    bool ParseEncryptedReport(DeviceSession& session, const ReportBuffer& buffer);
+
+    // Decode one of a swipe's tracks into its track_fields
+    static TrackStatus ParseTrackData(CardData& card_data, int track_number, char lrc);
+
+    // Fill in a swipe's raw response from its frame, as the raw response
+    // mode says
+    void AssignRawResponse(CardData& card_data);
+
+    // Start a session's read thread
+    void StartSession(DeviceSession& session);
+
+    // Stop a session's read thread and wait for it to exit
+    void StopSession(DeviceSession& session);
+
+    // Stop and close a session, leaving any swipes it still has queued to
+    // the next DrainCardSwipes; the session must already be unpublished
+    void CloseSession(const std::shared_ptr<DeviceSession>& session);
+
+    // Hand a session's queued swipes to the card swipe callback, stamping
+    // and recording their delivery; caller holds drain_mutex_
+    void DeliverQueuedSwipes(DeviceSession& session);
+
+    // Per-device monitoring thread function
+    void MonitoringThread(DeviceSession* session);
+
+    // Replace a session's dead connection, retrying with exponential backoff
+    // until the device opens again or the session stops; runs on the
+    // session's read thread
+    void ReconnectSession(DeviceSession& session);
+
+    // Find the cached device a lost session should reopen: the same ID, or
+    // failing that the same product and serial number
+    bool FindReconnectTarget(const DeviceSession& session, DeviceInfo* info);
+
+    // Take every command queued for a session, oldest first, claiming
+    // those whose deadline hasn't passed; the rest time out
+    std::deque<PendingCommand> TakeCommands(DeviceSession& session);
+
+    // Run taken commands, filling in their results. Only the session's read
+    // thread, the call that just stopped it, or a caller holding
+    // control_mutex_ while it has none may touch its connection.
+    void RunCommands(DeviceSession& session, std::deque<PendingCommand>& commands);
+
+    // Have the deadline thread time out a queued command's ticket unless
+    // it is claimed first, starting the thread if need be
+    void WatchDeadline(const std::shared_ptr<CommandTicket>& ticket);
+
+    // Stop the deadline thread, once no command can be queued any more
+    void StopDeadlineThread();
+
+    // Answer each watched ticket still unclaimed at its deadline
+    void DeadlineThread();
+
+    // Send one command and read back its response into command.result
+    void ExecuteCommand(DeviceSession& session, PendingCommand& command);
+
+    // Hand each owned command's result to its callback
+    static void CompleteCommands(std::deque<PendingCommand>& commands);
+
+    // Take, run and complete a session's queued commands on its read thread
+    void ServiceCommands(DeviceSession& session);
+
+    // Give the read path fresh pool buffers in place of any that swipes
+    // still hold
+    void PrepareReadBuffers(DeviceSession& session);
+
+    // Read data from HID device, waiting up to timeout_ms for a report
+    bool ReadFromDevice(DeviceSession& session, int timeout_ms);
+
+    // Parse the frame the assembler just completed and queue it for the
+    // platform thread
+    void DispatchFrame(DeviceSession& session);
+
+    // Parse a MagneSafe encrypted report and queue it for the platform thread
+    void DispatchEncryptedReport(DeviceSession& session, const ReportBuffer& report);
+
+    // Queue the swipe parsed into session.card_data, unless it is rejected
+    void QueueSwipe(DeviceSession& session, SwipeAssembler::Clock::time_point first_report_time,
+                    SwipeAssembler::Clock::time_point frame_complete_time);
+
+    // Open devices. Read threads take no locks; control calls serialize on
+    // control_mutex_ but never hold it across a device open or thread join
+    // of a closed device, and queries load the snapshot without it.
+    std::shared_ptr<const SessionMap> sessions_;
+    std::atomic<bool> is_monitoring_;
+    std::mutex control_mutex_;
+    // Serializes consumers of the per-session swipe queues
+    std::mutex drain_mutex_;
+    // Closed sessions whose queued swipes have not been drained yet;
+    // guarded by drain_mutex_
+    std::vector<std::shared_ptr<DeviceSession>> retired_sessions_;
+    std::atomic<ReadMode> read_mode_;
+    std::atomic<int> adaptive_idle_after_ms_;
+    std::atomic<int> adaptive_idle_interval_ms_;
+    std::atomic<RawResponseMode> raw_response_mode_;
+    std::atomic<bool> reject_invalid_swipes_;
+    std::atomic<int> duplicate_swipe_window_ms_;
+
+    std::function<void(CardData&&)> card_swipe_callback_;
+    std::function<void()> swipe_queued_callback_;
+    std::function<bool(const CardData&)> swipe_listener_;
+    std::function<void(DeviceEventType, DeviceInfo&&)> device_event_callback_;
+
+    // Tickets of queued commands by deadline, for the deadline thread,
+    // which starts with the first queued command and stops in Cleanup;
+    // all guarded by deadline_mutex_
+    std::multimap<SwipeAssembler::Clock::time_point, std::shared_ptr<CommandTicket>> deadlines_;
+    bool deadline_stopping_;
+    std::thread deadline_thread_;
+    std::mutex deadline_mutex_;
+    std::condition_variable deadline_cv_;
+
+    // Enumeration cache, kept current by hotplug notifications. Scans run
+    // unlocked; refresh_mutex_ only orders their commits, and a scan that
+    // finishes after a later one is discarded.
+    std::shared_ptr<const std::vector<DeviceInfo>> device_cache_;
+    std::atomic<unsigned long long> scan_sequence_;
+    unsigned long long committed_scan_;
+    std::mutex refresh_mutex_;
+
+    // Readers opened in this run and earlier ones, and the file they are
+    // kept in; both guarded by identities_mutex_
+    std::string identity_cache_path_;
+    std::unique_ptr<DeviceIdentityCache> identities_;
+    std::mutex identities_mutex_;
+
+    // Stage latencies of delivered swipes; lock-free
+    SwipeLatencyStats latency_stats_;
+
+    // Counters by device ID, created on a device's first open and kept
+    // after it closes. The map is guarded by counters_mutex_; the counters
+    // themselves are atomics.
+    std::map<std::string, std::shared_ptr<DeviceCounters>> counters_;
+    mutable std::mutex counters_mutex_;
+};
+
+#endif  // MAGTEK_DEVICE_MANAGER_CORE_H_
@@ -0,0 +1,75 @@
+#ifndef MAGTEK_DEVICE_METRICS_H_
+#define MAGTEK_DEVICE_METRICS_H_
+
+#include <atomic>
+#include <string>
+
+// Point-in-time copy of one device's counters, as returned by GetMetrics
+struct DeviceMetrics {
+    std::string device_id;
+    // Input reports returned by the HID read
+    unsigned long long reports_read;
+    // Bytes in those reports
+    unsigned long long bytes_read;
+    // Frames that yielded at least one track and were queued
+    unsigned long long swipes_parsed;
+    // Frames completed by the inter-report gap timeout rather than an end
+    // marker or length header
+    unsigned long long partial_frames;
+    // Frames in which no track was found
+    unsigned long long invalid_frames;
+    // Failed HID reads
+    unsigned long long read_errors;
+    // Swipes dropped because the platform thread fell behind
+    unsigned long long queue_overflows;
+    // Swipes dropped as repeats of the one before
+    unsigned long long duplicate_swipes;
+    // Times the device was opened again after its first open, whether by a
+    // caller or by the read thread after a read error
+    unsigned long long reconnects;
+};
+
+// Live counters for one device. Only its read thread writes most of them, so
+// increments are relaxed atomic adds with no lock; they outlive the device's
+// sessions so the totals survive a reconnect.
+class DeviceCounters {
+public:
+    DeviceCounters()
+        : reports_read(0), bytes_read(0), swipes_parsed(0), partial_frames(0),
+          invalid_frames(0), read_errors(0), queue_overflows(0), duplicate_swipes(0),
+          reconnects(0) {}
+
+    DeviceCounters(const DeviceCounters&) = delete;
+    DeviceCounters& operator=(const DeviceCounters&) = delete;
+
+    static void Increment(std::atomic<unsigned long long>& counter, unsigned long long amount = 1) {
+        counter.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    DeviceMetrics Snapshot(const std::string& device_id) const {
+        DeviceMetrics metrics;
+        metrics.device_id = device_id;
+        metrics.reports_read = reports_read.load(std::memory_order_relaxed);
+        metrics.bytes_read = bytes_read.load(std::memory_order_relaxed);
+        metrics.swipes_parsed = swipes_parsed.load(std::memory_order_relaxed);
+        metrics.partial_frames = partial_frames.load(std::memory_order_relaxed);
+        metrics.invalid_frames = invalid_frames.load(std::memory_order_relaxed);
+        metrics.read_errors = read_errors.load(std::memory_order_relaxed);
+        metrics.queue_overflows = queue_overflows.load(std::memory_order_relaxed);
+        metrics.duplicate_swipes = duplicate_swipes.load(std::memory_order_relaxed);
+        metrics.reconnects = reconnects.load(std::memory_order_relaxed);
+        return metrics;
+    }
+
+    std::atomic<unsigned long long> reports_read;
+    std::atomic<unsigned long long> bytes_read;
+    std::atomic<unsigned long long> swipes_parsed;
+    std::atomic<unsigned long long> partial_frames;
+    std::atomic<unsigned long long> invalid_frames;
+    std::atomic<unsigned long long> read_errors;
+    std::atomic<unsigned long long> queue_overflows;
+    std::atomic<unsigned long long> duplicate_swipes;
+    std::atomic<unsigned long long> reconnects;
+};
+
+#endif  // MAGTEK_DEVICE_METRICS_H_
@@ -0,0 +1,120 @@
+#include "ffi_bridge.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "device_manager_core.h"
+#include "packed_swipe_codec.h"
+
+// Dart_CObject_kTypedData and Dart_TypedData_kUint8
+static const int32_t DART_COBJECT_TYPED_DATA = 7;
+static const int32_t DART_TYPED_DATA_UINT8 = 2;
+
+// The manager the exported queries read; guarded by g_manager_mutex so a
+// query never outlives it. Queries only load its snapshots, so the lock is
+// never held for long.
+static std::mutex g_manager_mutex;
+static DeviceManagerCore* g_manager = nullptr;
+
+// Swipe destination, read by the read threads without a lock. 0 is Dart's
+// ILLEGAL_PORT.
+static std::atomic<int64_t> g_swipe_port(0);
+static std::atomic<MagtekDartPostCObjectFunc> g_post_cobject(nullptr);
+
+// Copy a string into a fixed-size field; false if it doesn't fit
+static bool CopyString(const std::string& value, char* field) {
+    if (value.size() >= MAGTEK_FFI_STRING_SIZE) {
+        return false;
+    }
+    memcpy(field, value.c_str(), value.size() + 1);
+    return true;
+}
+
+// Post a swipe to the Dart port, if one is set; runs on a read thread
+static bool PostSwipe(const CardData& card_data) {
+    int64_t port = g_swipe_port.load();
+    MagtekDartPostCObjectFunc post_cobject = g_post_cobject.load();
+    if (port == 0 || !post_cobject) {
+        return false;
+    }
+
+    // The VM copies the bytes before returning, so each read thread keeps
+    // one buffer for every record it sends
+    thread_local std::vector<unsigned char> record;
+    EncodePackedSwipe(card_data, &record);
+
+    MagtekDartCObject message;
+    memset(&message, 0, sizeof(message));
+    message.type = DART_COBJECT_TYPED_DATA;
+    message.value.as_typed_data.type = DART_TYPED_DATA_UINT8;
+    message.value.as_typed_data.length = static_cast<intptr_t>(record.size());
+    message.value.as_typed_data.values = record.data();
+    return post_cobject(port, &message);
+}
+
+void FfiBridge::Attach(DeviceManagerCore* manager) {
+    std::lock_guard<std::mutex> lock(g_manager_mutex);
+    if (g_manager == manager) {
+        return;
+    }
+    g_manager = manager;
+    manager->SetSwipeListener(PostSwipe);
+}
+
+void FfiBridge::Detach(DeviceManagerCore* manager) {
+    std::lock_guard<std::mutex> lock(g_manager_mutex);
+    if (g_manager == manager) {
+        g_manager = nullptr;
+    }
+}
+
+int32_t magtek_ffi_version(void) {
+    return MAGTEK_FFI_VERSION;
+}
+
+int32_t magtek_ffi_is_connected(void) {
+    std::lock_guard<std::mutex> lock(g_manager_mutex);
+    return g_manager && g_manager->IsConnected() ? 1 : 0;
+}
+
+int32_t magtek_ffi_is_device_open(const char* device_id) {
+    std::lock_guard<std::mutex> lock(g_manager_mutex);
+    return g_manager && device_id && g_manager->IsDeviceOpen(device_id) ? 1 : 0;
+}
+
+int32_t magtek_ffi_get_connected_devices(MagtekFfiDevice* devices, int32_t capacity) {
+    std::lock_guard<std::mutex> lock(g_manager_mutex);
+    if (!g_manager) {
+        return -1;
+    }
+    std::shared_ptr<const std::vector<DeviceInfo>> cache = g_manager->GetCachedDevices();
+    if (!cache) {
+        return -1;
+    }
+
+    int32_t count = static_cast<int32_t>(cache->size());
+    for (int32_t i = 0; i < count && i < capacity; i++) {
+        const DeviceInfo& info = (*cache)[i];
+        MagtekFfiDevice& device = devices[i];
+        if (!CopyString(info.device_id, device.device_id) || !CopyString(info.device_name, device.device_name) ||
+            !CopyString(info.serial_number, device.serial_number) ||
+            !CopyString(info.device_path, device.device_path)) {
+            return -1;
+        }
+        device.vendor_id = info.vendor_id;
+        device.product_id = info.product_id;
+        device.is_connected = g_manager->IsDeviceOpen(info.device_id) ? 1 : 0;
+    }
+    return count;
+}
+
+void magtek_ffi_set_swipe_port(int64_t port, MagtekDartPostCObjectFunc post_cobject) {
+    // The function goes in first so a read thread that sees the port also
+    // sees a function to post with
+    if (port != 0) {
+        g_post_cobject = post_cobject;
+    }
+    g_swipe_port = post_cobject ? port : 0;
+}
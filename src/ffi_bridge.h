@@ -0,0 +1,97 @@
+#ifndef MAGTEK_FFI_BRIDGE_H_
+#define MAGTEK_FFI_BRIDGE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class DeviceManagerCore;
+
+// The functions below are exported from the plugin's shared library for the
+// dart:ffi binding in lib/src/native/, which calls them on the Dart thread
+// without the method codec or a hop to the platform thread. They are
+// defined in the core library next to FfiBridge, which the plugins call, so
+// the linker always keeps them in the plugin.
+#if defined(_WIN32)
+#define MAGTEK_FFI_EXPORT __declspec(dllexport)
+#else
+#define MAGTEK_FFI_EXPORT __attribute__((visibility("default")))
+#endif
+
+// Version of this ABI, bumped whenever a function or struct changes
+#define MAGTEK_FFI_VERSION 1
+
+// Longest string, NUL included, a MagtekFfiDevice field holds
+#define MAGTEK_FFI_STRING_SIZE 256
+
+// One reader from the enumeration cache; strings are NUL-terminated UTF-8
+typedef struct {
+    char device_id[MAGTEK_FFI_STRING_SIZE];
+    char device_name[MAGTEK_FFI_STRING_SIZE];
+    char serial_number[MAGTEK_FFI_STRING_SIZE];
+    char device_path[MAGTEK_FFI_STRING_SIZE];
+    uint16_t vendor_id;
+    uint16_t product_id;
+    int32_t is_connected;
+} MagtekFfiDevice;
+
+// The members of Dart_CObject (dart_native_api.h in the Dart SDK) that the
+// swipe port uses. The Dart API headers don't ship with the desktop
+// embedders, and this part of the layout is fixed by the VM's native API.
+typedef struct {
+    int32_t type;
+    union {
+        struct {
+            int32_t type;
+            intptr_t length;
+            const uint8_t* values;
+        } as_typed_data;
+        // As large as Dart_CObject's largest member, so the VM never reads
+        // past the end of ours
+        void* padding[5];
+    } value;
+} MagtekDartCObject;
+
+// Dart_PostCObject, as handed over by NativeApi.postCObject
+typedef bool (*MagtekDartPostCObjectFunc)(int64_t port, MagtekDartCObject* message);
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+MAGTEK_FFI_EXPORT int32_t magtek_ffi_version(void);
+
+// 1 if at least one reader is open, 0 if none or before initialize
+MAGTEK_FFI_EXPORT int32_t magtek_ffi_is_connected(void);
+
+// 1 if the reader with this ID is open, 0 if not
+MAGTEK_FFI_EXPORT int32_t magtek_ffi_is_device_open(const char* device_id);
+
+// Copy up to capacity readers from the enumeration cache into devices and
+// return how many are cached, which may be more than capacity. Returns -1
+// when the cache has to be rescanned, before initialize, or if a field
+// does not fit; the method channel answers those.
+MAGTEK_FFI_EXPORT int32_t magtek_ffi_get_connected_devices(MagtekFfiDevice* devices, int32_t capacity);
+
+// Post every swipe to a Dart native port as a packed swipe record
+// (packed_swipe_codec.h), straight from the reader's read thread, instead
+// of sending it on the event channel. A port of 0 goes back to the event
+// channel, as does any swipe the port can no longer take.
+MAGTEK_FFI_EXPORT void magtek_ffi_set_swipe_port(int64_t port, MagtekDartPostCObjectFunc post_cobject);
+
+#if defined(__cplusplus)
+}  // extern "C"
+#endif
+
+// Connects the exported functions to the plugin's device manager
+class FfiBridge {
+public:
+    // Serve the exported functions from manager and offer it the swipe
+    // port. Call when the manager is created, before it opens devices.
+    static void Attach(DeviceManagerCore* manager);
+
+    // Stop serving manager; call before destroying it. Waits for any
+    // exported call that is using it.
+    static void Detach(DeviceManagerCore* manager);
+};
+
+#endif  // MAGTEK_FFI_BRIDGE_H_
@@ -0,0 +1,58 @@
+#ifndef MAGTEK_FIXED_STRING_H_
+#define MAGTEK_FIXED_STRING_H_
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+// A string of at most Capacity characters kept inline, for fields with a
+// known maximum length such as magnetic stripe tracks. It never allocates,
+// so moving one is a plain copy of its bytes; assigning more than fits
+// keeps the first Capacity characters. Always NUL-terminated.
+template <size_t Capacity>
+class FixedString {
+public:
+    FixedString() : length_(0) {
+        chars_[0] = '\0';
+    }
+
+    void assign(const char* data, size_t length) {
+        length_ = length < Capacity ? length : Capacity;
+        memcpy(chars_, data, length_);
+        chars_[length_] = '\0';
+    }
+
+    void clear() {
+        length_ = 0;
+        chars_[0] = '\0';
+    }
+
+    const char* data() const { return chars_; }
+    const char* c_str() const { return chars_; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    static size_t capacity() { return Capacity; }
+
+    // A std::string copy, for APIs that need one
+    std::string str() const { return std::string(chars_, length_); }
+
+    bool operator==(const char* other) const {
+        return strlen(other) == length_ && memcmp(chars_, other, length_) == 0;
+    }
+
+    bool operator==(const std::string& other) const {
+        return other.size() == length_ && memcmp(chars_, other.data(), length_) == 0;
+    }
+
+private:
+    char chars_[Capacity + 1];
+    size_t length_;
+};
+
+template <size_t Capacity>
+std::ostream& operator<<(std::ostream& out, const FixedString<Capacity>& value) {
+    return out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+#endif  // MAGTEK_FIXED_STRING_H_
@@ -0,0 +1,35 @@
+#ifndef MAGTEK_HID_TRANSPORT_H_
+#define MAGTEK_HID_TRANSPORT_H_
+
+#include <memory>
+#include <vector>
+
+#include "device_manager_core.h"
+
+// A way of reaching the readers: how a platform manager lists them and
+// opens them as HidConnections. The manager keeps hotplug notifications to
+// itself, so a transport only answers its calls. Initialize and Shutdown
+// bracket every other call; in between, Enumerate and Open may be called
+// from several threads at once (control calls, hotplug rescans and read
+// threads reconnecting).
+class HidTransport {
+public:
+    virtual ~HidTransport() {}
+
+    // Short name for logs and configuration, e.g. "hidapi"
+    virtual const char* Name() const = 0;
+
+    // Set up whatever library or OS interface the transport uses; false if
+    // it can't be used
+    virtual bool Initialize() = 0;
+
+    virtual void Shutdown() = 0;
+
+    // List the Magtek readers present. device_path is what Open takes.
+    virtual std::vector<DeviceInfo> Enumerate() = 0;
+
+    // Open a listed reader; null if it can't be opened
+    virtual std::unique_ptr<HidConnection> Open(const DeviceInfo& info) = 0;
+};
+
+#endif  // MAGTEK_HID_TRANSPORT_H_
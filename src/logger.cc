@@ -0,0 +1,57 @@
+#include "logger.h"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+
+const unsigned LogRateLimiter::LINES_PER_WINDOW;
+const long long LogRateLimiter::WINDOW_MS;
+
+static std::atomic<int> g_log_level(static_cast<int>(LogLevel::kWarning));
+
+// Keeps lines from different threads whole
+static std::mutex g_log_mutex;
+
+static long long SteadyMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LogLevel Logger::Level() {
+    return static_cast<LogLevel>(g_log_level.load(std::memory_order_relaxed));
+}
+
+void Logger::SetLevel(LogLevel level) {
+    g_log_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void Logger::Write(LogLevel level, const std::string& message, unsigned suppressed) {
+    std::ostream& out = level == LogLevel::kError || level == LogLevel::kWarning ? std::cerr : std::cout;
+
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    out << message;
+    if (suppressed > 0) {
+        out << " (" << suppressed << " similar lines suppressed)";
+    }
+    out << std::endl;
+}
+
+LogRateLimiter::LogRateLimiter()
+    : window_start_ms_(SteadyMilliseconds()), lines_in_window_(0), suppressed_(0) {
+}
+
+bool LogRateLimiter::Allow(unsigned* suppressed) {
+    long long now = SteadyMilliseconds();
+    long long window_start = window_start_ms_.load(std::memory_order_relaxed);
+    if (now - window_start >= WINDOW_MS &&
+        window_start_ms_.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+        lines_in_window_.store(0, std::memory_order_relaxed);
+    }
+
+    if (lines_in_window_.fetch_add(1, std::memory_order_relaxed) >= LINES_PER_WINDOW) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+}
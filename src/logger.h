@@ -0,0 +1,74 @@
+#ifndef MAGTEK_LOGGER_H_
+#define MAGTEK_LOGGER_H_
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+// Severity of a log line, most severe first. A line is written when its
+// level is at or above the logger's, i.e. its value is not greater.
+enum class LogLevel {
+    // Nothing is logged
+    kOff,
+    kError,
+    kWarning,
+    kInfo,
+    kDebug,
+};
+
+// Process-wide leveled logger for the core and the platform adapters.
+// Errors and warnings go to stderr, the rest to stdout.
+class Logger {
+public:
+    // Current level; kWarning by default
+    static LogLevel Level();
+
+    static void SetLevel(LogLevel level);
+
+    static bool IsEnabled(LogLevel level) {
+        return level != LogLevel::kOff && static_cast<int>(level) <= static_cast<int>(Level());
+    }
+
+    // Write one line; use MAGTEK_LOG, which checks the level and the call
+    // site's rate limit first
+    static void Write(LogLevel level, const std::string& message, unsigned suppressed);
+};
+
+// Caps how often one call site may log, so a flapping reader can't flood
+// the output. Lock-free; a few lines over the cap may slip through when
+// threads race at a window boundary.
+class LogRateLimiter {
+public:
+    // Lines each call site may write per window
+    static const unsigned LINES_PER_WINDOW = 5;
+    static const long long WINDOW_MS = 1000;
+
+    LogRateLimiter();
+
+    // Whether this line may be written. When it may, *suppressed is set to
+    // the number of lines dropped since the last one written.
+    bool Allow(unsigned* suppressed);
+
+private:
+    std::atomic<long long> window_start_ms_;
+    std::atomic<unsigned> lines_in_window_;
+    std::atomic<unsigned> suppressed_;
+};
+
+// Log a line built with stream insertion, e.g.
+//   MAGTEK_LOG(LogLevel::kWarning, "Failed to open device: " << path);
+// When the level is disabled the message is never formatted.
+#define MAGTEK_LOG(level, message)                                                    \
+    do {                                                                              \
+        if (Logger::IsEnabled(level)) {                                               \
+            static LogRateLimiter magtek_log_limiter;                                 \
+            unsigned magtek_log_suppressed = 0;                                       \
+            if (magtek_log_limiter.Allow(&magtek_log_suppressed)) {                   \
+                std::ostringstream magtek_log_stream;                                 \
+                magtek_log_stream << message;                                         \
+                Logger::Write(level, magtek_log_stream.str(), magtek_log_suppressed); \
+            }                                                                         \
+        }                                                                             \
+    } while (0)
+
+#endif  // MAGTEK_LOGGER_H_
@@ -0,0 +1,71 @@
+#include "magnesafe_report.h"
+#include <cstring>
+
+const size_t MagneSafeReportParser::REPORT_SIZE;
+const size_t MagneSafeReportParser::MIN_REPORT_SIZE;
+const size_t MagneSafeReportParser::TRACK_DATA_SIZE;
+const size_t MagneSafeReportParser::MAGNEPRINT_SIZE;
+const size_t MagneSafeReportParser::SERIAL_SIZE;
+const size_t MagneSafeReportParser::KSN_SIZE;
+const size_t MagneSafeReportParser::SESSION_ID_SIZE;
+
+// Field offsets of the MagneSafe V5 HID input report
+static const size_t DECODE_STATUS_OFFSET = 0;
+static const size_t ENCRYPTED_LENGTH_OFFSET = 3;
+static const size_t CARD_ENCODE_TYPE_OFFSET = 6;
+static const size_t ENCRYPTED_DATA_OFFSET = 7;
+static const size_t CARD_STATUS_OFFSET = 343;
+static const size_t MAGNEPRINT_STATUS_OFFSET = 344;
+static const size_t MAGNEPRINT_LENGTH_OFFSET = 348;
+static const size_t MAGNEPRINT_DATA_OFFSET = 349;
+static const size_t SERIAL_OFFSET = 477;
+static const size_t ENCRYPTION_STATUS_OFFSET = 493;
+static const size_t KSN_OFFSET = 495;
+static const size_t MASKED_LENGTH_OFFSET = 505;
+static const size_t MASKED_DATA_OFFSET = 508;
+static const size_t SESSION_ID_OFFSET = 844;
+
+bool MagneSafeReportParser::Parse(const unsigned char* data, size_t length, MagneSafeReport* report) {
+    if (length < MIN_REPORT_SIZE) {
+        return false;
+    }
+
+    // Tracks sit in fixed-size slots, each with its used length up front
+    for (size_t i = 0; i < 3; i++) {
+        size_t encrypted_length = data[ENCRYPTED_LENGTH_OFFSET + i];
+        size_t masked_length = data[MASKED_LENGTH_OFFSET + i];
+        if (encrypted_length > TRACK_DATA_SIZE || masked_length > TRACK_DATA_SIZE) {
+            return false;
+        }
+
+        MagneSafeTrack& track = report->tracks[i];
+        track.decode_status = data[DECODE_STATUS_OFFSET + i];
+        track.encrypted = ByteView(data + ENCRYPTED_DATA_OFFSET + i * TRACK_DATA_SIZE, encrypted_length);
+        track.masked = ByteView(data + MASKED_DATA_OFFSET + i * TRACK_DATA_SIZE, masked_length);
+    }
+
+    size_t magneprint_length = data[MAGNEPRINT_LENGTH_OFFSET];
+    if (magneprint_length > MAGNEPRINT_SIZE) {
+        return false;
+    }
+
+    report->card_encode_type = data[CARD_ENCODE_TYPE_OFFSET];
+    report->card_status = data[CARD_STATUS_OFFSET];
+    // Multi-byte status fields are little-endian, like the rest of HID
+    report->magneprint_status = 0;
+    for (size_t i = 0; i < 4; i++) {
+        report->magneprint_status |= static_cast<unsigned long>(data[MAGNEPRINT_STATUS_OFFSET + i]) << (8 * i);
+    }
+    report->magneprint = ByteView(data + MAGNEPRINT_DATA_OFFSET, magneprint_length);
+
+    const unsigned char* serial = data + SERIAL_OFFSET;
+    const void* serial_end = memchr(serial, 0, SERIAL_SIZE);
+    report->device_serial =
+        ByteView(serial, serial_end ? static_cast<const unsigned char*>(serial_end) - serial : SERIAL_SIZE);
+
+    report->encryption_status = static_cast<unsigned short>(data[ENCRYPTION_STATUS_OFFSET] |
+                                                            (data[ENCRYPTION_STATUS_OFFSET + 1] << 8));
+    report->ksn = ByteView(data + KSN_OFFSET, KSN_SIZE);
+    report->encrypted_session_id = ByteView(data + SESSION_ID_OFFSET, SESSION_ID_SIZE);
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef MAGTEK_MAGNESAFE_REPORT_H_
+#define MAGTEK_MAGNESAFE_REPORT_H_
+
+#include <cstddef>
+
+#include "byte_view.h"
+
+// One track of a MagneSafe report
+struct MagneSafeTrack {
+    // 0 if the reader decoded the track; bit 0 set on a decode error
+    unsigned char decode_status;
+    // Track data encrypted under the DUKPT key of the report's KSN
+    ByteView encrypted;
+    // The track in ASCII with the account number masked
+    ByteView masked;
+};
+
+// Fields of a MagneSafe encrypted swipe, as sent by readers such as the
+// eDynamo and uDynamo
+struct MagneSafeReport {
+    MagneSafeTrack tracks[3];
+    unsigned char card_encode_type;
+    unsigned char card_status;
+    unsigned long magneprint_status;
+    // Encrypted MagnePrint card authentication data
+    ByteView magneprint;
+    // The reader's own serial number in ASCII, NUL padding removed
+    ByteView device_serial;
+    unsigned short encryption_status;
+    // DUKPT key serial number the tracks were encrypted under
+    ByteView ksn;
+    ByteView encrypted_session_id;
+};
+
+// Reads the fixed-offset HID input report MagneSafe readers send for an
+// encrypted swipe. The whole swipe arrives in one report, so unlike clear
+// swipes it needs no reassembly. The variable-length fields are views into
+// the parsed bytes, so parsing copies and allocates nothing, and the report
+// is only valid while those bytes are.
+class MagneSafeReportParser {
+public:
+    // Size of the full input report, and the shortest one that reaches the
+    // last field this parser reads
+    static const size_t REPORT_SIZE = 887;
+    static const size_t MIN_REPORT_SIZE = 852;
+
+    static const size_t TRACK_DATA_SIZE = 112;
+    static const size_t MAGNEPRINT_SIZE = 128;
+    static const size_t SERIAL_SIZE = 16;
+    static const size_t KSN_SIZE = 10;
+    static const size_t SESSION_ID_SIZE = 8;
+
+    // Whether a report of this length is an encrypted swipe rather than
+    // clear ASCII track data
+    static bool IsEncryptedReport(size_t length) {
+        return length >= MIN_REPORT_SIZE;
+    }
+
+    // Parse one report (no report ID byte). Returns false if it is too
+    // short or a length field overruns its data.
+    static bool Parse(const unsigned char* data, size_t length, MagneSafeReport* report);
+};
+
+#endif  // MAGTEK_MAGNESAFE_REPORT_H_
@@ -0,0 +1,29 @@
+#include "magtek_products.h"
+
+const size_t ProductIndex::BUCKETS;
+
+static constexpr ProductIndex PRODUCT_INDEX;
+
+static_assert(MAGTEK_PRODUCT_COUNT < 256, "ProductIndex slots hold at most 255 entries");
+static_assert(!PRODUCT_INDEX.HasCollision(),
+              "Two Magtek product IDs share a ProductIndex bucket; change Bucket() or BUCKETS");
+
+const ProductDescriptor* FindMagtekProduct(unsigned short product_id) {
+    return PRODUCT_INDEX.Find(product_id);
+}
+
+FramingRules GetFramingRules(const ProductDescriptor& product) {
+    FramingRules rules;
+
+    switch (product.layout) {
+        case ReportLayout::kPaddedMultiReport:
+            // These split a swipe across several zero-padded reports, so a
+            // padded end sentinel does not mean the swipe is over
+            rules.complete_on_padding = false;
+            break;
+        case ReportLayout::kPaddedSingleReport:
+            break;
+    }
+
+    return rules;
+}
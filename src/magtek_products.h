@@ -0,0 +1,89 @@
+#ifndef MAGTEK_PRODUCTS_H_
+#define MAGTEK_PRODUCTS_H_
+
+#include <cstddef>
+
+#include "swipe_assembler.h"
+
+// USB vendor ID shared by every Magtek reader
+constexpr unsigned short MAGTEK_VENDOR_ID = 0x0801;
+
+// How a reader lays a swipe out across HID input reports
+enum class ReportLayout {
+    // Tracks end in a '?' followed by zero padding once the swipe is over
+    kPaddedSingleReport,
+    // Zero-padded reports are sent mid-swipe too, so padding marks nothing
+    kPaddedMultiReport,
+};
+
+// Everything the managers need to know about one reader model
+struct ProductDescriptor {
+    unsigned short product_id;
+    const char* name;
+    ReportLayout layout;
+    // Sends MagneSafe encrypted reports rather than clear track data
+    bool encrypting;
+    // Length of the feature report that carries commands, without the
+    // report ID byte
+    unsigned char feature_report_size;
+};
+
+// Known Magtek readers. Adding a model means adding one entry here.
+constexpr ProductDescriptor MAGTEK_PRODUCTS[] = {
+    {0x0001, "Magtek Mini Swipe Reader", ReportLayout::kPaddedSingleReport, false, 24},
+    {0x0002, "Magtek USB Swipe Reader", ReportLayout::kPaddedSingleReport, false, 24},
+    {0x0003, "Magtek eDynamo", ReportLayout::kPaddedMultiReport, true, 60},
+    {0x0004, "Magtek uDynamo", ReportLayout::kPaddedSingleReport, true, 24},
+    {0x0010, "Magtek SureSwipe Reader", ReportLayout::kPaddedMultiReport, false, 24},
+};
+
+constexpr size_t MAGTEK_PRODUCT_COUNT = sizeof(MAGTEK_PRODUCTS) / sizeof(MAGTEK_PRODUCTS[0]);
+
+// Perfect hash from product ID to table entry, built at compile time.
+// Every entry sits in its home bucket, so a lookup is a single probe; the
+// static_assert in magtek_products.cc fails the build if a new entry
+// collides with an existing one.
+class ProductIndex {
+public:
+    static constexpr size_t BUCKETS = 32;
+
+    constexpr ProductIndex() : slots_(), collision_(false) {
+        for (size_t i = 0; i < MAGTEK_PRODUCT_COUNT; i++) {
+            size_t bucket = Bucket(MAGTEK_PRODUCTS[i].product_id);
+            if (slots_[bucket] != 0) {
+                collision_ = true;
+            }
+            slots_[bucket] = static_cast<unsigned char>(i + 1);
+        }
+    }
+
+    constexpr bool HasCollision() const {
+        return collision_;
+    }
+
+    // Table entry for a product ID, or nullptr if it is not a known reader
+    constexpr const ProductDescriptor* Find(unsigned short product_id) const {
+        unsigned char slot = slots_[Bucket(product_id)];
+        if (slot == 0 || MAGTEK_PRODUCTS[slot - 1].product_id != product_id) {
+            return nullptr;
+        }
+        return &MAGTEK_PRODUCTS[slot - 1];
+    }
+
+private:
+    static constexpr size_t Bucket(unsigned short product_id) {
+        return (product_id ^ (product_id >> 5) ^ (product_id >> 10)) & (BUCKETS - 1);
+    }
+
+    // Table index + 1, or 0 for an empty bucket
+    unsigned char slots_[BUCKETS];
+    bool collision_;
+};
+
+// Table entry for a Magtek product ID, or nullptr if it is not a known reader
+const ProductDescriptor* FindMagtekProduct(unsigned short product_id);
+
+// Framing rules matching a reader's report layout
+FramingRules GetFramingRules(const ProductDescriptor& product);
+
+#endif  // MAGTEK_PRODUCTS_H_
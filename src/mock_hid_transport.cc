@@ -0,0 +1,177 @@
+#include "mock_hid_transport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// Reads one mock reader's queued reports until it is removed
+class MockHidTransport::MockConnection : public HidConnection {
+public:
+    MockConnection(std::shared_ptr<State> state, const std::string& device_path, int generation)
+        : state_(state), device_path_(device_path), generation_(generation), read_cancelled_(false) {}
+
+    int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) override {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        MockDevice& device = state_->devices[device_path_];
+        state_->changed.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                 [this, &device] {
+                                     return !Live(device) || !device.reports.empty() || read_cancelled_;
+                                 });
+        read_cancelled_ = false;
+        if (!Live(device)) {
+            return -1;
+        }
+        if (device.reports.empty()) {
+            return 0;
+        }
+
+        std::vector<unsigned char> report = std::move(device.reports.front());
+        device.reports.pop_front();
+        size_t length = std::min(size, report.size());
+        memcpy(buffer, report.data(), length);
+        return static_cast<int>(length);
+    }
+
+    bool CanCancelRead() const override { return true; }
+
+    void CancelRead() override {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            read_cancelled_ = true;
+        }
+        state_->changed.notify_all();
+    }
+
+    int SendFeatureReport(const unsigned char* data, size_t length) override {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        MockDevice& device = state_->devices[device_path_];
+        if (!Live(device)) {
+            return -1;
+        }
+        device.sent_feature_reports.push_back(std::vector<unsigned char>(data, data + length));
+        return static_cast<int>(length);
+    }
+
+    int GetFeatureReport(unsigned char* buffer, size_t size) override {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        MockDevice& device = state_->devices[device_path_];
+        if (!Live(device) || device.feature_responses.empty() || device.feature_responses.front().size() > size) {
+            return -1;
+        }
+
+        std::vector<unsigned char> report = std::move(device.feature_responses.front());
+        device.feature_responses.pop_front();
+        memcpy(buffer, report.data(), report.size());
+        return static_cast<int>(report.size());
+    }
+
+    std::string LastError() override {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return Live(state_->devices[device_path_]) ? "No feature report queued" : "Device removed";
+    }
+
+    std::string SerialNumber() override {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->devices[device_path_].info.serial_number;
+    }
+
+private:
+    // Whether the reader is still the one this connection opened; caller
+    // holds the state mutex
+    bool Live(const MockDevice& device) const { return device.present && device.generation == generation_; }
+
+    std::shared_ptr<State> state_;
+    std::string device_path_;
+    int generation_;
+    // Set by CancelRead until a read returns; guarded by the state mutex
+    bool read_cancelled_;
+};
+
+MockHidTransport::MockHidTransport() : state_(std::make_shared<State>()) {
+    state_->enumerate_count = 0;
+}
+
+const char* MockHidTransport::Name() const {
+    return "mock";
+}
+
+bool MockHidTransport::Initialize() {
+    return true;
+}
+
+void MockHidTransport::Shutdown() {}
+
+std::vector<DeviceInfo> MockHidTransport::Enumerate() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->enumerate_count++;
+    std::vector<DeviceInfo> devices;
+    for (const auto& entry : state_->devices) {
+        if (entry.second.present) {
+            devices.push_back(entry.second.info);
+        }
+    }
+    return devices;
+}
+
+std::unique_ptr<HidConnection> MockHidTransport::Open(const DeviceInfo& info) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto it = state_->devices.find(info.device_path);
+    if (it == state_->devices.end() || !it->second.present) {
+        return nullptr;
+    }
+    it->second.open_count++;
+    return std::unique_ptr<HidConnection>(new MockConnection(state_, info.device_path, it->second.generation));
+}
+
+void MockHidTransport::AddDevice(const DeviceInfo& info) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    MockDevice& device = state_->devices[info.device_path];
+    device.info = info;
+    device.info.is_connected = false;
+    device.present = true;
+}
+
+void MockHidTransport::RemoveDevice(const std::string& device_path) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        auto it = state_->devices.find(device_path);
+        if (it == state_->devices.end()) {
+            return;
+        }
+        it->second.present = false;
+        it->second.generation++;
+        it->second.reports.clear();
+    }
+    state_->changed.notify_all();
+}
+
+void MockHidTransport::QueueReport(const std::string& device_path, const std::vector<unsigned char>& report) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->devices[device_path].reports.push_back(report);
+    }
+    state_->changed.notify_all();
+}
+
+void MockHidTransport::QueueFeatureResponse(const std::string& device_path,
+                                            const std::vector<unsigned char>& report) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->devices[device_path].feature_responses.push_back(report);
+}
+
+std::vector<std::vector<unsigned char>> MockHidTransport::SentFeatureReports(const std::string& device_path) const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto it = state_->devices.find(device_path);
+    return it == state_->devices.end() ? std::vector<std::vector<unsigned char>>() : it->second.sent_feature_reports;
+}
+
+int MockHidTransport::OpenCount(const std::string& device_path) const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto it = state_->devices.find(device_path);
+    return it == state_->devices.end() ? 0 : it->second.open_count;
+}
+
+int MockHidTransport::EnumerateCount() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->enumerate_count;
+}
@@ -0,0 +1,76 @@
+#ifndef MAGTEK_MOCK_HID_TRANSPORT_H_
+#define MAGTEK_MOCK_HID_TRANSPORT_H_
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hid_transport.h"
+
+// An in-memory transport for tests: readers are added and removed by hand,
+// and their connections hand out whatever input reports are queued for
+// them. Thread-safe, so a test can keep driving it after giving it to a
+// manager; its open connections share its state and may outlive it.
+class MockHidTransport : public HidTransport {
+public:
+    MockHidTransport();
+
+    const char* Name() const override;
+    bool Initialize() override;
+    void Shutdown() override;
+    std::vector<DeviceInfo> Enumerate() override;
+    std::unique_ptr<HidConnection> Open(const DeviceInfo& info) override;
+
+    // List a reader, keyed by its device_path
+    void AddDevice(const DeviceInfo& info);
+
+    // Unlist a reader. Reads on the connections opened so far fail from now
+    // on, even if it is added again.
+    void RemoveDevice(const std::string& device_path);
+
+    // Queue an input report for the reader's connections to read
+    void QueueReport(const std::string& device_path, const std::vector<unsigned char>& report);
+
+    // Queue the feature report the reader answers its next GetFeatureReport
+    // with, report ID byte first
+    void QueueFeatureResponse(const std::string& device_path, const std::vector<unsigned char>& report);
+
+    // The feature reports sent to the reader so far, oldest first
+    std::vector<std::vector<unsigned char>> SentFeatureReports(const std::string& device_path) const;
+
+    // How many times the reader has been opened
+    int OpenCount(const std::string& device_path) const;
+
+    // How many times the readers have been listed
+    int EnumerateCount() const;
+
+private:
+    struct MockDevice {
+        DeviceInfo info;
+        bool present = false;
+        // Bumped on removal, retiring the connections opened before
+        int generation = 0;
+        int open_count = 0;
+        std::deque<std::vector<unsigned char>> reports;
+        std::deque<std::vector<unsigned char>> feature_responses;
+        std::vector<std::vector<unsigned char>> sent_feature_reports;
+    };
+
+    struct State {
+        std::mutex mutex;
+        // Signalled when a report is queued or a reader removed
+        std::condition_variable changed;
+        std::map<std::string, MockDevice> devices;
+        int enumerate_count;
+    };
+
+    class MockConnection;
+
+    std::shared_ptr<State> state_;
+};
+
+#endif  // MAGTEK_MOCK_HID_TRANSPORT_H_
@@ -0,0 +1,150 @@
+#ifndef MAGTEK_PACKED_SWIPE_CODEC_H_
+#define MAGTEK_PACKED_SWIPE_CODEC_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Packed binary encoding of a card swipe event, the compact alternative to
+// the string-keyed event map. Decoded by MethodChannelMagtekCardReader.
+//
+// Version 3 layout, all integers little-endian:
+//   u8   version (PACKED_SWIPE_VERSION)
+//   u8   flags (PACKED_SWIPE_RAW_HEX / PACKED_SWIPE_RAW_BYTES /
+//        PACKED_SWIPE_ENCRYPTED)
+//   i64  timestamp, milliseconds since the epoch
+//   then track1, track2, track3, device_id and the raw response, each as a
+//   u16 length followed by that many bytes. The raw response is the hex
+//   string or the frame bytes, as the flags say; its length is 0 for none.
+//   then five i64 monotonic nanosecond stage timestamps (SwipeTimings, in
+//   declaration order).
+//   then u8 SwipeValidation, and for each of track1-3 a u8 TrackStatus
+//   followed by the primary account number, cardholder name, expiration
+//   date, service code, discretionary data and additional data as fields.
+//   then, only with PACKED_SWIPE_ENCRYPTED, the MagneSafe fields: u8
+//   decrypted, then the KSN, device serial, encrypted track1-3 and
+//   MagnePrint as fields, u32 MagnePrint status, u16 encryption status and
+//   the encrypted session ID as a field.
+// Version 2 is the same without the decoded fields, and version 1 also
+// without the stage timestamps.
+constexpr unsigned char PACKED_SWIPE_VERSION = 3;
+constexpr unsigned char PACKED_SWIPE_RAW_HEX = 0x01;
+constexpr unsigned char PACKED_SWIPE_RAW_BYTES = 0x02;
+constexpr unsigned char PACKED_SWIPE_ENCRYPTED = 0x04;
+
+namespace packed_swipe_internal {
+
+inline void AppendField(const unsigned char* data, size_t length, std::vector<unsigned char>* out) {
+    // Longer than any swipe frame can be; clamp rather than corrupt the record
+    if (length > 0xFFFF) {
+        length = 0xFFFF;
+    }
+    out->push_back(static_cast<unsigned char>(length & 0xFF));
+    out->push_back(static_cast<unsigned char>(length >> 8));
+    out->insert(out->end(), data, data + length);
+}
+
+inline void AppendField(const std::string& value, std::vector<unsigned char>* out) {
+    AppendField(reinterpret_cast<const unsigned char*>(value.data()), value.size(), out);
+}
+
+inline void AppendUnsigned(unsigned long long value, int bytes, std::vector<unsigned char>* out) {
+    for (int i = 0; i < bytes; i++) {
+        out->push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+inline void AppendInt64(long long value, std::vector<unsigned char>* out) {
+    AppendUnsigned(static_cast<unsigned long long>(value), 8, out);
+}
+
+// Other byte and text fields: std::vector<unsigned char>, ByteView,
+// FixedString, or anything else with data() and size()
+template <typename Bytes>
+inline void AppendField(const Bytes& value, std::vector<unsigned char>* out) {
+    AppendField(reinterpret_cast<const unsigned char*>(value.data()), value.size(), out);
+}
+
+}  // namespace packed_swipe_internal
+
+// Encode a swipe into out, replacing its contents. Card is CardData, or
+// anything else with its fields.
+template <typename Card>
+void EncodePackedSwipe(const Card& card, std::vector<unsigned char>* out) {
+    using packed_swipe_internal::AppendField;
+    using packed_swipe_internal::AppendInt64;
+    using packed_swipe_internal::AppendUnsigned;
+
+    unsigned char flags = 0;
+    if (!card.raw_response.empty()) {
+        flags |= PACKED_SWIPE_RAW_HEX;
+    } else if (!card.raw_bytes.empty()) {
+        flags |= PACKED_SWIPE_RAW_BYTES;
+    }
+    if (card.encrypted) {
+        flags |= PACKED_SWIPE_ENCRYPTED;
+    }
+
+    out->clear();
+    // The decoded fields are pieces of the tracks, so they need no more room
+    // than the tracks themselves
+    size_t tracks_size = card.track1.size() + card.track2.size() + card.track3.size();
+    size_t encrypted_size = 0;
+    if (flags & PACKED_SWIPE_ENCRYPTED) {
+        const auto& report = card.magnesafe;
+        encrypted_size = 1 + 7 * 2 + 4 + 2 + report.ksn.size() + report.device_serial.size() +
+                         report.tracks[0].encrypted.size() + report.tracks[1].encrypted.size() +
+                         report.tracks[2].encrypted.size() + report.magneprint.size() +
+                         report.encrypted_session_id.size();
+    }
+    out->reserve(10 + 5 * 2 + 5 * 8 + 1 + 3 * (1 + 6 * 2) + 2 * tracks_size + card.device_id.size() +
+                 card.raw_response.size() + card.raw_bytes.size() + encrypted_size);
+
+    out->push_back(PACKED_SWIPE_VERSION);
+    out->push_back(flags);
+
+    AppendInt64(card.timestamp, out);
+
+    AppendField(card.track1, out);
+    AppendField(card.track2, out);
+    AppendField(card.track3, out);
+    AppendField(card.device_id, out);
+    if (flags & PACKED_SWIPE_RAW_HEX) {
+        AppendField(card.raw_response, out);
+    } else {
+        AppendField(card.raw_bytes, out);
+    }
+
+    AppendInt64(card.timings.first_report_ns, out);
+    AppendInt64(card.timings.frame_complete_ns, out);
+    AppendInt64(card.timings.parsed_ns, out);
+    AppendInt64(card.timings.queued_ns, out);
+    AppendInt64(card.timings.delivered_ns, out);
+
+    out->push_back(static_cast<unsigned char>(card.validation));
+    for (const auto& fields : card.track_fields) {
+        out->push_back(static_cast<unsigned char>(fields.status));
+        AppendField(fields.primary_account_number, out);
+        AppendField(fields.cardholder_name, out);
+        AppendField(fields.expiration_date, out);
+        AppendField(fields.service_code, out);
+        AppendField(fields.discretionary_data, out);
+        AppendField(fields.additional_data, out);
+    }
+
+    if (flags & PACKED_SWIPE_ENCRYPTED) {
+        const auto& report = card.magnesafe;
+        out->push_back(card.decrypted ? 1 : 0);
+        AppendField(report.ksn, out);
+        AppendField(report.device_serial, out);
+        for (const auto& track : report.tracks) {
+            AppendField(track.encrypted, out);
+        }
+        AppendField(report.magneprint, out);
+        AppendUnsigned(report.magneprint_status, 4, out);
+        AppendUnsigned(report.encryption_status, 2, out);
+        AppendField(report.encrypted_session_id, out);
+    }
+}
+
+#endif  // MAGTEK_PACKED_SWIPE_CODEC_H_
@@ -0,0 +1,105 @@
+#include "report_buffer_pool.h"
+
+#include "logger.h"
+
+ReportBuffer::ReportBuffer(const ReportBuffer& other) : slot_(other.slot_) {
+    if (slot_) {
+        slot_->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+ReportBuffer& ReportBuffer::operator=(const ReportBuffer& other) {
+    if (this != &other) {
+        ReportBuffer copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+ReportBuffer& ReportBuffer::operator=(ReportBuffer&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        slot_ = other.slot_;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+void ReportBuffer::Reset() {
+    if (!slot_) {
+        return;
+    }
+    ReportBufferSlot* slot = slot_;
+    slot_ = nullptr;
+    if (slot->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Dropping the slot's hold on the pool may free it, and the slot
+        // with it, so that waits until the slot is back on the free list
+        std::shared_ptr<ReportBufferPool> pool = std::move(slot->pool);
+        pool->Release(slot);
+    }
+}
+
+size_t ReportBuffer::capacity() const {
+    return slot_ ? slot_->pool->BufferSize() : 0;
+}
+
+std::shared_ptr<ReportBufferPool> ReportBufferPool::Create(size_t buffer_size, size_t buffers_per_block) {
+    return std::shared_ptr<ReportBufferPool>(new ReportBufferPool(buffer_size, buffers_per_block));
+}
+
+ReportBufferPool::ReportBufferPool(size_t buffer_size, size_t buffers_per_block)
+    : buffer_size_(buffer_size), buffers_per_block_(buffers_per_block > 0 ? buffers_per_block : 1),
+      free_list_(nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AddBlock();
+}
+
+ReportBuffer ReportBufferPool::Acquire() {
+    ReportBufferSlot* slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_list_) {
+            AddBlock();
+        }
+        slot = free_list_;
+        free_list_ = slot->next_free;
+    }
+
+    slot->next_free = nullptr;
+    slot->size = 0;
+    slot->references.store(1, std::memory_order_relaxed);
+    slot->pool = shared_from_this();
+    return ReportBuffer(slot);
+}
+
+size_t ReportBufferPool::BufferCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.size() * buffers_per_block_;
+}
+
+void ReportBufferPool::AddBlock() {
+    Block block;
+    block.slots.reset(new ReportBufferSlot[buffers_per_block_]);
+    block.storage.reset(new unsigned char[buffers_per_block_ * buffer_size_]);
+    for (size_t i = 0; i < buffers_per_block_; i++) {
+        ReportBufferSlot& slot = block.slots[i];
+        slot.data = block.storage.get() + i * buffer_size_;
+        slot.size = 0;
+        slot.references.store(0, std::memory_order_relaxed);
+        slot.next_free = free_list_;
+        free_list_ = &slot;
+    }
+    blocks_.push_back(std::move(block));
+
+    // Only a consumer holding on to swipes gets past the first block
+    if (blocks_.size() > 1) {
+        MAGTEK_LOG(LogLevel::kDebug, "Report buffer pool grew to " << blocks_.size() * buffers_per_block_
+                                                                   << " buffers");
+    }
+}
+
+void ReportBufferPool::Release(ReportBufferSlot* slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot->next_free = free_list_;
+    free_list_ = slot;
+}
@@ -0,0 +1,115 @@
+#ifndef MAGTEK_REPORT_BUFFER_POOL_H_
+#define MAGTEK_REPORT_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "byte_view.h"
+
+class ReportBufferPool;
+
+// One buffer of a pool; only ReportBuffer and ReportBufferPool touch it
+struct ReportBufferSlot {
+    unsigned char* data;
+    size_t size;
+    std::atomic<int> references;
+    // Keeps the pool alive while the buffer is handed out
+    std::shared_ptr<ReportBufferPool> pool;
+    ReportBufferSlot* next_free;
+};
+
+// A reference-counted handle to one buffer of a ReportBufferPool. Copies
+// share the buffer without allocating, so a swipe can carry the frame it
+// was parsed from across threads; the buffer goes back to its pool when
+// the last handle lets go. Write to it only while IsUnique, before it has
+// been shared.
+class ReportBuffer {
+public:
+    ReportBuffer() : slot_(nullptr) {}
+    ReportBuffer(const ReportBuffer& other);
+    ReportBuffer(ReportBuffer&& other) noexcept : slot_(other.slot_) { other.slot_ = nullptr; }
+    ReportBuffer& operator=(const ReportBuffer& other);
+    ReportBuffer& operator=(ReportBuffer&& other) noexcept;
+    ~ReportBuffer() { Reset(); }
+
+    // Drop this handle's reference, leaving it empty
+    void Reset();
+
+    // Whether this is the buffer's only handle
+    bool IsUnique() const {
+        return slot_ && slot_->references.load(std::memory_order_acquire) == 1;
+    }
+
+    // The bytes in use; none for an empty handle
+    const unsigned char* data() const { return slot_ ? slot_->data : nullptr; }
+    size_t size() const { return slot_ ? slot_->size : 0; }
+    bool empty() const { return size() == 0; }
+
+    // The whole buffer, for filling; capacity() bytes long
+    unsigned char* mutable_data() { return slot_ ? slot_->data : nullptr; }
+    size_t capacity() const;
+
+    // Mark the first size bytes as in use, after filling them
+    void SetSize(size_t size) { slot_->size = size; }
+
+    // size bytes at offset, which must lie within the bytes in use
+    ByteView View(size_t offset, size_t size) const { return ByteView(data() + offset, size); }
+
+private:
+    friend class ReportBufferPool;
+
+    explicit ReportBuffer(ReportBufferSlot* slot) : slot_(slot) {}
+
+    ReportBufferSlot* slot_;
+};
+
+// A per-device arena of equally sized report buffers. Buffers are carved
+// out of blocks allocated a whole block at a time, and handed out and
+// returned through a free list, so once the first block covers the
+// buffers in flight nothing is allocated per report. The blocks are freed
+// together when the pool's owner and every outstanding buffer have let go.
+class ReportBufferPool : public std::enable_shared_from_this<ReportBufferPool> {
+public:
+    // A pool of buffer_size-byte buffers that grows buffers_per_block at a time
+    static std::shared_ptr<ReportBufferPool> Create(size_t buffer_size, size_t buffers_per_block);
+
+    ReportBufferPool(const ReportBufferPool&) = delete;
+    ReportBufferPool& operator=(const ReportBufferPool&) = delete;
+
+    // A buffer no other handle references, with size 0. Adds a block when
+    // every buffer is in use, so it never fails.
+    ReportBuffer Acquire();
+
+    size_t BufferSize() const { return buffer_size_; }
+
+    // Buffers allocated so far, whether handed out or free
+    size_t BufferCount() const;
+
+private:
+    friend class ReportBuffer;
+
+    // Buffers and the storage behind them, allocated together
+    struct Block {
+        std::unique_ptr<ReportBufferSlot[]> slots;
+        std::unique_ptr<unsigned char[]> storage;
+    };
+
+    ReportBufferPool(size_t buffer_size, size_t buffers_per_block);
+
+    // Carve another block into free buffers; caller holds mutex_
+    void AddBlock();
+
+    // Put a buffer whose last handle let go back on the free list
+    void Release(ReportBufferSlot* slot);
+
+    const size_t buffer_size_;
+    const size_t buffers_per_block_;
+    mutable std::mutex mutex_;
+    std::vector<Block> blocks_;
+    ReportBufferSlot* free_list_;
+};
+
+#endif  // MAGTEK_REPORT_BUFFER_POOL_H_
@@ -0,0 +1,132 @@
+#include "report_capture.h"
+
+#include <cstring>
+
+static const char CAPTURE_MAGIC[4] = {'M', 'T', 'K', 'C'};
+static const size_t HEADER_SIZE = 7;
+static const size_t RECORD_HEADER_SIZE = 6;
+
+static void PutUnsigned(unsigned long value, int bytes, unsigned char* out) {
+    for (int i = 0; i < bytes; i++) {
+        out[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static unsigned long GetUnsigned(const unsigned char* data, int bytes) {
+    unsigned long value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<unsigned long>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+static void WriteBytes(std::ostream& out, const unsigned char* data, size_t length) {
+    out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(length));
+}
+
+static bool ReadBytes(std::istream& in, unsigned char* data, size_t length) {
+    in.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(length));
+    return static_cast<size_t>(in.gcount()) == length;
+}
+
+static void WriteHeader(std::ostream& out, unsigned short product_id) {
+    unsigned char header[HEADER_SIZE];
+    memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header[4] = REPORT_CAPTURE_VERSION;
+    PutUnsigned(product_id, 2, header + 5);
+    WriteBytes(out, header, sizeof(header));
+}
+
+// Write one report record, clamping what doesn't fit its fields
+static void WriteRecord(std::ostream& out, long long delta_us, const unsigned char* data, size_t length) {
+    if (delta_us < 0) {
+        delta_us = 0;
+    } else if (delta_us > 0xFFFFFFFFLL) {
+        delta_us = 0xFFFFFFFFLL;
+    }
+    if (length > 0xFFFF) {
+        length = 0xFFFF;
+    }
+
+    unsigned char header[RECORD_HEADER_SIZE];
+    PutUnsigned(static_cast<unsigned long>(delta_us), 4, header);
+    PutUnsigned(static_cast<unsigned long>(length), 2, header + 4);
+    WriteBytes(out, header, sizeof(header));
+    WriteBytes(out, data, length);
+}
+
+bool ReportCapture::Load(const std::string& path, ReportCapture* capture) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    unsigned char header[HEADER_SIZE];
+    if (!in || !ReadBytes(in, header, sizeof(header)) || memcmp(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+        header[4] != REPORT_CAPTURE_VERSION) {
+        return false;
+    }
+    capture->product_id = static_cast<unsigned short>(GetUnsigned(header + 5, 2));
+    capture->reports.clear();
+
+    long long offset_us = 0;
+    unsigned char record[RECORD_HEADER_SIZE];
+    while (ReadBytes(in, record, sizeof(record))) {
+        CapturedReport report;
+        offset_us += GetUnsigned(record, 4);
+        report.offset_us = offset_us;
+        report.data.resize(GetUnsigned(record + 4, 2));
+        if (!ReadBytes(in, report.data.data(), report.data.size())) {
+            break;
+        }
+        capture->reports.push_back(std::move(report));
+    }
+    return true;
+}
+
+bool ReportCapture::Save(const std::string& path) const {
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    WriteHeader(out, product_id);
+    long long previous_us = 0;
+    for (const CapturedReport& report : reports) {
+        WriteRecord(out, report.offset_us - previous_us, report.data.data(), report.data.size());
+        previous_us = report.offset_us;
+    }
+    out.close();
+    return !out.fail();
+}
+
+ReportCaptureWriter::ReportCaptureWriter() : started_(false) {}
+
+ReportCaptureWriter::~ReportCaptureWriter() {
+    Close();
+}
+
+bool ReportCaptureWriter::Open(const std::string& path, unsigned short product_id) {
+    Close();
+    file_.clear();
+    file_.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    WriteHeader(file_, product_id);
+    if (!file_) {
+        Close();
+        return false;
+    }
+    start_ = Clock::now();
+    started_ = false;
+    return true;
+}
+
+void ReportCaptureWriter::Write(const unsigned char* data, size_t length, Clock::time_point time) {
+    if (!file_.is_open()) {
+        return;
+    }
+
+    // The first report is timed from Open, the rest from each other
+    Clock::time_point previous = started_ ? last_ : start_;
+    WriteRecord(file_, std::chrono::duration_cast<std::chrono::microseconds>(time - previous).count(), data,
+                length);
+    last_ = time;
+    started_ = true;
+}
+
+void ReportCaptureWriter::Close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
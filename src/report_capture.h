@@ -0,0 +1,70 @@
+#ifndef MAGTEK_REPORT_CAPTURE_H_
+#define MAGTEK_REPORT_CAPTURE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary capture of the input reports a reader sent, so the swipe pipeline
+// can be replayed and measured without the reader (see report_replay.h).
+//
+// Layout, all integers little-endian:
+//   4 bytes "MTKC"
+//   u8   version (REPORT_CAPTURE_VERSION)
+//   u16  product ID of the reader
+//   then for each report: u32 microseconds since the previous report (since
+//   the capture started, for the first), u16 length, that many bytes.
+constexpr unsigned char REPORT_CAPTURE_VERSION = 1;
+
+// One report of a capture
+struct CapturedReport {
+    // Microseconds from the start of the capture
+    long long offset_us;
+    std::vector<unsigned char> data;
+};
+
+// A capture read back into memory
+struct ReportCapture {
+    unsigned short product_id;
+    std::vector<CapturedReport> reports;
+
+    // Read a capture file. Returns false if it can't be read or isn't a
+    // capture; a report cut short at the end of the file is dropped.
+    static bool Load(const std::string& path, ReportCapture* capture);
+
+    // Write the capture to a file; false on an I/O error
+    bool Save(const std::string& path) const;
+};
+
+// Appends reports to a capture file as they arrive. Not thread-safe; a
+// device's read thread is its only writer.
+class ReportCaptureWriter {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    ReportCaptureWriter();
+    ~ReportCaptureWriter();
+
+    ReportCaptureWriter(const ReportCaptureWriter&) = delete;
+    ReportCaptureWriter& operator=(const ReportCaptureWriter&) = delete;
+
+    // Create or truncate the file and write its header; false on failure
+    bool Open(const std::string& path, unsigned short product_id);
+
+    // Append one report received at time. Reports are buffered; Close, or
+    // destroying the writer, flushes them.
+    void Write(const unsigned char* data, size_t length, Clock::time_point time);
+
+    void Close();
+
+private:
+    std::ofstream file_;
+    Clock::time_point start_;
+    Clock::time_point last_;
+    // Whether a report has been written since Open
+    bool started_;
+};
+
+#endif  // MAGTEK_REPORT_CAPTURE_H_
@@ -0,0 +1,111 @@
+#include "report_parser.h"
+#include <cstring>
+
+#include "track_decoder.h"
+
+const int ReportParser::TRACK_COUNT;
+const size_t ReportParser::TRACK1_MAX_LENGTH;
+const size_t ReportParser::TRACK2_MAX_LENGTH;
+const size_t ReportParser::TRACK3_MAX_LENGTH;
+const size_t ReportParser::MAX_TEXT_SIZE;
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+ReportParser::ReportParser() : text_length_(0) {
+    for (int i = 0; i < TRACK_COUNT; i++) {
+        tracks_[i].offset = 0;
+        tracks_[i].length = 0;
+    }
+}
+
+bool ReportParser::Parse(const unsigned char* data, size_t length) {
+    text_length_ = 0;
+    for (int i = 0; i < TRACK_COUNT; i++) {
+        tracks_[i].length = 0;
+    }
+
+    // Magtek devices typically send card data in a specific format
+    // The exact format may vary by device model, but generally:
+    // - Byte 0: Report ID or status
+    // - Following bytes: Track data or encoded magnetic stripe data
+    if (length < 2) {
+        return false; // Not enough data
+    }
+    if (length > MAX_TEXT_SIZE + 1) {
+        length = MAX_TEXT_SIZE + 1;
+    }
+
+    for (size_t i = 1; i < length; i++) { // Skip first byte (report ID)
+        if (data[i] >= 0x20 && data[i] <= 0x7E) { // Printable ASCII
+            text_[text_length_++] = static_cast<char>(data[i]);
+        }
+    }
+
+    // Track 1: Starts with '%' (0x25), ends with '?' (0x3F)
+    // Track 2: Starts with ';' (0x3B), ends with '?' (0x3F)
+    // Track 3: Starts with ';' like track 2, or '+' on some readers. The
+    // readers send the tracks in order, so it is the next track after
+    // track 2; a swipe with track 3 alone reads as track 2.
+    tracks_[0] = FindTrack("%", 0);
+    tracks_[1] = FindTrack(";", 0);
+    size_t after_track2 = tracks_[1].length > 0 ? tracks_[1].offset + tracks_[1].length : 0;
+    tracks_[2] = FindTrack(tracks_[1].length > 0 ? ";+" : "+", after_track2);
+
+    return tracks_[0].length > 0 || tracks_[1].length > 0 || tracks_[2].length > 0;
+}
+
+const char* ReportParser::Text() const {
+    return text_;
+}
+
+TrackView ReportParser::Track(int track_number) const {
+    return tracks_[track_number - 1];
+}
+
+char ReportParser::TrackLrc(int track_number) const {
+    const TrackView& track = tracks_[track_number - 1];
+    size_t next = track.offset + track.length;
+    if (track.length == 0 || next >= text_length_) {
+        return 0;
+    }
+
+    // Another track's start sentinel is that track, not an LRC
+    char c = text_[next];
+    if (c == '%' || c == ';' || c == '+' || !TrackDecoder::IsTrackCharacter(track_number, c)) {
+        return 0;
+    }
+    return c;
+}
+
+void ReportParser::FormatHex(const unsigned char* data, size_t length, std::string* out) {
+    size_t start = out->size();
+    out->resize(start + length * 3);
+
+    char* p = &(*out)[start];
+    for (size_t i = 0; i < length; i++) {
+        *p++ = HEX_DIGITS[data[i] >> 4];
+        *p++ = HEX_DIGITS[data[i] & 0x0F];
+        *p++ = ' ';
+    }
+}
+
+TrackView ReportParser::FindTrack(const char* start_sentinels, size_t from) const {
+    TrackView track = {0, 0};
+
+    size_t offset = from;
+    while (offset < text_length_ && !strchr(start_sentinels, text_[offset])) {
+        offset++;
+    }
+    if (offset >= text_length_) {
+        return track;
+    }
+
+    const void* end = memchr(text_ + offset, '?', text_length_ - offset);
+    if (!end) {
+        return track;
+    }
+
+    track.offset = offset;
+    track.length = static_cast<const char*>(end) - (text_ + offset) + 1;
+    return track;
+}
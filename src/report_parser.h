@@ -0,0 +1,66 @@
+#ifndef MAGTEK_REPORT_PARSER_H_
+#define MAGTEK_REPORT_PARSER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "swipe_assembler.h"
+
+// Location of one track inside ReportParser::Text()
+struct TrackView {
+    size_t offset;
+    size_t length;
+};
+
+// Finds the tracks in an assembled swipe frame without allocating.
+//
+// The printable bytes of the frame are compacted into a buffer owned by the
+// parser, and tracks are returned as views into it. Keep one parser per
+// device and reuse it; views stay valid until the next Parse.
+class ReportParser {
+public:
+    static const int TRACK_COUNT = 3;
+    // Longest track 1-3 ISO 7811 allows, sentinels included
+    static const size_t TRACK1_MAX_LENGTH = 79;
+    static const size_t TRACK2_MAX_LENGTH = 40;
+    static const size_t TRACK3_MAX_LENGTH = 107;
+    static const size_t MAX_TEXT_SIZE = SwipeAssembler::MAX_REPORTS * SwipeAssembler::MAX_REPORT_SIZE;
+
+    ReportParser();
+
+    // Scan a frame (report ID first). Returns true if any track was found.
+    bool Parse(const unsigned char* data, size_t length);
+
+    // Printable bytes of the last frame, after the report ID
+    const char* Text() const;
+
+    // Track 1-3 of the last frame; empty if the track was not present
+    TrackView Track(int track_number) const;
+
+    // Copy a track into out, a std::string (reusing its capacity) or a
+    // FixedString
+    template <typename Out>
+    void AssignTrack(int track_number, Out* out) const {
+        const TrackView& track = tracks_[track_number - 1];
+        out->assign(text_ + track.offset, track.length);
+    }
+
+    // The character the reader sent after a track's end sentinel when it
+    // can be that track's LRC, or 0
+    char TrackLrc(int track_number) const;
+
+    // Append "xx " for every byte, as raw_response has always been formatted.
+    // Reserves once and uses a lookup table rather than iostreams.
+    static void FormatHex(const unsigned char* data, size_t length, std::string* out);
+
+private:
+    // Track from the first of the start sentinels at or after from through
+    // the next '?'
+    TrackView FindTrack(const char* start_sentinels, size_t from) const;
+
+    char text_[MAX_TEXT_SIZE];
+    size_t text_length_;
+    TrackView tracks_[TRACK_COUNT];
+};
+
+#endif  // MAGTEK_REPORT_PARSER_H_
@@ -0,0 +1,126 @@
+#include "report_replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+const char* const ReplayDeviceManager::REPLAY_DEVICE_ID = "replay";
+
+namespace {
+
+// Hands out a capture's reports in order, then reads nothing
+class ReplayConnection : public HidConnection {
+public:
+    ReplayConnection(std::shared_ptr<const ReportCapture> capture, ReplayPacing pacing, std::function<bool()> gate,
+                     std::shared_ptr<std::atomic<bool>> finished)
+        : capture_(capture), pacing_(pacing), gate_(gate), finished_(finished), next_(0), started_(false) {
+        *finished_ = capture_->reports.empty();
+    }
+
+    int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) override {
+        typedef std::chrono::steady_clock Clock;
+        if (next_ >= capture_->reports.size()) {
+            // Read timeouts are what complete a frame without an end marker
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+            return 0;
+        }
+
+        const CapturedReport& report = capture_->reports[next_];
+        if (pacing_ == ReplayPacing::kRecorded) {
+            // The first read starts the replay's clock
+            if (!started_) {
+                start_ = Clock::now() - std::chrono::microseconds(report.offset_us);
+                started_ = true;
+            }
+            Clock::time_point due = start_ + std::chrono::microseconds(report.offset_us);
+            Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+            if (due > deadline) {
+                std::this_thread::sleep_until(deadline);
+                return 0;
+            }
+            std::this_thread::sleep_until(due);
+        } else if (gate_) {
+            Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+            while (!gate_()) {
+                if (Clock::now() >= deadline) {
+                    return 0;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        size_t length = std::min(size, report.data.size());
+        memcpy(buffer, report.data.data(), length);
+        if (++next_ == capture_->reports.size()) {
+            *finished_ = true;
+        }
+        return static_cast<int>(length);
+    }
+
+    // A capture holds no command responses
+    int SendFeatureReport(const unsigned char*, size_t) override { return -1; }
+    int GetFeatureReport(unsigned char*, size_t) override { return -1; }
+
+    std::string LastError() override { return "Replayed readers take no commands"; }
+
+private:
+    std::shared_ptr<const ReportCapture> capture_;
+    ReplayPacing pacing_;
+    std::function<bool()> gate_;
+    std::shared_ptr<std::atomic<bool>> finished_;
+    size_t next_;
+    bool started_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace
+
+ReplayDeviceManager::ReplayDeviceManager(std::shared_ptr<const ReportCapture> capture, ReplayPacing pacing)
+    : capture_(capture), pacing_(pacing), finished_(std::make_shared<std::atomic<bool>>(false)) {}
+
+ReplayDeviceManager::~ReplayDeviceManager() {
+    Cleanup();
+}
+
+bool ReplayDeviceManager::Finished() const {
+    return finished_->load();
+}
+
+void ReplayDeviceManager::SetPaceGate(std::function<bool()> gate) {
+    pace_gate_ = gate;
+}
+
+bool ReplayDeviceManager::InitializeHid() {
+    return true;
+}
+
+void ReplayDeviceManager::ShutdownHid() {}
+
+std::vector<DeviceInfo> ReplayDeviceManager::EnumerateDevices() {
+    // Sessions take their framing rules from the product table
+    if (!FindMagtekProduct(capture_->product_id)) {
+        return {};
+    }
+
+    DeviceInfo info;
+    info.device_id = REPLAY_DEVICE_ID;
+    info.device_name = GetDeviceName(MAGTEK_VENDOR_ID, capture_->product_id);
+    info.vendor_id = MAGTEK_VENDOR_ID;
+    info.product_id = capture_->product_id;
+    info.device_path = REPLAY_DEVICE_ID;
+    info.is_connected = false;
+    return {info};
+}
+
+std::unique_ptr<HidConnection> ReplayDeviceManager::OpenConnection(const DeviceInfo&) {
+    return std::unique_ptr<HidConnection>(new ReplayConnection(capture_, pacing_, pace_gate_, finished_));
+}
+
+void ReplayDeviceManager::StartHotplugMonitor() {}
+
+void ReplayDeviceManager::StopHotplugMonitor() {}
+
+bool ReplayDeviceManager::IsHotplugActive() const {
+    return false;
+}
@@ -0,0 +1,56 @@
+#ifndef MAGTEK_REPORT_REPLAY_H_
+#define MAGTEK_REPORT_REPLAY_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "device_manager_core.h"
+#include "report_capture.h"
+
+// How a replayed capture is paced
+enum class ReplayPacing {
+    // Each report is handed out when it arrived relative to the first
+    kRecorded,
+    // Each report is handed out as soon as the read loop asks for one
+    kAsFastAsPossible,
+};
+
+// A device manager whose only reader replays a capture, for tests and the
+// pipeline benchmark. The reader is listed as REPLAY_DEVICE_ID with the
+// capture's product ID; every time it is opened, the replay starts over.
+class ReplayDeviceManager : public DeviceManagerCore {
+public:
+    static const char* const REPLAY_DEVICE_ID;
+
+    ReplayDeviceManager(std::shared_ptr<const ReportCapture> capture, ReplayPacing pacing);
+    ~ReplayDeviceManager();
+
+    // Whether the open replay has handed out every report
+    bool Finished() const;
+
+    // With kAsFastAsPossible, hold each report back until gate returns
+    // true, so a benchmark can keep the swipe queue from overflowing. It is
+    // polled on the read thread; set it before opening the device.
+    void SetPaceGate(std::function<bool()> gate);
+
+protected:
+    bool InitializeHid() override;
+    void ShutdownHid() override;
+    std::vector<DeviceInfo> EnumerateDevices() override;
+    std::unique_ptr<HidConnection> OpenConnection(const DeviceInfo& info) override;
+    void StartHotplugMonitor() override;
+    void StopHotplugMonitor() override;
+    bool IsHotplugActive() const override;
+
+private:
+    std::shared_ptr<const ReportCapture> capture_;
+    ReplayPacing pacing_;
+    std::function<bool()> pace_gate_;
+    // Shared with the open replay connection, which sets it
+    std::shared_ptr<std::atomic<bool>> finished_;
+};
+
+#endif  // MAGTEK_REPORT_REPLAY_H_
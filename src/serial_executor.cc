@@ -0,0 +1,55 @@
+#include "serial_executor.h"
+
+SerialExecutor::SerialExecutor() : busy_(false), stopping_(false) {
+    worker_ = std::thread(&SerialExecutor::WorkerThread, this);
+}
+
+SerialExecutor::~SerialExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void SerialExecutor::Post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    work_cv_.notify_one();
+}
+
+void SerialExecutor::WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return tasks_.empty() && !busy_; });
+}
+
+void SerialExecutor::WorkerThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        work_cv_.wait(lock, [this] { return !tasks_.empty() || stopping_; });
+        if (tasks_.empty()) {
+            // Stopping, and everything posted has run
+            return;
+        }
+
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        busy_ = true;
+
+        // Run without the lock so tasks can post follow-up work
+        lock.unlock();
+        task();
+        lock.lock();
+
+        busy_ = false;
+        if (tasks_.empty()) {
+            idle_cv_.notify_all();
+        }
+    }
+}
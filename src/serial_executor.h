@@ -0,0 +1,47 @@
+#ifndef MAGTEK_SERIAL_EXECUTOR_H_
+#define MAGTEK_SERIAL_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs tasks one at a time, in the order they were posted, on a worker
+// thread of its own.
+//
+// The plugins use one to keep blocking device manager calls (bus scans,
+// device opens, read thread joins) off the platform thread while still
+// applying them in the order Dart made them.
+class SerialExecutor {
+public:
+    SerialExecutor();
+
+    // Runs whatever is still queued, then stops the worker
+    ~SerialExecutor();
+
+    SerialExecutor(const SerialExecutor&) = delete;
+    SerialExecutor& operator=(const SerialExecutor&) = delete;
+
+    // Queue a task; never blocks on tasks already running
+    void Post(std::function<void()> task);
+
+    // Block until every task posted so far has finished. Must not be
+    // called from a task.
+    void WaitIdle();
+
+private:
+    void WorkerThread();
+
+    std::mutex mutex_;
+    // Signalled when a task is queued or the executor is stopping
+    std::condition_variable work_cv_;
+    // Signalled when the queue runs dry
+    std::condition_variable idle_cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool busy_;
+    bool stopping_;
+    std::thread worker_;
+};
+
+#endif  // MAGTEK_SERIAL_EXECUTOR_H_
@@ -0,0 +1,89 @@
+#ifndef MAGTEK_SPSC_RING_H_
+#define MAGTEK_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer/single-consumer queue with preallocated slots.
+//
+// One thread may push and one (other) thread may call ConsumeAll; neither
+// ever blocks. Items live in slots that last as long as the ring, so types
+// with heap storage (such as std::string members) reuse their buffers once
+// warmed up instead of allocating per item. The producer can also fill the
+// next slot in place (PrepareSlot/CommitSlot), so an item crosses threads by
+// publishing an index rather than by being copied.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() {
+        head_.value = 0;
+        tail_.value = 0;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Returns false, leaving the ring unchanged, when full.
+    bool TryPush(const T& item) {
+        size_t tail = tail_.value.load(std::memory_order_relaxed);
+        if (tail - head_.value.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.value.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side, in place: the slot the next push publishes, or null
+    // when the ring is full. The producer may fill it over any number of
+    // calls; nothing is published until CommitSlot.
+    T* PrepareSlot() {
+        size_t tail = tail_.value.load(std::memory_order_relaxed);
+        if (tail - head_.value.load(std::memory_order_acquire) == Capacity) {
+            return nullptr;
+        }
+        return &slots_[tail & (Capacity - 1)];
+    }
+
+    // Publish the slot PrepareSlot returned
+    void CommitSlot() {
+        tail_.value.store(tail_.value.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer side. Calls fn on every queued item, oldest first, and returns
+    // how many were consumed. fn may modify the item; each slot is handed
+    // back to the producer as soon as fn returns for it.
+    template <typename Fn>
+    size_t ConsumeAll(Fn&& fn) {
+        size_t head = head_.value.load(std::memory_order_relaxed);
+        size_t tail = tail_.value.load(std::memory_order_acquire);
+
+        for (size_t i = head; i != tail; i++) {
+            fn(slots_[i & (Capacity - 1)]);
+            head_.value.store(i + 1, std::memory_order_release);
+        }
+        return tail - head;
+    }
+
+    bool Empty() const {
+        return head_.value.load(std::memory_order_acquire) ==
+               tail_.value.load(std::memory_order_acquire);
+    }
+
+private:
+    // Keeps the consumer and producer indices on separate cache lines
+    struct PaddedIndex {
+        std::atomic<size_t> value;
+        char padding[64 - sizeof(std::atomic<size_t>)];
+    };
+
+    T slots_[Capacity];
+    PaddedIndex head_;
+    PaddedIndex tail_;
+};
+
+#endif  // MAGTEK_SPSC_RING_H_
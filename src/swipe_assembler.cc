@@ -0,0 +1,180 @@
+#include "swipe_assembler.h"
+#include <cstring>
+
+const size_t SwipeAssembler::MAX_REPORT_SIZE;
+const size_t SwipeAssembler::MAX_REPORTS;
+const size_t SwipeAssembler::MAX_FRAME_SIZE;
+
+// Whether a report carries anything besides its report ID and padding
+static bool HasPayload(const unsigned char* data, size_t length) {
+    for (size_t i = 1; i < length; i++) {
+        if (data[i] >= 0x20 && data[i] <= 0x7E) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SwipeAssembler::SwipeAssembler()
+    : count_(0), pending_length_(0), payload_length_(0), expected_payload_length_(0),
+      in_track_(false), has_track_(false), frame_buffer_(frame_), frame_length_(0) {
+}
+
+void SwipeAssembler::SetFramingRules(const FramingRules& rules) {
+    rules_ = rules;
+    Reset();
+}
+
+bool SwipeAssembler::AddReport(const unsigned char* data, size_t length, Clock::time_point now) {
+    frame_length_ = 0;
+
+    if (length == 0) {
+        return false;
+    }
+    if (length > MAX_REPORT_SIZE) {
+        length = MAX_REPORT_SIZE;
+    }
+
+    // Idle reports between swipes carry nothing worth buffering
+    if (count_ == 0 && !HasPayload(data, length)) {
+        return false;
+    }
+
+    // Keep the first report ID so the frame looks like a single report
+    size_t start = count_ == 0 ? 0 : 1;
+    memcpy(frame_buffer_ + pending_length_, data + start, length - start);
+    pending_length_ += length - start;
+    count_++;
+    payload_length_ += length - 1;
+    last_report_time_ = now;
+    if (count_ == 1) {
+        first_report_time_ = now;
+    }
+
+    if (count_ == 1 && rules_.length_header_offset >= 0) {
+        size_t offset = 1 + static_cast<size_t>(rules_.length_header_offset);
+        if (offset + 1 < length) {
+            expected_payload_length_ = data[offset] | (data[offset + 1] << 8);
+        }
+    }
+
+    bool complete;
+    if (expected_payload_length_ > 0) {
+        // A length header is authoritative; sentinels may appear in binary data
+        complete = payload_length_ >= expected_payload_length_;
+    } else {
+        complete = ScanReport(data, length);
+    }
+
+    // A full frame means the device never sent an end marker; parse what we
+    // have
+    if (complete || count_ == MAX_REPORTS) {
+        frame_complete_time_ = now;
+        CompleteFrame();
+        return true;
+    }
+    return false;
+}
+
+bool SwipeAssembler::CheckTimeout(Clock::time_point now) {
+    frame_length_ = 0;
+
+    if (count_ == 0) {
+        return false;
+    }
+    if (now - last_report_time_ < std::chrono::milliseconds(rules_.gap_timeout_ms)) {
+        return false;
+    }
+
+    frame_complete_time_ = now;
+    CompleteFrame();
+    return true;
+}
+
+bool SwipeAssembler::HasPendingFrame() const {
+    return count_ > 0;
+}
+
+int SwipeAssembler::MillisecondsUntilTimeout(Clock::time_point now, int limit_ms) const {
+    if (count_ == 0) {
+        return limit_ms;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_report_time_).count();
+    long long remaining = rules_.gap_timeout_ms - elapsed;
+    if (remaining < 0) {
+        return 0;
+    }
+    return remaining < limit_ms ? static_cast<int>(remaining) : limit_ms;
+}
+
+void SwipeAssembler::SetFrameBuffer(unsigned char* buffer) {
+    unsigned char* previous = frame_buffer_;
+    frame_buffer_ = buffer ? buffer : frame_;
+    if (pending_length_ > 0 && frame_buffer_ != previous) {
+        memcpy(frame_buffer_, previous, pending_length_);
+    }
+}
+
+const unsigned char* SwipeAssembler::FrameData() const {
+    return frame_buffer_;
+}
+
+size_t SwipeAssembler::FrameLength() const {
+    return frame_length_;
+}
+
+SwipeAssembler::Clock::time_point SwipeAssembler::FrameStartTime() const {
+    return first_report_time_;
+}
+
+SwipeAssembler::Clock::time_point SwipeAssembler::FrameCompleteTime() const {
+    return frame_complete_time_;
+}
+
+void SwipeAssembler::Reset() {
+    count_ = 0;
+    pending_length_ = 0;
+    payload_length_ = 0;
+    expected_payload_length_ = 0;
+    in_track_ = false;
+    has_track_ = false;
+    frame_length_ = 0;
+}
+
+bool SwipeAssembler::ScanReport(const unsigned char* data, size_t length) {
+    bool track_ended_here = false;
+
+    for (size_t i = 1; i < length; i++) { // Skip first byte (report ID)
+        unsigned char c = data[i];
+
+        if (in_track_) {
+            if (c == '?') {
+                in_track_ = false;
+                has_track_ = true;
+                track_ended_here = true;
+            }
+            continue;
+        }
+
+        if (c == '%' || c == ';') {
+            in_track_ = true;
+        } else if (c == 0x00 && track_ended_here && rules_.complete_on_padding) {
+            return true;
+        } else if ((c == '\r' || c == '\n') && has_track_ && rules_.complete_on_newline) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SwipeAssembler::CompleteFrame() {
+    frame_length_ = pending_length_;
+    pending_length_ = 0;
+    count_ = 0;
+    payload_length_ = 0;
+    expected_payload_length_ = 0;
+    in_track_ = false;
+    has_track_ = false;
+}
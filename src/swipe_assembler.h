@@ -0,0 +1,102 @@
+#ifndef MAGTEK_SWIPE_ASSEMBLER_H_
+#define MAGTEK_SWIPE_ASSEMBLER_H_
+
+#include <chrono>
+#include <cstddef>
+
+// Rules that decide when the reports gathered for a swipe form a complete frame
+struct FramingRules {
+    // Complete when a track end sentinel ('?') is followed by zero padding in
+    // the same report. Readers that pad every report, even mid-swipe, must
+    // turn this off and rely on the other rules.
+    bool complete_on_padding = true;
+
+    // Complete on a CR/LF end-of-swipe marker after the last track
+    bool complete_on_newline = true;
+
+    // Offset (after the report ID) of a little-endian 16-bit total payload
+    // length in the first report of a frame, or -1 if the device sends none
+    int length_header_offset = -1;
+
+    // Complete a pending frame when no further report arrives within this time
+    int gap_timeout_ms = 20;
+};
+
+// Gathers the HID input reports that make up a single card swipe so that the
+// report parser runs once per swipe instead of once per report.
+//
+// Each report's payload is appended to the frame buffer as it arrives, so a
+// report is copied once, from wherever it was read into, and nothing is
+// allocated after construction. A completed frame is the first report's ID
+// byte followed by the payload of every report, in arrival order.
+class SwipeAssembler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const size_t MAX_REPORT_SIZE = 256;
+    static const size_t MAX_REPORTS = 8;
+    // Longest frame the reports can add up to
+    static const size_t MAX_FRAME_SIZE = MAX_REPORTS * MAX_REPORT_SIZE;
+
+    SwipeAssembler();
+
+    // Replace the framing rules; drops any partially gathered frame
+    void SetFramingRules(const FramingRules& rules);
+
+    // Add one input report. Returns true when it completes a frame.
+    bool AddReport(const unsigned char* data, size_t length, Clock::time_point now);
+
+    // Complete the pending frame if the inter-report gap has elapsed
+    bool CheckTimeout(Clock::time_point now);
+
+    // Whether reports are buffered waiting for the rest of the swipe
+    bool HasPendingFrame() const;
+
+    // Time left before the pending frame times out, clamped to [0, limit_ms]
+    int MillisecondsUntilTimeout(Clock::time_point now, int limit_ms) const;
+
+    // Assemble frames into buffer, which must hold MAX_FRAME_SIZE bytes,
+    // instead of the assembler's own; null switches back to that. A frame
+    // partway through is carried over.
+    void SetFrameBuffer(unsigned char* buffer);
+
+    // Completed frame; valid until the next AddReport/CheckTimeout/Reset
+    const unsigned char* FrameData() const;
+    size_t FrameLength() const;
+
+    // When the completed frame's first report arrived, and when the frame
+    // was completed (the times given to AddReport/CheckTimeout)
+    Clock::time_point FrameStartTime() const;
+    Clock::time_point FrameCompleteTime() const;
+
+    // Drop all buffered reports and any completed frame
+    void Reset();
+
+private:
+    // Update track sentinel state with one report; returns true on an end marker
+    bool ScanReport(const unsigned char* data, size_t length);
+
+    // Hand the gathered frame out and start on the next one
+    void CompleteFrame();
+
+    FramingRules rules_;
+    // Reports gathered for the pending frame
+    size_t count_;
+    // Bytes of the pending frame in frame_buffer_
+    size_t pending_length_;
+    size_t payload_length_;
+    size_t expected_payload_length_;
+    bool in_track_;
+    bool has_track_;
+    Clock::time_point last_report_time_;
+    Clock::time_point first_report_time_;
+    Clock::time_point frame_complete_time_;
+
+    unsigned char frame_[MAX_FRAME_SIZE];
+    // Where frames are assembled; frame_ unless SetFrameBuffer said otherwise
+    unsigned char* frame_buffer_;
+    // Length of the completed frame, or 0 if there is none
+    size_t frame_length_;
+};
+
+#endif  // MAGTEK_SWIPE_ASSEMBLER_H_
@@ -0,0 +1,53 @@
+#include "swipe_deduplicator.h"
+
+const size_t SwipeDeduplicator::TRACK_COUNT;
+
+SwipeDeduplicator::SwipeDeduplicator() : has_last_(false), last_hashes_() {
+}
+
+uint64_t SwipeDeduplicator::HashTrack(const char* data, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    // Keep 0 for "no track"
+    return hash != 0 ? hash : 1;
+}
+
+bool SwipeDeduplicator::IsRepeat(const uint64_t (&track_hashes)[TRACK_COUNT], Clock::time_point now,
+                                 std::chrono::milliseconds window) {
+    bool repeat = false;
+    if (has_last_ && now - last_time_ < window) {
+        for (size_t i = 0; i < TRACK_COUNT; i++) {
+            if (track_hashes[i] != 0 && track_hashes[i] == last_hashes_[i]) {
+                repeat = true;
+                break;
+            }
+        }
+    }
+
+    if (repeat) {
+        // A track the first read missed identifies the card from now on too
+        for (size_t i = 0; i < TRACK_COUNT; i++) {
+            if (last_hashes_[i] == 0) {
+                last_hashes_[i] = track_hashes[i];
+            }
+        }
+    } else {
+        for (size_t i = 0; i < TRACK_COUNT; i++) {
+            last_hashes_[i] = track_hashes[i];
+        }
+        has_last_ = true;
+    }
+    last_time_ = now;
+    return repeat;
+}
+
+void SwipeDeduplicator::Reset() {
+    has_last_ = false;
+}
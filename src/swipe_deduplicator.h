@@ -0,0 +1,41 @@
+#ifndef MAGTEK_SWIPE_DEDUPLICATOR_H_
+#define MAGTEK_SWIPE_DEDUPLICATOR_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Recognizes repeats of a swipe: the same card read again within a time
+// window, as a noisy head's double read or a card swiped back and forth
+// produces. Tracks are compared by hash, each on its own, so a repeat in
+// which one track misread still matches on the others.
+//
+// One per device, used only by its read thread; nothing is allocated.
+class SwipeDeduplicator {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const size_t TRACK_COUNT = 3;
+
+    SwipeDeduplicator();
+
+    // FNV-1a hash of one track; 0 only for an empty track
+    static uint64_t HashTrack(const char* data, size_t length);
+
+    // Whether a swipe whose tracks hash to track_hashes (0 for a missing
+    // track), completed at now, shares a track with the last swipe seen
+    // less than window before. Each repeat restarts the window, so a card
+    // swiped back and forth stays suppressed until it is put down.
+    bool IsRepeat(const uint64_t (&track_hashes)[TRACK_COUNT], Clock::time_point now,
+                  std::chrono::milliseconds window);
+
+    // Forget the last swipe
+    void Reset();
+
+private:
+    bool has_last_;
+    uint64_t last_hashes_[TRACK_COUNT];
+    Clock::time_point last_time_;
+};
+
+#endif  // MAGTEK_SWIPE_DEDUPLICATOR_H_
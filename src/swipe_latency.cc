@@ -0,0 +1,135 @@
+#include "swipe_latency.h"
+
+const int LatencyHistogram::SUB_BUCKETS;
+const int LatencyHistogram::MAX_EXPONENT;
+const int LatencyHistogram::BUCKET_COUNT;
+
+LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+int LatencyHistogram::BucketIndex(long long duration_ns) {
+    if (duration_ns < SUB_BUCKETS) {
+        return duration_ns < 0 ? 0 : static_cast<int>(duration_ns);
+    }
+
+    unsigned long long value = static_cast<unsigned long long>(duration_ns);
+    int exponent = 0;
+    while ((value >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+    if (exponent >= MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+
+    // The three bits below the leading one pick the sub-bucket
+    int sub_bucket = static_cast<int>((value >> (exponent - 3)) & (SUB_BUCKETS - 1));
+    return (exponent - 2) * SUB_BUCKETS + sub_bucket;
+}
+
+long long LatencyHistogram::BucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    int exponent = index / SUB_BUCKETS + 2;
+    long long sub_bucket = index % SUB_BUCKETS;
+    long long width = 1LL << (exponent - 3);
+    return (SUB_BUCKETS + sub_bucket) * width + width - 1;
+}
+
+void LatencyHistogram::Record(long long duration_ns) {
+    if (duration_ns < 0) {
+        duration_ns = 0;
+    }
+
+    buckets_[BucketIndex(duration_ns)].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(static_cast<unsigned long long>(duration_ns), std::memory_order_relaxed);
+
+    long long max_ns = max_ns_.load(std::memory_order_relaxed);
+    while (duration_ns > max_ns &&
+           !max_ns_.compare_exchange_weak(max_ns, duration_ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencySummary LatencyHistogram::Summarize() const {
+    LatencySummary summary = {0, 0, 0, 0, 0, 0};
+
+    // Work from one copy of the buckets so the percentiles agree with each other
+    unsigned long long counts[BUCKET_COUNT];
+    unsigned long long total = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return summary;
+    }
+
+    summary.count = total;
+    summary.max_ns = max_ns_.load(std::memory_order_relaxed);
+    summary.mean_ns = static_cast<long long>(sum_ns_.load(std::memory_order_relaxed) / total);
+
+    const double quantiles[] = {0.50, 0.90, 0.99};
+    long long* results[] = {&summary.p50_ns, &summary.p90_ns, &summary.p99_ns};
+    for (int q = 0; q < 3; q++) {
+        // Smallest bucket holding at least the quantile's share of durations
+        unsigned long long rank = static_cast<unsigned long long>(quantiles[q] * total);
+        if (rank < 1) {
+            rank = 1;
+        }
+
+        unsigned long long seen = 0;
+        int index = 0;
+        while (index < BUCKET_COUNT - 1 && seen + counts[index] < rank) {
+            seen += counts[index];
+            index++;
+        }
+
+        long long bound = BucketUpperBound(index);
+        *results[q] = bound < summary.max_ns ? bound : summary.max_ns;
+    }
+    return summary;
+}
+
+void LatencyHistogram::Reset() {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+void SwipeLatencyStats::Record(const SwipeTimings& timings) {
+    stages_[static_cast<int>(SwipeStage::kAssembly)].Record(timings.frame_complete_ns - timings.first_report_ns);
+    stages_[static_cast<int>(SwipeStage::kParse)].Record(timings.parsed_ns - timings.frame_complete_ns);
+    stages_[static_cast<int>(SwipeStage::kQueue)].Record(timings.queued_ns - timings.parsed_ns);
+    stages_[static_cast<int>(SwipeStage::kDelivery)].Record(timings.delivered_ns - timings.queued_ns);
+    stages_[static_cast<int>(SwipeStage::kTotal)].Record(timings.delivered_ns - timings.first_report_ns);
+}
+
+LatencySummary SwipeLatencyStats::Summarize(SwipeStage stage) const {
+    return stages_[static_cast<int>(stage)].Summarize();
+}
+
+void SwipeLatencyStats::Reset() {
+    for (int i = 0; i < SWIPE_STAGE_COUNT; i++) {
+        stages_[i].Reset();
+    }
+}
+
+const char* SwipeLatencyStats::StageName(SwipeStage stage) {
+    switch (stage) {
+        case SwipeStage::kAssembly:
+            return "assembly";
+        case SwipeStage::kParse:
+            return "parse";
+        case SwipeStage::kQueue:
+            return "queue";
+        case SwipeStage::kDelivery:
+            return "delivery";
+        case SwipeStage::kTotal:
+            return "total";
+    }
+    return "";
+}
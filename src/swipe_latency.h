@@ -0,0 +1,113 @@
+#ifndef MAGTEK_SWIPE_LATENCY_H_
+#define MAGTEK_SWIPE_LATENCY_H_
+
+#include <atomic>
+#include <chrono>
+
+// Monotonic (steady_clock) nanoseconds at each stage of a swipe's trip from
+// the reader to the platform channel. The values are only meaningful
+// relative to each other; 0 marks a stage the swipe has not reached.
+struct SwipeTimings {
+    // First HID report of the swipe returned by the read
+    long long first_report_ns;
+    // Reports assembled into a complete frame
+    long long frame_complete_ns;
+    // Tracks parsed out of the frame
+    long long parsed_ns;
+    // Pushed onto the device's swipe queue for the platform thread
+    long long queued_ns;
+    // Handed to the card swipe callback, which sends it on the channel
+    long long delivered_ns;
+};
+
+// Intervals between the SwipeTimings stages that the statistics track
+enum class SwipeStage {
+    // First report to complete frame
+    kAssembly,
+    // Complete frame to parsed tracks
+    kParse,
+    // Parsed tracks to queued
+    kQueue,
+    // Queued to delivered, i.e. the hop to the platform thread
+    kDelivery,
+    // First report to delivered
+    kTotal,
+};
+
+static const int SWIPE_STAGE_COUNT = 5;
+
+// Convert a steady_clock time to SwipeTimings nanoseconds
+inline long long MonotonicNanoseconds(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+inline long long MonotonicNanoseconds() {
+    return MonotonicNanoseconds(std::chrono::steady_clock::now());
+}
+
+// Percentiles of a LatencyHistogram, in nanoseconds. Percentiles report the
+// upper bound of their bucket, so they read high by at most an eighth.
+struct LatencySummary {
+    unsigned long long count;
+    long long p50_ns;
+    long long p90_ns;
+    long long p99_ns;
+    long long max_ns;
+    long long mean_ns;
+};
+
+// Log-linear histogram of nanosecond durations: eight buckets per power of
+// two up to about 18 minutes. Recording is a few relaxed atomic operations,
+// so read threads and the platform thread record into the same histogram
+// without a lock.
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKETS = 8;
+    // Durations of 2^MAX_EXPONENT ns and above share the last bucket
+    static const int MAX_EXPONENT = 40;
+    static const int BUCKET_COUNT = (MAX_EXPONENT - 2) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Record one duration; negative durations count as 0
+    void Record(long long duration_ns);
+
+    // Percentiles of everything recorded since construction or Reset. Not
+    // atomic with respect to concurrent Records, which may or may not count.
+    LatencySummary Summarize() const;
+
+    void Reset();
+
+    // Bucket a duration falls in, and the largest duration in a bucket
+    static int BucketIndex(long long duration_ns);
+    static long long BucketUpperBound(int index);
+
+private:
+    std::atomic<unsigned long long> buckets_[BUCKET_COUNT];
+    std::atomic<unsigned long long> sum_ns_;
+    std::atomic<long long> max_ns_;
+};
+
+// One LatencyHistogram per SwipeStage
+class SwipeLatencyStats {
+public:
+    SwipeLatencyStats() {}
+
+    // Record every stage interval of a delivered swipe
+    void Record(const SwipeTimings& timings);
+
+    LatencySummary Summarize(SwipeStage stage) const;
+
+    void Reset();
+
+    // Name of a stage in getStats results: "assembly", "parse", ...
+    static const char* StageName(SwipeStage stage);
+
+private:
+    LatencyHistogram stages_[SWIPE_STAGE_COUNT];
+};
+
+#endif  // MAGTEK_SWIPE_LATENCY_H_
@@ -0,0 +1,7 @@
+#include "trace_events.h"
+
+std::atomic<TraceSink*> Tracer::sink_(nullptr);
+
+void Tracer::SetSink(TraceSink* sink) {
+    sink_.store(sink, std::memory_order_release);
+}
@@ -0,0 +1,71 @@
+#ifndef MAGTEK_TRACE_EVENTS_H_
+#define MAGTEK_TRACE_EVENTS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// Receives the swipe pipeline's trace slices. Each platform plugin supplies
+// one that writes to the OS tracer, so the slices land on the same timeline
+// as the Flutter engine's: ftrace's trace_marker in systrace format on Linux,
+// which Perfetto records, and TraceLogging (ETW) on Windows.
+//
+// Slices nest per thread; every BeginSlice is followed by the matching
+// EndSlice on the same thread before an enclosing slice ends.
+class TraceSink {
+public:
+    virtual ~TraceSink() {}
+
+    // A stage began on the calling thread, handling report_size bytes of
+    // device_id's reports
+    virtual void BeginSlice(const char* name, const std::string& device_id, size_t report_size) = 0;
+
+    // The stage most recently begun on the calling thread ended
+    virtual void EndSlice(const char* name) = 0;
+};
+
+// Process-wide switch for tracing. While it is off, a traced stage costs
+// one atomic load.
+class Tracer {
+public:
+    // Where slices go, or null while tracing is off
+    static TraceSink* Sink() {
+        return sink_.load(std::memory_order_acquire);
+    }
+
+    // Send slices to sink from now on, or stop with null. A thread may still
+    // be inside a slice begun on the old sink, so the plugins keep theirs
+    // for the life of the process.
+    static void SetSink(TraceSink* sink);
+
+private:
+    static std::atomic<TraceSink*> sink_;
+};
+
+// One traced stage, from construction to the end of the enclosing scope:
+//   TraceScope trace("ParseInputReport", session.device_id, frame.size());
+// The sink is read once, so a stage that begins a slice always ends it.
+class TraceScope {
+public:
+    TraceScope(const char* name, const std::string& device_id, size_t report_size)
+        : sink_(Tracer::Sink()), name_(name) {
+        if (sink_) {
+            sink_->BeginSlice(name, device_id, report_size);
+        }
+    }
+
+    ~TraceScope() {
+        if (sink_) {
+            sink_->EndSlice(name_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceSink* sink_;
+    const char* name_;
+};
+
+#endif  // MAGTEK_TRACE_EVENTS_H_
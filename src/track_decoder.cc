@@ -0,0 +1,245 @@
+#include "track_decoder.h"
+#include <cstring>
+
+const size_t TrackFields::MAX_PAN_LENGTH;
+const size_t TrackFields::MAX_NAME_LENGTH;
+const size_t TrackFields::EXPIRATION_DATE_LENGTH;
+const size_t TrackFields::SERVICE_CODE_LENGTH;
+const size_t TrackFields::MAX_DISCRETIONARY_LENGTH;
+const size_t TrackFields::MAX_ADDITIONAL_LENGTH;
+
+// Split the data after the last field separator into YYMM, service code
+// and discretionary data, as tracks 1 and 2 both lay it out
+static void AssignTrailingFields(const char* data, size_t length, TrackFields* fields) {
+    const size_t date_end = TrackFields::EXPIRATION_DATE_LENGTH;
+    const size_t service_end = date_end + TrackFields::SERVICE_CODE_LENGTH;
+    if (length >= date_end) {
+        fields->expiration_date.assign(data, date_end);
+    }
+    if (length >= service_end) {
+        fields->service_code.assign(data + date_end, TrackFields::SERVICE_CODE_LENGTH);
+    }
+    if (length > service_end) {
+        fields->discretionary_data.assign(data + service_end, length - service_end);
+    }
+}
+
+// '*' is a masked digit, as in the masked tracks of encrypting readers
+static bool IsDigits(const char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if ((data[i] < '0' || data[i] > '9') && data[i] != '*') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// %B PAN ^ NAME ^ YYMM SVC DISCRETIONARY ?
+static TrackStatus DecodeTrack1(const char* track, size_t length, TrackFields* fields) {
+    if (length < 4 || track[0] != '%' || track[1] != 'B' || track[length - 1] != '?') {
+        return TrackStatus::kFormatError;
+    }
+
+    const char* end = track + length - 1;
+    const char* pan = track + 2;
+    const char* first_separator = static_cast<const char*>(memchr(pan, '^', end - pan));
+    if (!first_separator) {
+        return TrackStatus::kFormatError;
+    }
+    const char* name = first_separator + 1;
+    const char* second_separator = static_cast<const char*>(memchr(name, '^', end - name));
+    if (!second_separator) {
+        return TrackStatus::kFormatError;
+    }
+
+    size_t pan_length = first_separator - pan;
+    size_t name_length = second_separator - name;
+    if (pan_length == 0 || pan_length > TrackFields::MAX_PAN_LENGTH || !IsDigits(pan, pan_length) ||
+        name_length > TrackFields::MAX_NAME_LENGTH) {
+        return TrackStatus::kFormatError;
+    }
+
+    fields->primary_account_number.assign(pan, pan_length);
+    fields->cardholder_name.assign(name, name_length);
+    AssignTrailingFields(second_separator + 1, end - second_separator - 1, fields);
+    return TrackStatus::kDecoded;
+}
+
+// ; PAN = YYMM SVC DISCRETIONARY ?
+static TrackStatus DecodeTrack2(const char* track, size_t length, TrackFields* fields) {
+    if (length < 3 || track[0] != ';' || track[length - 1] != '?') {
+        return TrackStatus::kFormatError;
+    }
+
+    const char* end = track + length - 1;
+    const char* pan = track + 1;
+    const char* separator = static_cast<const char*>(memchr(pan, '=', end - pan));
+    if (!separator) {
+        return TrackStatus::kFormatError;
+    }
+
+    size_t pan_length = separator - pan;
+    const char* trailing = separator + 1;
+    size_t trailing_length = end - trailing;
+    if (pan_length == 0 || pan_length > TrackFields::MAX_PAN_LENGTH || !IsDigits(pan, pan_length)) {
+        return TrackStatus::kFormatError;
+    }
+    // Track 2 is numeric apart from its separators
+    for (size_t i = 0; i < trailing_length; i++) {
+        if (!IsDigits(trailing + i, 1) && trailing[i] != '=') {
+            return TrackStatus::kFormatError;
+        }
+    }
+
+    fields->primary_account_number.assign(pan, pan_length);
+    AssignTrailingFields(trailing, trailing_length, fields);
+    return TrackStatus::kDecoded;
+}
+
+// ; or + DATA ?, laid out as the issuing application chooses
+static TrackStatus DecodeTrack3(const char* track, size_t length, TrackFields* fields) {
+    if (length < 2 || (track[0] != ';' && track[0] != '+') || track[length - 1] != '?') {
+        return TrackStatus::kFormatError;
+    }
+
+    fields->additional_data.assign(track + 1, length - 2);
+    return TrackStatus::kDecoded;
+}
+
+TrackStatus TrackDecoder::Decode(int track_number, const char* track, size_t length, char lrc,
+                                 TrackFields* fields) {
+    fields->primary_account_number.clear();
+    fields->cardholder_name.clear();
+    fields->expiration_date.clear();
+    fields->service_code.clear();
+    fields->discretionary_data.clear();
+    fields->additional_data.clear();
+
+    if (length == 0) {
+        fields->status = TrackStatus::kAbsent;
+        return fields->status;
+    }
+
+    // Most readers check the LRC themselves and drop it; when one passes it
+    // on, a mismatch means the stripe was misread
+    if (lrc != 0 && ComputeLrc(track_number, track, length) != lrc) {
+        fields->status = TrackStatus::kLrcError;
+        return fields->status;
+    }
+
+    switch (track_number) {
+        case 1:
+            fields->status = DecodeTrack1(track, length, fields);
+            break;
+        case 2:
+            fields->status = DecodeTrack2(track, length, fields);
+            break;
+        default:
+            fields->status = DecodeTrack3(track, length, fields);
+            break;
+    }
+    return fields->status;
+}
+
+char TrackDecoder::ComputeLrc(int track_number, const char* track, size_t length) {
+    // XOR of the data bits of every character. Track 1 is six-bit
+    // alphanumeric offset from 0x20; tracks 2 and 3 are four-bit BCD offset
+    // from 0x30, where a '+' start sentinel stands in for the BCD one
+    unsigned char lrc = 0;
+    if (track_number == 1) {
+        for (size_t i = 0; i < length; i++) {
+            lrc ^= static_cast<unsigned char>(track[i] - 0x20) & 0x3F;
+        }
+        return static_cast<char>(lrc + 0x20);
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        lrc ^= static_cast<unsigned char>(track[i] - 0x30) & 0x0F;
+    }
+    return static_cast<char>(lrc + 0x30);
+}
+
+bool TrackDecoder::IsValidLuhn(const char* digits, size_t length) {
+    if (length == 0) {
+        return false;
+    }
+
+    int sum = 0;
+    bool alternate = false;
+    for (size_t i = length; i-- > 0;) {
+        if (digits[i] < '0' || digits[i] > '9') {
+            return false;
+        }
+        int digit = digits[i] - '0';
+        if (alternate) {
+            digit *= 2;
+            if (digit > 9) {
+                digit -= 9;
+            }
+        }
+        sum += digit;
+        alternate = !alternate;
+    }
+    return sum % 10 == 0;
+}
+
+SwipeValidation TrackDecoder::Validate(const TrackFields* tracks, int track_count, bool check_luhn) {
+    const TrackFields* account_track = nullptr;
+    bool any_decoded = false;
+    for (int i = 0; i < track_count; i++) {
+        if (tracks[i].status == TrackStatus::kLrcError) {
+            return SwipeValidation::kLrcError;
+        }
+        if (tracks[i].status == TrackStatus::kDecoded) {
+            any_decoded = true;
+            // Track 1's account number is preferred, as in the Dart CardData
+            if (!account_track && !tracks[i].primary_account_number.empty()) {
+                account_track = &tracks[i];
+            }
+        }
+    }
+
+    if (!any_decoded) {
+        return SwipeValidation::kFormatError;
+    }
+    if (check_luhn && account_track &&
+        !IsValidLuhn(account_track->primary_account_number.data(), account_track->primary_account_number.size())) {
+        return SwipeValidation::kLuhnError;
+    }
+    return SwipeValidation::kValid;
+}
+
+const char* TrackDecoder::StatusName(TrackStatus status) {
+    switch (status) {
+        case TrackStatus::kAbsent:
+            return "absent";
+        case TrackStatus::kDecoded:
+            return "decoded";
+        case TrackStatus::kFormatError:
+            return "formatError";
+        case TrackStatus::kLrcError:
+            return "lrcError";
+    }
+    return "";
+}
+
+const char* TrackDecoder::ValidationName(SwipeValidation validation) {
+    switch (validation) {
+        case SwipeValidation::kValid:
+            return "valid";
+        case SwipeValidation::kLrcError:
+            return "lrcError";
+        case SwipeValidation::kFormatError:
+            return "formatError";
+        case SwipeValidation::kLuhnError:
+            return "luhnError";
+    }
+    return "";
+}
+
+bool TrackDecoder::IsTrackCharacter(int track_number, char c) {
+    if (track_number == 1) {
+        return c >= 0x20 && c <= 0x5F;
+    }
+    return c >= 0x30 && c <= 0x3F;
+}
@@ -0,0 +1,85 @@
+#ifndef MAGTEK_TRACK_DECODER_H_
+#define MAGTEK_TRACK_DECODER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "fixed_string.h"
+
+// Outcome of decoding one track
+enum class TrackStatus {
+    // The swipe had no such track
+    kAbsent,
+    kDecoded,
+    // Sentinels, format code or separators are not where the format puts them
+    kFormatError,
+    // The reader sent an LRC character and it does not match the track
+    kLrcError,
+};
+
+// Overall verdict on a swipe, most serious problem first
+enum class SwipeValidation {
+    kValid,
+    // Some track failed its LRC check
+    kLrcError,
+    // No track decoded
+    kFormatError,
+    // The tracks decoded, but the account number fails the Luhn check
+    kLuhnError,
+};
+
+// Fields of one decoded track. Track 1 fills all of them but
+// additional_data; track 2 all but cardholder_name and additional_data;
+// track 3 only additional_data. A field the card leaves out is empty.
+// Every field is stored inline at its ISO maximum, so decoding a track
+// never allocates.
+struct TrackFields {
+    // Longest account number and cardholder name ISO 7813 allows
+    static const size_t MAX_PAN_LENGTH = 19;
+    static const size_t MAX_NAME_LENGTH = 26;
+    static const size_t EXPIRATION_DATE_LENGTH = 4;
+    static const size_t SERVICE_CODE_LENGTH = 3;
+    // What a 79-character track 1 leaves once "%B", a one-digit account
+    // number, both '^', the date, the service code and '?' have taken 13
+    static const size_t MAX_DISCRETIONARY_LENGTH = 79 - 13;
+    // A 107-character track 3 without its sentinels
+    static const size_t MAX_ADDITIONAL_LENGTH = 107 - 2;
+
+    TrackStatus status;
+    FixedString<MAX_PAN_LENGTH> primary_account_number;
+    FixedString<MAX_NAME_LENGTH> cardholder_name;
+    // YYMM
+    FixedString<EXPIRATION_DATE_LENGTH> expiration_date;
+    FixedString<SERVICE_CODE_LENGTH> service_code;
+    FixedString<MAX_DISCRETIONARY_LENGTH> discretionary_data;
+    // Track 3: everything between the sentinels
+    FixedString<MAX_ADDITIONAL_LENGTH> additional_data;
+};
+
+// Decodes ISO 7813 tracks 1 and 2 and ISO 4909 track 3 from the ASCII the
+// readers send, into the caller's TrackFields.
+class TrackDecoder {
+public:
+    // Decode one track, sentinels included. lrc is the character the reader
+    // sent after the end sentinel, or 0 if it sent none.
+    static TrackStatus Decode(int track_number, const char* track, size_t length, char lrc, TrackFields* fields);
+
+    // Longitudinal redundancy check character of a track, sentinels included
+    static char ComputeLrc(int track_number, const char* track, size_t length);
+
+    // Whether a string of digits passes the Luhn check
+    static bool IsValidLuhn(const char* digits, size_t length);
+
+    // Judge a swipe from its three decoded tracks. Masked tracks can't pass
+    // the Luhn check, so leave check_luhn off for them.
+    static SwipeValidation Validate(const TrackFields* tracks, int track_count, bool check_luhn = true);
+
+    // Names used on the event channel: "decoded", "lrcError", ...
+    static const char* StatusName(TrackStatus status);
+    static const char* ValidationName(SwipeValidation validation);
+
+    // Whether a character can be the LRC of the given track
+    static bool IsTrackCharacter(int track_number, char c);
+};
+
+#endif  // MAGTEK_TRACK_DECODER_H_
@@ -1,6 +1,14 @@
+import 'dart:typed_data';
+import 'dart:ui' show AppLifecycleState;
+
 import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:magtek_card_reader/magtek_card_reader_method_channel.dart';
+import 'package:magtek_card_reader/src/models/device_command_response.dart';
+import 'package:magtek_card_reader/src/models/swipe_batch_options.dart';
+import 'package:magtek_card_reader/src/models/swipe_stats.dart';
+import 'package:magtek_card_reader/src/models/swipe_validation.dart';
+import 'package:magtek_card_reader/src/models/track_data.dart';
 
 void main() {
   TestWidgetsFlutterBinding.ensureInitialized();
@@ -24,4 +32,207 @@ void main() {
   test('getPlatformVersion', () async {
     expect(await platform.getPlatformVersion(), '42');
   });
+
+  test('isConnected and getConnectedDevices use the channel without native bindings', () async {
+    platform.nativeBindings = null;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+      channel,
+      (MethodCall methodCall) async {
+        return methodCall.method == 'isConnected' ? true : <dynamic>[];
+      },
+    );
+    expect(await platform.isConnected(), isTrue);
+    expect(await platform.getConnectedDevices(), isEmpty);
+  });
+
+  test('the card swipe event channel is listened to only while onCardSwipe is', () async {
+    final reader = MethodChannelMagtekCardReader();
+    final calls = <String>[];
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+      const MethodChannel('magtek_card_reader/card_swipe'),
+      (MethodCall methodCall) async {
+        calls.add(methodCall.method);
+        return null;
+      },
+    );
+
+    final first = reader.onCardSwipe.listen((_) {});
+    final second = reader.onCardSwipe.listen((_) {});
+    await first.cancel();
+    await pumpEventQueue();
+    expect(calls, ['listen']);
+    await second.cancel();
+    await pumpEventQueue();
+    expect(calls, ['listen', 'cancel']);
+
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+      const MethodChannel('magtek_card_reader/card_swipe'),
+      null,
+    );
+  });
+
+  test('setAppLifecycleState sends the state name', () async {
+    MethodCall? call;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+      channel,
+      (MethodCall methodCall) async {
+        call = methodCall;
+        return null;
+      },
+    );
+    await platform.setAppLifecycleState(AppLifecycleState.paused);
+    expect(call?.method, 'setAppLifecycleState');
+    expect(call?.arguments, {'state': 'paused'});
+  });
+
+  test('setTracing sends the switch and returns whether tracing is on', () async {
+    MethodCall? call;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+      channel,
+      (MethodCall methodCall) async {
+        call = methodCall;
+        return false;
+      },
+    );
+    expect(await platform.setTracing(true), isFalse);
+    expect(call?.method, 'setTracing');
+    expect(call?.arguments, {'enabled': true});
+  });
+
+  test('SwipeBatchOptions.toMap sends whole milliseconds of at least 1', () {
+    expect(
+      const SwipeBatchOptions(window: Duration(milliseconds: 25), maxEvents: 8, lowLatency: false).toMap(),
+      {'windowMs': 25, 'maxEvents': 8, 'lowLatency': false},
+    );
+    expect(const SwipeBatchOptions(window: Duration.zero).toMap()['windowMs'], 1);
+  });
+
+  test('decodePackedSwipe reads a version 1 record', () {
+    // Same bytes as the PackedSwipeCodec test in linux/test
+    final record = Uint8List.fromList([
+      1, 0x01, 0x02, 0x01, 0, 0, 0, 0, 0, 0, //
+      0, 0, //
+      7, 0, ...';41=25?'.codeUnits, //
+      0, 0, //
+      2, 0, ...'d1'.codeUnits, //
+      3, 0, ...'01 '.codeUnits,
+    ]);
+
+    final cardData = MethodChannelMagtekCardReader.decodePackedSwipe(record)!;
+    expect(cardData.track1, isNull);
+    expect(cardData.track2?.rawData, ';41=25?');
+    expect(cardData.deviceId, 'd1');
+    expect(cardData.rawResponse, '01 ');
+    expect(cardData.rawBytes, isNull);
+  });
+
+  test('decodePackedSwipe reads the stage timestamps of a version 2 record', () {
+    // Same bytes as the PackedSwipeCodec test in linux/test
+    final record = Uint8List.fromList([
+      2, 0x01, 0x02, 0x01, 0, 0, 0, 0, 0, 0, //
+      0, 0, //
+      7, 0, ...';41=25?'.codeUnits, //
+      0, 0, //
+      2, 0, ...'d1'.codeUnits, //
+      3, 0, ...'01 '.codeUnits, //
+      1, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, //
+      3, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, //
+      0x05, 0x01, 0, 0, 0, 0, 0, 0,
+    ]);
+
+    final cardData = MethodChannelMagtekCardReader.decodePackedSwipe(record)!;
+    expect(cardData.track2?.rawData, ';41=25?');
+    expect(cardData.rawResponse, '01 ');
+    expect(cardData.timings?.toMap(), {
+      'firstReportNs': 1,
+      'frameCompleteNs': 2,
+      'parsedNs': 3,
+      'queuedNs': 4,
+      'deliveredNs': 0x0105,
+    });
+  });
+
+  test('decodePackedSwipe takes the decoded fields of a version 3 record', () {
+    // Same bytes as the PackedSwipeCodec test in linux/test
+    final record = Uint8List.fromList([
+      3, 0x01, 0x02, 0x01, 0, 0, 0, 0, 0, 0, //
+      0, 0, //
+      7, 0, ...';41=25?'.codeUnits, //
+      0, 0, //
+      2, 0, ...'d1'.codeUnits, //
+      3, 0, ...'01 '.codeUnits, //
+      1, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, //
+      3, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, //
+      0x05, 0x01, 0, 0, 0, 0, 0, 0, //
+      3, //
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+      1, 2, 0, ...'41'.codeUnits, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    ]);
+
+    final cardData = MethodChannelMagtekCardReader.decodePackedSwipe(record)!;
+    expect(cardData.track1, isNull);
+    expect(cardData.track2?.rawData, ';41=25?');
+    expect(cardData.track2?.primaryAccountNumber, '41');
+    expect(cardData.track2?.expirationDate, isNull);
+    expect(cardData.track3, isNull);
+    expect(cardData.validation, SwipeValidation.luhnError);
+    expect(cardData.hasValidData, isTrue);
+  });
+
+  test('decodePackedSwipe reads the MagneSafe fields of an encrypted record', () {
+    final record = Uint8List.fromList([
+      3, 0x04, 0, 0, 0, 0, 0, 0, 0, 0, //
+      ...List.filled(5 * 2 + 5 * 8, 0), //
+      0, //
+      ...List.filled(3 * 13, 0), //
+      1, //
+      2, 0, 0xF0, 0xF1, //
+      1, 0, ...'B'.codeUnits, //
+      0, 0, 1, 0, 0xA5, 0, 0, //
+      0, 0, //
+      0x01, 0, 0, 0x02, //
+      0x02, 0, //
+      1, 0, 0x33,
+    ]);
+
+    final encrypted = MethodChannelMagtekCardReader.decodePackedSwipe(record)!.encrypted!;
+    expect(encrypted.decrypted, isTrue);
+    expect(encrypted.ksnHex, 'F0F1');
+    expect(encrypted.deviceSerialNumber, 'B');
+    expect(encrypted.encryptedTracks.map((track) => track.length), [0, 1, 0]);
+    expect(encrypted.magnePrintStatus, 0x02000001);
+    expect(encrypted.encryptionStatus, 0x0002);
+    expect(encrypted.sessionId, [0x33]);
+  });
+
+  test('TrackData.fromNativeFields reports failed tracks without parsing them', () {
+    final track = TrackData.fromNativeFields(1, '%B41^A^?', {'status': 'lrcError'})!;
+    expect(track.isDecoded, isFalse);
+    expect(track.errorMessage, 'Track 1 LRC mismatch');
+    expect(TrackData.fromNativeFields(3, null, {'status': 'absent'}), isNull);
+  });
+
+  test('decodePackedSwipe rejects unknown versions', () {
+    expect(MethodChannelMagtekCardReader.decodePackedSwipe(Uint8List.fromList([4, 0])), isNull);
+  });
+
+  test('SwipeStats.fromMap reads each stage and defaults missing ones', () {
+    final stats = SwipeStats.fromMap({
+      'total': {'count': 2, 'p50Ns': 1000, 'p90Ns': 2000, 'p99Ns': 2000, 'maxNs': 2100, 'meanNs': 1500},
+    });
+    expect(stats.total.count, 2);
+    expect(stats.total.p99Ns, 2000);
+    expect(stats.assembly.count, 0);
+  });
+
+  test('DeviceCommandResponse.fromMap reads the result code and data', () {
+    final response = DeviceCommandResponse.fromMap({
+      'resultCode': 0,
+      'data': Uint8List.fromList([1, 2]),
+    });
+    expect(response.isSuccess, isTrue);
+    expect(response.data, [1, 2]);
+    expect(DeviceCommandResponse.fromMap({'resultCode': 2}).isSuccess, isFalse);
+  });
 }
@@ -1,8 +1,18 @@
+import 'dart:typed_data';
+import 'dart:ui' show AppLifecycleState;
+
 import 'package:flutter_test/flutter_test.dart';
 import 'package:magtek_card_reader/magtek_card_reader_platform_interface.dart';
 import 'package:magtek_card_reader/magtek_card_reader_method_channel.dart';
 import 'package:magtek_card_reader/src/models/card_data.dart';
+import 'package:magtek_card_reader/src/models/device_command_response.dart';
 import 'package:magtek_card_reader/src/models/device_info.dart';
+import 'package:magtek_card_reader/src/models/device_metrics.dart';
+import 'package:magtek_card_reader/src/models/log_level.dart';
+import 'package:magtek_card_reader/src/models/raw_response_mode.dart';
+import 'package:magtek_card_reader/src/models/swipe_batch_options.dart';
+import 'package:magtek_card_reader/src/models/swipe_event_encoding.dart';
+import 'package:magtek_card_reader/src/models/swipe_stats.dart';
 import 'package:magtek_card_reader/src/exceptions/magtek_exceptions.dart';
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
@@ -19,11 +29,22 @@ class MockMagtekCardReaderPlatform
   @override
   Stream<DeviceInfo> get onDeviceConnected => Stream.empty();
 
+  @override
+  Stream<DeviceInfo> get onDeviceDisconnected => Stream.empty();
+
   @override
   Stream<MagtekException> get onError => Stream.empty();
 
   @override
-  Future<void> initialize() async {}
+  Future<void> initialize({
+    RawResponseMode rawResponseMode = RawResponseMode.hex,
+    SwipeEventEncoding swipeEventEncoding = SwipeEventEncoding.map,
+    SwipeBatchOptions? swipeBatching,
+    bool rejectInvalidSwipes = false,
+    bool idlePowerSaving = false,
+    Duration? duplicateSwipeWindow,
+    bool rememberDevices = false,
+  }) async {}
 
   @override
   Future<void> dispose() async {}
@@ -34,11 +55,46 @@ class MockMagtekCardReaderPlatform
   @override
   Future<bool> connectToDevice(String deviceId) async => true;
 
+  @override
+  Future<bool> openDevice(String deviceId) async => true;
+
+  @override
+  Future<void> closeDevice(String deviceId) async {}
+
   @override
   Future<void> disconnect() async {}
 
   @override
   Future<bool> isConnected() async => false;
+
+  @override
+  Future<void> setRawResponseMode(RawResponseMode mode) async {}
+
+  @override
+  Future<SwipeStats> getStats({bool reset = false}) async => SwipeStats.fromMap(const {});
+
+  @override
+  Future<Map<String, DeviceMetrics>> getMetrics() async => {};
+
+  @override
+  Future<void> setLogLevel(MagtekLogLevel level) async {}
+
+  @override
+  Future<bool> setTracing(bool enabled) async => enabled;
+
+  @override
+  Future<void> setAppLifecycleState(AppLifecycleState state) async {}
+
+  @override
+  Future<DeviceCommandResponse> sendCommand(String deviceId, int command,
+          {Uint8List? data, Duration timeout = const Duration(seconds: 2)}) async =>
+      DeviceCommandResponse(resultCode: 0, data: Uint8List(0));
+
+  @override
+  Future<bool> startCapture(String deviceId, String path) => Future.value(true);
+
+  @override
+  Future<void> stopCapture(String deviceId) => Future.value();
 }
 
 void main() {
@@ -0,0 +1,124 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:magtek_card_reader/src/pipeline/swipe_pipeline.dart';
+
+/// One case of test/conformance/swipe_pipeline_vectors.txt, which the native
+/// core's tests run too.
+class ConformanceCase {
+  final String name;
+  int productId = 0;
+  int dedupMs = 0;
+  final List<(int, Uint8List)> reports = [];
+  final List<String> swipes = [];
+  int duplicates = 0;
+
+  ConformanceCase(this.name);
+}
+
+/// A report line's ID, size and payload, its escapes decoded.
+Uint8List decodeReport(String id, int size, String payload) {
+  final report = <int>[int.parse(id, radix: 16)];
+  for (var i = 0; i < payload.length; i++) {
+    if (payload[i] != r'\' || i + 1 == payload.length) {
+      report.add(payload.codeUnitAt(i));
+      continue;
+    }
+    final escape = payload[++i];
+    if (escape == 'x') {
+      report.add(int.parse(payload.substring(i + 1, i + 3), radix: 16));
+      i += 2;
+    } else {
+      report.add(escape == 'r' ? 0x0D : escape == 'n' ? 0x0A : escape.codeUnitAt(0));
+    }
+  }
+  while (report.length < size) {
+    report.add(0);
+  }
+  return Uint8List.fromList(report);
+}
+
+List<ConformanceCase> loadCases(String path) {
+  final cases = <ConformanceCase>[];
+  for (final line in File(path).readAsLinesSync()) {
+    final fields = line.trim().split(' ');
+    if (line.isEmpty || line.startsWith('#') || fields.first.isEmpty) {
+      continue;
+    }
+
+    switch (fields.first) {
+      case 'case':
+        cases.add(ConformanceCase(fields[1]));
+      case 'product':
+        cases.last.productId = int.parse(fields[1], radix: 16);
+      case 'dedup':
+        cases.last.dedupMs = int.parse(fields[1]);
+      case 'duplicates':
+        cases.last.duplicates = int.parse(fields[1]);
+      case 'swipe':
+        cases.last.swipes.add(line.length > 6 ? line.substring(6) : '');
+      case 'report':
+        final payload = fields.length > 4 ? line.split(' ').skip(4).join(' ') : '';
+        cases.last.reports.add((
+          int.parse(fields[1]),
+          decodeReport(fields[2], int.parse(fields[3]), payload),
+        ));
+    }
+  }
+  return cases;
+}
+
+/// What the pipeline makes of a case's reports, as "track1|track2|track3"
+/// per swipe.
+(List<String>, int) runCase(ConformanceCase testCase) {
+  final pipeline = SwipePipeline(
+    productId: testCase.productId,
+    duplicateWindow: Duration(milliseconds: testCase.dedupMs),
+  );
+  final swipes = <String>[];
+  void take(PipelineSwipe? swipe) {
+    if (swipe != null) {
+      swipes.add(swipe.tracks.join('|'));
+    }
+  }
+
+  var now = Duration.zero;
+  for (final (atMs, report) in testCase.reports) {
+    now = Duration(milliseconds: atMs);
+    take(pipeline.checkTimeout(now));
+    take(pipeline.addReport(report, now));
+  }
+  take(pipeline.checkTimeout(now + const Duration(seconds: 1)));
+  return (swipes, pipeline.duplicates);
+}
+
+void main() {
+  final cases = loadCases('test/conformance/swipe_pipeline_vectors.txt');
+
+  test('loads the shared vectors', () {
+    expect(cases.length, greaterThanOrEqualTo(8));
+  });
+
+  for (final testCase in cases) {
+    test('matches the native pipeline: ${testCase.name}', () {
+      final (swipes, duplicates) = runCase(testCase);
+      expect(swipes, testCase.swipes);
+      expect(duplicates, testCase.duplicates);
+    });
+  }
+
+  test('formats raw responses as the native plugins do', () {
+    expect(ReportParser.formatHex(Uint8List.fromList([0x01, 0x3f, 0x00])), '01 3f 00 ');
+  });
+
+  test('reports how long the pending frame has left', () {
+    final pipeline = SwipePipeline(productId: 0x0010);
+    expect(pipeline.timeUntilTimeout(Duration.zero), isNull);
+
+    pipeline.addReport(decodeReport('01', 8, ';41=25?'), Duration.zero);
+    expect(pipeline.hasPendingFrame, isTrue);
+    expect(pipeline.timeUntilTimeout(const Duration(milliseconds: 5)), const Duration(milliseconds: 15));
+    expect(pipeline.timeUntilTimeout(const Duration(milliseconds: 50)), Duration.zero);
+  });
+}
@@ -0,0 +1,47 @@
+#include "etw_trace_sink.h"
+
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+#include "logger.h"
+
+// Magtek.CardReader; the GUID is the ETW name hash of the provider name
+TRACELOGGING_DEFINE_PROVIDER(
+    g_magtek_trace_provider,
+    "Magtek.CardReader",
+    (0x5b4dc7e4, 0x74c0, 0x5bed, 0xbf, 0x17, 0x7c, 0xd0, 0x87, 0x5b, 0xab, 0x43));
+
+EtwTraceSink::EtwTraceSink() : registered_(false) {
+    HRESULT result = TraceLoggingRegister(g_magtek_trace_provider);
+    registered_ = SUCCEEDED(result);
+    if (!registered_) {
+        MAGTEK_LOG(LogLevel::kWarning, "Can't register the ETW provider (0x" << std::hex << result
+                                           << "), tracing is unavailable");
+    }
+}
+
+EtwTraceSink* EtwTraceSink::Instance() {
+    // Never destroyed or unregistered: a read thread may still be inside a
+    // slice at exit, and the plugin DLL stays loaded until then
+    static EtwTraceSink* sink = new EtwTraceSink();
+    return sink;
+}
+
+bool EtwTraceSink::IsAvailable() const {
+    return registered_;
+}
+
+void EtwTraceSink::BeginSlice(const char* name, const std::string& device_id, size_t report_size) {
+    TraceLoggingWrite(g_magtek_trace_provider, "Stage",
+                      TraceLoggingOpcode(WINEVENT_OPCODE_START),
+                      TraceLoggingString(name, "Name"),
+                      TraceLoggingString(device_id.c_str(), "DeviceId"),
+                      TraceLoggingUInt64(static_cast<UINT64>(report_size), "ReportSize"));
+}
+
+void EtwTraceSink::EndSlice(const char* name) {
+    TraceLoggingWrite(g_magtek_trace_provider, "Stage",
+                      TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+                      TraceLoggingString(name, "Name"));
+}
@@ -0,0 +1,34 @@
+#ifndef ETW_TRACE_SINK_H_
+#define ETW_TRACE_SINK_H_
+
+#include <cstddef>
+#include <string>
+
+#include "trace_events.h"
+
+// Writes the swipe pipeline's trace slices as TraceLogging (ETW) events of
+// the "Magtek.CardReader" provider. Its GUID,
+// {5b4dc7e4-74c0-5bed-bf17-7cd0875bab43}, is the one derived from the name,
+// so wpr, tracelog and PerfView can enable it as *Magtek.CardReader. A slice
+// is a "Stage" event with the start opcode followed by one with the stop
+// opcode on the same thread, carrying the stage name, device ID and report
+// size; WPA pairs them into regions. Events cost next to nothing while no
+// session listens.
+class EtwTraceSink : public TraceSink {
+public:
+    // The process's sink; the provider is registered on first use
+    static EtwTraceSink* Instance();
+
+    // Whether the provider registered
+    bool IsAvailable() const;
+
+    void BeginSlice(const char* name, const std::string& device_id, size_t report_size) override;
+    void EndSlice(const char* name) override;
+
+private:
+    EtwTraceSink();
+
+    bool registered_;
+};
+
+#endif  // ETW_TRACE_SINK_H_
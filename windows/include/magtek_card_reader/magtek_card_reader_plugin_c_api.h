@@ -16,6 +16,19 @@ extern "C" {
 FLUTTER_PLUGIN_EXPORT void MagtekCardReaderPluginCApiRegisterWithRegistrar(
     FlutterDesktopPluginRegistrarRef registrar);
 
+// Decrypts one track of a MagneSafe encrypted swipe, e.g. by handing the KSN
+// and ciphertext to an HSM. Called on a reader's read thread, so it must be
+// thread-safe. Writes at most plaintext_capacity bytes of plaintext and
+// returns how many, or -1 to deliver the reader's masked track instead.
+typedef int (*MagtekTrackDecryptFunc)(void* user_data, const unsigned char* ksn, size_t ksn_length,
+                                      int track_number, const unsigned char* ciphertext,
+                                      size_t ciphertext_length, char* plaintext, size_t plaintext_capacity);
+
+// Install the track decryptor, or remove it with a null func. Decrypted
+// tracks never cross the platform channel unless one is installed.
+FLUTTER_PLUGIN_EXPORT void MagtekCardReaderPluginCApiSetTrackDecryptor(MagtekTrackDecryptFunc func,
+                                                                      void* user_data);
+
 #if defined(__cplusplus)
 }  // extern "C"
 #endif
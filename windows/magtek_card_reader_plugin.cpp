@@ -14,14 +14,50 @@
 
 #include <memory>
 #include <sstream>
+#include <utility>
 
+#include "etw_trace_sink.h"
+#include "ffi_bridge.h"
+#include "logger.h"
+#include "packed_swipe_codec.h"
+#include "serial_executor.h"
+#include "trace_events.h"
 #include "windows_usb_device_manager.h"
 
 namespace magtek_card_reader {
 
+// A device event on its way from the thread that raised it to the platform thread
+struct MagtekCardReaderPlugin::PendingDeviceEvent {
+  DeviceEventType type;
+  DeviceInfo device_info;
+};
+
+// Sends the read loop's trace slices to ETW, or stops. False if the
+// provider couldn't be registered, in which case tracing stays off.
+static bool SetTracing(bool enabled) {
+  if (!enabled) {
+    Tracer::SetSink(nullptr);
+    return true;
+  }
+
+  EtwTraceSink* sink = EtwTraceSink::Instance();
+  if (!sink->IsAvailable()) {
+    return false;
+  }
+  Tracer::SetSink(sink);
+  return true;
+}
+
 // static
 void MagtekCardReaderPlugin::RegisterWithRegistrar(
     flutter::PluginRegistrarWindows *registrar) {
+
+  // MAGTEK_TRACE traces from startup, before Dart can ask to
+  char trace[8];
+  DWORD trace_length = GetEnvironmentVariableA("MAGTEK_TRACE", trace, static_cast<DWORD>(sizeof(trace)));
+  if (trace_length > 0 && trace_length < sizeof(trace) && std::string(trace, trace_length) != "0") {
+    SetTracing(true);
+  }
   
   // Create method channel
   auto method_channel =
@@ -40,7 +76,7 @@ void MagtekCardReaderPlugin::RegisterWithRegistrar(
           registrar->messenger(), "magtek_card_reader/device_events",
           &flutter::StandardMethodCodec::GetInstance());
 
-  auto plugin = std::make_unique<MagtekCardReaderPlugin>();
+  auto plugin = std::make_unique<MagtekCardReaderPlugin>(registrar);
 
   // Set up method channel
   method_channel->SetMethodCallHandler(
@@ -84,12 +120,165 @@ void MagtekCardReaderPlugin::RegisterWithRegistrar(
 }
 
 MagtekCardReaderPlugin::MagtekCardReaderPlugin() 
-    : device_manager_(std::make_unique<WindowsUsbDeviceManager>()) {}
+    : device_manager_(std::make_unique<WindowsUsbDeviceManager>()),
+      control_executor_(std::make_unique<SerialExecutor>()),
+      registrar_(nullptr),
+      window_proc_id_(-1),
+      drain_swipes_message_(RegisterWindowMessage(L"MagtekCardReaderDrainSwipes")),
+      drain_window_(nullptr),
+      swipe_drain_scheduled_(false),
+      packed_swipe_events_(false),
+      batch_swipes_(false),
+      batch_window_ms_(0),
+      batch_max_events_(0),
+      batch_low_latency_(false),
+      batch_timer_armed_(false),
+      initialized_(false),
+      card_swipe_listening_(false),
+      app_active_(true),
+      monitoring_(false),
+      device_events_message_(RegisterWindowMessage(L"MagtekCardReaderDeviceEvents")),
+      platform_tasks_message_(RegisterWindowMessage(L"MagtekCardReaderPlatformTasks")) {
+  // Lets the dart:ffi binding query the manager and take swipes directly
+  FfiBridge::Attach(device_manager_.get());
+}
+
+MagtekCardReaderPlugin::MagtekCardReaderPlugin(flutter::PluginRegistrarWindows *registrar)
+    : MagtekCardReaderPlugin() {
+  registrar_ = registrar;
+  window_proc_id_ = registrar_->RegisterTopLevelWindowProcDelegate(
+      [this](HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+        return HandleWindowProc(hwnd, message, wparam, lparam);
+      });
+}
 
 MagtekCardReaderPlugin::~MagtekCardReaderPlugin() {
+  // Finishes any queued control calls before the manager goes away
+  control_executor_.reset();
   if (device_manager_) {
+    FfiBridge::Detach(device_manager_.get());
     device_manager_->Cleanup();
   }
+  if (batch_timer_armed_ && drain_window_) {
+    KillTimer(drain_window_, reinterpret_cast<UINT_PTR>(this));
+  }
+  if (registrar_ && window_proc_id_ >= 0) {
+    registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_id_);
+  }
+}
+
+std::optional<LRESULT> MagtekCardReaderPlugin::HandleWindowProc(
+    HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+  if (message == device_events_message_) {
+    DrainDeviceEvents();
+    return 0;
+  }
+  if (message == platform_tasks_message_) {
+    DrainPlatformTasks();
+    return 0;
+  }
+  // The batch window timer is keyed by this plugin's address
+  if (message == WM_TIMER && wparam == reinterpret_cast<WPARAM>(this)) {
+    FlushSwipeBatch();
+    return 0;
+  }
+  if (message != drain_swipes_message_) {
+    return std::nullopt;
+  }
+
+  // Clear first so a swipe queued while draining posts another message
+  swipe_drain_scheduled_ = false;
+  if (device_manager_) {
+    device_manager_->DrainCardSwipes();
+  }
+
+  // Nothing else is waiting, so holding the batch back only adds latency;
+  // otherwise the window timer armed by the first event flushes it
+  if (batch_low_latency_ && !pending_swipes_.empty()) {
+    FlushSwipeBatch();
+  }
+  return 0;
+}
+
+void MagtekCardReaderPlugin::ScheduleSwipeDrain() {
+  if (!drain_window_) {
+    return;
+  }
+
+  // Coalesce wake-ups so a burst of swipes is delivered in one pass
+  if (!swipe_drain_scheduled_.exchange(true)) {
+    PostMessage(drain_window_, drain_swipes_message_, 0, 0);
+  }
+}
+
+void MagtekCardReaderPlugin::ScheduleDeviceEvent(DeviceEventType type,
+                                                 DeviceInfo&& device_info) {
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(device_events_mutex_);
+    was_empty = pending_device_events_.empty();
+    pending_device_events_.push_back(PendingDeviceEvent{type, std::move(device_info)});
+  }
+
+  // One message per batch; the drain takes everything queued by then
+  if (was_empty && drain_window_) {
+    PostMessage(drain_window_, device_events_message_, 0, 0);
+  }
+}
+
+void MagtekCardReaderPlugin::DrainDeviceEvents() {
+  std::vector<PendingDeviceEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(device_events_mutex_);
+    events.swap(pending_device_events_);
+  }
+
+  // The manager itself reopens or closes an unplugged reader's dead handle
+  for (const auto& event : events) {
+    SendDeviceEvent(event.type, event.device_info);
+  }
+}
+
+void MagtekCardReaderPlugin::RespondFromExecutor(
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+    std::function<Completion()> work) {
+  if (!drain_window_) {
+    work()(result.get());
+    return;
+  }
+
+  // MethodResult is move-only and std::function needs a copyable target
+  std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> pending(std::move(result));
+  control_executor_->Post([this, pending, work]() {
+    Completion complete = work();
+    RunOnPlatformThread([pending, complete]() { complete(pending.get()); });
+  });
+}
+
+void MagtekCardReaderPlugin::RunOnPlatformThread(std::function<void()> task) {
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(platform_tasks_mutex_);
+    was_empty = pending_platform_tasks_.empty();
+    pending_platform_tasks_.push_back(std::move(task));
+  }
+
+  // One message per batch, as for device events
+  if (was_empty) {
+    PostMessage(drain_window_, platform_tasks_message_, 0, 0);
+  }
+}
+
+void MagtekCardReaderPlugin::DrainPlatformTasks() {
+  std::vector<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(platform_tasks_mutex_);
+    tasks.swap(pending_platform_tasks_);
+  }
+
+  for (const auto& task : tasks) {
+    task();
+  }
 }
 
 void MagtekCardReaderPlugin::HandleMethodCall(
@@ -111,56 +300,238 @@ void MagtekCardReaderPlugin::HandleMethodCall(
     result->Success(flutter::EncodableValue(version_stream.str()));
   } 
   else if (method_name == "initialize") {
-    HandleInitialize(result);
+    HandleInitialize(method_call, std::move(result));
   }
   else if (method_name == "dispose") {
-    HandleDispose(result);
+    HandleDispose(std::move(result));
   }
   else if (method_name == "getConnectedDevices") {
-    HandleGetConnectedDevices(result);
+    HandleGetConnectedDevices(std::move(result));
   }
   else if (method_name == "connectToDevice") {
-    HandleConnectToDevice(method_call, result);
+    HandleConnectToDevice(method_call, std::move(result));
+  }
+  else if (method_name == "openDevice") {
+    HandleOpenDevice(method_call, std::move(result));
+  }
+  else if (method_name == "closeDevice") {
+    HandleCloseDevice(method_call, std::move(result));
   }
   else if (method_name == "disconnect") {
-    HandleDisconnect(result);
+    HandleDisconnect(std::move(result));
   }
   else if (method_name == "isConnected") {
-    HandleIsConnected(result);
+    HandleIsConnected(std::move(result));
+  }
+  else if (method_name == "setRawResponseMode") {
+    HandleSetRawResponseMode(method_call, std::move(result));
+  }
+  else if (method_name == "getStats") {
+    HandleGetStats(method_call, std::move(result));
+  }
+  else if (method_name == "getMetrics") {
+    HandleGetMetrics(std::move(result));
+  }
+  else if (method_name == "setLogLevel") {
+    HandleSetLogLevel(method_call, std::move(result));
+  }
+  else if (method_name == "setTracing") {
+    HandleSetTracing(method_call, std::move(result));
+  }
+  else if (method_name == "setAppLifecycleState") {
+    HandleSetAppLifecycleState(method_call, std::move(result));
+  }
+  else if (method_name == "sendCommand") {
+    HandleSendCommand(method_call, std::move(result));
+  }
+  else if (method_name == "startCapture") {
+    HandleStartCapture(method_call, std::move(result));
+  }
+  else if (method_name == "stopCapture") {
+    HandleStopCapture(method_call, std::move(result));
   }
   else {
     result->NotImplemented();
   }
 }
 
+// Parses a raw response mode name ("off", "hex" or "binary")
+static bool ParseRawResponseMode(const flutter::EncodableValue& value, RawResponseMode* mode) {
+  const auto* name = std::get_if<std::string>(&value);
+  if (!name) {
+    return false;
+  }
+
+  if (*name == "off") {
+    *mode = RawResponseMode::kOff;
+  } else if (*name == "hex") {
+    *mode = RawResponseMode::kHex;
+  } else if (*name == "binary") {
+    *mode = RawResponseMode::kBinary;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Where the "rememberDevices" option keeps the readers it has opened: the
+// MAGTEK_DEVICE_CACHE environment variable, or else a file under
+// %LOCALAPPDATA%. Kept in the ANSI code page, which is what the core's file
+// streams take. Empty if neither is available.
+static std::string DeviceIdentityCachePath() {
+  char buffer[MAX_PATH];
+  DWORD length = GetEnvironmentVariableA("MAGTEK_DEVICE_CACHE", buffer, MAX_PATH);
+  if (length > 0 && length < MAX_PATH) {
+    return std::string(buffer, length);
+  }
+
+  length = GetEnvironmentVariableA("LOCALAPPDATA", buffer, MAX_PATH);
+  if (length == 0 || length >= MAX_PATH) {
+    MAGTEK_LOG(LogLevel::kWarning, "No LOCALAPPDATA, not remembering devices");
+    return std::string();
+  }
+  std::string directory = std::string(buffer, length) + "\\magtek_card_reader";
+  if (!CreateDirectoryA(directory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) {
+    MAGTEK_LOG(LogLevel::kWarning, "Can't create " << directory << ", not remembering devices");
+    return std::string();
+  }
+  return directory + "\\devices";
+}
+
 void MagtekCardReaderPlugin::HandleInitialize(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  
-  if (!device_manager_->Initialize()) {
-    result->Error("INITIALIZATION_FAILED", "Failed to initialize USB device manager");
-    return;
+
+  // Options are optional; older callers send no arguments at all
+  RawResponseMode raw_mode = RawResponseMode::kHex;
+  bool packed_swipe_events = false;
+  bool reject_invalid_swipes = false;
+  bool idle_power_saving = false;
+  int32_t duplicate_swipe_window_ms = 0;
+  bool remember_devices = false;
+  if (const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments())) {
+    auto raw_mode_it = arguments->find(flutter::EncodableValue("rawResponseMode"));
+    if (raw_mode_it != arguments->end() && !ParseRawResponseMode(raw_mode_it->second, &raw_mode)) {
+      result->Error("INVALID_ARGUMENTS", "rawResponseMode must be off, hex or binary");
+      return;
+    }
+
+    auto encoding_it = arguments->find(flutter::EncodableValue("swipeEventEncoding"));
+    if (encoding_it != arguments->end()) {
+      const auto* encoding = std::get_if<std::string>(&encoding_it->second);
+      if (!encoding || (*encoding != "map" && *encoding != "packed")) {
+        result->Error("INVALID_ARGUMENTS", "swipeEventEncoding must be map or packed");
+        return;
+      }
+      packed_swipe_events = *encoding == "packed";
+    }
+
+    auto reject_it = arguments->find(flutter::EncodableValue("rejectInvalidSwipes"));
+    if (reject_it != arguments->end()) {
+      const auto* reject = std::get_if<bool>(&reject_it->second);
+      if (!reject) {
+        result->Error("INVALID_ARGUMENTS", "rejectInvalidSwipes must be a bool");
+        return;
+      }
+      reject_invalid_swipes = *reject;
+    }
+
+    auto power_saving_it = arguments->find(flutter::EncodableValue("idlePowerSaving"));
+    if (power_saving_it != arguments->end()) {
+      const auto* power_saving = std::get_if<bool>(&power_saving_it->second);
+      if (!power_saving) {
+        result->Error("INVALID_ARGUMENTS", "idlePowerSaving must be a bool");
+        return;
+      }
+      idle_power_saving = *power_saving;
+    }
+
+    auto window_it = arguments->find(flutter::EncodableValue("duplicateSwipeWindowMs"));
+    if (window_it != arguments->end()) {
+      const auto* window_ms = std::get_if<int32_t>(&window_it->second);
+      if (!window_ms || *window_ms < 0) {
+        result->Error("INVALID_ARGUMENTS", "duplicateSwipeWindowMs must be a non-negative int");
+        return;
+      }
+      duplicate_swipe_window_ms = *window_ms;
+    }
+
+    auto remember_it = arguments->find(flutter::EncodableValue("rememberDevices"));
+    if (remember_it != arguments->end()) {
+      const auto* remember = std::get_if<bool>(&remember_it->second);
+      if (!remember) {
+        result->Error("INVALID_ARGUMENTS", "rememberDevices must be a bool");
+        return;
+      }
+      remember_devices = *remember;
+    }
+  }
+  packed_swipe_events_ = packed_swipe_events;
+
+  if (const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments())) {
+    auto batching_it = arguments->find(flutter::EncodableValue("swipeBatching"));
+    if (!ApplySwipeBatching(batching_it == arguments->end() ? nullptr : &batching_it->second)) {
+      result->Error("INVALID_ARGUMENTS",
+                    "swipeBatching needs windowMs >= 1, maxEvents >= 1 and lowLatency");
+      return;
+    }
+  } else {
+    ApplySwipeBatching(nullptr);
+  }
+  device_manager_->SetRawResponseMode(raw_mode);
+  device_manager_->SetRejectInvalidSwipes(reject_invalid_swipes);
+  device_manager_->SetReadMode(idle_power_saving ? ReadMode::kAdaptive : ReadMode::kEventDriven);
+  device_manager_->SetDuplicateSwipeWindow(duplicate_swipe_window_ms);
+  device_manager_->SetDeviceIdentityCache(remember_devices ? DeviceIdentityCachePath() : std::string());
+
+  // Read and hotplug threads queue events; they are sent from the window
+  // procedure on the platform thread, where the event sinks must be used
+  if (registrar_ && registrar_->GetView()) {
+    drain_window_ = GetAncestor(registrar_->GetView()->GetNativeWindow(), GA_ROOT);
   }
 
+  // Hotplug events can fire as soon as Initialize returns, so the callback
+  // has to be in place first
+  device_manager_->SetDeviceEventCallback(
+      [this](DeviceEventType type, DeviceInfo&& device_info) {
+        ScheduleDeviceEvent(type, std::move(device_info));
+      });
+
   // Set up callbacks
-  device_manager_->SetCardSwipeCallback([this](const CardData& card_data) {
+  device_manager_->SetCardSwipeCallback([this](CardData&& card_data) {
     SendCardSwipeEvent(card_data);
   });
 
-  device_manager_->SetDeviceConnectionCallback([this](const DeviceInfo& device_info) {
-    SendDeviceEvent(device_info);
+  device_manager_->SetSwipeQueuedCallback([this]() {
+    ScheduleSwipeDrain();
   });
 
-  device_manager_->StartMonitoring();
+  // Initializing scans the bus, so it runs on the control executor
+  RespondFromExecutor(std::move(result), [this]() -> Completion {
+    if (!device_manager_->Initialize()) {
+      return [](auto* result) {
+        result->Error("INITIALIZATION_FAILED", "Failed to initialize USB device manager");
+      };
+    }
 
-  result->Success();
+    return [](auto* result) { result->Success(); };
+  });
+
+  // Monitoring starts after the scan, once Dart is listening
+  initialized_ = true;
+  UpdateMonitoring();
 }
 
 void MagtekCardReaderPlugin::HandleDispose(
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   
   if (device_manager_) {
+    // Calls already handed to the executor finish against the manager first
+    control_executor_->WaitIdle();
     device_manager_->Cleanup();
   }
+  initialized_ = false;
+  monitoring_ = false;
 
   result->Success();
 }
@@ -173,23 +544,53 @@ void MagtekCardReaderPlugin::HandleGetConnectedDevices(
     return;
   }
 
-  auto devices = device_manager_->GetConnectedDevices();
-  flutter::EncodableList device_list;
+  // Without hotplug support this rescans the bus
+  RespondFromExecutor(std::move(result), [this]() -> Completion {
+    auto devices = device_manager_->GetConnectedDevices();
+    flutter::EncodableList device_list;
 
-  for (const auto& device : devices) {
-    flutter::EncodableMap device_map;
-    device_map[flutter::EncodableValue("deviceId")] = flutter::EncodableValue(device.device_id);
-    device_map[flutter::EncodableValue("deviceName")] = flutter::EncodableValue(device.device_name);
-    device_map[flutter::EncodableValue("vendorId")] = flutter::EncodableValue(static_cast<int>(device.vendor_id));
-    device_map[flutter::EncodableValue("productId")] = flutter::EncodableValue(static_cast<int>(device.product_id));
-    device_map[flutter::EncodableValue("serialNumber")] = flutter::EncodableValue(device.serial_number);
-    device_map[flutter::EncodableValue("devicePath")] = flutter::EncodableValue(device.device_path);
-    device_map[flutter::EncodableValue("isConnected")] = flutter::EncodableValue(device.is_connected);
+    for (const auto& device : devices) {
+      flutter::EncodableMap device_map;
+      device_map[flutter::EncodableValue("deviceId")] = flutter::EncodableValue(device.device_id);
+      device_map[flutter::EncodableValue("deviceName")] = flutter::EncodableValue(device.device_name);
+      device_map[flutter::EncodableValue("vendorId")] = flutter::EncodableValue(static_cast<int>(device.vendor_id));
+      device_map[flutter::EncodableValue("productId")] = flutter::EncodableValue(static_cast<int>(device.product_id));
+      device_map[flutter::EncodableValue("serialNumber")] = flutter::EncodableValue(device.serial_number);
+      device_map[flutter::EncodableValue("devicePath")] = flutter::EncodableValue(device.device_path);
+      device_map[flutter::EncodableValue("isConnected")] = flutter::EncodableValue(device.is_connected);
+
+      device_list.emplace_back(device_map);
+    }
 
-    device_list.emplace_back(device_map);
+    return [device_list = std::move(device_list)](auto* result) {
+      result->Success(flutter::EncodableValue(device_list));
+    };
+  });
+}
+
+const std::string* MagtekCardReaderPlugin::GetDeviceIdArgument(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    flutter::MethodResult<flutter::EncodableValue>* result) {
+  
+  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  if (!arguments) {
+    result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+    return nullptr;
   }
 
-  result->Success(flutter::EncodableValue(device_list));
+  auto device_id_it = arguments->find(flutter::EncodableValue("deviceId"));
+  if (device_id_it == arguments->end()) {
+    result->Error("INVALID_ARGUMENTS", "deviceId is required");
+    return nullptr;
+  }
+
+  const auto* device_id = std::get_if<std::string>(&device_id_it->second);
+  if (!device_id) {
+    result->Error("INVALID_ARGUMENTS", "deviceId must be a string");
+    return nullptr;
+  }
+
+  return device_id;
 }
 
 void MagtekCardReaderPlugin::HandleConnectToDevice(
@@ -201,26 +602,56 @@ void MagtekCardReaderPlugin::HandleConnectToDevice(
     return;
   }
 
-  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-  if (!arguments) {
-    result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+  const std::string* device_id = GetDeviceIdArgument(method_call, result.get());
+  if (!device_id) {
     return;
   }
 
-  auto device_id_it = arguments->find(flutter::EncodableValue("deviceId"));
-  if (device_id_it == arguments->end()) {
-    result->Error("INVALID_ARGUMENTS", "deviceId is required");
+  RespondFromExecutor(std::move(result), [this, id = *device_id]() -> Completion {
+    bool success = device_manager_->ConnectToDevice(id);
+    return [success](auto* result) { result->Success(flutter::EncodableValue(success)); };
+  });
+}
+
+void MagtekCardReaderPlugin::HandleOpenDevice(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  
+  if (!device_manager_) {
+    result->Error("NOT_INITIALIZED", "Device manager not initialized");
     return;
   }
 
-  const auto* device_id = std::get_if<std::string>(&device_id_it->second);
+  const std::string* device_id = GetDeviceIdArgument(method_call, result.get());
   if (!device_id) {
-    result->Error("INVALID_ARGUMENTS", "deviceId must be a string");
     return;
   }
 
-  bool success = device_manager_->ConnectToDevice(*device_id);
-  result->Success(flutter::EncodableValue(success));
+  RespondFromExecutor(std::move(result), [this, id = *device_id]() -> Completion {
+    bool success = device_manager_->OpenDevice(id);
+    return [success](auto* result) { result->Success(flutter::EncodableValue(success)); };
+  });
+}
+
+void MagtekCardReaderPlugin::HandleCloseDevice(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  
+  if (!device_manager_) {
+    result->Error("NOT_INITIALIZED", "Device manager not initialized");
+    return;
+  }
+
+  const std::string* device_id = GetDeviceIdArgument(method_call, result.get());
+  if (!device_id) {
+    return;
+  }
+
+  // Closing joins the device's read thread
+  RespondFromExecutor(std::move(result), [this, id = *device_id]() -> Completion {
+    device_manager_->CloseDevice(id);
+    return [](auto* result) { result->Success(); };
+  });
 }
 
 void MagtekCardReaderPlugin::HandleDisconnect(
@@ -231,8 +662,10 @@ void MagtekCardReaderPlugin::HandleDisconnect(
     return;
   }
 
-  device_manager_->Disconnect();
-  result->Success();
+  RespondFromExecutor(std::move(result), [this]() -> Completion {
+    device_manager_->Disconnect();
+    return [](auto* result) { result->Success(); };
+  });
 }
 
 void MagtekCardReaderPlugin::HandleIsConnected(
@@ -247,9 +680,329 @@ void MagtekCardReaderPlugin::HandleIsConnected(
   result->Success(flutter::EncodableValue(connected));
 }
 
+void MagtekCardReaderPlugin::HandleSetRawResponseMode(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  if (!arguments) {
+    result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+    return;
+  }
+
+  RawResponseMode raw_mode;
+  auto mode_it = arguments->find(flutter::EncodableValue("mode"));
+  if (mode_it == arguments->end() || !ParseRawResponseMode(mode_it->second, &raw_mode)) {
+    result->Error("INVALID_ARGUMENTS", "mode must be off, hex or binary");
+    return;
+  }
+
+  device_manager_->SetRawResponseMode(raw_mode);
+  result->Success();
+}
+
+void MagtekCardReaderPlugin::HandleGetStats(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  // The histograms are lock-free, so this never waits on the read threads
+  flutter::EncodableMap stages;
+  for (int i = 0; i < SWIPE_STAGE_COUNT; i++) {
+    SwipeStage stage = static_cast<SwipeStage>(i);
+    LatencySummary summary = device_manager_->GetStageLatency(stage);
+
+    flutter::EncodableMap stage_map;
+    stage_map[flutter::EncodableValue("count")] = flutter::EncodableValue(static_cast<int64_t>(summary.count));
+    stage_map[flutter::EncodableValue("p50Ns")] = flutter::EncodableValue(summary.p50_ns);
+    stage_map[flutter::EncodableValue("p90Ns")] = flutter::EncodableValue(summary.p90_ns);
+    stage_map[flutter::EncodableValue("p99Ns")] = flutter::EncodableValue(summary.p99_ns);
+    stage_map[flutter::EncodableValue("maxNs")] = flutter::EncodableValue(summary.max_ns);
+    stage_map[flutter::EncodableValue("meanNs")] = flutter::EncodableValue(summary.mean_ns);
+    stages[flutter::EncodableValue(SwipeLatencyStats::StageName(stage))] = flutter::EncodableValue(std::move(stage_map));
+  }
+
+  if (const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments())) {
+    auto reset_it = arguments->find(flutter::EncodableValue("reset"));
+    if (reset_it != arguments->end()) {
+      const auto* reset = std::get_if<bool>(&reset_it->second);
+      if (reset && *reset) {
+        device_manager_->ResetStats();
+      }
+    }
+  }
+
+  result->Success(flutter::EncodableValue(std::move(stages)));
+}
+
+void MagtekCardReaderPlugin::HandleGetMetrics(
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  flutter::EncodableMap devices;
+  for (const auto& metrics : device_manager_->GetMetrics()) {
+    flutter::EncodableMap counters;
+    counters[flutter::EncodableValue("reportsRead")] = flutter::EncodableValue(static_cast<int64_t>(metrics.reports_read));
+    counters[flutter::EncodableValue("bytesRead")] = flutter::EncodableValue(static_cast<int64_t>(metrics.bytes_read));
+    counters[flutter::EncodableValue("swipesParsed")] = flutter::EncodableValue(static_cast<int64_t>(metrics.swipes_parsed));
+    counters[flutter::EncodableValue("partialFrames")] = flutter::EncodableValue(static_cast<int64_t>(metrics.partial_frames));
+    counters[flutter::EncodableValue("invalidFrames")] = flutter::EncodableValue(static_cast<int64_t>(metrics.invalid_frames));
+    counters[flutter::EncodableValue("readErrors")] = flutter::EncodableValue(static_cast<int64_t>(metrics.read_errors));
+    counters[flutter::EncodableValue("queueOverflows")] = flutter::EncodableValue(static_cast<int64_t>(metrics.queue_overflows));
+    counters[flutter::EncodableValue("duplicateSwipes")] = flutter::EncodableValue(static_cast<int64_t>(metrics.duplicate_swipes));
+    counters[flutter::EncodableValue("reconnects")] = flutter::EncodableValue(static_cast<int64_t>(metrics.reconnects));
+    devices[flutter::EncodableValue(metrics.device_id)] = flutter::EncodableValue(std::move(counters));
+  }
+
+  result->Success(flutter::EncodableValue(std::move(devices)));
+}
+
+// Parses a log level name ("off", "error", "warning", "info" or "debug")
+static bool ParseLogLevel(const flutter::EncodableValue& value, LogLevel* level) {
+  const auto* name = std::get_if<std::string>(&value);
+  if (!name) {
+    return false;
+  }
+
+  if (*name == "off") {
+    *level = LogLevel::kOff;
+  } else if (*name == "error") {
+    *level = LogLevel::kError;
+  } else if (*name == "warning") {
+    *level = LogLevel::kWarning;
+  } else if (*name == "info") {
+    *level = LogLevel::kInfo;
+  } else if (*name == "debug") {
+    *level = LogLevel::kDebug;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void MagtekCardReaderPlugin::HandleSetLogLevel(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  if (!arguments) {
+    result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+    return;
+  }
+
+  LogLevel level;
+  auto level_it = arguments->find(flutter::EncodableValue("level"));
+  if (level_it == arguments->end() || !ParseLogLevel(level_it->second, &level)) {
+    result->Error("INVALID_ARGUMENTS", "level must be off, error, warning, info or debug");
+    return;
+  }
+
+  // The logger is process-wide, so this works before initialize too
+  Logger::SetLevel(level);
+  result->Success();
+}
+
+void MagtekCardReaderPlugin::HandleSetTracing(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  const bool* enabled = nullptr;
+  if (arguments) {
+    auto enabled_it = arguments->find(flutter::EncodableValue("enabled"));
+    if (enabled_it != arguments->end()) {
+      enabled = std::get_if<bool>(&enabled_it->second);
+    }
+  }
+  if (!enabled) {
+    result->Error("INVALID_ARGUMENTS", "enabled must be a bool");
+    return;
+  }
+
+  // Tracing is process-wide like the logger, so this works before
+  // initialize too
+  result->Success(flutter::EncodableValue(SetTracing(*enabled)));
+}
+
+void MagtekCardReaderPlugin::HandleSetAppLifecycleState(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  const std::string* state = nullptr;
+  if (arguments) {
+    auto state_it = arguments->find(flutter::EncodableValue("state"));
+    if (state_it != arguments->end()) {
+      state = std::get_if<std::string>(&state_it->second);
+    }
+  }
+  if (!state) {
+    result->Error("INVALID_ARGUMENTS", "state must be an AppLifecycleState name");
+    return;
+  }
+
+  // Monitoring stops while the app is hidden, paused or detached and
+  // resumes with it; the state is kept from before initialize too
+  app_active_ = *state != "hidden" && *state != "paused" && *state != "detached";
+  UpdateMonitoring();
+  result->Success();
+}
+
+void MagtekCardReaderPlugin::UpdateMonitoring() {
+  bool wanted = initialized_ && card_swipe_listening_ && app_active_;
+  if (wanted == monitoring_) {
+    return;
+  }
+  monitoring_ = wanted;
+
+  control_executor_->Post([this, wanted]() {
+    if (wanted) {
+      device_manager_->StartMonitoring();
+    } else {
+      device_manager_->StopMonitoring();
+    }
+  });
+}
+
+// Completes a method call with a command's result
+static void CompleteCommand(const CommandResult& command_result,
+                            flutter::MethodResult<flutter::EncodableValue>* result) {
+  switch (command_result.status) {
+    case CommandStatus::kOk:
+      break;
+    case CommandStatus::kNotOpen:
+      result->Error("DEVICE_NOT_OPEN", "Device is not open");
+      return;
+    case CommandStatus::kTimedOut:
+      result->Error("TIMEOUT", "Command timed out before it could run");
+      return;
+    case CommandStatus::kFailed:
+      result->Error("COMMAND_FAILED", "Command could not be sent or its response read");
+      return;
+  }
+
+  flutter::EncodableMap response;
+  response[flutter::EncodableValue("resultCode")] =
+      flutter::EncodableValue(static_cast<int32_t>(command_result.result_code));
+  response[flutter::EncodableValue("data")] = flutter::EncodableValue(command_result.data);
+  result->Success(flutter::EncodableValue(std::move(response)));
+}
+
+void MagtekCardReaderPlugin::HandleSendCommand(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  if (!device_manager_) {
+    result->Error("NOT_INITIALIZED", "Device manager not initialized");
+    return;
+  }
+
+  const std::string* device_id = GetDeviceIdArgument(method_call, result.get());
+  if (!device_id) {
+    return;
+  }
+
+  const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
+  auto lookup = [&arguments](const char* key) -> const flutter::EncodableValue* {
+    auto it = arguments.find(flutter::EncodableValue(key));
+    return it == arguments.end() ? nullptr : &it->second;
+  };
+  const auto* command_value = lookup("command");
+  const auto* data_value = lookup("data");
+  const auto* timeout_value = lookup("timeoutMs");
+  const int32_t* command_number = command_value ? std::get_if<int32_t>(command_value) : nullptr;
+  const auto* data = data_value ? std::get_if<std::vector<uint8_t>>(data_value) : nullptr;
+  const int32_t* timeout_ms = timeout_value ? std::get_if<int32_t>(timeout_value) : nullptr;
+  if (!command_number || *command_number < 0 || *command_number > 0xFF) {
+    result->Error("INVALID_ARGUMENTS", "command must be an int from 0 to 255");
+    return;
+  }
+  if (data_value && !data_value->IsNull() && !data) {
+    result->Error("INVALID_ARGUMENTS", "data must be a Uint8List");
+    return;
+  }
+  if (!timeout_ms || *timeout_ms < 1) {
+    result->Error("INVALID_ARGUMENTS", "timeoutMs must be an int >= 1");
+    return;
+  }
+
+  DeviceCommand command;
+  command.command = static_cast<unsigned char>(*command_number);
+  if (data) {
+    command.data = *data;
+  }
+  command.timeout_ms = *timeout_ms;
+
+  std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> pending(std::move(result));
+  auto complete = [this, pending](const CommandResult& command_result) {
+    if (!drain_window_) {
+      CompleteCommand(command_result, pending.get());
+      return;
+    }
+    RunOnPlatformThread([pending, command_result]() { CompleteCommand(command_result, pending.get()); });
+  };
+
+  // For a monitored device the executor only queues the command for its
+  // read thread, so a batch sent together reaches every reader at once;
+  // the result comes back from whichever thread ran it
+  control_executor_->Post([this, id = *device_id, command, complete]() {
+    device_manager_->SendCommand(id, command, complete);
+  });
+}
+
+void MagtekCardReaderPlugin::HandleStartCapture(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  if (!device_manager_) {
+    result->Error("NOT_INITIALIZED", "Device manager not initialized");
+    return;
+  }
+
+  const std::string* device_id = GetDeviceIdArgument(method_call, result.get());
+  if (!device_id) {
+    return;
+  }
+
+  const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
+  auto path_it = arguments.find(flutter::EncodableValue("path"));
+  const auto* path = path_it == arguments.end() ? nullptr : std::get_if<std::string>(&path_it->second);
+  if (!path) {
+    result->Error("INVALID_ARGUMENTS", "path must be a string");
+    return;
+  }
+
+  // Creating the file can block
+  RespondFromExecutor(std::move(result), [this, id = *device_id, path = *path]() -> Completion {
+    bool started = device_manager_->StartCapture(id, path);
+    return [started](auto* result) { result->Success(flutter::EncodableValue(started)); };
+  });
+}
+
+void MagtekCardReaderPlugin::HandleStopCapture(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+
+  if (!device_manager_) {
+    result->Error("NOT_INITIALIZED", "Device manager not initialized");
+    return;
+  }
+
+  const std::string* device_id = GetDeviceIdArgument(method_call, result.get());
+  if (!device_id) {
+    return;
+  }
+
+  RespondFromExecutor(std::move(result), [this, id = *device_id]() -> Completion {
+    device_manager_->StopCapture(id);
+    return [](auto* result) { result->Success(); };
+  });
+}
+
 void MagtekCardReaderPlugin::SetCardSwipeEventSink(
     std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> events) {
+  // Nobody taking swipes means nothing to read them for
   card_swipe_event_sink_ = std::move(events);
+  card_swipe_listening_ = card_swipe_event_sink_ != nullptr;
+  UpdateMonitoring();
 }
 
 void MagtekCardReaderPlugin::SetDeviceEventSink(
@@ -257,23 +1010,157 @@ void MagtekCardReaderPlugin::SetDeviceEventSink(
   device_event_sink_ = std::move(events);
 }
 
+// A byte field of a swipe, a view into its frame buffer, copied into the event
+static flutter::EncodableValue EncodeBytes(const ByteView& bytes) {
+  return flutter::EncodableValue(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+}
+
 void MagtekCardReaderPlugin::SendCardSwipeEvent(const CardData& card_data) {
   if (!card_swipe_event_sink_) {
     return;
   }
+  TraceScope trace("SendCardSwipeEvent", card_data.device_id, card_data.frame.size());
+
+  if (packed_swipe_events_) {
+    std::vector<uint8_t> record;
+    EncodePackedSwipe(card_data, &record);
+    DeliverCardSwipeEvent(flutter::EncodableValue(std::move(record)));
+    return;
+  }
 
   flutter::EncodableMap event_map;
-  event_map[flutter::EncodableValue("track1")] = flutter::EncodableValue(card_data.track1);
-  event_map[flutter::EncodableValue("track2")] = flutter::EncodableValue(card_data.track2);
-  event_map[flutter::EncodableValue("track3")] = flutter::EncodableValue(card_data.track3);
+  event_map[flutter::EncodableValue("track1")] = flutter::EncodableValue(card_data.track1.str());
+  event_map[flutter::EncodableValue("track2")] = flutter::EncodableValue(card_data.track2.str());
+  event_map[flutter::EncodableValue("track3")] = flutter::EncodableValue(card_data.track3.str());
   event_map[flutter::EncodableValue("deviceId")] = flutter::EncodableValue(card_data.device_id);
-  event_map[flutter::EncodableValue("rawResponse")] = flutter::EncodableValue(card_data.raw_response);
+  // Only the representation the raw response mode asked for is sent
+  if (!card_data.raw_response.empty()) {
+    event_map[flutter::EncodableValue("rawResponse")] = flutter::EncodableValue(card_data.raw_response);
+  }
+  if (!card_data.raw_bytes.empty()) {
+    event_map[flutter::EncodableValue("rawBytes")] = EncodeBytes(card_data.raw_bytes);
+  }
   event_map[flutter::EncodableValue("timestamp")] = flutter::EncodableValue(card_data.timestamp);
 
-  card_swipe_event_sink_->Success(flutter::EncodableValue(event_map));
+  flutter::EncodableMap timings;
+  timings[flutter::EncodableValue("firstReportNs")] = flutter::EncodableValue(card_data.timings.first_report_ns);
+  timings[flutter::EncodableValue("frameCompleteNs")] = flutter::EncodableValue(card_data.timings.frame_complete_ns);
+  timings[flutter::EncodableValue("parsedNs")] = flutter::EncodableValue(card_data.timings.parsed_ns);
+  timings[flutter::EncodableValue("queuedNs")] = flutter::EncodableValue(card_data.timings.queued_ns);
+  timings[flutter::EncodableValue("deliveredNs")] = flutter::EncodableValue(card_data.timings.delivered_ns);
+  event_map[flutter::EncodableValue("timings")] = flutter::EncodableValue(std::move(timings));
+
+  // Decoded track1-3, so Dart doesn't parse the tracks again
+  flutter::EncodableList track_fields;
+  for (const auto& fields : card_data.track_fields) {
+    flutter::EncodableMap fields_map;
+    fields_map[flutter::EncodableValue("status")] = flutter::EncodableValue(TrackDecoder::StatusName(fields.status));
+    fields_map[flutter::EncodableValue("accountNumber")] = flutter::EncodableValue(fields.primary_account_number.str());
+    fields_map[flutter::EncodableValue("cardholderName")] = flutter::EncodableValue(fields.cardholder_name.str());
+    fields_map[flutter::EncodableValue("expirationDate")] = flutter::EncodableValue(fields.expiration_date.str());
+    fields_map[flutter::EncodableValue("serviceCode")] = flutter::EncodableValue(fields.service_code.str());
+    fields_map[flutter::EncodableValue("discretionaryData")] = flutter::EncodableValue(fields.discretionary_data.str());
+    fields_map[flutter::EncodableValue("additionalData")] = flutter::EncodableValue(fields.additional_data.str());
+    track_fields.push_back(flutter::EncodableValue(std::move(fields_map)));
+  }
+  event_map[flutter::EncodableValue("trackFields")] = flutter::EncodableValue(std::move(track_fields));
+  event_map[flutter::EncodableValue("validation")] =
+      flutter::EncodableValue(TrackDecoder::ValidationName(card_data.validation));
+
+  // A MagneSafe swipe's encrypted fields, for decryption off the device
+  if (card_data.encrypted) {
+    const MagneSafeReport& report = card_data.magnesafe;
+    flutter::EncodableMap encrypted;
+    encrypted[flutter::EncodableValue("ksn")] = EncodeBytes(report.ksn);
+    encrypted[flutter::EncodableValue("deviceSerial")] = flutter::EncodableValue(
+        std::string(report.device_serial.chars(), report.device_serial.size()));
+    flutter::EncodableList encrypted_tracks;
+    for (const auto& track : report.tracks) {
+      encrypted_tracks.push_back(EncodeBytes(track.encrypted));
+    }
+    encrypted[flutter::EncodableValue("encryptedTracks")] = flutter::EncodableValue(std::move(encrypted_tracks));
+    encrypted[flutter::EncodableValue("magnePrint")] = EncodeBytes(report.magneprint);
+    encrypted[flutter::EncodableValue("magnePrintStatus")] =
+        flutter::EncodableValue(static_cast<int64_t>(report.magneprint_status));
+    encrypted[flutter::EncodableValue("encryptionStatus")] =
+        flutter::EncodableValue(static_cast<int32_t>(report.encryption_status));
+    encrypted[flutter::EncodableValue("sessionId")] = EncodeBytes(report.encrypted_session_id);
+    encrypted[flutter::EncodableValue("decrypted")] = flutter::EncodableValue(card_data.decrypted);
+    event_map[flutter::EncodableValue("encrypted")] = flutter::EncodableValue(std::move(encrypted));
+  }
+
+  DeliverCardSwipeEvent(flutter::EncodableValue(std::move(event_map)));
+}
+
+void MagtekCardReaderPlugin::DeliverCardSwipeEvent(flutter::EncodableValue event) {
+  if (!batch_swipes_) {
+    card_swipe_event_sink_->Success(event);
+    return;
+  }
+
+  pending_swipes_.push_back(std::move(event));
+  if (pending_swipes_.size() >= batch_max_events_) {
+    FlushSwipeBatch();
+  } else if (!batch_timer_armed_ && drain_window_) {
+    // The window runs from the first event of the batch
+    SetTimer(drain_window_, reinterpret_cast<UINT_PTR>(this), batch_window_ms_, nullptr);
+    batch_timer_armed_ = true;
+  }
+}
+
+void MagtekCardReaderPlugin::FlushSwipeBatch() {
+  if (batch_timer_armed_) {
+    KillTimer(drain_window_, reinterpret_cast<UINT_PTR>(this));
+    batch_timer_armed_ = false;
+  }
+  if (pending_swipes_.empty()) {
+    return;
+  }
+
+  flutter::EncodableList batch;
+  batch.swap(pending_swipes_);
+  if (card_swipe_event_sink_) {
+    card_swipe_event_sink_->Success(flutter::EncodableValue(std::move(batch)));
+  }
+}
+
+bool MagtekCardReaderPlugin::ApplySwipeBatching(const flutter::EncodableValue* value) {
+  if (!value || value->IsNull()) {
+    FlushSwipeBatch();
+    batch_swipes_ = false;
+    return true;
+  }
+
+  const auto* options = std::get_if<flutter::EncodableMap>(value);
+  if (!options) {
+    return false;
+  }
+
+  auto lookup = [options](const char* key) -> const flutter::EncodableValue* {
+    auto it = options->find(flutter::EncodableValue(key));
+    return it == options->end() ? nullptr : &it->second;
+  };
+  const auto* window = lookup("windowMs");
+  const auto* max_events = lookup("maxEvents");
+  const auto* low_latency = lookup("lowLatency");
+  const int32_t* window_ms = window ? std::get_if<int32_t>(window) : nullptr;
+  const int32_t* max_count = max_events ? std::get_if<int32_t>(max_events) : nullptr;
+  const bool* low_latency_flag = low_latency ? std::get_if<bool>(low_latency) : nullptr;
+  if (!window_ms || *window_ms < 1 || !max_count || *max_count < 1 || !low_latency_flag) {
+    return false;
+  }
+
+  // Anything gathered under the old settings goes out first
+  FlushSwipeBatch();
+  batch_swipes_ = true;
+  batch_window_ms_ = static_cast<UINT>(*window_ms);
+  batch_max_events_ = static_cast<size_t>(*max_count);
+  batch_low_latency_ = *low_latency_flag;
+  return true;
 }
 
-void MagtekCardReaderPlugin::SendDeviceEvent(const DeviceInfo& device_info) {
+void MagtekCardReaderPlugin::SendDeviceEvent(DeviceEventType type,
+                                             const DeviceInfo& device_info) {
   if (!device_event_sink_) {
     return;
   }
@@ -288,7 +1175,8 @@ void MagtekCardReaderPlugin::SendDeviceEvent(const DeviceInfo& device_info) {
   device_map[flutter::EncodableValue("isConnected")] = flutter::EncodableValue(device_info.is_connected);
 
   flutter::EncodableMap event_map;
-  event_map[flutter::EncodableValue("type")] = flutter::EncodableValue("device_connected");
+  event_map[flutter::EncodableValue("type")] = flutter::EncodableValue(
+      type == DeviceEventType::kConnected ? "device_connected" : "device_disconnected");
   event_map[flutter::EncodableValue("device")] = flutter::EncodableValue(device_map);
 
   device_event_sink_->Success(flutter::EncodableValue(event_map));
@@ -3,14 +3,23 @@
 
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
+#include <flutter/encodable_value.h>
 #include <flutter/event_sink.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
 
 // Forward declarations
 class WindowsUsbDeviceManager;
+class SerialExecutor;
 struct DeviceInfo;
 struct CardData;
+enum class DeviceEventType;
 
 namespace magtek_card_reader {
 
@@ -20,6 +29,8 @@ class MagtekCardReaderPlugin : public flutter::Plugin {
 
   MagtekCardReaderPlugin();
 
+  explicit MagtekCardReaderPlugin(flutter::PluginRegistrarWindows *registrar);
+
   virtual ~MagtekCardReaderPlugin();
 
   // Disallow copy and assign.
@@ -36,22 +47,132 @@ class MagtekCardReaderPlugin : public flutter::Plugin {
   void SetDeviceEventSink(std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> events);
 
  private:
+  // Completes a method call; built off the platform thread, run on it
+  using Completion = std::function<void(flutter::MethodResult<flutter::EncodableValue>*)>;
+
+  // Runs work on the control executor and completes result on the platform
+  // thread with the Completion it returns, so a slow reader never stalls a
+  // frame. Without a window to post back to, work runs inline.
+  void RespondFromExecutor(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+                           std::function<Completion()> work);
+
+  // Queues a task and posts a message so it runs, in order, from the
+  // window procedure; callable from any thread
+  void RunOnPlatformThread(std::function<void()> task);
+
+  // Runs every queued platform task; platform thread only
+  void DrainPlatformTasks();
+
   // Method handlers
-  void HandleInitialize(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleInitialize(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                        std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   void HandleDispose(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   void HandleGetConnectedDevices(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   void HandleConnectToDevice(const flutter::MethodCall<flutter::EncodableValue> &method_call,
                             std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleOpenDevice(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                        std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleCloseDevice(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                         std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   void HandleDisconnect(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Returns the "deviceId" argument, or reports an error on result and
+  // returns nullptr if it is missing
+  const std::string* GetDeviceIdArgument(
+      const flutter::MethodCall<flutter::EncodableValue> &method_call,
+      flutter::MethodResult<flutter::EncodableValue>* result);
   void HandleIsConnected(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleSetRawResponseMode(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                                std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleGetStats(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleGetMetrics(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleSetLogLevel(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                         std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleSetTracing(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                        std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleSetAppLifecycleState(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                                  std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleSendCommand(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                         std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleStartCapture(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                          std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleStopCapture(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                         std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Starts or stops the read threads on the control executor, behind the
+  // calls already made, to match whether anyone can take a swipe
+  void UpdateMonitoring();
 
   // Event senders
   void SendCardSwipeEvent(const CardData& card_data);
-  void SendDeviceEvent(const DeviceInfo& device_info);
+  void SendDeviceEvent(DeviceEventType type, const DeviceInfo& device_info);
+
+  // Called from the hotplug, read or platform thread; queues the event
+  // and posts a message so it is sent, in order, from the window procedure
+  void ScheduleDeviceEvent(DeviceEventType type, DeviceInfo&& device_info);
+
+  // Sends every queued device event; platform thread only
+  void DrainDeviceEvents();
+
+  // Called on a read thread after it queues a swipe; posts a drain message
+  // to the top-level window so events are sent on the platform thread
+  void ScheduleSwipeDrain();
+
+  // Top-level window procedure delegate that handles the drain messages
+  std::optional<LRESULT> HandleWindowProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
 
   std::unique_ptr<WindowsUsbDeviceManager> device_manager_;
+  // Runs the device manager calls that can block (bus scans, device opens,
+  // read thread joins) off the platform thread, in the order they were made
+  std::unique_ptr<SerialExecutor> control_executor_;
   std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> card_swipe_event_sink_;
   std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> device_event_sink_;
+
+  flutter::PluginRegistrarWindows* registrar_;
+  int window_proc_id_;
+  UINT drain_swipes_message_;
+  HWND drain_window_;
+  std::atomic<bool> swipe_drain_scheduled_;
+
+  // Send swipes as packed records (packed_swipe_codec.h) instead of maps
+  bool packed_swipe_events_;
+
+  // Queue a swipe event for the current batch, or send it if not batching
+  void DeliverCardSwipeEvent(flutter::EncodableValue event);
+
+  // Send the pending batch, if any, as a single list event
+  void FlushSwipeBatch();
+
+  // Applies the "swipeBatching" option; false if it is malformed
+  bool ApplySwipeBatching(const flutter::EncodableValue* value);
+
+  // Swipe batching: events are gathered into pending_swipes_ and sent as
+  // one list once batch_max_events_ are queued, the window timer fires, or,
+  // with batch_low_latency_, a drain pass leaves the read queues empty
+  bool batch_swipes_;
+  UINT batch_window_ms_;
+  size_t batch_max_events_;
+  bool batch_low_latency_;
+  flutter::EncodableList pending_swipes_;
+  bool batch_timer_armed_;
+
+  // The read threads run only once initialized, while Dart listens for
+  // swipes and the app isn't in the background; monitoring_ is the state
+  // last asked of the manager
+  bool initialized_;
+  bool card_swipe_listening_;
+  bool app_active_;
+  bool monitoring_;
+
+  struct PendingDeviceEvent;
+  UINT device_events_message_;
+  std::mutex device_events_mutex_;
+  std::vector<PendingDeviceEvent> pending_device_events_;
+
+  UINT platform_tasks_message_;
+  std::mutex platform_tasks_mutex_;
+  std::vector<std::function<void()>> pending_platform_tasks_;
 };
 
 }  // namespace magtek_card_reader
@@ -2,6 +2,7 @@
 
 #include <flutter/plugin_registrar_windows.h>
 
+#include "device_manager_core.h"
 #include "magtek_card_reader_plugin.h"
 
 void MagtekCardReaderPluginCApiRegisterWithRegistrar(
@@ -10,3 +11,7 @@ void MagtekCardReaderPluginCApiRegisterWithRegistrar(
       flutter::PluginRegistrarManager::GetInstance()
           ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar));
 }
+
+void MagtekCardReaderPluginCApiSetTrackDecryptor(MagtekTrackDecryptFunc func, void* user_data) {
+  DeviceManagerCore::SetTrackDecryptFunction(func, user_data);
+}
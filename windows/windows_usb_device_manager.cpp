@@ -1,348 +1,246 @@
 #include "windows_usb_device_manager.h"
-#include <chrono>
-#include <iostream>
 #include <sstream>
-#include <iomanip>
-#include <locale>
-#include <codecvt>
+#include <cwchar>
+#include <cwctype>
 
-// Known Magtek product IDs
-const std::vector<unsigned short> WindowsUsbDeviceManager::MAGTEK_PRODUCT_IDS = {
-    0x0001, // Magtek Mini Swipe Reader
-    0x0002, // Magtek USB Swipe Reader
-    0x0003, // Magtek eDynamo
-    0x0004, // Magtek uDynamo
-    0x0010, // Magtek SureSwipe Reader
+#include "logger.h"
+
+// GUID_DEVINTERFACE_HID, defined locally to avoid linking hid.lib for it
+static const GUID HID_INTERFACE_GUID =
+    {0x4D1E55B2, 0xF16F, 0x11CF, {0x88, 0xCB, 0x00, 0x11, 0x11, 0x00, 0x00, 0x30}};
+
+namespace {
+
+// Longest serial number read back from an open reader, in characters
+const size_t SERIAL_NUMBER_MAX_LENGTH = 128;
+
+std::string WideToUtf8(const wchar_t* wide, int length) {
+    if (length == 0) {
+        return std::string();
+    }
+    
+    int size_needed = WideCharToMultiByte(CP_UTF8, 0, wide, length, NULL, 0, NULL, NULL);
+    std::string utf8_string(size_needed, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wide, length, &utf8_string[0], size_needed, NULL, NULL);
+    return utf8_string;
+}
+
+// A reader opened through HIDAPI
+class HidapiConnection : public HidConnection {
+public:
+    explicit HidapiConnection(hid_device* handle) : handle_(handle) {}
+    
+    ~HidapiConnection() override {
+        hid_close(handle_);
+    }
+    
+    int ReadReport(unsigned char* buffer, size_t size, int timeout_ms) override {
+        // hid_read_timeout blocks on HIDAPI's own completion event
+        return hid_read_timeout(handle_, buffer, size, timeout_ms);
+    }
+
+    int SendFeatureReport(const unsigned char* data, size_t length) override {
+        return hid_send_feature_report(handle_, data, length);
+    }
+
+    int GetFeatureReport(unsigned char* buffer, size_t size) override {
+        return hid_get_feature_report(handle_, buffer, size);
+    }
+    
+    std::string LastError() override {
+        const wchar_t* error = hid_error(handle_);
+        if (!error) {
+            return std::string();
+        }
+        std::wstring wide_error(error);
+        return WideToUtf8(wide_error.data(), static_cast<int>(wide_error.size()));
+    }
+
+    std::string SerialNumber() override {
+        wchar_t serial_number[SERIAL_NUMBER_MAX_LENGTH + 1];
+        if (hid_get_serial_number_string(handle_, serial_number, SERIAL_NUMBER_MAX_LENGTH + 1) != 0) {
+            return std::string();
+        }
+        serial_number[SERIAL_NUMBER_MAX_LENGTH] = L'\0';
+        return WideToUtf8(serial_number, static_cast<int>(wcslen(serial_number)));
+    }
+
+private:
+    hid_device* handle_;
 };
 
+}  // namespace
+
 WindowsUsbDeviceManager::WindowsUsbDeviceManager() 
-    : current_device_(nullptr), is_monitoring_(false) {
+    : hotplug_active_(false), hotplug_notification_(nullptr), hotplug_pending_(false) {
 }
 
 WindowsUsbDeviceManager::~WindowsUsbDeviceManager() {
     Cleanup();
 }
 
-bool WindowsUsbDeviceManager::Initialize() {
-    // Initialize HIDAPI
-    if (hid_init() != 0) {
-        std::cerr << "Failed to initialize HIDAPI" << std::endl;
-        return false;
-    }
-    return true;
+bool WindowsUsbDeviceManager::InitializeHid() {
+    return hid_init() == 0;
 }
 
-void WindowsUsbDeviceManager::Cleanup() {
-    StopMonitoring();
-    Disconnect();
+void WindowsUsbDeviceManager::ShutdownHid() {
     hid_exit();
 }
 
-std::vector<DeviceInfo> WindowsUsbDeviceManager::GetConnectedDevices() {
-    std::vector<DeviceInfo> devices;
-    
-    struct hid_device_info* device_info = hid_enumerate(0, 0);
-    struct hid_device_info* current = device_info;
-    
-    while (current != nullptr) {
-        if (IsMagtekDevice(current->vendor_id, current->product_id)) {
-            DeviceInfo info;
-            
-            // Generate unique device ID
-            std::stringstream ss;
-            ss << std::hex << current->vendor_id << ":" << current->product_id << ":";
-            if (current->serial_number) {
-                // Convert wide string to regular string
-                info.serial_number = WideStringToUtf8(std::wstring(current->serial_number));
-                ss << info.serial_number;
-            } else {
-                ss << current->path;
-            }
-            info.device_id = ss.str();
-            
-            info.device_name = GetDeviceName(current->vendor_id, current->product_id);
-            info.vendor_id = current->vendor_id;
-            info.product_id = current->product_id;
-            info.device_path = current->path ? current->path : "";
-            
-            info.is_connected = (current_device_ != nullptr && current_device_id_ == info.device_id);
-            
-            devices.push_back(info);
-        }
-        current = current->next;
+std::string WindowsUsbDeviceManager::MakeDeviceId(const struct hid_device_info* device) {
+    // Generate unique device ID
+    std::stringstream ss;
+    ss << std::hex << device->vendor_id << ":" << device->product_id << ":";
+    if (device->serial_number) {
+        ss << WideStringToUtf8(std::wstring(device->serial_number));
+    } else {
+        ss << device->path;
     }
-    
-    hid_free_enumeration(device_info);
-    return devices;
+    return ss.str();
 }
 
-bool WindowsUsbDeviceManager::ConnectToDevice(const std::string& device_id) {
-    std::lock_guard<std::mutex> lock(device_mutex_);
+DeviceInfo WindowsUsbDeviceManager::MakeDeviceInfo(const struct hid_device_info* device) {
+    DeviceInfo info;
+    info.device_id = MakeDeviceId(device);
+    info.device_name = GetDeviceName(device->vendor_id, device->product_id);
+    info.vendor_id = device->vendor_id;
+    info.product_id = device->product_id;
+    info.device_path = device->path ? device->path : "";
     
-    // Disconnect from current device first
-    if (current_device_) {
-        hid_close(current_device_);
-        current_device_ = nullptr;
-        current_device_id_.clear();
+    if (device->serial_number) {
+        info.serial_number = WideStringToUtf8(std::wstring(device->serial_number));
     }
     
-    // Find the device in the enumeration
-    struct hid_device_info* device_info = hid_enumerate(0, 0);
+    info.is_connected = false;
+    return info;
+}
+
+std::vector<DeviceInfo> WindowsUsbDeviceManager::EnumerateDevices() {
+    std::vector<DeviceInfo> devices;
+    
+    struct hid_device_info* device_info = hid_enumerate(MAGTEK_VENDOR_ID, 0);
     struct hid_device_info* current = device_info;
-    std::string target_path;
     
     while (current != nullptr) {
         if (IsMagtekDevice(current->vendor_id, current->product_id)) {
-            // Generate device ID for comparison
-            std::stringstream ss;
-            ss << std::hex << current->vendor_id << ":" << current->product_id << ":";
-            if (current->serial_number) {
-                std::string serial = WideStringToUtf8(std::wstring(current->serial_number));
-                ss << serial;
-            } else {
-                ss << current->path;
-            }
-            
-            if (ss.str() == device_id) {
-                target_path = current->path;
-                break;
-            }
+            devices.push_back(MakeDeviceInfo(current));
         }
         current = current->next;
     }
     
     hid_free_enumeration(device_info);
-    
-    if (target_path.empty()) {
-        std::cerr << "Device not found: " << device_id << std::endl;
-        return false;
-    }
-    
-    // Open the device
-    current_device_ = hid_open_path(target_path.c_str());
-    if (!current_device_) {
-        std::cerr << "Failed to open device: " << target_path << std::endl;
-        return false;
-    }
-    
-    current_device_id_ = device_id;
-    
-    // Set non-blocking mode
-    hid_set_nonblocking(current_device_, 1);
-    
-    // Notify about device connection
-    if (device_connection_callback_) {
-        auto devices = GetConnectedDevices();
-        for (const auto& device : devices) {
-            if (device.device_id == device_id) {
-                device_connection_callback_(device);
-                break;
-            }
-        }
-    }
-    
-    std::cout << "Connected to device: " << device_id << std::endl;
-    return true;
-}
-
-void WindowsUsbDeviceManager::Disconnect() {
-    std::lock_guard<std::mutex> lock(device_mutex_);
-    
-    if (current_device_) {
-        hid_close(current_device_);
-        current_device_ = nullptr;
-        current_device_id_.clear();
-        std::cout << "Disconnected from device" << std::endl;
-    }
-}
-
-bool WindowsUsbDeviceManager::IsConnected() const {
-    std::lock_guard<std::mutex> lock(device_mutex_);
-    return current_device_ != nullptr;
+    return devices;
 }
 
-void WindowsUsbDeviceManager::StartMonitoring() {
-    if (is_monitoring_.load()) {
-        return;
+std::unique_ptr<HidConnection> WindowsUsbDeviceManager::OpenConnection(const DeviceInfo& info) {
+    hid_device* handle = hid_open_path(info.device_path.c_str());
+    if (!handle) {
+        return nullptr;
     }
     
-    is_monitoring_ = true;
-    monitoring_thread_ = std::thread(&WindowsUsbDeviceManager::MonitoringThread, this);
-    std::cout << "Started device monitoring" << std::endl;
+    // Set non-blocking mode
+    hid_set_nonblocking(handle, 1);
+    return std::unique_ptr<HidConnection>(new HidapiConnection(handle));
 }
 
-void WindowsUsbDeviceManager::StopMonitoring() {
-    if (!is_monitoring_.load()) {
+void WindowsUsbDeviceManager::StartHotplugMonitor() {
+    if (hotplug_active_.load()) {
         return;
     }
     
-    is_monitoring_ = false;
-    if (monitoring_thread_.joinable()) {
-        monitoring_thread_.join();
+    hotplug_pending_ = false;
+    hotplug_active_ = true;
+    hotplug_thread_ = std::thread(&WindowsUsbDeviceManager::HotplugThread, this);
+    
+    CM_NOTIFY_FILTER filter = {};
+    filter.cbSize = sizeof(filter);
+    filter.FilterType = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+    filter.u.DeviceInterface.ClassGuid = HID_INTERFACE_GUID;
+    
+    CONFIGRET cr = CM_Register_Notification(&filter, this, &WindowsUsbDeviceManager::HotplugCallback,
+                                            &hotplug_notification_);
+    if (cr != CR_SUCCESS) {
+        MAGTEK_LOG(LogLevel::kWarning, "Failed to register for device notifications, rescanning on demand");
+        hotplug_notification_ = nullptr;
+        StopHotplugMonitor();
     }
-    std::cout << "Stopped device monitoring" << std::endl;
 }
 
-void WindowsUsbDeviceManager::SetCardSwipeCallback(std::function<void(const CardData&)> callback) {
-    card_swipe_callback_ = callback;
-}
-
-void WindowsUsbDeviceManager::SetDeviceConnectionCallback(std::function<void(const DeviceInfo&)> callback) {
-    device_connection_callback_ = callback;
-}
-
-bool WindowsUsbDeviceManager::IsMagtekDevice(unsigned short vendor_id, unsigned short product_id) {
-    if (vendor_id != MAGTEK_VENDOR_ID) {
-        return false;
+void WindowsUsbDeviceManager::StopHotplugMonitor() {
+    if (!hotplug_active_.load()) {
+        return;
     }
     
-    for (unsigned short pid : MAGTEK_PRODUCT_IDS) {
-        if (product_id == pid) {
-            return true;
-        }
+    // Blocks until any callback in progress has returned
+    if (hotplug_notification_) {
+        CM_Unregister_Notification(hotplug_notification_);
+        hotplug_notification_ = nullptr;
     }
     
-    return false;
-}
-
-std::string WindowsUsbDeviceManager::GetDeviceName(unsigned short vendor_id, unsigned short product_id) {
-    if (vendor_id != MAGTEK_VENDOR_ID) {
-        return "Unknown Device";
+    {
+        std::lock_guard<std::mutex> lock(hotplug_mutex_);
+        hotplug_active_ = false;
     }
-    
-    switch (product_id) {
-        case 0x0001:
-            return "Magtek Mini Swipe Reader";
-        case 0x0002:
-            return "Magtek USB Swipe Reader";
-        case 0x0003:
-            return "Magtek eDynamo";
-        case 0x0004:
-            return "Magtek uDynamo";
-        case 0x0010:
-            return "Magtek SureSwipe Reader";
-        default:
-            std::stringstream ss;
-            ss << "Magtek Card Reader (PID: 0x" << std::hex << std::setfill('0') << std::setw(4) << product_id << ")";
-            return ss.str();
+    hotplug_cv_.notify_all();
+    if (hotplug_thread_.joinable()) {
+        hotplug_thread_.join();
     }
 }
 
-void WindowsUsbDeviceManager::MonitoringThread() {
-    const int SLEEP_INTERVAL_MS = 50; // Check every 50ms
+void WindowsUsbDeviceManager::HotplugThread() {
+    std::unique_lock<std::mutex> lock(hotplug_mutex_);
     
-    while (is_monitoring_.load()) {
-        if (IsConnected()) {
-            ReadFromDevice();
+    while (true) {
+        hotplug_cv_.wait(lock, [this] {
+            return hotplug_pending_ || !hotplug_active_.load();
+        });
+        if (!hotplug_active_.load()) {
+            return;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP_INTERVAL_MS));
-    }
-}
-
-bool WindowsUsbDeviceManager::ReadFromDevice() {
-    if (!current_device_) {
-        return false;
-    }
-    
-    unsigned char buffer[256];
-    int bytes_read = hid_read_timeout(current_device_, buffer, sizeof(buffer), 10); // 10ms timeout
-    
-    if (bytes_read > 0) {
-        // Parse the input report and extract card data
-        CardData card_data = ParseInputReport(buffer, bytes_read, current_device_id_);
+        hotplug_pending_ = false;
         
-        // Only notify if we have valid track data
-        if (!card_data.track1.empty() || !card_data.track2.empty() || !card_data.track3.empty()) {
-            if (card_swipe_callback_) {
-                card_swipe_callback_(card_data);
-            }
-            std::cout << "Card swipe detected" << std::endl;
-        }
-        return true;
-    } else if (bytes_read < 0) {
-        // Error occurred
-        const wchar_t* error_wide = hid_error(current_device_);
-        if (error_wide) {
-            std::string error_str = WideStringToUtf8(std::wstring(error_wide));
-            std::cerr << "Error reading from device: " << error_str << std::endl;
-        }
-        return false;
+        // Rescan outside the lock so further notifications aren't held up;
+        // a burst of them for one device collapses into a single rescan
+        lock.unlock();
+        RefreshDeviceCache(true);
+        lock.lock();
     }
-    
-    // No data available (bytes_read == 0)
-    return true;
 }
 
-CardData WindowsUsbDeviceManager::ParseInputReport(const unsigned char* data, size_t length, const std::string& device_id) {
-    CardData card_data;
-    card_data.device_id = device_id;
-    card_data.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    
-    // Store raw response for debugging
-    std::stringstream raw_ss;
-    for (size_t i = 0; i < length; i++) {
-        raw_ss << std::hex << std::setfill('0') << std::setw(2) << (int)data[i] << " ";
+DWORD CALLBACK WindowsUsbDeviceManager::HotplugCallback(HCMNOTIFICATION notification, PVOID context,
+                                                        CM_NOTIFY_ACTION action,
+                                                        PCM_NOTIFY_EVENT_DATA event_data,
+                                                        DWORD event_data_size) {
+    if (action != CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL &&
+        action != CM_NOTIFY_ACTION_DEVICEINTERFACEREMOVAL) {
+        return ERROR_SUCCESS;
     }
-    card_data.raw_response = raw_ss.str();
-    
-    // Magtek devices typically send card data in a specific format
-    // The exact format may vary by device model, but generally:
-    // - Byte 0: Report ID or status
-    // - Following bytes: Track data or encoded magnetic stripe data
     
-    if (length < 2) {
-        return card_data; // Not enough data
+    // Ignore interfaces from other vendors; the symbolic link embeds VID_xxxx
+    std::wstring link(event_data->u.DeviceInterface.SymbolicLink);
+    for (auto& c : link) {
+        c = towupper(c);
     }
-    
-    // Look for track data patterns in the input report
-    // Track 1: Starts with '%' (0x25), ends with '?' (0x3F)
-    // Track 2: Starts with ';' (0x3B), ends with '?' (0x3F)
-    // Track 3: Variable format
-    
-    std::string data_str;
-    for (size_t i = 1; i < length; i++) { // Skip first byte (report ID)
-        if (data[i] >= 0x20 && data[i] <= 0x7E) { // Printable ASCII
-            data_str += (char)data[i];
-        }
+    if (link.find(L"VID_0801") == std::wstring::npos) {
+        return ERROR_SUCCESS;
     }
     
-    if (data_str.empty()) {
-        return card_data;
-    }
-    
-    // Parse track data from the string
-    size_t track1_start = data_str.find('%');
-    if (track1_start != std::string::npos) {
-        size_t track1_end = data_str.find('?', track1_start);
-        if (track1_end != std::string::npos) {
-            card_data.track1 = data_str.substr(track1_start, track1_end - track1_start + 1);
-        }
+    // Runs on a system thread pool thread; hand the rescan to HotplugThread
+    WindowsUsbDeviceManager* self = static_cast<WindowsUsbDeviceManager*>(context);
+    {
+        std::lock_guard<std::mutex> lock(self->hotplug_mutex_);
+        self->hotplug_pending_ = true;
     }
-    
-    size_t track2_start = data_str.find(';');
-    if (track2_start != std::string::npos) {
-        size_t track2_end = data_str.find('?', track2_start);
-        if (track2_end != std::string::npos) {
-            card_data.track2 = data_str.substr(track2_start, track2_end - track2_start + 1);
-        }
-    }
-    
-    // Track 3 parsing is more complex and device-dependent
-    // For now, we'll leave it empty unless we find a specific pattern
-    
-    return card_data;
+    self->hotplug_cv_.notify_all();
+    return ERROR_SUCCESS;
+}
+
+bool WindowsUsbDeviceManager::IsHotplugActive() const {
+    return hotplug_active_.load();
 }
 
 std::string WindowsUsbDeviceManager::WideStringToUtf8(const std::wstring& wide_string) {
-    if (wide_string.empty()) {
-        return std::string();
-    }
-    
-    int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wide_string[0], (int)wide_string.size(), NULL, 0, NULL, NULL);
-    std::string utf8_string(size_needed, 0);
-    WideCharToMultiByte(CP_UTF8, 0, &wide_string[0], (int)wide_string.size(), &utf8_string[0], size_needed, NULL, NULL);
-    return utf8_string;
+    return WideToUtf8(wide_string.data(), static_cast<int>(wide_string.size()));
 }
 
 std::wstring WindowsUsbDeviceManager::Utf8ToWideString(const std::string& utf8_string) {
@@ -4,103 +4,63 @@
 #include <windows.h>
 #include <setupapi.h>
 #include <hidsdi.h>
+#include <cfgmgr32.h>
 #include <hidapi.h>
 #include <vector>
 #include <string>
 #include <memory>
-#include <functional>
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
 
-struct DeviceInfo {
-    std::string device_id;
-    std::string device_name;
-    unsigned short vendor_id;
-    unsigned short product_id;
-    std::string serial_number;
-    std::string device_path;
-    bool is_connected;
-};
-
-struct CardData {
-    std::string track1;
-    std::string track2;
-    std::string track3;
-    std::string device_id;
-    std::string raw_response;
-    long long timestamp;
-};
+#include "device_manager_core.h"
 
-class WindowsUsbDeviceManager {
+// Windows adapter for DeviceManagerCore: HIDAPI for device access and
+// CM_Register_Notification for HID interface arrival/removal
+class WindowsUsbDeviceManager : public DeviceManagerCore {
 public:
     WindowsUsbDeviceManager();
     ~WindowsUsbDeviceManager();
 
-    // Initialize the USB device manager
-    bool Initialize();
-    
-    // Cleanup resources
-    void Cleanup();
-    
-    // Get list of connected Magtek devices
-    std::vector<DeviceInfo> GetConnectedDevices();
-    
-    // Connect to a specific device
-    bool ConnectToDevice(const std::string& device_id);
-    
-    // Disconnect from current device
-    void Disconnect();
-    
-    // Check if connected to a device
-    bool IsConnected() const;
-    
-    // Start monitoring for card swipes
-    void StartMonitoring();
-    
-    // Stop monitoring
-    void StopMonitoring();
-    
-    // Set callback for card swipe events
-    void SetCardSwipeCallback(std::function<void(const CardData&)> callback);
-    
-    // Set callback for device connection events
-    void SetDeviceConnectionCallback(std::function<void(const DeviceInfo&)> callback);
+protected:
+    bool InitializeHid() override;
+    void ShutdownHid() override;
+    std::vector<DeviceInfo> EnumerateDevices() override;
+    std::unique_ptr<HidConnection> OpenConnection(const DeviceInfo& info) override;
+    void StartHotplugMonitor() override;
+    void StopHotplugMonitor() override;
+    bool IsHotplugActive() const override;
 
 private:
-    // Check if vendor/product ID is a Magtek device
-    bool IsMagtekDevice(unsigned short vendor_id, unsigned short product_id);
+    // Build a device ID from an enumeration entry
+    std::string MakeDeviceId(const struct hid_device_info* device);
     
-    // Get device name from vendor/product ID
-    std::string GetDeviceName(unsigned short vendor_id, unsigned short product_id);
+    // Build device details from an enumeration entry
+    DeviceInfo MakeDeviceInfo(const struct hid_device_info* device);
     
-    // Parse HID input report from device
-    CardData ParseInputReport(const unsigned char* data, size_t length, const std::string& device_id);
+    // Rescans the device cache whenever a hotplug notification arrives
+    void HotplugThread();
     
-    // Device monitoring thread function
-    void MonitoringThread();
-    
-    // Read data from HID device
-    bool ReadFromDevice();
+    // CM_Register_Notification callback for HID interface arrival/removal
+    static DWORD CALLBACK HotplugCallback(HCMNOTIFICATION notification, PVOID context,
+                                          CM_NOTIFY_ACTION action,
+                                          PCM_NOTIFY_EVENT_DATA event_data,
+                                          DWORD event_data_size);
     
     // Convert wide string to UTF-8 string
-    std::string WideStringToUtf8(const std::wstring& wide_string);
+    static std::string WideStringToUtf8(const std::wstring& wide_string);
     
     // Convert UTF-8 string to wide string
-    std::wstring Utf8ToWideString(const std::string& utf8_string);
-
-    hid_device* current_device_;
-    std::string current_device_id_;
-    std::atomic<bool> is_monitoring_;
-    std::thread monitoring_thread_;
-    mutable std::mutex device_mutex_;
-    
-    std::function<void(const CardData&)> card_swipe_callback_;
-    std::function<void(const DeviceInfo&)> device_connection_callback_;
-    
-    // Magtek vendor IDs and product IDs
-    static const unsigned short MAGTEK_VENDOR_ID = 0x0801;
-    static const std::vector<unsigned short> MAGTEK_PRODUCT_IDS;
+    static std::wstring Utf8ToWideString(const std::string& utf8_string);
+    
+    // Hotplug notification state
+    std::atomic<bool> hotplug_active_;
+    std::thread hotplug_thread_;
+    HCMNOTIFICATION hotplug_notification_;
+    bool hotplug_pending_;
+    std::mutex hotplug_mutex_;
+    std::condition_variable hotplug_cv_;
 };
 
 #endif  // WINDOWS_USB_DEVICE_MANAGER_H_